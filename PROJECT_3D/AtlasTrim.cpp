@@ -0,0 +1,298 @@
+#include "AtlasTrim.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+	struct tile_rect_t {
+		int32_t x0, y0, x1, y1;     // tiles, x1 and y1 exclusive
+
+		int64_t Area() const { return int64_t(x1 - x0) * (y1 - y0); }
+	};
+
+	tile_rect_t Union(const tile_rect_t& a, const tile_rect_t& b) {
+		return { (std::min)(a.x0, b.x0), (std::min)(a.y0, b.y0), (std::max)(a.x1, b.x1), (std::max)(a.y1, b.y1) };
+	}
+
+	int32_t Wrap(int64_t value, uint32_t size) {
+		int64_t const wrapped = value % size;
+		return static_cast<int32_t>(wrapped < 0 ? wrapped + size : wrapped);
+	}
+
+	// Marks every texel whose square overlaps the triangle: each edge
+	// function is pushed outwards by the texel's half extent along the edge
+	// normal, which turns every edge into a bound on the texel column, so a
+	// row of the triangle is one span.
+	size_t RasterizeTriangle(const double x[3], const double y[3], uint32_t width, uint32_t height, std::vector<uint8_t>& used) {
+		int32_t const tx0 = std::clamp(static_cast<int32_t>(std::floor((std::min)({ x[0], x[1], x[2] }))), 0, int32_t(width) - 1);
+		int32_t const ty0 = std::clamp(static_cast<int32_t>(std::floor((std::min)({ y[0], y[1], y[2] }))), 0, int32_t(height) - 1);
+		int32_t const tx1 = std::clamp(static_cast<int32_t>(std::ceil((std::max)({ x[0], x[1], x[2] }))) - 1, tx0, int32_t(width) - 1);
+		int32_t const ty1 = std::clamp(static_cast<int32_t>(std::ceil((std::max)({ y[0], y[1], y[2] }))) - 1, ty0, int32_t(height) - 1);
+		double const area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+		double const orientation = area < 0.0 ? -1.0 : 1.0;
+		// A triangle without area is a segment or point, whose box is all
+		// it can touch.
+		bool const degenerate = std::abs(area) < 1e-12;
+
+		size_t marked = 0;
+		for (int32_t ty = ty0; ty <= ty1; ++ty) {
+			double const cy = ty + 0.5;
+			double low = tx0, high = tx1;
+			for (int e = 0; e < 3 && !degenerate; ++e) {
+				// slope * column + offset >= 0 at the texel center.
+				int const n = (e + 1) % 3;
+				double const dx = x[n] - x[e], dy = y[n] - y[e];
+				double const slope = -orientation * dy;
+				double const offset = orientation * (dx * (cy - y[e]) + dy * (x[e] - 0.5)) + 0.5 * (std::abs(dx) + std::abs(dy)) + 1e-9;
+				if (slope > 0.0) {
+					low = (std::max)(low, std::ceil(-offset / slope));
+				}
+				else if (slope < 0.0) {
+					high = (std::min)(high, std::floor(-offset / slope));
+				}
+				else if (offset < 0.0) {
+					high = low - 1.0;
+				}
+			}
+			uint8_t* row = &used[size_t(ty) * width];
+			for (int32_t tx = static_cast<int32_t>(low); tx <= static_cast<int32_t>(high); ++tx) {
+				marked += row[tx] == 0;
+				row[tx] = 1;
+			}
+		}
+		return marked;
+	}
+
+	// Shelf packing, tallest first, at the width that gives the smallest
+	// and then the squarest atlas. Positions are in tiles.
+	void PackRects(const std::vector<tile_rect_t>& rects, std::vector<int32_t>& px, std::vector<int32_t>& py, int32_t& width, int32_t& height) {
+		std::vector<size_t> order(rects.size());
+		std::iota(order.begin(), order.end(), size_t(0));
+		std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+			int32_t const ha = rects[a].y1 - rects[a].y0, hb = rects[b].y1 - rects[b].y0;
+			return ha != hb ? ha > hb : rects[a].x1 - rects[a].x0 > rects[b].x1 - rects[b].x0;
+		});
+		int32_t widest = 0, total_width = 0;
+		for (const tile_rect_t& rect : rects) {
+			widest = (std::max)(widest, rect.x1 - rect.x0);
+			total_width += rect.x1 - rect.x0;
+		}
+
+		width = height = 0;
+		std::vector<int32_t> x(rects.size()), y(rects.size());
+		for (int32_t candidate = widest; candidate <= total_width; ++candidate) {
+			int32_t shelf_x = 0, shelf_y = 0, shelf_height = 0;
+			for (size_t i : order) {
+				int32_t const w = rects[i].x1 - rects[i].x0, h = rects[i].y1 - rects[i].y0;
+				if (shelf_x + w > candidate) {
+					shelf_y += shelf_height;
+					shelf_x = shelf_height = 0;
+				}
+				x[i] = shelf_x;
+				y[i] = shelf_y;
+				shelf_x += w;
+				shelf_height = (std::max)(shelf_height, h);
+			}
+			int32_t const packed_height = shelf_y + shelf_height;
+			int64_t const area = int64_t(candidate) * packed_height, best = int64_t(width) * height;
+			if (width == 0 || area < best ||
+				(area == best && (std::max)(candidate, packed_height) < (std::max)(width, height))) {
+				width = candidate;
+				height = packed_height;
+				px = x;
+				py = y;
+			}
+		}
+	}
+}
+
+atlas_trim_t PlanAtlasTrim(
+	const vertex_t* vertices, size_t count, uint32_t width, uint32_t height, const atlas_trim_config_t& config
+) {
+	uint32_t const tile = config.tile_size;
+	if (tile < 4 || (tile & (tile - 1)) != 0 || width == 0 || height == 0) {
+		throw std::runtime_error("Atlas trim: tile size must be a power of two of at least 4");
+	}
+	size_t const triangles = count / 3;
+	atlas_trim_t trim = {};
+	trim.source_width = width;
+	trim.source_height = height;
+	trim.triangle_regions.assign(triangles, 0);
+	trim.triangle_shifts.assign(triangles * 2, 0);
+
+	// Texels some triangle touches, and the tile under each triangle's
+	// centroid, which is inside it and so names its region later.
+	std::vector<uint8_t> used(size_t(width) * height, 0);
+	std::vector<size_t> centroid_tiles(triangles);
+	int32_t const tiles_x = static_cast<int32_t>((width + tile - 1) / tile);
+	int32_t const tiles_y = static_cast<int32_t>((height + tile - 1) / tile);
+	for (size_t t = 0; t < triangles; ++t) {
+		const vertex_t* v = vertices + t * 3;
+		double const min_u = (std::min)({ v[0].tex_coord[0], v[1].tex_coord[0], v[2].tex_coord[0] });
+		double const min_v = (std::min)({ v[0].tex_coord[1], v[1].tex_coord[1], v[2].tex_coord[1] });
+		// Whole periods render the same through a WRAP sampler.
+		int32_t const shift_u = static_cast<int32_t>(std::floor(min_u));
+		int32_t const shift_v = static_cast<int32_t>(std::floor(min_v));
+		trim.triangle_shifts[t * 2] = shift_u;
+		trim.triangle_shifts[t * 2 + 1] = shift_v;
+		double x[3], y[3];
+		for (int c = 0; c < 3; ++c) {
+			x[c] = (v[c].tex_coord[0] - shift_u) * width;
+			y[c] = (v[c].tex_coord[1] - shift_v) * height;
+			if (x[c] > width + 1e-3 || y[c] > height + 1e-3) {
+				throw std::runtime_error("Atlas trim: a triangle spans the texture seam");
+			}
+		}
+		trim.used_texels += RasterizeTriangle(x, y, width, height, used);
+		int32_t const cx = std::clamp(static_cast<int32_t>((x[0] + x[1] + x[2]) / 3.0), 0, int32_t(width) - 1);
+		int32_t const cy = std::clamp(static_cast<int32_t>((y[0] + y[1] + y[2]) / 3.0), 0, int32_t(height) - 1);
+		centroid_tiles[t] = size_t(cy / tile + 1) * (tiles_x + 2) + (cx / tile + 1);
+	}
+
+	// Tiles with used texels grown by one tile of padding, on a grid with a
+	// ring of tiles around the atlas for the padding past its edges.
+	int32_t const grid_x = tiles_x + 2, grid_y = tiles_y + 2;
+	std::vector<uint8_t> kept(size_t(grid_x) * grid_y, 0);
+	for (uint32_t ty = 0; ty < height; ++ty) {
+		for (uint32_t tx = 0; tx < width; ++tx) {
+			if (!used[size_t(ty) * width + tx]) {
+				continue;
+			}
+			int32_t const gx = static_cast<int32_t>(tx / tile) + 1, gy = static_cast<int32_t>(ty / tile) + 1;
+			for (int32_t dy = -1; dy <= 1; ++dy) {
+				for (int32_t dx = -1; dx <= 1; ++dx) {
+					kept[size_t(gy + dy) * grid_x + (gx + dx)] = 1;
+				}
+			}
+		}
+	}
+
+	// Each 8-connected group of kept tiles becomes a rectangle.
+	std::vector<int32_t> labels(kept.size(), -1);
+	std::vector<tile_rect_t> rects;
+	std::vector<size_t> stack;
+	for (size_t start = 0; start < kept.size(); ++start) {
+		if (!kept[start] || labels[start] >= 0) {
+			continue;
+		}
+		int32_t const label = static_cast<int32_t>(rects.size());
+		tile_rect_t rect = { grid_x, grid_y, 0, 0 };
+		labels[start] = label;
+		stack.push_back(start);
+		while (!stack.empty()) {
+			size_t const cell = stack.back();
+			stack.pop_back();
+			int32_t const gx = static_cast<int32_t>(cell % grid_x), gy = static_cast<int32_t>(cell / grid_x);
+			rect = Union(rect, { gx, gy, gx + 1, gy + 1 });
+			for (int32_t dy = -1; dy <= 1; ++dy) {
+				for (int32_t dx = -1; dx <= 1; ++dx) {
+					int32_t const nx = gx + dx, ny = gy + dy;
+					if (nx < 0 || ny < 0 || nx >= grid_x || ny >= grid_y) {
+						continue;
+					}
+					size_t const neighbor = size_t(ny) * grid_x + nx;
+					if (kept[neighbor] && labels[neighbor] < 0) {
+						labels[neighbor] = label;
+						stack.push_back(neighbor);
+					}
+				}
+			}
+		}
+		rects.push_back(rect);
+	}
+
+	// Rectangles that overlap become one where that copies no more texels
+	// than keeping both; a region copies everything inside its rectangle,
+	// so the merged one still serves the triangles of both.
+	std::vector<int32_t> merged_into(rects.size());
+	std::iota(merged_into.begin(), merged_into.end(), 0);
+	for (bool changed = true; changed;) {
+		changed = false;
+		for (size_t i = 0; i < rects.size(); ++i) {
+			for (size_t j = i + 1; j < rects.size() && merged_into[i] == int32_t(i); ++j) {
+				if (merged_into[j] != int32_t(j)) {
+					continue;
+				}
+				tile_rect_t const joined = Union(rects[i], rects[j]);
+				if (joined.Area() <= rects[i].Area() + rects[j].Area()) {
+					rects[i] = joined;
+					merged_into[j] = static_cast<int32_t>(i);
+					changed = true;
+				}
+			}
+		}
+	}
+	std::vector<int32_t> region_of(rects.size(), -1);
+	std::vector<tile_rect_t> regions;
+	for (size_t i = 0; i < rects.size(); ++i) {
+		if (merged_into[i] == int32_t(i)) {
+			region_of[i] = static_cast<int32_t>(regions.size());
+			regions.push_back(rects[i]);
+		}
+	}
+	for (size_t i = 0; i < rects.size(); ++i) {
+		size_t root = i;
+		while (merged_into[root] != int32_t(root)) {
+			root = merged_into[root];
+		}
+		region_of[i] = region_of[root];
+	}
+
+	std::vector<int32_t> px, py;
+	int32_t packed_x = 0, packed_y = 0;
+	PackRects(regions, px, py, packed_x, packed_y);
+	if (regions.empty() || uint64_t(packed_x) * packed_y * tile * tile >= uint64_t(width) * height) {
+		trim.width = width;
+		trim.height = height;
+		trim.regions = { { 0, 0, 0, 0, width, height } };
+		trim.kept_texels = size_t(width) * height;
+		return trim;
+	}
+
+	trim.width = static_cast<uint32_t>(packed_x) * tile;
+	trim.height = static_cast<uint32_t>(packed_y) * tile;
+	for (size_t r = 0; r < regions.size(); ++r) {
+		atlas_region_t region = {};
+		region.source_x = (regions[r].x0 - 1) * int32_t(tile);
+		region.source_y = (regions[r].y0 - 1) * int32_t(tile);
+		region.x = static_cast<uint32_t>(px[r]) * tile;
+		region.y = static_cast<uint32_t>(py[r]) * tile;
+		region.width = static_cast<uint32_t>(regions[r].x1 - regions[r].x0) * tile;
+		region.height = static_cast<uint32_t>(regions[r].y1 - regions[r].y0) * tile;
+		trim.kept_texels += size_t(region.width) * region.height;
+		trim.regions.push_back(region);
+	}
+	for (size_t t = 0; t < triangles; ++t) {
+		trim.triangle_regions[t] = static_cast<uint32_t>(region_of[labels[centroid_tiles[t]]]);
+	}
+	return trim;
+}
+
+std::vector<uint8_t> TrimAtlas(const atlas_trim_t& trim, const uint8_t* rgba, size_t pitch) {
+	std::vector<uint8_t> atlas(size_t(trim.width) * trim.height * 4, 0);
+	for (const atlas_region_t& region : trim.regions) {
+		for (uint32_t y = 0; y < region.height; ++y) {
+			const uint8_t* source_row = rgba + pitch * Wrap(int64_t(region.source_y) + y, trim.source_height);
+			uint8_t* row = &atlas[(size_t(region.y + y) * trim.width + region.x) * 4];
+			for (uint32_t x = 0; x < region.width; ++x) {
+				memcpy(row + size_t(x) * 4, source_row + size_t(Wrap(int64_t(region.source_x) + x, trim.source_width)) * 4, 4);
+			}
+		}
+	}
+	return atlas;
+}
+
+void RemapTexCoords(const atlas_trim_t& trim, vertex_t* vertices, size_t count) {
+	for (size_t t = 0; t < count / 3 && t < trim.triangle_regions.size(); ++t) {
+		const atlas_region_t& region = trim.regions[trim.triangle_regions[t]];
+		for (int c = 0; c < 3; ++c) {
+			float* uv = vertices[t * 3 + c].tex_coord;
+			double const x = (uv[0] - trim.triangle_shifts[t * 2]) * trim.source_width - region.source_x + region.x;
+			double const y = (uv[1] - trim.triangle_shifts[t * 2 + 1]) * trim.source_height - region.source_y + region.y;
+			uv[0] = static_cast<float>(x / trim.width);
+			uv[1] = static_cast<float>(y / trim.height);
+		}
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Vertex.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct atlas_trim_config_t {
+    // Regions are cut along a grid of tile_size texels (a power of two, at
+    // least 4 so block compression stays aligned) and keep one tile of the
+    // surrounding source texels as padding. When the source's sides are
+    // multiples of tile_size, levels up to log2(tile_size) of the trimmed
+    // atlas's mip chain then hold exactly the texels the same level of the
+    // source held, and bilinear taps at those levels never reach a
+    // neighboring region.
+    uint32_t tile_size = 8;
+};
+
+// Rectangle of the source atlas, in texels, copied into the trimmed one.
+// Padding at the atlas border may reach past the source edge; those
+// texels wrap around, as the renderer's WRAP sampler reads them.
+struct atlas_region_t {
+    int32_t source_x;
+    int32_t source_y;
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+};
+
+struct atlas_trim_t {
+    uint32_t source_width;
+    uint32_t source_height;
+    uint32_t width;
+    uint32_t height;
+    std::vector<atlas_region_t> regions;
+    // Per triangle: its region, and the whole texture periods (u, then v)
+    // its tex_coord is shifted by to land in [0, 1] of the source.
+    std::vector<uint32_t> triangle_regions;
+    std::vector<int32_t> triangle_shifts;
+    size_t used_texels;         // source texels some triangle touches
+    size_t kept_texels;         // source texels copied, padding included
+};
+
+// Rasterizes every triangle of a list conservatively in the texel space of
+// a width x height atlas, grows the touched texels to tiles plus padding
+// and shelf-packs the resulting rectangles. When packing saves nothing the
+// plan is one region holding the whole atlas. Throws std::runtime_error
+// for a triangle that spans the texture seam, which cannot be cut out.
+atlas_trim_t PlanAtlasTrim(
+    const vertex_t* vertices, size_t count, uint32_t width, uint32_t height,
+    const atlas_trim_config_t& config = {}
+);
+
+// Copies the planned regions of an RGBA8 atlas whose rows are pitch bytes
+// apart into a new atlas with tightly packed rows. Texels outside every
+// region are zero.
+std::vector<uint8_t> TrimAtlas(const atlas_trim_t& trim, const uint8_t* rgba, size_t pitch);
+
+// Rewrites tex_coord of the triangle list the plan was made from to
+// address the trimmed atlas.
+void RemapTexCoords(const atlas_trim_t& trim, vertex_t* vertices, size_t count);
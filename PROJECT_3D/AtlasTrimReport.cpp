@@ -0,0 +1,125 @@
+#include "ReportTools.h"
+#include "AtlasTrim.h"
+#include "BlockCompression.h"
+#include "ImageFile.h"
+#include "MipGenerator.h"
+#include "SceneAsset.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+	// Bytes of a full mip chain, as the renderer keeps it resident.
+	size_t ResidentTextureBytes(uint32_t width, uint32_t height, bool bc7) {
+		size_t bytes = 0;
+		for (uint32_t level = 0; level < MipLevelCount(width, height); ++level) {
+			uint32_t const w = (std::max)(width >> level, 1u), h = (std::max)(height >> level, 1u);
+			bytes += bc7 ? CompressedSize(block_format_t::bc7, w, h) : size_t(w) * h * 4;
+		}
+		return bytes;
+	}
+
+	// The atlas for the atlas tools: the decoded image, or when it cannot be
+	// read a generated stand-in of textures.png's size, which is all the
+	// coverage analysis looks at.
+	rgba_image_t AtlasImage(const char* path, bool& generated) {
+		generated = false;
+		try {
+			return LoadImageFile(path);
+		}
+		catch (const std::exception&) {
+			generated = true;
+			rgba_image_t image = { 768, 768, BlockTestImage(768, 768) };
+			return image;
+		}
+	}
+}
+
+// Trims the atlas to the texels the scene's triangles sample and checks
+// that the rewritten geometry samples the trimmed atlas exactly like the
+// original: bilinear taps at points across every triangle must read the
+// same texels on every mip level the plan keeps intact.
+//   --atlas-report [atlas.txt] [textures.png] [tile size]
+int AtlasReportTool(const std::vector<std::string>& args) {
+	bool generated = false;
+	rgba_image_t const image = AtlasImage(args.size() > 2 ? args[2].c_str() : "textures.png", generated);
+	atlas_trim_config_t config;
+	if (args.size() > 3) {
+		config.tile_size = static_cast<uint32_t>(std::stoul(args[3]));
+	}
+	std::vector<vertex_t> const source = SceneSourceVertices();
+	auto const start = std::chrono::steady_clock::now();
+	atlas_trim_t const trim = PlanAtlasTrim(source.data(), source.size(), image.width, image.height, config);
+	std::vector<uint8_t> const trimmed = TrimAtlas(trim, image.pixels.data(), size_t(image.width) * 4);
+	std::vector<vertex_t> remapped = source;
+	RemapTexCoords(trim, remapped.data(), remapped.size());
+	double const seconds = Seconds(start);
+
+	mip_chain_t const before = GenerateMipChain(image.pixels.data(), image.width, image.height, size_t(image.width) * 4);
+	mip_chain_t const after = GenerateMipChain(trimmed.data(), trim.width, trim.height, size_t(trim.width) * 4);
+	uint32_t exact_levels = 0;
+	while ((2u << exact_levels) <= config.tile_size) {
+		++exact_levels;
+	}
+	exact_levels = (std::min)(exact_levels + 1, static_cast<uint32_t>((std::min)(before.levels.size(), after.levels.size())));
+	size_t taps = 0, mismatched = 0;
+	int const STEPS = 8;
+	for (size_t t = 0; t + 2 < source.size(); t += 3) {
+		for (int i = 0; i <= STEPS; ++i) {
+			for (int j = 0; i + j <= STEPS; ++j) {
+				float const w[3] = { float(i) / STEPS, float(j) / STEPS, float(STEPS - i - j) / STEPS };
+				float uv[2][2] = {};
+				for (int c = 0; c < 3; ++c) {
+					for (int k = 0; k < 2; ++k) {
+						uv[0][k] += w[c] * source[t + c].tex_coord[k];
+						uv[1][k] += w[c] * remapped[t + c].tex_coord[k];
+					}
+				}
+				for (uint32_t level = 0; level < exact_levels; ++level) {
+					const mip_chain_t* chains[2] = { &before, &after };
+					int32_t texel[2][2];
+					bool on_edge = false;
+					for (int a = 0; a < 2; ++a) {
+						const mip_level_t& mip = chains[a]->levels[level];
+						for (int k = 0; k < 2; ++k) {
+							double const coord = uv[a][k] * (k == 0 ? mip.width : mip.height) - 0.5;
+							double const whole = std::floor(coord);
+							on_edge |= coord - whole < 1e-3 || coord - whole > 1.0 - 1e-3;
+							texel[a][k] = static_cast<int32_t>(whole);
+						}
+					}
+					if (on_edge) {
+						continue;
+					}
+					for (int tap = 0; tap < 4; ++tap) {
+						uint32_t values[2];
+						for (int a = 0; a < 2; ++a) {
+							const mip_level_t& mip = chains[a]->levels[level];
+							int64_t const x = ((int64_t(texel[a][0]) + (tap & 1)) % mip.width + mip.width) % mip.width;
+							int64_t const y = ((int64_t(texel[a][1]) + (tap >> 1)) % mip.height + mip.height) % mip.height;
+							memcpy(&values[a], &chains[a]->pixels[mip.offset + (size_t(y) * mip.width + size_t(x)) * 4], 4);
+						}
+						++taps;
+						mismatched += values[0] != values[1];
+					}
+				}
+			}
+		}
+	}
+
+	FILE* out = OpenReport(args, "atlas.txt");
+	if (!out) {
+		return 1;
+	}
+	size_t const source_texels = size_t(image.width) * image.height;
+	fprintf(out, "%ux%u%s, %zu triangles, tile %u: %zu texels sampled (%.1f%%), %zu kept with padding\n",
+		image.width, image.height, generated ? " (generated, unreadable)" : "", source.size() / 3, config.tile_size,
+		trim.used_texels, 100.0 * trim.used_texels / source_texels, trim.kept_texels);
+	fprintf(out, "trimmed to %ux%u in %zu regions, %.1f ms\n", trim.width, trim.height, trim.regions.size(), seconds * 1e3);
+	fprintf(out, "resident with mips: RGBA8 %zu -> %zu bytes, BC7 %zu -> %zu bytes (%.1f%%)\n",
+		ResidentTextureBytes(image.width, image.height, false), ResidentTextureBytes(trim.width, trim.height, false),
+		ResidentTextureBytes(image.width, image.height, true), ResidentTextureBytes(trim.width, trim.height, true),
+		100.0 * ResidentTextureBytes(trim.width, trim.height, true) / ResidentTextureBytes(image.width, image.height, true));
+	fprintf(out, "levels 0-%u: %zu bilinear taps compared, %zu mismatched\n", exact_levels - 1, taps, mismatched);
+	return CloseReport(out, mismatched);
+}
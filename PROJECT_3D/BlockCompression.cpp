@@ -0,0 +1,781 @@
+#include "BlockCompression.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define BLOCKS_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+	size_t const BLOCK_ROWS_PER_TASK = 4;
+	float const BLOCK_MAX_ERROR = 1e30f;
+
+	// BC7 4-bit index weights, out of 64.
+	int const BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+	float const BC7_WEIGHT_FRACTIONS[16] = {
+		0 / 64.0f, 4 / 64.0f, 9 / 64.0f, 13 / 64.0f, 17 / 64.0f, 21 / 64.0f, 26 / 64.0f, 30 / 64.0f,
+		34 / 64.0f, 38 / 64.0f, 43 / 64.0f, 47 / 64.0f, 51 / 64.0f, 55 / 64.0f, 60 / 64.0f, 64 / 64.0f
+	};
+	float const BC1_WEIGHTS_4[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	float const BC1_WEIGHTS_3[4] = { 0.0f, 1.0f, 0.5f, 0.0f };
+	float const BC4_WEIGHTS_8[8] = { 0.0f, 1.0f, 1.0f / 7, 2.0f / 7, 3.0f / 7, 4.0f / 7, 5.0f / 7, 6.0f / 7 };
+
+	int Refinements(block_quality_t quality) {
+		return quality == block_quality_t::fast ? 0 : quality == block_quality_t::normal ? 2 : 6;
+	}
+
+	// 16 texels in structure-of-arrays order, one SSE register per four
+	// texels of a channel.
+	struct block_t {
+		alignas(16) float c[4][16];
+		bool transparent[16];
+		bool has_transparent;
+	};
+
+	void LoadBlock(const uint8_t* rgba, uint32_t width, uint32_t height, size_t pitch, uint32_t bx, uint32_t by, block_t& block) {
+		block.has_transparent = false;
+		for (uint32_t y = 0; y < 4; ++y) {
+			const uint8_t* row = rgba + std::min(by * 4 + y, height - 1) * pitch;
+			for (uint32_t x = 0; x < 4; ++x) {
+				const uint8_t* texel = row + std::min(bx * 4 + x, width - 1) * 4;
+				int const i = y * 4 + x;
+				for (int c = 0; c < 4; ++c) {
+					block.c[c][i] = texel[c];
+				}
+				block.transparent[i] = texel[3] < 128;
+				block.has_transparent |= block.transparent[i];
+			}
+		}
+	}
+
+	// Palette entry closest to each texel over the first channels, and the
+	// summed squared error.
+	float SelectNearest(const block_t& block, int channels, const float (*palette)[4], int count, uint8_t indices[16]) {
+#ifdef BLOCKS_USE_SSE
+		__m128 total = _mm_setzero_ps();
+		for (int g = 0; g < 16; g += 4) {
+			__m128 best = _mm_set1_ps(BLOCK_MAX_ERROR);
+			__m128i best_index = _mm_setzero_si128();
+			for (int e = 0; e < count; ++e) {
+				__m128 distance = _mm_setzero_ps();
+				for (int c = 0; c < channels; ++c) {
+					__m128 const diff = _mm_sub_ps(_mm_load_ps(block.c[c] + g), _mm_set1_ps(palette[e][c]));
+					distance = _mm_add_ps(distance, _mm_mul_ps(diff, diff));
+				}
+				__m128i const closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+				best = _mm_min_ps(distance, best);
+				best_index = _mm_or_si128(_mm_andnot_si128(closer, best_index), _mm_and_si128(closer, _mm_set1_epi32(e)));
+			}
+			total = _mm_add_ps(total, best);
+			alignas(16) int32_t lanes[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(lanes), best_index);
+			for (int i = 0; i < 4; ++i) {
+				indices[g + i] = static_cast<uint8_t>(lanes[i]);
+			}
+		}
+		alignas(16) float sums[4];
+		_mm_store_ps(sums, total);
+		return sums[0] + sums[1] + sums[2] + sums[3];
+#else
+		float total = 0.0f;
+		for (int i = 0; i < 16; ++i) {
+			float best = BLOCK_MAX_ERROR;
+			for (int e = 0; e < count; ++e) {
+				float distance = 0.0f;
+				for (int c = 0; c < channels; ++c) {
+					float const diff = block.c[c][i] - palette[e][c];
+					distance += diff * diff;
+				}
+				if (distance < best) {
+					best = distance;
+					indices[i] = static_cast<uint8_t>(e);
+				}
+			}
+			total += best;
+		}
+		return total;
+#endif
+	}
+
+	// Sum over the 16 texels of a[i] * b[i].
+	float Dot16(const float* a, const float* b) {
+#ifdef BLOCKS_USE_SSE
+		__m128 sum = _mm_mul_ps(_mm_load_ps(a), _mm_load_ps(b));
+		for (int g = 4; g < 16; g += 4) {
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(a + g), _mm_load_ps(b + g)));
+		}
+		alignas(16) float lanes[4];
+		_mm_store_ps(lanes, sum);
+		return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#else
+		float sum = 0.0f;
+		for (int i = 0; i < 16; ++i) {
+			sum += a[i] * b[i];
+		}
+		return sum;
+#endif
+	}
+
+	// Endpoints at the extremes of the texels along their principal axis,
+	// over the first channels and the texels in mask.
+	void PrincipalEndpoints(const block_t& block, int channels, const bool* mask, float a[4], float b[4]) {
+		alignas(16) float weight[16];
+		alignas(16) float centered[4][16];
+		float count = 0.0f, mean[4] = {};
+		for (int i = 0; i < 16; ++i) {
+			weight[i] = mask && !mask[i] ? 0.0f : 1.0f;
+			count += weight[i];
+		}
+		if (count == 0.0f) {
+			std::fill(a, a + 4, 0.0f);
+			std::fill(b, b + 4, 0.0f);
+			return;
+		}
+		// Texels outside the mask center to zero and drop out of every sum.
+		for (int c = 0; c < channels; ++c) {
+			mean[c] = Dot16(block.c[c], weight) / count;
+			for (int i = 0; i < 16; ++i) {
+				centered[c][i] = (block.c[c][i] - mean[c]) * weight[i];
+			}
+		}
+		float covariance[4][4];
+		for (int r = 0; r < channels; ++r) {
+			for (int c = r; c < channels; ++c) {
+				covariance[r][c] = covariance[c][r] = Dot16(centered[r], centered[c]);
+			}
+		}
+
+		// Power iteration from the row of the channel that varies most.
+		int widest = 0;
+		for (int c = 1; c < channels; ++c) {
+			if (covariance[c][c] > covariance[widest][widest]) {
+				widest = c;
+			}
+		}
+		float axis[4] = {};
+		std::copy(covariance[widest], covariance[widest] + channels, axis);
+		for (int iteration = 0; iteration < 4; ++iteration) {
+			float next[4] = {}, length = 0.0f;
+			for (int r = 0; r < channels; ++r) {
+				for (int c = 0; c < channels; ++c) {
+					next[r] += covariance[r][c] * axis[c];
+				}
+				length = std::max(length, std::abs(next[r]));
+			}
+			if (length < 1e-6f) {
+				break;
+			}
+			for (int c = 0; c < channels; ++c) {
+				axis[c] = next[c] / length;
+			}
+		}
+
+		float tmin = 0.0f, tmax = 0.0f, length = 0.0f;
+		for (int c = 0; c < channels; ++c) {
+			length += axis[c] * axis[c];
+		}
+		if (length > 0.0f) {
+			for (int i = 0; i < 16; ++i) {
+				float t = 0.0f;
+				for (int c = 0; c < channels; ++c) {
+					t += centered[c][i] * axis[c];
+				}
+				tmin = std::min(tmin, t);
+				tmax = std::max(tmax, t);
+			}
+			tmin /= length;
+			tmax /= length;
+		}
+		for (int c = 0; c < 4; ++c) {
+			a[c] = c < channels ? std::clamp(mean[c] + axis[c] * tmin, 0.0f, 255.0f) : 0.0f;
+			b[c] = c < channels ? std::clamp(mean[c] + axis[c] * tmax, 0.0f, 255.0f) : 0.0f;
+		}
+	}
+
+	// Endpoints minimizing the squared error of texel i rebuilt as
+	// a + weight[indices[i]] * (b - a); false when the weights are all equal.
+	bool LeastSquaresEndpoints(
+		const block_t& block, int channels, const bool* mask, const uint8_t indices[16], const float* weights,
+		float a[4], float b[4]
+	) {
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[4] = {}, bx[4] = {};
+		for (int i = 0; i < 16; ++i) {
+			if (mask && !mask[i]) {
+				continue;
+			}
+			float const w = weights[indices[i]];
+			aa += (1.0f - w) * (1.0f - w);
+			ab += (1.0f - w) * w;
+			bb += w * w;
+			for (int c = 0; c < channels; ++c) {
+				ax[c] += (1.0f - w) * block.c[c][i];
+				bx[c] += w * block.c[c][i];
+			}
+		}
+		float const determinant = aa * bb - ab * ab;
+		if (std::abs(determinant) < 1e-6f) {
+			return false;
+		}
+		for (int c = 0; c < channels; ++c) {
+			a[c] = std::clamp((bb * ax[c] - ab * bx[c]) / determinant, 0.0f, 255.0f);
+			b[c] = std::clamp((aa * bx[c] - ab * ax[c]) / determinant, 0.0f, 255.0f);
+		}
+		return true;
+	}
+
+	uint16_t To565(const float color[4]) {
+		int const r = static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f);
+		int const g = static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f);
+		int const b = static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f);
+		return static_cast<uint16_t>(r << 11 | g << 5 | b);
+	}
+
+	void From565(uint16_t packed, int color[3]) {
+		int const r = packed >> 11, g = (packed >> 5) & 63, b = packed & 31;
+		color[0] = r << 3 | r >> 2;
+		color[1] = g << 2 | g >> 4;
+		color[2] = b << 3 | b >> 2;
+	}
+
+	// Palette in the order the index bits select it. Four colors unless
+	// three_color, where the last entry is transparent black.
+	void Bc1Palette(uint16_t c0, uint16_t c1, bool three_color, int palette[4][4]) {
+		From565(c0, palette[0]);
+		From565(c1, palette[1]);
+		for (int c = 0; c < 3; ++c) {
+			if (three_color) {
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+			else {
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+		}
+		palette[0][3] = palette[1][3] = palette[2][3] = 255;
+		palette[3][3] = three_color ? 0 : 255;
+	}
+
+	struct bc1_candidate_t {
+		float error;
+		uint16_t c0, c1;
+		bool three_color;
+		uint8_t indices[16];
+	};
+
+	// Searches endpoints in one mode, refining them from the indices each
+	// round. Three-color mode leaves transparent texels on index 3.
+	bc1_candidate_t SearchBc1(const block_t& block, bool three_color, int refinements) {
+		bool opaque[16];
+		for (int i = 0; i < 16; ++i) {
+			opaque[i] = !block.transparent[i];
+		}
+		const bool* mask = three_color ? opaque : nullptr;
+
+		bc1_candidate_t best;
+		best.error = BLOCK_MAX_ERROR;
+		float a[4], b[4];
+		PrincipalEndpoints(block, 3, mask, a, b);
+		for (int round = 0; round <= refinements; ++round) {
+			bc1_candidate_t candidate;
+			candidate.three_color = three_color;
+			candidate.c0 = To565(a);
+			candidate.c1 = To565(b);
+			int palette[4][4];
+			Bc1Palette(candidate.c0, candidate.c1, three_color, palette);
+			float entries[4][4];
+			for (int e = 0; e < 4; ++e) {
+				for (int c = 0; c < 4; ++c) {
+					entries[e][c] = static_cast<float>(palette[e][c]);
+				}
+			}
+			candidate.error = SelectNearest(block, 3, entries, three_color ? 3 : 4, candidate.indices);
+			if (three_color) {
+				for (int i = 0; i < 16; ++i) {
+					if (block.transparent[i]) {
+						candidate.indices[i] = 3;
+					}
+				}
+			}
+			if (candidate.error < best.error) {
+				best = candidate;
+			}
+			if (round == refinements || best.error == 0.0f ||
+				!LeastSquaresEndpoints(block, 3, mask, candidate.indices, three_color ? BC1_WEIGHTS_3 : BC1_WEIGHTS_4, a, b)) {
+				break;
+			}
+		}
+		return best;
+	}
+
+	// Orders the endpoints for the candidate's mode and writes the block.
+	// four_color_only is the BC3 color block, which ignores endpoint order.
+	void PackBc1(bc1_candidate_t candidate, bool four_color_only, uint8_t out[8]) {
+		uint8_t remap[4] = { 0, 1, 2, 3 };
+		if (candidate.three_color ? candidate.c0 > candidate.c1 : candidate.c0 < candidate.c1) {
+			std::swap(candidate.c0, candidate.c1);
+			remap[0] = 1;
+			remap[1] = 0;
+			if (!candidate.three_color) {
+				remap[2] = 3;
+				remap[3] = 2;
+			}
+		}
+		// Equal endpoints read as three-color; every opaque entry is then
+		// the same color, so index 0 loses nothing.
+		bool const flat = !candidate.three_color && !four_color_only && candidate.c0 == candidate.c1;
+		out[0] = static_cast<uint8_t>(candidate.c0);
+		out[1] = static_cast<uint8_t>(candidate.c0 >> 8);
+		out[2] = static_cast<uint8_t>(candidate.c1);
+		out[3] = static_cast<uint8_t>(candidate.c1 >> 8);
+		uint32_t bits = 0;
+		for (int i = 0; i < 16; ++i) {
+			bits |= static_cast<uint32_t>(flat ? 0 : remap[candidate.indices[i]]) << (2 * i);
+		}
+		memcpy(out + 4, &bits, 4);
+	}
+
+	void EncodeBc1(const block_t& block, block_quality_t quality, bool four_color_only, uint8_t out[8]) {
+		int const refinements = Refinements(quality);
+		bc1_candidate_t best;
+		if (block.has_transparent && !four_color_only) {
+			best = SearchBc1(block, true, refinements);
+		}
+		else {
+			best = SearchBc1(block, false, refinements);
+			if (quality == block_quality_t::high && !four_color_only) {
+				// The midpoint mode sometimes fits two-tone blocks better.
+				bc1_candidate_t const three = SearchBc1(block, true, refinements);
+				if (three.error < best.error) {
+					best = three;
+				}
+			}
+		}
+		PackBc1(best, four_color_only, out);
+	}
+
+	void DecodeBc1(const uint8_t in[8], bool four_color_only, uint8_t texels[16][4]) {
+		uint16_t const c0 = static_cast<uint16_t>(in[0] | in[1] << 8);
+		uint16_t const c1 = static_cast<uint16_t>(in[2] | in[3] << 8);
+		int palette[4][4];
+		Bc1Palette(c0, c1, !four_color_only && c0 <= c1, palette);
+		uint32_t bits;
+		memcpy(&bits, in + 4, 4);
+		for (int i = 0; i < 16; ++i) {
+			const int* color = palette[(bits >> (2 * i)) & 3];
+			for (int c = 0; c < 4; ++c) {
+				texels[i][c] = static_cast<uint8_t>(color[c]);
+			}
+		}
+	}
+
+	void Bc4Palette(int a0, int a1, int palette[8]) {
+		palette[0] = a0;
+		palette[1] = a1;
+		if (a0 > a1) {
+			for (int k = 1; k < 7; ++k) {
+				palette[k + 1] = ((7 - k) * a0 + k * a1) / 7;
+			}
+		}
+		else {
+			for (int k = 1; k < 5; ++k) {
+				palette[k + 1] = ((5 - k) * a0 + k * a1) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	float SearchBc4(const block_t& block, int a0, int a1, uint8_t indices[16]) {
+		int palette[8];
+		Bc4Palette(a0, a1, palette);
+		float values[8][4] = {};
+		for (int e = 0; e < 8; ++e) {
+			values[e][0] = static_cast<float>(palette[e]);
+		}
+		// The alpha channel stands in as the first channel.
+		block_t alpha;
+		std::copy(block.c[3], block.c[3] + 16, alpha.c[0]);
+		return SelectNearest(alpha, 1, values, 8, indices);
+	}
+
+	void EncodeBc4(const block_t& block, block_quality_t quality, uint8_t out[8]) {
+		float lo = 255.0f, hi = 0.0f, inner_lo = 255.0f, inner_hi = 0.0f;
+		for (int i = 0; i < 16; ++i) {
+			float const v = block.c[3][i];
+			lo = std::min(lo, v);
+			hi = std::max(hi, v);
+			if (v > 0.0f && v < 255.0f) {
+				inner_lo = std::min(inner_lo, v);
+				inner_hi = std::max(inner_hi, v);
+			}
+		}
+
+		// Eight-value mode needs a0 > a1; equal endpoints fall into the
+		// six-value mode, whose first entry is still a0.
+		int a0 = static_cast<int>(hi), a1 = static_cast<int>(lo);
+		uint8_t indices[16];
+		float error = SearchBc4(block, a0, a1, indices);
+		for (int round = 0; round < Refinements(quality) && error > 0.0f && a0 > a1; ++round) {
+			// Least squares on the interpolated values, kept in order.
+			block_t alpha;
+			std::copy(block.c[3], block.c[3] + 16, alpha.c[0]);
+			float a[4], b[4];
+			if (!LeastSquaresEndpoints(alpha, 1, nullptr, indices, BC4_WEIGHTS_8, a, b)) {
+				break;
+			}
+			int const n0 = static_cast<int>(a[0] + 0.5f), n1 = static_cast<int>(b[0] + 0.5f);
+			if (n0 <= n1) {
+				break;
+			}
+			uint8_t next[16];
+			float const next_error = SearchBc4(block, n0, n1, next);
+			if (next_error >= error) {
+				break;
+			}
+			a0 = n0;
+			a1 = n1;
+			error = next_error;
+			std::copy(next, next + 16, indices);
+		}
+
+		if (quality == block_quality_t::high && (lo == 0.0f || hi == 255.0f) && inner_lo <= inner_hi) {
+			// Six-value mode with explicit 0 and 255 for blocks that mix
+			// cut-outs with soft edges.
+			uint8_t six[16];
+			int const s0 = static_cast<int>(inner_lo), s1 = static_cast<int>(inner_hi);
+			float const six_error = SearchBc4(block, s0, s1, six);
+			if (six_error < error) {
+				a0 = s0;
+				a1 = s1;
+				std::copy(six, six + 16, indices);
+			}
+		}
+
+		out[0] = static_cast<uint8_t>(a0);
+		out[1] = static_cast<uint8_t>(a1);
+		uint64_t bits = 0;
+		for (int i = 0; i < 16; ++i) {
+			bits |= static_cast<uint64_t>(indices[i]) << (3 * i);
+		}
+		for (int k = 0; k < 6; ++k) {
+			out[2 + k] = static_cast<uint8_t>(bits >> (8 * k));
+		}
+	}
+
+	void DecodeBc4(const uint8_t in[8], uint8_t texels[16][4], int channel) {
+		int palette[8];
+		Bc4Palette(in[0], in[1], palette);
+		uint64_t bits = 0;
+		for (int k = 0; k < 6; ++k) {
+			bits |= static_cast<uint64_t>(in[2 + k]) << (8 * k);
+		}
+		for (int i = 0; i < 16; ++i) {
+			texels[i][channel] = static_cast<uint8_t>(palette[(bits >> (3 * i)) & 7]);
+		}
+	}
+
+	int Bc7Interpolate(int e0, int e1, int index) {
+		return ((64 - BC7_WEIGHTS[index]) * e0 + BC7_WEIGHTS[index] * e1 + 32) >> 6;
+	}
+
+	// 7-bit endpoint plus shared p-bit, expanded to 8 bits.
+	int Bc7Quantize(float value, int pbit) {
+		return std::clamp(static_cast<int>((value - pbit) * 0.5f + 0.5f), 0, 127) * 2 + pbit;
+	}
+
+	// Index of the weight nearest to each position 0..64 along the line.
+	struct bc7_nearest_t {
+		uint8_t index[65];
+
+		constexpr bc7_nearest_t() : index() {
+			for (int t = 0; t <= 64; ++t) {
+				int best = 0;
+				for (int k = 1; k < 16; ++k) {
+					int const distance = BC7_WEIGHTS[k] > t ? BC7_WEIGHTS[k] - t : t - BC7_WEIGHTS[k];
+					int const best_distance = BC7_WEIGHTS[best] > t ? BC7_WEIGHTS[best] - t : t - BC7_WEIGHTS[best];
+					if (distance < best_distance) {
+						best = k;
+					}
+				}
+				index[t] = static_cast<uint8_t>(best);
+			}
+		}
+	};
+	constexpr bc7_nearest_t BC7_NEAREST;
+
+	// Indices from each texel's position along e0 -> e1, and the summed
+	// squared error against the palette.
+	float ProjectBc7(const block_t& block, const int e0[4], const int e1[4], const float (*palette)[4], uint8_t indices[16]) {
+		float direction[4], length = 0.0f;
+		for (int c = 0; c < 4; ++c) {
+			direction[c] = static_cast<float>(e1[c] - e0[c]);
+			length += direction[c] * direction[c];
+		}
+		float const scale = length > 0.0f ? 64.0f / length : 0.0f;
+#ifdef BLOCKS_USE_SSE
+		for (int g = 0; g < 16; g += 4) {
+			__m128 t = _mm_setzero_ps();
+			for (int c = 0; c < 4; ++c) {
+				__m128 const offset = _mm_sub_ps(_mm_load_ps(block.c[c] + g), _mm_set1_ps(static_cast<float>(e0[c])));
+				t = _mm_add_ps(t, _mm_mul_ps(offset, _mm_set1_ps(direction[c])));
+			}
+			t = _mm_min_ps(_mm_max_ps(_mm_mul_ps(t, _mm_set1_ps(scale)), _mm_setzero_ps()), _mm_set1_ps(64.0f));
+			alignas(16) int32_t lanes[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(lanes), _mm_cvtps_epi32(t));
+			for (int i = 0; i < 4; ++i) {
+				indices[g + i] = BC7_NEAREST.index[lanes[i]];
+			}
+		}
+#else
+		for (int i = 0; i < 16; ++i) {
+			float t = 0.0f;
+			for (int c = 0; c < 4; ++c) {
+				t += (block.c[c][i] - e0[c]) * direction[c];
+			}
+			indices[i] = BC7_NEAREST.index[static_cast<int>(std::clamp(t * scale, 0.0f, 64.0f) + 0.5f)];
+		}
+#endif
+		float error = 0.0f;
+		for (int i = 0; i < 16; ++i) {
+			for (int c = 0; c < 4; ++c) {
+				float const diff = block.c[c][i] - palette[indices[i]][c];
+				error += diff * diff;
+			}
+		}
+		return error;
+	}
+
+	// P-bit that quantizes an endpoint with the least error.
+	int Bc7Pbit(const float endpoint[4]) {
+		float error[2] = {};
+		for (int pbit = 0; pbit < 2; ++pbit) {
+			for (int c = 0; c < 4; ++c) {
+				float const diff = endpoint[c] - Bc7Quantize(endpoint[c], pbit);
+				error[pbit] += diff * diff;
+			}
+		}
+		return error[1] < error[0] ? 1 : 0;
+	}
+
+	struct bc7_candidate_t {
+		float error;
+		int e0[4], e1[4];
+		uint8_t indices[16];
+	};
+
+	void EncodeBc7(const block_t& block, block_quality_t quality, uint8_t out[16]) {
+		bc7_candidate_t best;
+		best.error = BLOCK_MAX_ERROR;
+		float a[4], b[4];
+		PrincipalEndpoints(block, 4, nullptr, a, b);
+		for (int round = 0, refinements = Refinements(quality); round <= refinements; ++round) {
+			// Fast picks each p-bit by rounding; otherwise all four pairs.
+			int pbits[4][2];
+			int pairs = 0;
+			if (quality == block_quality_t::fast) {
+				pbits[0][0] = Bc7Pbit(a);
+				pbits[0][1] = Bc7Pbit(b);
+				pairs = 1;
+			}
+			else {
+				for (int p = 0; p < 4; ++p, ++pairs) {
+					pbits[p][0] = p & 1;
+					pbits[p][1] = p >> 1;
+				}
+			}
+
+			bc7_candidate_t round_best;
+			round_best.error = BLOCK_MAX_ERROR;
+			for (int p = 0; p < pairs; ++p) {
+				bc7_candidate_t candidate;
+				float palette[16][4];
+				for (int c = 0; c < 4; ++c) {
+					candidate.e0[c] = Bc7Quantize(a[c], pbits[p][0]);
+					candidate.e1[c] = Bc7Quantize(b[c], pbits[p][1]);
+					for (int k = 0; k < 16; ++k) {
+						palette[k][c] = static_cast<float>(Bc7Interpolate(candidate.e0[c], candidate.e1[c], k));
+					}
+				}
+				// Projecting onto the endpoint line is nearly as good as
+				// searching all 16 entries and much cheaper.
+				candidate.error = quality == block_quality_t::high
+					? SelectNearest(block, 4, palette, 16, candidate.indices)
+					: ProjectBc7(block, candidate.e0, candidate.e1, palette, candidate.indices);
+				if (candidate.error < round_best.error) {
+					round_best = candidate;
+				}
+			}
+			if (round_best.error < best.error) {
+				best = round_best;
+			}
+			if (round == refinements || best.error == 0.0f ||
+				!LeastSquaresEndpoints(block, 4, nullptr, round_best.indices, BC7_WEIGHT_FRACTIONS, a, b)) {
+				break;
+			}
+		}
+
+		// The first index is stored without its top bit, so it must be
+		// below 8: swap the endpoints and mirror the indices if not.
+		if (best.indices[0] >= 8) {
+			std::swap(best.e0, best.e1);
+			for (uint8_t& index : best.indices) {
+				index = static_cast<uint8_t>(15 - index);
+			}
+		}
+
+		uint64_t bits[2] = {};
+		int position = 0;
+		auto write = [&](uint32_t value, int count) {
+			for (int k = 0; k < count; ++k, ++position) {
+				bits[position >> 6] |= static_cast<uint64_t>((value >> k) & 1) << (position & 63);
+			}
+		};
+		write(1u << 6, 7);
+		for (int c = 0; c < 4; ++c) {
+			write(static_cast<uint32_t>(best.e0[c] >> 1), 7);
+			write(static_cast<uint32_t>(best.e1[c] >> 1), 7);
+		}
+		write(static_cast<uint32_t>(best.e0[0] & 1), 1);
+		write(static_cast<uint32_t>(best.e1[0] & 1), 1);
+		write(best.indices[0], 3);
+		for (int i = 1; i < 16; ++i) {
+			write(best.indices[i], 4);
+		}
+		for (int k = 0; k < 16; ++k) {
+			out[k] = static_cast<uint8_t>(bits[k >> 3] >> (8 * (k & 7)));
+		}
+	}
+
+	void DecodeBc7(const uint8_t in[16], uint8_t texels[16][4]) {
+		uint64_t bits[2] = {};
+		for (int k = 0; k < 16; ++k) {
+			bits[k >> 3] |= static_cast<uint64_t>(in[k]) << (8 * (k & 7));
+		}
+		int position = 0;
+		auto read = [&](int count) {
+			uint32_t value = 0;
+			for (int k = 0; k < count; ++k, ++position) {
+				value |= static_cast<uint32_t>((bits[position >> 6] >> (position & 63)) & 1) << k;
+			}
+			return value;
+		};
+		if (read(7) != 1u << 6) {
+			throw std::runtime_error("DecompressImage: only BC7 mode 6 blocks are supported");
+		}
+		int e0[4], e1[4];
+		for (int c = 0; c < 4; ++c) {
+			e0[c] = static_cast<int>(read(7)) << 1;
+			e1[c] = static_cast<int>(read(7)) << 1;
+		}
+		int const p0 = static_cast<int>(read(1)), p1 = static_cast<int>(read(1));
+		for (int c = 0; c < 4; ++c) {
+			e0[c] |= p0;
+			e1[c] |= p1;
+		}
+		for (int i = 0; i < 16; ++i) {
+			int const index = static_cast<int>(read(i == 0 ? 3 : 4));
+			for (int c = 0; c < 4; ++c) {
+				texels[i][c] = static_cast<uint8_t>(Bc7Interpolate(e0[c], e1[c], index));
+			}
+		}
+	}
+}
+
+size_t BlockBytes(block_format_t format) {
+	return format == block_format_t::bc1 ? 8 : 16;
+}
+
+size_t BlockRowBytes(block_format_t format, uint32_t width) {
+	return static_cast<size_t>((width + 3) / 4) * BlockBytes(format);
+}
+
+size_t CompressedSize(block_format_t format, uint32_t width, uint32_t height) {
+	return BlockRowBytes(format, width) * ((height + 3) / 4);
+}
+
+void CompressImage(
+	block_format_t format, block_quality_t quality, const uint8_t* rgba, uint32_t width, uint32_t height,
+	size_t pitch, uint8_t* out, unsigned thread_count
+) {
+	if (width == 0 || height == 0) {
+		return;
+	}
+	uint32_t const blocks_x = (width + 3) / 4, blocks_y = (height + 3) / 4;
+	size_t const row_bytes = BlockRowBytes(format, width);
+	size_t const block_bytes = BlockBytes(format);
+	size_t const tasks = (blocks_y + BLOCK_ROWS_PER_TASK - 1) / BLOCK_ROWS_PER_TASK;
+	ParallelFor(tasks, ResolveThreadCount(thread_count), [&](size_t task) {
+		uint32_t const end = static_cast<uint32_t>(std::min<size_t>(blocks_y, (task + 1) * BLOCK_ROWS_PER_TASK));
+		block_t block;
+		for (uint32_t by = static_cast<uint32_t>(task * BLOCK_ROWS_PER_TASK); by < end; ++by) {
+			for (uint32_t bx = 0; bx < blocks_x; ++bx) {
+				LoadBlock(rgba, width, height, pitch, bx, by, block);
+				uint8_t* block_out = out + by * row_bytes + bx * block_bytes;
+				if (format == block_format_t::bc1) {
+					EncodeBc1(block, quality, false, block_out);
+				}
+				else if (format == block_format_t::bc3) {
+					EncodeBc4(block, quality, block_out);
+					EncodeBc1(block, quality, true, block_out + 8);
+				}
+				else {
+					EncodeBc7(block, quality, block_out);
+				}
+			}
+		}
+	});
+}
+
+void DecompressImage(
+	block_format_t format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* rgba, size_t pitch
+) {
+	size_t const row_bytes = BlockRowBytes(format, width);
+	size_t const block_bytes = BlockBytes(format);
+	uint8_t texels[16][4];
+	for (uint32_t by = 0; by < (height + 3) / 4; ++by) {
+		for (uint32_t bx = 0; bx < (width + 3) / 4; ++bx) {
+			const uint8_t* in = blocks + by * row_bytes + bx * block_bytes;
+			if (format == block_format_t::bc1) {
+				DecodeBc1(in, false, texels);
+			}
+			else if (format == block_format_t::bc3) {
+				DecodeBc1(in + 8, true, texels);
+				DecodeBc4(in, texels, 3);
+			}
+			else {
+				DecodeBc7(in, texels);
+			}
+			for (uint32_t y = 0; y < 4 && by * 4 + y < height; ++y) {
+				for (uint32_t x = 0; x < 4 && bx * 4 + x < width; ++x) {
+					memcpy(rgba + (by * 4 + y) * pitch + (bx * 4 + x) * 4, texels[y * 4 + x], 4);
+				}
+			}
+		}
+	}
+}
+
+compressed_texture_t CompressMipChain(
+	const mip_chain_t& chain, block_format_t format, block_quality_t quality, unsigned thread_count
+) {
+	compressed_texture_t texture;
+	texture.format = format;
+	size_t offset = 0;
+	for (const mip_level_t& level : chain.levels) {
+		texture.levels.push_back({ level.width, level.height, offset });
+		offset += CompressedSize(format, level.width, level.height);
+	}
+	texture.data.resize(offset);
+	for (size_t l = 0; l < chain.levels.size(); ++l) {
+		const mip_level_t& level = chain.levels[l];
+		CompressImage(
+			format, quality, chain.pixels.data() + level.offset, level.width, level.height, level.width * 4,
+			texture.data.data() + texture.levels[l].offset, thread_count
+		);
+	}
+	return texture;
+}
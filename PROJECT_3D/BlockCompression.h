@@ -0,0 +1,51 @@
+#pragma once
+
+#include "MipGenerator.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class block_format_t {
+    bc1,                        // RGB with 1-bit alpha, 8 bytes per 4x4 block
+    bc3,                        // RGB plus interpolated alpha, 16 bytes
+    bc7,                        // RGBA in mode 6 (one subset, 4-bit indices), 16 bytes
+};
+
+// Trades encode time for quality: more least-squares refinements of the
+// endpoints and, at the top level, the alternative block modes as well.
+enum class block_quality_t {
+    fast,
+    normal,
+    high,
+};
+
+size_t BlockBytes(block_format_t format);
+// Bytes in one row of 4x4 blocks, and the whole image; partial blocks at
+// the right and bottom edges are padded by repeating the last texel.
+size_t BlockRowBytes(block_format_t format, uint32_t width);
+size_t CompressedSize(block_format_t format, uint32_t width, uint32_t height);
+
+// Encodes an RGBA8 image whose rows are pitch bytes apart into rows of
+// blocks, split across thread_count threads (0: every hardware thread).
+// BC1 treats alpha below 128 as transparent. out holds CompressedSize bytes.
+void CompressImage(
+    block_format_t format, block_quality_t quality, const uint8_t* rgba, uint32_t width, uint32_t height,
+    size_t pitch, uint8_t* out, unsigned thread_count = 0
+);
+// Decodes what CompressImage writes back to RGBA8, for verification. BC7
+// blocks in modes other than 6 throw std::runtime_error.
+void DecompressImage(
+    block_format_t format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* rgba, size_t pitch
+);
+
+// A mip chain compressed level by level. Level offsets index data, and rows
+// of blocks are BlockRowBytes apart.
+struct compressed_texture_t {
+    block_format_t format;
+    std::vector<mip_level_t> levels;
+    std::vector<uint8_t> data;
+};
+
+compressed_texture_t CompressMipChain(
+    const mip_chain_t& chain, block_format_t format, block_quality_t quality, unsigned thread_count = 0
+);
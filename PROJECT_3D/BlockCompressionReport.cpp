@@ -0,0 +1,67 @@
+#include "ReportTools.h"
+#include "BlockCompression.h"
+#include <cmath>
+
+namespace {
+	double Psnr(double squared_error, size_t samples) {
+		return squared_error == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 * samples / squared_error);
+	}
+}
+
+// Encodes a test image in every format and quality, decodes it again
+// and reports throughput and PSNR.
+//   --bc-report [bc.txt] [width] [height]
+int BlockReportTool(const std::vector<std::string>& args) {
+	uint32_t const width = args.size() > 2 ? static_cast<uint32_t>(std::stoul(args[2])) : 1024;
+	uint32_t const height = args.size() > 3 ? static_cast<uint32_t>(std::stoul(args[3])) : width;
+	if (width == 0 || height == 0) {
+		return 1;
+	}
+	std::vector<uint8_t> const image = BlockTestImage(width, height);
+
+	FILE* out = OpenReport(args, "bc.txt");
+	if (!out) {
+		return 1;
+	}
+	fprintf(out, "%ux%u, %zu bytes as RGBA8\n", width, height, image.size());
+	// Below these the encoder is broken rather than merely imprecise.
+	double const MIN_COLOR_PSNR[3] = { 30.0, 30.0, 33.0 };
+	double const MIN_ALPHA_PSNR = 30.0;
+	const char* const FORMAT_NAMES[3] = { "bc1", "bc3", "bc7" };
+	const char* const QUALITY_NAMES[3] = { "fast", "normal", "high" };
+	bool passed = true;
+	std::vector<uint8_t> decoded(image.size());
+	for (int f = 0; f < 3; ++f) {
+		block_format_t const format = static_cast<block_format_t>(f);
+		std::vector<uint8_t> blocks(CompressedSize(format, width, height));
+		for (int q = 0; q < 3; ++q) {
+			block_quality_t const quality = static_cast<block_quality_t>(q);
+			auto const start = std::chrono::steady_clock::now();
+			CompressImage(format, quality, image.data(), width, height, width * 4, blocks.data());
+			double const seconds = Seconds(start);
+			DecompressImage(format, blocks.data(), width, height, decoded.data(), width * 4);
+
+			double color_error = 0.0, alpha_error = 0.0;
+			for (size_t i = 0; i < image.size(); i += 4) {
+				// BC1 keeps only whether a texel is transparent, and
+				// then drops its color.
+				bool const cut = format == block_format_t::bc1 && image[i + 3] < 128;
+				for (int c = 0; c < 3 && !cut; ++c) {
+					double const diff = static_cast<double>(image[i + c]) - decoded[i + c];
+					color_error += diff * diff;
+				}
+				double const alpha_diff = format == block_format_t::bc1
+					? (cut ? 0.0 : 255.0) - decoded[i + 3]
+					: static_cast<double>(image[i + 3]) - decoded[i + 3];
+				alpha_error += alpha_diff * alpha_diff;
+			}
+			size_t const texels = image.size() / 4;
+			double const color_psnr = Psnr(color_error, texels * 3);
+			double const alpha_psnr = Psnr(alpha_error, texels);
+			passed &= color_psnr >= MIN_COLOR_PSNR[f] && (format == block_format_t::bc1 || alpha_psnr >= MIN_ALPHA_PSNR);
+			fprintf(out, "%s %-6s: %7.1f MP/s, color PSNR %.2f dB, alpha PSNR %.2f dB, %zu bytes\n",
+				FORMAT_NAMES[f], QUALITY_NAMES[q], texels / seconds / 1e6, color_psnr, alpha_psnr, blocks.size());
+		}
+	}
+	return CloseReport(out, passed ? 0 : 1);
+}
@@ -0,0 +1,541 @@
+#include "Bvh.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <thread>
+
+#if defined(__AVX2__)
+#define BVH_USE_AVX2 1
+#include <immintrin.h>
+#endif
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define BVH_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+	int const SAH_BINS = 16;
+	uint32_t const MAX_LEAF_SIZE = 8;
+	int const MAX_DEPTH = 60;
+	int const STACK_SIZE = MAX_DEPTH + 4;
+	uint32_t const PARALLEL_MIN_TRIANGLES = 16384;
+	float const TRAVERSAL_COST = 1.0f;
+	// Triangles a leaf test handles at once.
+	uint32_t const LEAF_LANES = 8;
+
+	struct aabb_t {
+		float min[3];
+		float max[3];
+
+		void Reset() {
+			for (int k = 0; k < 3; ++k) {
+				min[k] = FLT_MAX;
+				max[k] = -FLT_MAX;
+			}
+		}
+		void Grow(const aabb_t& b) {
+			for (int k = 0; k < 3; ++k) {
+				min[k] = std::min(min[k], b.min[k]);
+				max[k] = std::max(max[k], b.max[k]);
+			}
+		}
+		void Grow(const float* p) {
+			for (int k = 0; k < 3; ++k) {
+				min[k] = std::min(min[k], p[k]);
+				max[k] = std::max(max[k], p[k]);
+			}
+		}
+		float HalfArea() const {
+			if (min[0] > max[0]) {
+				return 0.0f;
+			}
+			float const dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+			return dx * dy + dy * dz + dz * dx;
+		}
+	};
+
+	struct build_context_t {
+		std::vector<aabb_t> tri_bounds;
+		std::vector<float> centroids;
+		std::vector<uint32_t> order;
+		std::vector<bvh_node_t>* nodes;
+		std::atomic<uint32_t> next_node;
+		int parallel_depth;
+	};
+
+	void MakeLeaf(bvh_node_t& node, uint32_t first, uint32_t count) {
+		node.left_or_first = first;
+		node.count = count;
+	}
+
+	void BuildNode(build_context_t& ctx, uint32_t node_index, uint32_t first, uint32_t count, int depth) {
+		bvh_node_t& node = (*ctx.nodes)[node_index];
+		aabb_t bounds, centroid_bounds;
+		bounds.Reset();
+		centroid_bounds.Reset();
+		for (uint32_t i = first; i < first + count; ++i) {
+			uint32_t const t = ctx.order[i];
+			bounds.Grow(ctx.tri_bounds[t]);
+			centroid_bounds.Grow(&ctx.centroids[t * 3]);
+		}
+		for (int k = 0; k < 3; ++k) {
+			node.bounds_min[k] = bounds.min[k];
+			node.bounds_max[k] = bounds.max[k];
+		}
+
+		if (count <= 2 || depth >= MAX_DEPTH) {
+			MakeLeaf(node, first, count);
+			return;
+		}
+
+		// Binned SAH over the centroid bounds of every axis.
+		int best_axis = -1;
+		int best_split = 0;
+		float best_cost = FLT_MAX;
+		for (int axis = 0; axis < 3; ++axis) {
+			float const lo = centroid_bounds.min[axis];
+			float const extent = centroid_bounds.max[axis] - lo;
+			if (extent <= 0.0f) {
+				continue;
+			}
+			float const scale = SAH_BINS / extent;
+
+			aabb_t bin_bounds[SAH_BINS];
+			uint32_t bin_count[SAH_BINS] = {};
+			for (auto& b : bin_bounds) {
+				b.Reset();
+			}
+			for (uint32_t i = first; i < first + count; ++i) {
+				uint32_t const t = ctx.order[i];
+				int const bin = std::min(SAH_BINS - 1, static_cast<int>((ctx.centroids[t * 3 + axis] - lo) * scale));
+				++bin_count[bin];
+				bin_bounds[bin].Grow(ctx.tri_bounds[t]);
+			}
+
+			float right_area[SAH_BINS];
+			uint32_t right_count[SAH_BINS];
+			aabb_t acc;
+			acc.Reset();
+			uint32_t n = 0;
+			for (int b = SAH_BINS - 1; b > 0; --b) {
+				acc.Grow(bin_bounds[b]);
+				n += bin_count[b];
+				right_area[b] = acc.HalfArea();
+				right_count[b] = n;
+			}
+			acc.Reset();
+			n = 0;
+			for (int b = 0; b < SAH_BINS - 1; ++b) {
+				acc.Grow(bin_bounds[b]);
+				n += bin_count[b];
+				if (n == 0 || right_count[b + 1] == 0) {
+					continue;
+				}
+				float const cost = n * acc.HalfArea() + right_count[b + 1] * right_area[b + 1];
+				if (cost < best_cost) {
+					best_cost = cost;
+					best_axis = axis;
+					best_split = b + 1;
+				}
+			}
+		}
+
+		float const leaf_cost = count * bounds.HalfArea();
+		float const split_cost = TRAVERSAL_COST * bounds.HalfArea() + best_cost;
+		if (count <= MAX_LEAF_SIZE && (best_axis < 0 || leaf_cost <= split_cost)) {
+			MakeLeaf(node, first, count);
+			return;
+		}
+
+		uint32_t mid = first + count / 2;
+		if (best_axis >= 0) {
+			float const lo = centroid_bounds.min[best_axis];
+			float const scale = SAH_BINS / (centroid_bounds.max[best_axis] - lo);
+			auto it = std::partition(
+				ctx.order.begin() + first, ctx.order.begin() + first + count,
+				[&](uint32_t t) {
+					int const bin = std::min(SAH_BINS - 1, static_cast<int>((ctx.centroids[t * 3 + best_axis] - lo) * scale));
+					return bin < best_split;
+				});
+			mid = static_cast<uint32_t>(it - ctx.order.begin());
+			if (mid == first || mid == first + count) {
+				mid = first + count / 2;
+			}
+		}
+
+		uint32_t const left = ctx.next_node.fetch_add(2);
+		node.left_or_first = left;
+		node.count = 0;
+
+		uint32_t const left_count = mid - first;
+		uint32_t const right_count = count - left_count;
+		if (depth < ctx.parallel_depth && count >= PARALLEL_MIN_TRIANGLES) {
+			std::thread worker(BuildNode, std::ref(ctx), left, first, left_count, depth + 1);
+			BuildNode(ctx, left + 1, mid, right_count, depth + 1);
+			worker.join();
+		}
+		else {
+			BuildNode(ctx, left, first, left_count, depth + 1);
+			BuildNode(ctx, left + 1, mid, right_count, depth + 1);
+		}
+	}
+
+	inline void Cross(const float* a, const float* b, float* out) {
+		out[0] = a[1] * b[2] - a[2] * b[1];
+		out[1] = a[2] * b[0] - a[0] * b[2];
+		out[2] = a[0] * b[1] - a[1] * b[0];
+	}
+
+	inline float Dot(const float* a, const float* b) {
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	struct ray_setup_t {
+		float origin[4];
+		float inv_dir[4];
+	};
+
+	ray_setup_t SetupRay(const ray_t& ray) {
+		ray_setup_t s = {};
+		for (int k = 0; k < 3; ++k) {
+			float d = ray.direction[k];
+			// Avoid 0 * inf = NaN in the slab test.
+			if (fabsf(d) < 1e-30f) {
+				d = d < 0.0f ? -1e-30f : 1e-30f;
+			}
+			s.origin[k] = ray.origin[k];
+			s.inv_dir[k] = 1.0f / d;
+		}
+		return s;
+	}
+
+#ifdef BVH_USE_SSE
+	inline bool RayBox(const bvh_node_t& node, __m128 origin, __m128 inv_dir, float t_max, float& t_enter) {
+		__m128 const t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.bounds_min), origin), inv_dir);
+		__m128 const t2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.bounds_max), origin), inv_dir);
+		// Lane 3 holds the node payload; overwrite it with the z slab.
+		__m128 lo = _mm_min_ps(t1, t2);
+		__m128 hi = _mm_max_ps(t1, t2);
+		lo = _mm_shuffle_ps(lo, lo, _MM_SHUFFLE(2, 2, 1, 0));
+		hi = _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(2, 2, 1, 0));
+		lo = _mm_max_ps(lo, _mm_shuffle_ps(lo, lo, _MM_SHUFFLE(1, 0, 3, 2)));
+		lo = _mm_max_ps(lo, _mm_shuffle_ps(lo, lo, _MM_SHUFFLE(2, 3, 0, 1)));
+		hi = _mm_min_ps(hi, _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(1, 0, 3, 2)));
+		hi = _mm_min_ps(hi, _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(2, 3, 0, 1)));
+		float const enter = std::max(_mm_cvtss_f32(lo), 0.0f);
+		float const exit = std::min(_mm_cvtss_f32(hi), t_max);
+		t_enter = enter;
+		return enter <= exit;
+	}
+#else
+	inline bool RayBox(const bvh_node_t& node, const ray_setup_t& ray, float t_max, float& t_enter) {
+		float enter = 0.0f, exit = t_max;
+		for (int k = 0; k < 3; ++k) {
+			float const t1 = (node.bounds_min[k] - ray.origin[k]) * ray.inv_dir[k];
+			float const t2 = (node.bounds_max[k] - ray.origin[k]) * ray.inv_dir[k];
+			enter = std::max(enter, std::min(t1, t2));
+			exit = std::min(exit, std::max(t1, t2));
+		}
+		t_enter = enter;
+		return enter <= exit;
+	}
+#endif
+}
+
+void Bvh::Build(const vertex_t* vertices, const uint32_t* indices, size_t index_count, unsigned thread_count) {
+	uint32_t const tri_count = static_cast<uint32_t>(index_count / 3);
+	m_nodes.clear();
+	for (std::vector<float>& component : m_triangles) {
+		component.clear();
+	}
+	m_triangleIds.clear();
+	if (tri_count == 0) {
+		return;
+	}
+
+	build_context_t ctx;
+	ctx.tri_bounds.resize(tri_count);
+	ctx.centroids.resize(tri_count * 3);
+	ctx.order.resize(tri_count);
+	for (uint32_t t = 0; t < tri_count; ++t) {
+		aabb_t& b = ctx.tri_bounds[t];
+		b.Reset();
+		for (int k = 0; k < 3; ++k) {
+			b.Grow(vertices[indices[t * 3 + k]].position);
+		}
+		for (int k = 0; k < 3; ++k) {
+			ctx.centroids[t * 3 + k] = 0.5f * (b.min[k] + b.max[k]);
+		}
+		ctx.order[t] = t;
+	}
+
+	if (thread_count == 0) {
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+	}
+	ctx.parallel_depth = 0;
+	while ((1u << ctx.parallel_depth) < thread_count) {
+		++ctx.parallel_depth;
+	}
+
+	m_nodes.resize(static_cast<size_t>(tri_count) * 2);
+	ctx.nodes = &m_nodes;
+	ctx.next_node = 1;
+	BuildNode(ctx, 0, 0, tri_count, 0);
+	m_nodes.resize(ctx.next_node);
+	m_nodes.shrink_to_fit();
+
+	// Store triangles in leaf order as (v0, e1, e2) for the hit test. The
+	// padding is degenerate and never hit.
+	for (std::vector<float>& component : m_triangles) {
+		component.assign(tri_count + LEAF_LANES - 1, 0.0f);
+	}
+	m_triangleIds.resize(tri_count);
+	for (uint32_t i = 0; i < tri_count; ++i) {
+		uint32_t const t = ctx.order[i];
+		const float* p0 = vertices[indices[t * 3 + 0]].position;
+		const float* p1 = vertices[indices[t * 3 + 1]].position;
+		const float* p2 = vertices[indices[t * 3 + 2]].position;
+		for (int k = 0; k < 3; ++k) {
+			m_triangles[V0X + k][i] = p0[k];
+			m_triangles[E1X + k][i] = p1[k] - p0[k];
+			m_triangles[E2X + k][i] = p2[k] - p0[k];
+		}
+		m_triangleIds[i] = t;
+	}
+}
+
+#ifdef BVH_USE_AVX2
+
+template <bool ANY_HIT>
+bool Bvh::IntersectLeaf(const ray_t& ray, uint32_t first, uint32_t count, ray_hit_t& hit) const {
+	__m256 const dx = _mm256_set1_ps(ray.direction[0]);
+	__m256 const dy = _mm256_set1_ps(ray.direction[1]);
+	__m256 const dz = _mm256_set1_ps(ray.direction[2]);
+	__m256 const zero = _mm256_setzero_ps();
+	__m256 const one = _mm256_set1_ps(1.0f);
+	__m256 const abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+	__m256i const lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	bool found = false;
+	for (uint32_t i = first; i < first + count; i += LEAF_LANES) {
+		auto load = [&](int component) { return _mm256_loadu_ps(&m_triangles[component][i]); };
+		__m256 const e1x = load(E1X), e1y = load(E1Y), e1z = load(E1Z);
+		__m256 const e2x = load(E2X), e2y = load(E2Y), e2z = load(E2Z);
+		// Moller-Trumbore, two-sided, as the scalar test below.
+		__m256 const px = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+		__m256 const py = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+		__m256 const pz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+		__m256 const det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, px), _mm256_mul_ps(e1y, py)), _mm256_mul_ps(e1z, pz));
+		__m256 valid = _mm256_cmp_ps(_mm256_and_ps(det, abs_mask), _mm256_set1_ps(1e-12f), _CMP_GE_OQ);
+		valid = _mm256_and_ps(valid, _mm256_castsi256_ps(
+			_mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(first + count - i)), lane)
+		));
+		__m256 const inv_det = _mm256_div_ps(one, det);
+		__m256 const sx = _mm256_sub_ps(_mm256_set1_ps(ray.origin[0]), load(V0X));
+		__m256 const sy = _mm256_sub_ps(_mm256_set1_ps(ray.origin[1]), load(V0Y));
+		__m256 const sz = _mm256_sub_ps(_mm256_set1_ps(ray.origin[2]), load(V0Z));
+		__m256 const u = _mm256_mul_ps(
+			_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, px), _mm256_mul_ps(sy, py)), _mm256_mul_ps(sz, pz)), inv_det
+		);
+		valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(u, zero, _CMP_GE_OQ), _mm256_cmp_ps(u, one, _CMP_LE_OQ)));
+		__m256 const qx = _mm256_sub_ps(_mm256_mul_ps(sy, e1z), _mm256_mul_ps(sz, e1y));
+		__m256 const qy = _mm256_sub_ps(_mm256_mul_ps(sz, e1x), _mm256_mul_ps(sx, e1z));
+		__m256 const qz = _mm256_sub_ps(_mm256_mul_ps(sx, e1y), _mm256_mul_ps(sy, e1x));
+		__m256 const v = _mm256_mul_ps(
+			_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz)), inv_det
+		);
+		valid = _mm256_and_ps(valid, _mm256_and_ps(
+			_mm256_cmp_ps(v, zero, _CMP_GE_OQ), _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ)
+		));
+		__m256 const t = _mm256_mul_ps(
+			_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)), inv_det
+		);
+		valid = _mm256_and_ps(valid, _mm256_and_ps(
+			_mm256_cmp_ps(t, zero, _CMP_GT_OQ), _mm256_cmp_ps(t, _mm256_set1_ps(hit.t), _CMP_LT_OQ)
+		));
+		int mask = _mm256_movemask_ps(valid);
+		if (mask == 0) {
+			continue;
+		}
+		// Closest lane: the minimum over the valid ones, the first on a tie.
+		alignas(32) float ts[LEAF_LANES], us[LEAF_LANES], vs[LEAF_LANES];
+		_mm256_store_ps(ts, t);
+		_mm256_store_ps(us, u);
+		_mm256_store_ps(vs, v);
+		int best = -1;
+		for (; mask; mask &= mask - 1) {
+#ifdef _MSC_VER
+			unsigned long bit;
+			_BitScanForward(&bit, static_cast<unsigned long>(mask));
+			int const k = static_cast<int>(bit);
+#else
+			int const k = __builtin_ctz(static_cast<unsigned>(mask));
+#endif
+			if (best < 0 || ts[k] < ts[best]) {
+				best = k;
+			}
+		}
+		hit = { ts[best], us[best], vs[best], m_triangleIds[i + best] };
+		found = true;
+		if (ANY_HIT) {
+			return true;
+		}
+	}
+	return found;
+}
+
+#else
+
+template <bool ANY_HIT>
+bool Bvh::IntersectLeaf(const ray_t& ray, uint32_t first, uint32_t count, ray_hit_t& hit) const {
+	bool found = false;
+	for (uint32_t i = first; i < first + count; ++i) {
+		// Moller-Trumbore, two-sided.
+		float const v0[3] = { m_triangles[V0X][i], m_triangles[V0Y][i], m_triangles[V0Z][i] };
+		float const e1[3] = { m_triangles[E1X][i], m_triangles[E1Y][i], m_triangles[E1Z][i] };
+		float const e2[3] = { m_triangles[E2X][i], m_triangles[E2Y][i], m_triangles[E2Z][i] };
+		float p[3], q[3], s[3];
+		Cross(ray.direction, e2, p);
+		float const det = Dot(e1, p);
+		if (fabsf(det) < 1e-12f) {
+			continue;
+		}
+		float const inv_det = 1.0f / det;
+		for (int k = 0; k < 3; ++k) {
+			s[k] = ray.origin[k] - v0[k];
+		}
+		float const u = Dot(s, p) * inv_det;
+		if (u < 0.0f || u > 1.0f) {
+			continue;
+		}
+		Cross(s, e1, q);
+		float const v = Dot(ray.direction, q) * inv_det;
+		if (v < 0.0f || u + v > 1.0f) {
+			continue;
+		}
+		float const t = Dot(e2, q) * inv_det;
+		if (t > 0.0f && t < hit.t) {
+			hit = { t, u, v, m_triangleIds[i] };
+			found = true;
+			if (ANY_HIT) {
+				return true;
+			}
+		}
+	}
+	return found;
+}
+
+#endif
+
+template <bool ANY_HIT>
+bool Bvh::Traverse(const ray_t& ray, ray_hit_t& hit) const {
+	hit.t = ray.t_max;
+	hit.triangle = UINT32_MAX;
+	if (m_nodes.empty()) {
+		return false;
+	}
+
+	ray_setup_t const setup = SetupRay(ray);
+#ifdef BVH_USE_SSE
+	__m128 const origin = _mm_loadu_ps(setup.origin);
+	__m128 const inv_dir = _mm_loadu_ps(setup.inv_dir);
+#define BVH_RAY_BOX(n, t_enter) RayBox(n, origin, inv_dir, hit.t, t_enter)
+#else
+#define BVH_RAY_BOX(n, t_enter) RayBox(n, setup, hit.t, t_enter)
+#endif
+
+	float t_root;
+	if (!BVH_RAY_BOX(m_nodes[0], t_root)) {
+		return false;
+	}
+
+	// Far children wait on the stack with the distance at which the ray
+	// enters them, and are dropped once a closer hit has been found.
+	uint32_t stack[STACK_SIZE];
+	float stack_t[STACK_SIZE];
+	int sp = 0;
+	uint32_t node_index = 0;
+	for (;;) {
+		const bvh_node_t& node = m_nodes[node_index];
+		if (node.count) {
+			if (IntersectLeaf<ANY_HIT>(ray, node.left_or_first, node.count, hit) && ANY_HIT) {
+				return true;
+			}
+		}
+		else {
+			uint32_t near_child = node.left_or_first;
+			uint32_t far_child = near_child + 1;
+			float t_near, t_far;
+			bool const hit_near = BVH_RAY_BOX(m_nodes[near_child], t_near);
+			bool const hit_far = BVH_RAY_BOX(m_nodes[far_child], t_far);
+			if (hit_near && hit_far) {
+				if (t_far < t_near) {
+					std::swap(near_child, far_child);
+					std::swap(t_near, t_far);
+				}
+				stack[sp] = far_child;
+				stack_t[sp++] = t_far;
+				node_index = near_child;
+				continue;
+			}
+			if (hit_near || hit_far) {
+				node_index = hit_near ? near_child : far_child;
+				continue;
+			}
+		}
+		do {
+			if (sp == 0) {
+#undef BVH_RAY_BOX
+				return hit.triangle != UINT32_MAX;
+			}
+			--sp;
+		} while (stack_t[sp] > hit.t);
+		node_index = stack[sp];
+	}
+}
+
+bool Bvh::Intersect(const ray_t& ray, ray_hit_t& hit) const {
+	return Traverse<false>(ray, hit);
+}
+
+bool Bvh::Occluded(const ray_t& ray) const {
+	ray_hit_t hit;
+	return Traverse<true>(ray, hit);
+}
+
+void Bvh::QueryAabb(const float box_min[3], const float box_max[3], std::vector<uint32_t>& triangles) const {
+	if (m_nodes.empty()) {
+		return;
+	}
+	auto overlaps = [&](const float* lo, const float* hi) {
+		return lo[0] <= box_max[0] && hi[0] >= box_min[0] &&
+			lo[1] <= box_max[1] && hi[1] >= box_min[1] &&
+			lo[2] <= box_max[2] && hi[2] >= box_min[2];
+	};
+
+	uint32_t stack[STACK_SIZE];
+	int sp = 0;
+	stack[sp++] = 0;
+	while (sp > 0) {
+		const bvh_node_t& node = m_nodes[stack[--sp]];
+		if (!overlaps(node.bounds_min, node.bounds_max)) {
+			continue;
+		}
+		if (node.count == 0) {
+			stack[sp++] = node.left_or_first;
+			stack[sp++] = node.left_or_first + 1;
+			continue;
+		}
+		for (uint32_t i = node.left_or_first; i < node.left_or_first + node.count; ++i) {
+			float lo[3], hi[3];
+			for (int k = 0; k < 3; ++k) {
+				float const a = m_triangles[V0X + k][i], b = a + m_triangles[E1X + k][i], c = a + m_triangles[E2X + k][i];
+				lo[k] = std::min(a, std::min(b, c));
+				hi[k] = std::max(a, std::max(b, c));
+			}
+			if (overlaps(lo, hi)) {
+				triangles.push_back(m_triangleIds[i]);
+			}
+		}
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Vertex.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct bvh_node_t {
+    float bounds_min[3];
+    uint32_t left_or_first;     // first child for inner nodes, first triangle for leaves
+    float bounds_max[3];
+    uint32_t count;             // triangles in a leaf, 0 for inner nodes
+};
+
+struct ray_t {
+    float origin[3];
+    float direction[3];
+    float t_max;
+};
+
+struct ray_hit_t {
+    float t;
+    float u;
+    float v;
+    uint32_t triangle;          // index of the triangle in the source index list / 3
+};
+
+// Bounding volume hierarchy over triangles, built with binned SAH.
+class Bvh
+{
+public:
+    // thread_count 0 uses every hardware thread.
+    void Build(const vertex_t* vertices, const uint32_t* indices, size_t index_count, unsigned thread_count = 0);
+
+    // Closest hit along the ray within (0, t_max].
+    bool Intersect(const ray_t& ray, ray_hit_t& hit) const;
+    // True as soon as any triangle is hit within (0, t_max].
+    bool Occluded(const ray_t& ray) const;
+    // Appends triangles whose bounds overlap the box.
+    void QueryAabb(const float box_min[3], const float box_max[3], std::vector<uint32_t>& triangles) const;
+
+    size_t NodeCount() const { return m_nodes.size(); }
+    size_t TriangleCount() const { return m_triangleIds.size(); }
+    const bvh_node_t* Nodes() const { return m_nodes.data(); }
+
+private:
+    // Components of the triangles' v0, e1 = v1 - v0 and e2 = v2 - v0, in
+    // that order, x y z each.
+    enum { V0X, V0Y, V0Z, E1X, E1Y, E1Z, E2X, E2Y, E2Z, TRIANGLE_COMPONENTS };
+
+    template <bool ANY_HIT>
+    bool Traverse(const ray_t& ray, ray_hit_t& hit) const;
+    template <bool ANY_HIT>
+    bool IntersectLeaf(const ray_t& ray, uint32_t first, uint32_t count, ray_hit_t& hit) const;
+
+    std::vector<bvh_node_t> m_nodes;
+    // Triangles in leaf order, one array per component so a leaf is tested
+    // eight triangles at a time where AVX2 is available; padded so those
+    // loads stay in bounds.
+    std::vector<float> m_triangles[TRIANGLE_COMPONENTS];
+    std::vector<uint32_t> m_triangleIds;
+};
@@ -0,0 +1,180 @@
+#include "ReportTools.h"
+#include "Bvh.h"
+#include "MeshWeld.h"
+#include "SceneAsset.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+	// Closest hit of the ray over every triangle, with the Bvh's two-sided
+	// test. triangle is UINT32_MAX on a miss.
+	ray_hit_t BruteForceHit(const vertex_t* vertices, const uint32_t* indices, size_t triangle_count, const ray_t& ray) {
+		ray_hit_t hit = { ray.t_max, 0.0f, 0.0f, UINT32_MAX };
+		const float* d = ray.direction;
+		for (size_t i = 0; i < triangle_count; ++i) {
+			const float* p0 = vertices[indices[i * 3 + 0]].position;
+			const float* p1 = vertices[indices[i * 3 + 1]].position;
+			const float* p2 = vertices[indices[i * 3 + 2]].position;
+			float const e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float const e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float const p[3] = { d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0] };
+			float const det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+			if (fabsf(det) < 1e-12f) {
+				continue;
+			}
+			float const inv_det = 1.0f / det;
+			float const s[3] = { ray.origin[0] - p0[0], ray.origin[1] - p0[1], ray.origin[2] - p0[2] };
+			float const u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv_det;
+			if (u < 0.0f || u > 1.0f) {
+				continue;
+			}
+			float const q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+			float const v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inv_det;
+			if (v < 0.0f || u + v > 1.0f) {
+				continue;
+			}
+			float const t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inv_det;
+			if (t > 0.0f && t < hit.t) {
+				hit = { t, u, v, static_cast<uint32_t>(i) };
+			}
+		}
+		return hit;
+	}
+
+	// How close a hit lies to its triangle's border, in barycentrics. Rays
+	// that close to an edge may fall either side of it with a different
+	// operation order, so disagreements there are not errors.
+	float HitEdgeMargin(const ray_hit_t& hit) {
+		return (std::min)((std::min)(hit.u, hit.v), 1.0f - hit.u - hit.v);
+	}
+}
+
+// Builds a Bvh over the welded room and over a grid of rooms of about
+// the given number of triangles, and checks Intersect and Occluded on
+// random rays, and QueryAabb on random boxes, against brute force over
+// every triangle. Prints the build time and Mrays/s on one thread. Fails
+// on any disagreement away from triangle edges.
+//   --ray-report [rays.txt] [million triangles]
+int RayReportTool(const std::vector<std::string>& args) {
+	double const target_triangles = (args.size() > 2 ? std::stod(args[2]) : 10.0) * 1e6;
+	size_t const TIMED_RAYS = 1000000;
+	size_t const BOXES = 200;
+	float const EDGE_MARGIN = 1e-4f;
+
+	std::vector<vertex_t> const room = SceneSourceVertices();
+	indexed_mesh_t const welded = WeldVertices(room.data(), room.size());
+	uint32_t const size = (std::max)(1u, static_cast<uint32_t>(ceil(sqrt(target_triangles / (room.size() / 3)))));
+	indexed_mesh_t scene;
+	scene.vertices = ReportGrid(room, size, size);
+	scene.indices.resize(scene.vertices.size());
+	for (size_t i = 0; i < scene.indices.size(); ++i) {
+		scene.indices[i] = static_cast<uint32_t>(i);
+	}
+
+	FILE* out = OpenReport(args, "rays.txt");
+	if (!out) {
+		return 1;
+	}
+	size_t failures = 0;
+	struct input_t {
+		const char* name;
+		const indexed_mesh_t* mesh;
+		size_t checked_rays;
+	};
+	input_t const inputs[] = { { "room", &welded, 20000 }, { "grid", &scene, 50 } };
+	for (const input_t& input : inputs) {
+		const indexed_mesh_t& mesh = *input.mesh;
+		size_t const triangle_count = mesh.indices.size() / 3;
+		Bvh bvh;
+		auto start = std::chrono::steady_clock::now();
+		bvh.Build(mesh.vertices.data(), mesh.indices.data(), mesh.indices.size());
+		double const build_seconds = Seconds(start);
+
+		// Against brute force.
+		std::vector<ray_t> const checked = RandomRays(mesh.vertices, input.checked_rays, 7);
+		size_t hit_errors = 0, occlusion_errors = 0, query_errors = 0;
+		for (ray_t ray : checked) {
+			ray_hit_t const reference = BruteForceHit(mesh.vertices.data(), mesh.indices.data(), triangle_count, ray);
+			bool const ended = reference.triangle != UINT32_MAX;
+			if (bvh.Occluded(ray) != ended) {
+				// Fine only for a hit near an edge or the end of the segment.
+				ray_hit_t any = reference;
+				bool const hit = ended || bvh.Intersect(ray, any);
+				occlusion_errors += !hit || (HitEdgeMargin(any) > EDGE_MARGIN && any.t < ray.t_max * (1.0f - 1e-4f));
+			}
+
+			ray.t_max = FLT_MAX;
+			ray_hit_t const closest = BruteForceHit(mesh.vertices.data(), mesh.indices.data(), triangle_count, ray);
+			ray_hit_t hit;
+			bool const found = bvh.Intersect(ray, hit);
+			bool const expected = closest.triangle != UINT32_MAX;
+			if (found != expected) {
+				hit_errors += HitEdgeMargin(found ? hit : closest) > EDGE_MARGIN;
+			}
+			else if (found && fabsf(hit.t - closest.t) > 1e-4f * (std::max)(1.0f, closest.t)) {
+				hit_errors += HitEdgeMargin(closest) > EDGE_MARGIN && HitEdgeMargin(hit) > EDGE_MARGIN;
+			}
+		}
+
+		// Boxes around random points, up to a tenth of the bounds across.
+		std::vector<ray_t> const centers = RandomRays(mesh.vertices, BOXES, 11);
+		std::vector<uint32_t> found;
+		for (const ray_t& center : centers) {
+			float box_min[3], box_max[3];
+			for (int k = 0; k < 3; ++k) {
+				float const half = 0.05f * fabsf(center.direction[k]);
+				box_min[k] = center.origin[k] - half;
+				box_max[k] = center.origin[k] + half;
+			}
+			found.clear();
+			bvh.QueryAabb(box_min, box_max, found);
+			std::sort(found.begin(), found.end());
+			std::vector<uint32_t> expected;
+			for (size_t i = 0; i < triangle_count; ++i) {
+				bool overlaps = true;
+				const float* p0 = mesh.vertices[mesh.indices[i * 3 + 0]].position;
+				const float* p1 = mesh.vertices[mesh.indices[i * 3 + 1]].position;
+				const float* p2 = mesh.vertices[mesh.indices[i * 3 + 2]].position;
+				for (int k = 0; k < 3; ++k) {
+					// As the Bvh stores them: v0 and its edges.
+					float const a = p0[k], b = a + (p1[k] - a), c = a + (p2[k] - a);
+					overlaps = overlaps && (std::min)(a, (std::min)(b, c)) <= box_max[k] &&
+						(std::max)(a, (std::max)(b, c)) >= box_min[k];
+				}
+				if (overlaps) {
+					expected.push_back(static_cast<uint32_t>(i));
+				}
+			}
+			query_errors += found != expected;
+		}
+
+		// Throughput.
+		std::vector<ray_t> rays = RandomRays(mesh.vertices, TIMED_RAYS, 3);
+		size_t hits = 0, occluded = 0;
+		start = std::chrono::steady_clock::now();
+		for (const ray_t& ray : rays) {
+			occluded += bvh.Occluded(ray);
+		}
+		double const occluded_seconds = Seconds(start);
+		for (ray_t& ray : rays) {
+			ray.t_max = FLT_MAX;
+		}
+		start = std::chrono::steady_clock::now();
+		for (const ray_t& ray : rays) {
+			ray_hit_t hit;
+			hits += bvh.Intersect(ray, hit);
+		}
+		double const intersect_seconds = Seconds(start);
+
+		fprintf(out, "%s: %zu triangles, %zu nodes, built in %.3f s; Intersect %.2f Mrays/s (%.0f%% hit), "
+			"Occluded %.2f Mrays/s (%.0f%% occluded)\n",
+			input.name, triangle_count, bvh.NodeCount(), build_seconds,
+			TIMED_RAYS / intersect_seconds / 1e6, 100.0 * hits / TIMED_RAYS,
+			TIMED_RAYS / occluded_seconds / 1e6, 100.0 * occluded / TIMED_RAYS);
+		fprintf(out, "%s: %zu rays and %zu boxes against brute force, %zu hit errors, %zu occlusion errors, %zu query errors\n",
+			input.name, checked.size(), centers.size(), hit_errors, occlusion_errors, query_errors);
+		failures += hit_errors + occlusion_errors + query_errors;
+	}
+	return CloseReport(out, failures);
+}
@@ -0,0 +1,405 @@
+#include "Collision.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// Distance kept between a sliding sphere and the surface it touches, so
+	// the next sweep does not start in contact through rounding.
+	float const CONTACT_SKIN = 1e-3f;
+	int const MAX_SLIDE_ITERATIONS = 4;
+	int const MAX_SEPARATE_ITERATIONS = 8;
+	float const MIN_DISPLACEMENT = 1e-6f;
+
+	float Dot(const float* a, const float* b) {
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	void Sub(const float* a, const float* b, float* out) {
+		for (int k = 0; k < 3; ++k) {
+			out[k] = a[k] - b[k];
+		}
+	}
+
+	void Cross(const float* a, const float* b, float* out) {
+		out[0] = a[1] * b[2] - a[2] * b[1];
+		out[1] = a[2] * b[0] - a[0] * b[2];
+		out[2] = a[0] * b[1] - a[1] * b[0];
+	}
+
+	// First time in [0, t_max] at which a*t^2 + b*t + c, a squared distance
+	// minus the squared radius, reaches zero. Already overlapping counts as
+	// contact at 0 while the distance is still shrinking.
+	bool LowestRoot(float a, float b, float c, float t_max, float& root) {
+		if (c < 0.0f) {
+			root = 0.0f;
+			return b < 0.0f;
+		}
+		if (a < 1e-12f) {
+			return false;
+		}
+		float const determinant = b * b - 4.0f * a * c;
+		if (determinant < 0.0f) {
+			return false;
+		}
+		float const s = std::sqrt(determinant);
+		float r1 = (-b - s) / (2.0f * a);
+		float r2 = (-b + s) / (2.0f * a);
+		if (r1 > r2) {
+			std::swap(r1, r2);
+		}
+		if (r1 >= 0.0f && r1 <= t_max) {
+			root = r1;
+			return true;
+		}
+		if (r2 >= 0.0f && r2 <= t_max) {
+			root = r2;
+			return true;
+		}
+		return false;
+	}
+
+	// Point on the plane of the triangle, tested with barycentric coordinates.
+	bool InsideTriangle(const float* q, const float (&p)[3][3]) {
+		float e1[3], e2[3], d[3];
+		Sub(p[1], p[0], e1);
+		Sub(p[2], p[0], e2);
+		Sub(q, p[0], d);
+		float const d11 = Dot(e1, e1), d12 = Dot(e1, e2), d22 = Dot(e2, e2);
+		float const d1 = Dot(d, e1), d2 = Dot(d, e2);
+		float const denominator = d11 * d22 - d12 * d12;
+		if (denominator <= 0.0f) {
+			return false;
+		}
+		float const u = (d22 * d1 - d12 * d2) / denominator;
+		float const v = (d11 * d2 - d12 * d1) / denominator;
+		return u >= 0.0f && v >= 0.0f && u + v <= 1.0f;
+	}
+
+	// Ericson, "Real-Time Collision Detection", 5.1.5.
+	void ClosestPointOnTriangle(const float* q, const float (&p)[3][3], float* out) {
+		float ab[3], ac[3], ap[3];
+		Sub(p[1], p[0], ab);
+		Sub(p[2], p[0], ac);
+		Sub(q, p[0], ap);
+		float const d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+		if (d1 <= 0.0f && d2 <= 0.0f) {
+			std::copy(p[0], p[0] + 3, out);
+			return;
+		}
+		float bp[3];
+		Sub(q, p[1], bp);
+		float const d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+		if (d3 >= 0.0f && d4 <= d3) {
+			std::copy(p[1], p[1] + 3, out);
+			return;
+		}
+		float const vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+			float const v = d1 / (d1 - d3);
+			for (int k = 0; k < 3; ++k) {
+				out[k] = p[0][k] + v * ab[k];
+			}
+			return;
+		}
+		float cp[3];
+		Sub(q, p[2], cp);
+		float const d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+		if (d6 >= 0.0f && d5 <= d6) {
+			std::copy(p[2], p[2] + 3, out);
+			return;
+		}
+		float const vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+			float const w = d2 / (d2 - d6);
+			for (int k = 0; k < 3; ++k) {
+				out[k] = p[0][k] + w * ac[k];
+			}
+			return;
+		}
+		float const va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+			float const w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+			for (int k = 0; k < 3; ++k) {
+				out[k] = p[1][k] + w * (p[2][k] - p[1][k]);
+			}
+			return;
+		}
+		float const denominator = 1.0f / (va + vb + vc);
+		float const v = vb * denominator, w = vc * denominator;
+		for (int k = 0; k < 3; ++k) {
+			out[k] = p[0][k] + ab[k] * v + ac[k] * w;
+		}
+	}
+
+	// Time interval in which a sphere moving by velocity touches the plane
+	// of the triangle, seen from the side the sphere starts on.
+	struct plane_contact_t {
+		float normal[3];
+		float distance;
+		float approach;
+		float t0;
+		float t1;
+		bool embedded;
+	};
+
+	bool PlaneContact(
+		const float* center, float radius, const float* velocity, const float* triangle_normal,
+		const float* p0, float t_max, plane_contact_t& contact
+	) {
+		float to_center[3];
+		Sub(center, p0, to_center);
+		float const side = Dot(to_center, triangle_normal) < 0.0f ? -1.0f : 1.0f;
+		for (int k = 0; k < 3; ++k) {
+			contact.normal[k] = side * triangle_normal[k];
+		}
+		contact.distance = Dot(to_center, contact.normal);
+		contact.approach = Dot(contact.normal, velocity);
+		contact.embedded = false;
+		if (contact.approach >= 0.0f) {
+			if (contact.distance >= radius) {
+				return false;
+			}
+			// Within a radius of the plane and not closing in: the face is
+			// out of reach, but an edge or corner can still be run into
+			// until the sphere has left the plane's reach.
+			contact.embedded = true;
+			contact.t0 = 0.0f;
+			contact.t1 = contact.approach > 0.0f ? std::min((radius - contact.distance) / contact.approach, 1.0f) : 1.0f;
+			return true;
+		}
+		contact.t0 = (contact.distance - radius) / -contact.approach;
+		contact.t1 = (contact.distance + radius) / -contact.approach;
+		if (contact.t0 > t_max || contact.t1 < 0.0f) {
+			return false;
+		}
+		contact.t0 = std::max(contact.t0, 0.0f);
+		contact.t1 = std::min(contact.t1, 1.0f);
+		return true;
+	}
+
+	// Where the sphere first touches the plane, when that is inside the
+	// triangle no edge or corner can be touched earlier.
+	bool SweepFace(
+		const float* center, const float* velocity, const float (&p)[3][3], const plane_contact_t& contact,
+		float* point
+	) {
+		if (contact.embedded) {
+			return false;
+		}
+		for (int k = 0; k < 3; ++k) {
+			point[k] = center[k] + contact.t0 * velocity[k]
+				- (contact.distance + contact.t0 * contact.approach) * contact.normal[k];
+		}
+		return InsideTriangle(point, p);
+	}
+
+	// Corners and edges, after Fauerby, "Improved Collision detection and
+	// Response". Lowers t only for contacts earlier than the current t.
+	bool SweepEdges(
+		const float* center, float radius, const float* velocity, const float (&p)[3][3],
+		const plane_contact_t& contact, float& t, float* point, float* normal
+	) {
+		bool found = false;
+		float const speed_sq = Dot(velocity, velocity);
+		float const radius_sq = radius * radius;
+		float best = std::min(t, contact.t1);
+		for (int i = 0; i < 3; ++i) {
+			float base[3];
+			Sub(center, p[i], base);
+			float root;
+			if (LowestRoot(speed_sq, 2.0f * Dot(velocity, base), Dot(base, base) - radius_sq, best, root)) {
+				best = root;
+				std::copy(p[i], p[i] + 3, point);
+				found = true;
+			}
+		}
+		for (int i = 0; i < 3; ++i) {
+			const float* a = p[i];
+			const float* b = p[(i + 1) % 3];
+			float edge[3], base[3];
+			Sub(b, a, edge);
+			Sub(a, center, base);
+			float const edge_sq = Dot(edge, edge);
+			float const edge_velocity = Dot(edge, velocity);
+			float const edge_base = Dot(edge, base);
+			// Squared distance to the edge's line, scaled by edge_sq.
+			float root;
+			if (!LowestRoot(
+				edge_sq * speed_sq - edge_velocity * edge_velocity,
+				2.0f * edge_velocity * edge_base - edge_sq * 2.0f * Dot(velocity, base),
+				edge_sq * (Dot(base, base) - radius_sq) - edge_base * edge_base,
+				best, root
+			)) {
+				continue;
+			}
+			float const f = (edge_velocity * root - edge_base) / edge_sq;
+			if (f >= 0.0f && f <= 1.0f) {
+				best = root;
+				for (int k = 0; k < 3; ++k) {
+					point[k] = a[k] + f * edge[k];
+				}
+				found = true;
+			}
+		}
+		if (!found) {
+			return false;
+		}
+
+		t = best;
+		float away[3];
+		for (int k = 0; k < 3; ++k) {
+			away[k] = center[k] + t * velocity[k] - point[k];
+		}
+		float const away_length = std::sqrt(Dot(away, away));
+		for (int k = 0; k < 3; ++k) {
+			normal[k] = away_length > 0.0f ? away[k] / away_length : contact.normal[k];
+		}
+		return true;
+	}
+}
+
+void CollisionWorld::Build(const vertex_t* vertices, const uint32_t* indices, size_t index_count) {
+	m_triangles.resize(index_count / 3);
+	for (size_t t = 0; t < m_triangles.size(); ++t) {
+		triangle_t& triangle = m_triangles[t];
+		for (int c = 0; c < 3; ++c) {
+			const float* position = vertices[indices[t * 3 + c]].position;
+			std::copy(position, position + 3, triangle.p[c]);
+		}
+		float e1[3], e2[3];
+		Sub(triangle.p[1], triangle.p[0], e1);
+		Sub(triangle.p[2], triangle.p[0], e2);
+		Cross(e1, e2, triangle.normal);
+		float const length = std::sqrt(Dot(triangle.normal, triangle.normal));
+		for (int k = 0; k < 3; ++k) {
+			triangle.normal[k] = length > 0.0f ? triangle.normal[k] / length : 0.0f;
+		}
+	}
+	m_bvh.Build(vertices, indices, index_count);
+}
+
+bool CollisionWorld::SweepSphere(
+	const float center[3], float radius, const float displacement[3], sphere_hit_t& hit
+) const {
+	float box_min[3], box_max[3];
+	for (int k = 0; k < 3; ++k) {
+		float const end = center[k] + displacement[k];
+		box_min[k] = std::min(center[k], end) - radius;
+		box_max[k] = std::max(center[k], end) + radius;
+	}
+	// Reused between queries to keep them free of allocations.
+	thread_local std::vector<uint32_t> candidates;
+	candidates.clear();
+	m_bvh.QueryAabb(box_min, box_max, candidates);
+
+	// Faces first: the cheap plane test settles most triangles, and the
+	// earliest face contact then rules out edges that would be touched later.
+	thread_local std::vector<uint32_t> edge_candidates;
+	edge_candidates.clear();
+	bool found = false;
+	hit.t = 1.0f;
+	for (uint32_t triangle : candidates) {
+		const triangle_t& tri = m_triangles[triangle];
+		plane_contact_t contact;
+		if (!PlaneContact(center, radius, displacement, tri.normal, tri.p[0], hit.t, contact)) {
+			continue;
+		}
+		float point[3];
+		if (SweepFace(center, displacement, tri.p, contact, point)) {
+			hit.t = contact.t0;
+			std::copy(point, point + 3, hit.point);
+			std::copy(contact.normal, contact.normal + 3, hit.normal);
+			hit.triangle = triangle;
+			found = true;
+		} else {
+			edge_candidates.push_back(triangle);
+		}
+	}
+	for (uint32_t triangle : edge_candidates) {
+		const triangle_t& tri = m_triangles[triangle];
+		plane_contact_t contact;
+		if (PlaneContact(center, radius, displacement, tri.normal, tri.p[0], hit.t, contact) &&
+			SweepEdges(center, radius, displacement, tri.p, contact, hit.t, hit.point, hit.normal)) {
+			hit.triangle = triangle;
+			found = true;
+		}
+	}
+	return found;
+}
+
+void CollisionWorld::MoveSphere(
+	const float center[3], float radius, const float displacement[3], float result[3]
+) const {
+	float position[3], remaining[3];
+	std::copy(center, center + 3, position);
+	std::copy(displacement, displacement + 3, remaining);
+	for (int iteration = 0; iteration < MAX_SLIDE_ITERATIONS; ++iteration) {
+		float const length = std::sqrt(Dot(remaining, remaining));
+		if (length < MIN_DISPLACEMENT) {
+			break;
+		}
+		sphere_hit_t hit;
+		if (!SweepSphere(position, radius, remaining, hit)) {
+			for (int k = 0; k < 3; ++k) {
+				position[k] += remaining[k];
+			}
+			break;
+		}
+
+		// Stop just short of the contact, then slide the rest of the way
+		// along the plane tangent to the sphere at the contact point.
+		float const travel = std::max(hit.t * length - CONTACT_SKIN, 0.0f);
+		for (int k = 0; k < 3; ++k) {
+			position[k] += remaining[k] / length * travel;
+			remaining[k] *= 1.0f - hit.t;
+		}
+		float const into = std::min(Dot(remaining, hit.normal), 0.0f);
+		for (int k = 0; k < 3; ++k) {
+			remaining[k] -= into * hit.normal[k];
+		}
+	}
+	std::copy(position, position + 3, result);
+}
+
+bool CollisionWorld::SeparateSphere(const float center[3], float radius, float result[3]) const {
+	float position[3];
+	std::copy(center, center + 3, position);
+	bool moved = false;
+	thread_local std::vector<uint32_t> candidates;
+	for (int iteration = 0; iteration < MAX_SEPARATE_ITERATIONS; ++iteration) {
+		float box_min[3], box_max[3];
+		for (int k = 0; k < 3; ++k) {
+			box_min[k] = position[k] - radius;
+			box_max[k] = position[k] + radius;
+		}
+		candidates.clear();
+		m_bvh.QueryAabb(box_min, box_max, candidates);
+
+		// Leave the deepest overlap along the direction from its closest
+		// point; shallower ones are handled by the following iterations.
+		float push[3] = { 0.0f, 0.0f, 0.0f };
+		float deepest = 0.0f;
+		for (uint32_t triangle : candidates) {
+			float closest[3], away[3];
+			ClosestPointOnTriangle(position, m_triangles[triangle].p, closest);
+			Sub(position, closest, away);
+			float const distance = std::sqrt(Dot(away, away));
+			if (distance >= radius || distance <= 0.0f || radius - distance <= deepest) {
+				continue;
+			}
+			deepest = radius - distance;
+			for (int k = 0; k < 3; ++k) {
+				push[k] = away[k] / distance * (deepest + CONTACT_SKIN);
+			}
+		}
+		if (deepest <= 0.0f) {
+			break;
+		}
+		for (int k = 0; k < 3; ++k) {
+			position[k] += push[k];
+		}
+		moved = true;
+	}
+	std::copy(position, position + 3, result);
+	return moved;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Bvh.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct sphere_hit_t {
+    float t;                    // fraction of the displacement travelled before contact
+    float point[3];             // contact point on the triangle
+    float normal[3];            // unit vector from the contact point towards the sphere center
+    uint32_t triangle;          // index of the triangle in the source index list / 3
+};
+
+// Static triangle soup the player collides with. A Bvh box query collects
+// the triangles near a sphere's path; the exact time of impact is then
+// found against each triangle's face, edges and corners.
+// Triangles are two-sided, so open and single-sided geometry still blocks.
+class CollisionWorld
+{
+public:
+    void Build(const vertex_t* vertices, const uint32_t* indices, size_t index_count);
+
+    // Earliest contact of a sphere moved from center by displacement; false
+    // when the whole path is free. A sphere that already overlaps a
+    // triangle it is moving into reports t = 0.
+    bool SweepSphere(const float center[3], float radius, const float displacement[3], sphere_hit_t& hit) const;
+    // Moves the sphere as far as it can, sliding along whatever it touches
+    // for the remainder of the displacement, and writes the final center.
+    void MoveSphere(const float center[3], float radius, const float displacement[3], float result[3]) const;
+    // Pushes a sphere out of the triangles it overlaps, e.g. at a spawn
+    // point, and writes the new center. False when it was already free.
+    // A center lying exactly on a triangle has no direction to leave by
+    // and stays put.
+    bool SeparateSphere(const float center[3], float radius, float result[3]) const;
+
+    size_t TriangleCount() const { return m_triangles.size(); }
+
+private:
+    struct triangle_t {
+        float p[3][3];
+        float normal[3];        // unit length, zero for degenerate triangles
+    };
+
+    Bvh m_bvh;
+    std::vector<triangle_t> m_triangles;
+};
@@ -0,0 +1,327 @@
+#include "ReportTools.h"
+#include "Collision.h"
+#include "MeshWeld.h"
+#include "SceneAsset.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <utility>
+
+namespace {
+	// Distance from p to triangle (a, b, c): to the plane when p projects
+	// inside, otherwise to the nearest edge.
+	double TriangleDistance(const double* p, const float* a, const float* b, const float* c) {
+		const float* const corners[3] = { a, b, c };
+		double e1[3], e2[3], d[3];
+		for (int k = 0; k < 3; ++k) {
+			e1[k] = double(b[k]) - a[k];
+			e2[k] = double(c[k]) - a[k];
+			d[k] = p[k] - a[k];
+		}
+		double const d11 = e1[0] * e1[0] + e1[1] * e1[1] + e1[2] * e1[2];
+		double const d12 = e1[0] * e2[0] + e1[1] * e2[1] + e1[2] * e2[2];
+		double const d22 = e2[0] * e2[0] + e2[1] * e2[1] + e2[2] * e2[2];
+		double const d1 = d[0] * e1[0] + d[1] * e1[1] + d[2] * e1[2];
+		double const d2 = d[0] * e2[0] + d[1] * e2[1] + d[2] * e2[2];
+		double const denominator = d11 * d22 - d12 * d12;
+		if (denominator > 0.0) {
+			double const u = (d22 * d1 - d12 * d2) / denominator;
+			double const v = (d11 * d2 - d12 * d1) / denominator;
+			if (u >= 0.0 && v >= 0.0 && u + v <= 1.0) {
+				double squared = 0.0;
+				for (int k = 0; k < 3; ++k) {
+					double const q = d[k] - u * e1[k] - v * e2[k];
+					squared += q * q;
+				}
+				return sqrt(squared);
+			}
+		}
+		double nearest = DBL_MAX;
+		for (int i = 0; i < 3; ++i) {
+			const float* s = corners[i];
+			const float* e = corners[(i + 1) % 3];
+			double edge[3], to_p[3];
+			double edge_sq = 0.0, along = 0.0;
+			for (int k = 0; k < 3; ++k) {
+				edge[k] = double(e[k]) - s[k];
+				to_p[k] = p[k] - s[k];
+				edge_sq += edge[k] * edge[k];
+				along += edge[k] * to_p[k];
+			}
+			double const f = edge_sq > 0.0 ? (std::min)((std::max)(along / edge_sq, 0.0), 1.0) : 0.0;
+			double squared = 0.0;
+			for (int k = 0; k < 3; ++k) {
+				squared += (to_p[k] - f * edge[k]) * (to_p[k] - f * edge[k]);
+			}
+			nearest = (std::min)(nearest, sqrt(squared));
+		}
+		return nearest;
+	}
+
+	// Distance from p to the nearest of the listed triangles.
+	double SceneDistance(const double* p, const indexed_mesh_t& mesh, const std::vector<uint32_t>& triangles) {
+		double nearest = DBL_MAX;
+		for (uint32_t t : triangles) {
+			nearest = (std::min)(nearest, TriangleDistance(p,
+				mesh.vertices[mesh.indices[t * 3 + 0]].position,
+				mesh.vertices[mesh.indices[t * 3 + 1]].position,
+				mesh.vertices[mesh.indices[t * 3 + 2]].position
+			));
+		}
+		return nearest;
+	}
+
+	// First contact of the sweep by sphere tracing the exact distance over
+	// every triangle near the path: each step moves by the clearance, so
+	// no contact is stepped over. Returns 1 for a free path; -1 when the
+	// path grazes a surface too long to settle.
+	double ReferenceContact(const indexed_mesh_t& mesh, const float* center, float radius, const float* displacement) {
+		std::vector<uint32_t> near;
+		for (uint32_t t = 0; t < mesh.indices.size() / 3; ++t) {
+			bool overlaps = true;
+			for (int k = 0; k < 3; ++k) {
+				float const lo = (std::min)(center[k], center[k] + displacement[k]) - radius;
+				float const hi = (std::max)(center[k], center[k] + displacement[k]) + radius;
+				float const a = mesh.vertices[mesh.indices[t * 3 + 0]].position[k];
+				float const b = mesh.vertices[mesh.indices[t * 3 + 1]].position[k];
+				float const c = mesh.vertices[mesh.indices[t * 3 + 2]].position[k];
+				overlaps = overlaps && (std::min)(a, (std::min)(b, c)) <= hi && (std::max)(a, (std::max)(b, c)) >= lo;
+			}
+			if (overlaps) {
+				near.push_back(t);
+			}
+		}
+		double const length = sqrt(double(displacement[0]) * displacement[0] + double(displacement[1]) * displacement[1] +
+			double(displacement[2]) * displacement[2]);
+		double t = 0.0;
+		for (int step = 0; step < 10000; ++step) {
+			double const p[3] = { center[0] + t * displacement[0], center[1] + t * displacement[1], center[2] + t * displacement[2] };
+			double const clearance = SceneDistance(p, mesh, near) - radius;
+			if (clearance < 1e-6) {
+				return t;
+			}
+			t += clearance / length;
+			if (t >= 1.0) {
+				return 1.0;
+			}
+		}
+		return -1.0;
+	}
+}
+
+// Checks SweepSphere and MoveSphere on a one-triangle world with known
+// answers and on random sweeps through the welded room against a
+// brute-force reference over every triangle: no contact missed or
+// reported later than it happens, none reported while the sphere is
+// still clear, and no move ending inside geometry. Then times both on
+// the room and on a grid of rooms. Fails on any broken check.
+//   --collision-report [collision.txt] [columns] [rows]
+int CollisionReportTool(const std::vector<std::string>& args) {
+	uint32_t const columns = args.size() > 2 ? static_cast<uint32_t>(std::stoul(args[2])) : 40;
+	uint32_t const rows = args.size() > 3 ? static_cast<uint32_t>(std::stoul(args[3])) : 40;
+	float const RADIUS = 0.3f;
+	size_t const CHECKED_SWEEPS = 20000;
+	size_t const TIMED_SWEEPS = 1000000;
+	double const TOLERANCE = 1e-3;
+
+	FILE* out = OpenReport(args, "collision.txt");
+	if (!out) {
+		return 1;
+	}
+	size_t failures = 0;
+
+	// One triangle in y = 0 over x <= 0, z >= 0 with edges along both
+	// axes; t = -1 for a free path.
+	indexed_mesh_t single;
+	single.vertices.resize(3);
+	single.indices = { 0, 1, 2 };
+	float const corners[3][3] = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 4.0f }, { -4.0f, 0.0f, 0.0f } };
+	for (int c = 0; c < 3; ++c) {
+		std::copy(corners[c], corners[c] + 3, single.vertices[c].position);
+	}
+	{
+		CollisionWorld world;
+		world.Build(single.vertices.data(), single.indices.data(), single.indices.size());
+		struct sweep_case_t {
+			const char* name;
+			float center[3];
+			float displacement[3];
+			float t;
+		};
+		sweep_case_t const cases[] = {
+			{ "face, head on", { -1.0f, 1.0f, 1.0f }, { 0.0f, -2.0f, 0.0f }, 0.35f },
+			{ "face from below", { -1.0f, -1.0f, 1.0f }, { 0.0f, 2.0f, 0.0f }, 0.35f },
+			// (0.5 - t)^2 + 0.2^2 = 0.3^2
+			{ "edge, level within a radius", { 0.5f, 0.2f, 1.0f }, { -1.0f, 0.0f, 0.0f }, 0.276393f },
+			// (0.5 - t)^2 + (0.2 + 0.01 t)^2 = 0.3^2
+			{ "edge, leaving the plane", { 0.5f, 0.2f, 1.0f }, { -1.0f, 0.01f, 0.0f }, 0.278920f },
+			{ "corner", { 1.0f, 0.0f, -1.0f }, { -2.0f, 0.0f, 2.0f }, 0.5f - 0.3f / 2.0f / sqrtf(2.0f) },
+			{ "passing above", { -1.0f, 0.5f, 1.0f }, { -1.0f, 0.0f, 1.0f }, -1.0f },
+			{ "leaving", { -1.0f, 0.2f, 1.0f }, { 0.0f, 1.0f, 0.0f }, -1.0f },
+			{ "beside the edge", { 0.5f, 0.0f, 1.0f }, { 0.0f, 0.0f, 1.0f }, -1.0f },
+		};
+		for (const sweep_case_t& c : cases) {
+			sphere_hit_t hit;
+			bool const found = world.SweepSphere(c.center, RADIUS, c.displacement, hit);
+			bool const passed = c.t < 0.0f ? !found : found && fabsf(hit.t - c.t) < 1e-4f;
+			fprintf(out, "one triangle, %s: %s at t = %.6f, expected %.6f: %s\n",
+				c.name, found ? "hit" : "free", found ? hit.t : 1.0f, c.t < 0.0f ? 1.0f : c.t, passed ? "ok" : "FAILED");
+			failures += !passed;
+		}
+	}
+
+	// Random sweeps by the triangle and through the room, half of them
+	// starting just over a radius from a random point of a triangle,
+	// often on an edge, where grazing and sliding contacts happen.
+	std::vector<vertex_t> const room = SceneSourceVertices();
+	indexed_mesh_t const welded = WeldVertices(room.data(), room.size());
+	uint32_t noise = 1;
+	auto random = [&](float from, float to) {
+		noise = noise * 1664525u + 1013904223u;
+		return from + (to - from) * static_cast<float>(noise >> 8) / 16777216.0f;
+	};
+	auto random_direction = [&](float* direction) {
+		float length = 0.0f;
+		do {
+			for (int k = 0; k < 3; ++k) {
+				direction[k] = random(-1.0f, 1.0f);
+			}
+			length = sqrtf(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+		} while (length < 0.1f || length > 1.0f);
+		for (int k = 0; k < 3; ++k) {
+			direction[k] /= length;
+		}
+	};
+	const std::pair<const char*, const indexed_mesh_t*> checked_scenes[] = { { "one triangle", &single }, { "room", &welded } };
+	for (const auto& scene : checked_scenes) {
+		const indexed_mesh_t& mesh = *scene.second;
+		CollisionWorld world;
+		world.Build(mesh.vertices.data(), mesh.indices.data(), mesh.indices.size());
+		float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (const vertex_t& v : mesh.vertices) {
+			for (int k = 0; k < 3; ++k) {
+				lo[k] = (std::min)(lo[k], v.position[k] - RADIUS);
+				hi[k] = (std::max)(hi[k], v.position[k] + RADIUS);
+			}
+		}
+		std::vector<uint32_t> all(mesh.indices.size() / 3);
+		for (uint32_t t = 0; t < all.size(); ++t) {
+			all[t] = t;
+		}
+		size_t checked = 0, contacts = 0, ungraded = 0, missed = 0, early = 0, inside = 0;
+		double worst_miss = 0.0;
+		for (size_t i = 0; i < CHECKED_SWEEPS; ++i) {
+			float center[3], direction[3];
+			if (i % 2) {
+				for (int k = 0; k < 3; ++k) {
+					center[k] = random(lo[k], hi[k]);
+				}
+			}
+			else {
+				uint32_t const t = static_cast<uint32_t>(random(0.0f, 1.0f) * all.size()) % all.size();
+				const float* p[3];
+				for (int c = 0; c < 3; ++c) {
+					p[c] = mesh.vertices[mesh.indices[t * 3 + c]].position;
+				}
+				float u = random(0.0f, 1.0f), v = random(0.0f, 1.0f);
+				if (u + v > 1.0f) {
+					u = 1.0f - u;
+					v = 1.0f - v;
+				}
+				if (i % 4 == 0) {
+					v = 1.0f - u;
+				}
+				float const clearance = RADIUS + random(0.0f, 0.1f);
+				random_direction(direction);
+				for (int k = 0; k < 3; ++k) {
+					center[k] = p[0][k] + u * (p[1][k] - p[0][k]) + v * (p[2][k] - p[0][k]) + clearance * direction[k];
+				}
+			}
+			float const length = random(0.05f, 1.0f);
+			random_direction(direction);
+			float const displacement[3] = { direction[0] * length, direction[1] * length, direction[2] * length };
+			double const start[3] = { center[0], center[1], center[2] };
+			if (SceneDistance(start, mesh, all) < RADIUS + TOLERANCE) {
+				continue;
+			}
+			++checked;
+
+			double const reference = ReferenceContact(mesh, center, RADIUS, displacement);
+			if (reference < 0.0) {
+				++ungraded;
+				continue;
+			}
+			sphere_hit_t hit;
+			bool const found = world.SweepSphere(center, RADIUS, displacement, hit);
+			contacts += reference < 1.0;
+			if (reference < 1.0 && (!found || (hit.t - reference) * length > TOLERANCE)) {
+				++missed;
+				double const end = found ? hit.t : 1.0;
+				double const at[3] = {
+					center[0] + end * displacement[0], center[1] + end * displacement[1], center[2] + end * displacement[2]
+				};
+				worst_miss = (std::max)(worst_miss, RADIUS - SceneDistance(at, mesh, all));
+			}
+			if (found) {
+				double const at[3] = {
+					center[0] + hit.t * displacement[0], center[1] + hit.t * displacement[1], center[2] + hit.t * displacement[2]
+				};
+				early += SceneDistance(at, mesh, all) > RADIUS + TOLERANCE;
+			}
+			float moved[3];
+			world.MoveSphere(center, RADIUS, displacement, moved);
+			double const end[3] = { moved[0], moved[1], moved[2] };
+			inside += SceneDistance(end, mesh, all) < RADIUS - TOLERANCE;
+		}
+		fprintf(out, "%s: %zu sweeps of radius %.1f against brute force, %zu contacts, %zu too grazing to grade; "
+			"%zu missed or late (deepest %.4f into the surface), %zu early, %zu moves ending inside\n",
+			scene.first, checked, RADIUS, contacts, ungraded, missed, worst_miss, early, inside);
+		failures += missed + early + inside;
+	}
+
+	// Throughput on the room and a grid of rooms: player-sized steps
+	// from random points.
+	indexed_mesh_t grid;
+	grid.vertices = ReportGrid(room, columns, rows);
+	grid.indices.resize(grid.vertices.size());
+	for (size_t i = 0; i < grid.indices.size(); ++i) {
+		grid.indices[i] = static_cast<uint32_t>(i);
+	}
+	const std::pair<const char*, const indexed_mesh_t*> scenes[] = { { "room", &welded }, { "grid", &grid } };
+	for (const auto& scene : scenes) {
+		const indexed_mesh_t& mesh = *scene.second;
+		CollisionWorld timed;
+		auto start = std::chrono::steady_clock::now();
+		timed.Build(mesh.vertices.data(), mesh.indices.data(), mesh.indices.size());
+		double const build_seconds = Seconds(start);
+		std::vector<ray_t> const steps = RandomRays(mesh.vertices, TIMED_SWEEPS, 5);
+		std::vector<std::array<float, 3>> displacements(steps.size());
+		for (size_t i = 0; i < steps.size(); ++i) {
+			const float* d = steps[i].direction;
+			float const d_length = (std::max)(sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]), 1e-6f);
+			for (int k = 0; k < 3; ++k) {
+				displacements[i][k] = d[k] / d_length * 0.1f;
+			}
+		}
+		size_t hits = 0;
+		start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < steps.size(); ++i) {
+			sphere_hit_t hit;
+			hits += timed.SweepSphere(steps[i].origin, RADIUS, displacements[i].data(), hit);
+		}
+		double const sweep_seconds = Seconds(start);
+		float sink = 0.0f;
+		start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < steps.size(); ++i) {
+			float moved[3];
+			timed.MoveSphere(steps[i].origin, RADIUS, displacements[i].data(), moved);
+			sink += moved[0];
+		}
+		double const move_seconds = Seconds(start);
+		fprintf(out, "%s: %zu triangles, built in %.3f s; SweepSphere %.2f M queries/s (%.0f%% hit), "
+			"MoveSphere %.2f M queries/s%s\n",
+			scene.first, timed.TriangleCount(), build_seconds, steps.size() / sweep_seconds / 1e6, 100.0 * hits / steps.size(),
+			steps.size() / move_seconds / 1e6, sink == FLT_MAX ? " " : "");
+	}
+	return CloseReport(out, failures);
+}
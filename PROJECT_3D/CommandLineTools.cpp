@@ -0,0 +1,260 @@
+#include "CommandLineTools.h"
+#include "AtlasTrim.h"
+#include "FileUtil.h"
+#include "ImageFile.h"
+#include "MeshAsset.h"
+#include "MeshImport.h"
+#include "ObjectSegmentation.h"
+#include "ReportTools.h"
+#include "SceneAsset.h"
+#include "SceneGenerator.h"
+#include "TextureAsset.h"
+#include "VertexStream.h"
+#include <exception>
+#include <string>
+#include <utility>
+
+namespace {
+	// Opens the scene asset, baking it first when it is missing or stale.
+	bool OpenSceneAsset(MeshAsset& asset) {
+		if (asset.Open(SCENE_ASSET_PATH)) {
+			return true;
+		}
+		BakeSceneAsset(SCENE_ASSET_PATH);
+		return asset.Open(SCENE_ASSET_PATH);
+	}
+
+	// Lists the scene asset's objects with their bounds and index ranges.
+	//   --dump-objects [objects.txt]
+	int DumpObjectsTool(const std::vector<std::string>& args) {
+		MeshAsset asset;
+		if (!OpenSceneAsset(asset)) {
+			return 1;
+		}
+		const char* out_path = args.size() > 1 ? args[1].c_str() : "objects.txt";
+		FILE* out = OpenFile(out_path, "w");
+		if (!out) {
+			return 1;
+		}
+		DumpObjects(out, asset.Objects(), static_cast<size_t>(asset.Header().object_count));
+		return fclose(out) == 0 ? 0 : 1;
+	}
+
+	// Imports an OBJ or GLB file and bakes it into a mesh asset, by default
+	// the one the renderer loads.
+	//   --import model.obj|model.glb [scene.p3dm]
+	int ImportTool(const std::vector<std::string>& args) {
+		if (args.size() < 2) {
+			return 1;
+		}
+		const char* out_path = args.size() > 2 ? args[2].c_str() : SCENE_ASSET_PATH;
+		import_stats_t stats = {};
+		auto const start = std::chrono::steady_clock::now();
+		std::vector<vertex_t> vertices = ImportMesh(args[1].c_str(), 0, &stats);
+		double const seconds = Seconds(start);
+		printf("%s: %zu positions, %zu faces, %zu triangles, %.1f MB/s\n",
+			args[1].c_str(), stats.positions, stats.faces, stats.triangles,
+			seconds > 0.0 ? stats.bytes / seconds / 1e6 : 0.0);
+		if (vertices.empty()) {
+			return 1;
+		}
+		BakeMeshAsset(out_path, std::move(vertices));
+		return 0;
+	}
+
+	// Builds a stress scene from copies of the room, either as a vertex
+	// stream written while it is generated or baked into a mesh asset.
+	//   --generate rooms|towers|soup out.p3dv|out.p3dm [columns] [rows] [floors|objects] [seed]
+	int GenerateTool(const std::vector<std::string>& args) {
+		if (args.size() < 3) {
+			return 1;
+		}
+		scene_generator_config_t config;
+		if (args[1] == "rooms") {
+			config.layout = scene_layout_t::rooms;
+		}
+		else if (args[1] == "towers") {
+			config.layout = scene_layout_t::towers;
+		}
+		else if (args[1] == "soup") {
+			config.layout = scene_layout_t::soup;
+		}
+		else {
+			return 1;
+		}
+		if (args.size() > 3) {
+			config.columns = static_cast<uint32_t>(std::stoul(args[3]));
+		}
+		if (args.size() > 4) {
+			config.rows = static_cast<uint32_t>(std::stoul(args[4]));
+		}
+		if (args.size() > 5) {
+			if (config.layout == scene_layout_t::soup) {
+				config.objects = std::stoull(args[5]);
+			}
+			else {
+				config.floors = static_cast<uint32_t>(std::stoul(args[5]));
+			}
+		}
+		if (args.size() > 6) {
+			config.seed = std::stoull(args[6]);
+		}
+
+		SceneGenerator const generator(SceneSourceVertices());
+		const std::string& out_path = args[2];
+		bool const stream = out_path.size() > 5 && out_path.compare(out_path.size() - 5, 5, ".p3dv") == 0;
+		auto const start = std::chrono::steady_clock::now();
+		uint64_t vertex_count = 0;
+		if (stream) {
+			VertexStreamWriter writer;
+			writer.Open(out_path.c_str());
+			generator.Generate(config, [&](const vertex_t* vertices, size_t count) {
+				writer.Append(vertices, count);
+			});
+			vertex_count = writer.VertexCount();
+			writer.Close();
+		}
+		else {
+			std::vector<vertex_t> vertices = generator.GenerateVertices(config);
+			vertex_count = vertices.size();
+			BakeMeshAsset(out_path.c_str(), std::move(vertices));
+		}
+		double const seconds = Seconds(start);
+		printf("%s: %llu copies, %llu triangles in %.2f s\n", out_path.c_str(),
+			static_cast<unsigned long long>(generator.CopyCount(config)),
+			static_cast<unsigned long long>(vertex_count / 3), seconds);
+		return 0;
+	}
+
+	bool ParseTextureFormat(const std::string& name, texture_format_t& format) {
+		const char* const NAMES[4] = { "rgba8", "bc1", "bc3", "bc7" };
+		for (int f = 0; f < 4; ++f) {
+			if (name == NAMES[f]) {
+				format = static_cast<texture_format_t>(f);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Bakes an image into the texture container the renderer maps at
+	// startup, by default textures.png into TEXTURE_ASSET_PATH as BC7.
+	//   --bake-texture [in.png] [out.p3dt] [rgba8|bc1|bc3|bc7] [fast|normal|high]
+	int BakeTextureTool(const std::vector<std::string>& args) {
+		const char* in_path = args.size() > 1 ? args[1].c_str() : "textures.png";
+		const char* out_path = args.size() > 2 ? args[2].c_str() : TEXTURE_ASSET_PATH;
+		texture_format_t format = texture_format_t::bc7;
+		if (args.size() > 3 && !ParseTextureFormat(args[3], format)) {
+			return 1;
+		}
+		block_quality_t quality = block_quality_t::normal;
+		if (args.size() > 4) {
+			if (args[4] == "fast") {
+				quality = block_quality_t::fast;
+			}
+			else if (args[4] == "high") {
+				quality = block_quality_t::high;
+			}
+			else if (args[4] != "normal") {
+				return 1;
+			}
+		}
+		rgba_image_t const image = LoadImageFile(in_path);
+		texture_bake_stats_t const stats = BakeTextureAsset(
+			out_path, image.pixels.data(), image.width, image.height, size_t(image.width) * 4, format, quality
+		);
+		printf("%s: %ux%u, %u levels, %zu -> %zu bytes\n",
+			out_path, stats.width, stats.height, stats.levels, stats.source_bytes, stats.data_bytes);
+		return 0;
+	}
+
+	// Writes the trimmed atlas as the renderer's texture asset and the
+	// scene with rewritten tex_coord as its mesh asset; the two belong
+	// together and replace both defaults.
+	//   --trim-atlas [textures.png] [textures.p3dt] [scene.p3dm] [tile size]
+	int TrimAtlasTool(const std::vector<std::string>& args) {
+		const char* image_path = args.size() > 1 ? args[1].c_str() : "textures.png";
+		const char* texture_path = args.size() > 2 ? args[2].c_str() : TEXTURE_ASSET_PATH;
+		const char* scene_path = args.size() > 3 ? args[3].c_str() : SCENE_ASSET_PATH;
+		atlas_trim_config_t config;
+		if (args.size() > 4) {
+			config.tile_size = static_cast<uint32_t>(std::stoul(args[4]));
+		}
+		rgba_image_t const image = LoadImageFile(image_path);
+		std::vector<vertex_t> vertices = SceneSourceVertices();
+		atlas_trim_t const trim = PlanAtlasTrim(vertices.data(), vertices.size(), image.width, image.height, config);
+		std::vector<uint8_t> const trimmed = TrimAtlas(trim, image.pixels.data(), size_t(image.width) * 4);
+		RemapTexCoords(trim, vertices.data(), vertices.size());
+		texture_bake_stats_t const stats = BakeTextureAsset(
+			texture_path, trimmed.data(), trim.width, trim.height, size_t(trim.width) * 4, texture_format_t::bc7
+		);
+		BakeMeshAsset(scene_path, std::move(vertices));
+		printf("%ux%u -> %ux%u in %zu regions, %zu bytes resident\n",
+			image.width, image.height, trim.width, trim.height, trim.regions.size(), stats.data_bytes);
+		return 0;
+	}
+
+	struct tool_t {
+		const char* name;
+		const char* usage;
+		int (*run)(const std::vector<std::string>& args);
+	};
+
+	tool_t const TOOLS[] = {
+		{ "--weld-report", "[weld.txt] [columns] [rows]", WeldReportTool },
+		{ "--cache-report", "[cache.txt] [columns] [rows]", CacheReportTool },
+		{ "--quantize-report", "[quantize.txt] [columns] [rows]", QuantizeReportTool },
+		{ "--load-report", "[load.txt] [gigabytes]", LoadReportTool },
+		{ "--meshlet-report", "[meshlets.txt] [columns] [rows]", MeshletReportTool },
+		{ "--ray-report", "[rays.txt] [million triangles]", RayReportTool },
+		{ "--dump-objects", "[objects.txt]", DumpObjectsTool },
+		{ "--segment-report", "[segments.txt] [columns] [rows]", SegmentReportTool },
+		{ "--cull-report", "[cull.txt] [objects]", CullReportTool },
+		{ "--occlusion-report", "[occlusion.txt] [columns] [rows] [views]", OcclusionReportTool },
+		{ "--simplify-report", "[simplify.txt] [columns] [rows]", SimplifyReportTool },
+		{ "--merge-report", "[merge.txt]", MergeReportTool },
+		{ "--instance-report", "[instances.txt] [columns] [rows]", InstanceReportTool },
+		{ "--collision-report", "[collision.txt] [columns] [rows]", CollisionReportTool },
+		{ "--import", "model.obj|model.glb [scene.p3dm]", ImportTool },
+		{ "--import-report", "[import.txt] [columns] [rows]", ImportReportTool },
+		{ "--stream-report", "[streaming.txt] [model.glb]", StreamReportTool },
+		{ "--generate", "rooms|towers|soup out.p3dv|out.p3dm [columns] [rows] [floors|objects] [seed]", GenerateTool },
+		{ "--generate-report", "[generate.txt] [columns] [rows]", GenerateReportTool },
+		{ "--mip-report", "[mips.txt] [width] [height]", MipReportTool },
+		{ "--bc-report", "[bc.txt] [width] [height]", BlockReportTool },
+		{ "--bake-texture", "[in.png] [out.p3dt] [rgba8|bc1|bc3|bc7] [fast|normal|high]", BakeTextureTool },
+		{ "--texture-report", "[texture.txt] [textures.png]", TextureReportTool },
+		{ "--atlas-report", "[atlas.txt] [textures.png] [tile size]", AtlasReportTool },
+		{ "--trim-atlas", "[textures.png] [textures.p3dt] [scene.p3dm] [tile size]", TrimAtlasTool },
+		{ "--png-report", "[png.txt] [textures.png ...]", PngReportTool },
+		{ "--decode-report", "[decode.txt] [textures.png] [direct|copy|both]", DecodeReportTool },
+		{ "--upload-ring-report", "[ring.txt] [ring KB] [frames] [latency]", UploadRingReportTool },
+		{ "--texture-stream-report", "[stream.txt] [textures] [budget MB] [frames] [latency frames] [MB per frame]", TextureStreamReportTool },
+		{ "--virtual-texture-report", "[vt.txt] [texels] [cache tiles] [frames] [latency frames] [tiles per frame]", VirtualTextureReportTool },
+	};
+}
+
+bool RunCommandLineTool(const std::vector<std::string>& args, int& exit_code) {
+	if (args.empty()) {
+		return false;
+	}
+	for (const tool_t& tool : TOOLS) {
+		if (args[0] != tool.name) {
+			continue;
+		}
+		try {
+			exit_code = tool.run(args);
+		}
+		catch (const std::exception&) {
+			exit_code = 1;
+		}
+		return true;
+	}
+	return false;
+}
+
+void PrintCommandLineTools(FILE* out) {
+	for (const tool_t& tool : TOOLS) {
+		fprintf(out, "  %s %s\n", tool.name, tool.usage);
+	}
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Offline tools built into the executable, e.g.
+//   PROJECT_3D.exe --weld-report weld.txt 16 16
+// The table in CommandLineTools.cpp lists every tool with its arguments.
+// args excludes the program name. Returns false when args do not name a
+// tool, so the caller starts the renderer instead; otherwise exit_code
+// holds the tool's result.
+bool RunCommandLineTool(const std::vector<std::string>& args, int& exit_code);
+
+// Writes one line per tool: its name and arguments.
+void PrintCommandLineTools(FILE* out);
@@ -0,0 +1,558 @@
+#include "CoplanarMerge.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+	float const PLANE_EPSILON = 1e-4f;
+	float const MAP_EPSILON = 1e-5f;
+	// Largest fan a collapse may create. Bigger fans mean slivers that
+	// rasterize poorly, and every later collapse near them walks the fan.
+	size_t const MAX_FAN_TRIANGLES = 24;
+
+	// Plane and texture mapping of one triangle: uv = (dot(gu, p) + cu, dot(gv, p) + cv).
+	struct triangle_map_t {
+		bool valid;
+		double normal[3];
+		double distance;
+		double gu[3];
+		double gv[3];
+		double cu;
+		double cv;
+	};
+
+	double Dot(const double* a, const double* b) {
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	void Cross(const double* a, const double* b, double* out) {
+		out[0] = a[1] * b[2] - a[2] * b[1];
+		out[1] = a[2] * b[0] - a[0] * b[2];
+		out[2] = a[0] * b[1] - a[1] * b[0];
+	}
+
+	void Sub(const float* a, const float* b, double* out) {
+		for (int k = 0; k < 3; ++k) {
+			out[k] = double(a[k]) - b[k];
+		}
+	}
+
+	triangle_map_t MapTriangle(const vertex_t* v) {
+		triangle_map_t m = {};
+		double e1[3], e2[3], n[3];
+		Sub(v[1].position, v[0].position, e1);
+		Sub(v[2].position, v[0].position, e2);
+		Cross(e1, e2, n);
+		double const area2 = Dot(n, n);
+		bool const flat_color = !memcmp(v[0].color, v[1].color, sizeof(v[0].color)) &&
+			!memcmp(v[0].color, v[2].color, sizeof(v[0].color));
+		if (!(area2 > 0.0) || !flat_color) {
+			return m;
+		}
+
+		// Gradients of u and v over the plane: g = (du1 * (e2 x n) + du2 * (n x e1)) / |n|^2.
+		double a[3], b[3];
+		Cross(e2, n, a);
+		Cross(n, e1, b);
+		double const du1 = double(v[1].tex_coord[0]) - v[0].tex_coord[0];
+		double const du2 = double(v[2].tex_coord[0]) - v[0].tex_coord[0];
+		double const dv1 = double(v[1].tex_coord[1]) - v[0].tex_coord[1];
+		double const dv2 = double(v[2].tex_coord[1]) - v[0].tex_coord[1];
+		double p0[3];
+		for (int k = 0; k < 3; ++k) {
+			m.gu[k] = (du1 * a[k] + du2 * b[k]) / area2;
+			m.gv[k] = (dv1 * a[k] + dv2 * b[k]) / area2;
+			p0[k] = v[0].position[k];
+		}
+		m.cu = v[0].tex_coord[0] - Dot(m.gu, p0);
+		m.cv = v[0].tex_coord[1] - Dot(m.gv, p0);
+
+		double const length = sqrt(area2);
+		for (int k = 0; k < 3; ++k) {
+			m.normal[k] = n[k] / length;
+		}
+		m.distance = -Dot(m.normal, p0);
+		m.valid = true;
+		return m;
+	}
+
+	bool Near(double a, double b, double epsilon) {
+		return fabs(a - b) <= epsilon * std::max(1.0, std::max(fabs(a), fabs(b)));
+	}
+
+	double WrappedDifference(double a, double b, bool wrap) {
+		double const d = a - b;
+		return wrap ? d - floor(d + 0.5) : d;
+	}
+
+	bool Compatible(const triangle_map_t& a, const triangle_map_t& b, bool wrap) {
+		if (!a.valid || !b.valid || Dot(a.normal, b.normal) < 1.0 - PLANE_EPSILON * PLANE_EPSILON) {
+			return false;
+		}
+		if (!Near(a.distance, b.distance, PLANE_EPSILON)) {
+			return false;
+		}
+		for (int k = 0; k < 3; ++k) {
+			if (!Near(a.gu[k], b.gu[k], MAP_EPSILON) || !Near(a.gv[k], b.gv[k], MAP_EPSILON)) {
+				return false;
+			}
+		}
+		return fabs(WrappedDifference(a.cu, b.cu, wrap)) <= MAP_EPSILON &&
+			fabs(WrappedDifference(a.cv, b.cv, wrap)) <= MAP_EPSILON;
+	}
+
+	// Ids shared by all corners with bitwise equal positions (-0 == 0).
+	std::vector<uint32_t> PositionIds(const std::vector<vertex_t>& vertices, std::vector<uint32_t>& representative) {
+		size_t const count = vertices.size();
+		std::vector<uint32_t> order(count);
+		std::vector<uint32_t> keys(count * 3);
+		for (size_t v = 0; v < count; ++v) {
+			order[v] = static_cast<uint32_t>(v);
+			memcpy(&keys[v * 3], vertices[v].position, 3 * sizeof(uint32_t));
+			for (int k = 0; k < 3; ++k) {
+				if (keys[v * 3 + k] == 0x80000000u) {
+					keys[v * 3 + k] = 0;
+				}
+			}
+		}
+		auto less = [&](uint32_t a, uint32_t b) {
+			return std::lexicographical_compare(&keys[a * 3], &keys[a * 3 + 3], &keys[b * 3], &keys[b * 3 + 3]);
+		};
+		std::sort(order.begin(), order.end(), less);
+
+		std::vector<uint32_t> ids(count);
+		representative.clear();
+		for (size_t i = 0; i < count; ++i) {
+			if (i == 0 || less(order[i - 1], order[i])) {
+				representative.push_back(order[i]);
+			}
+			ids[order[i]] = static_cast<uint32_t>(representative.size() - 1);
+		}
+		return ids;
+	}
+
+	class PlanarCollapser
+	{
+	public:
+		PlanarCollapser(const std::vector<vertex_t>& vertices, bool wrap)
+			: m_vertices(vertices), m_wrap(wrap) {
+			size_t const tri_count = vertices.size() / 3;
+			m_corner = PositionIds(vertices, m_representative);
+			m_maps.resize(tri_count);
+			m_alive.assign(tri_count, 1);
+			m_modified.assign(tri_count, 0);
+			m_triangles.resize(m_representative.size());
+			m_triangleStamp.assign(tri_count, 0);
+			m_positionStamp.assign(m_representative.size(), 0);
+			m_positionSlot.assign(m_representative.size(), 0);
+			for (size_t t = 0; t < tri_count; ++t) {
+				m_maps[t] = MapTriangle(&vertices[t * 3]);
+				for (int k = 0; k < 3; ++k) {
+					m_triangles[m_corner[t * 3 + k]].push_back(static_cast<uint32_t>(t));
+				}
+			}
+			m_originalCorners.resize(m_representative.size());
+			for (size_t v = 0; v < vertices.size(); ++v) {
+				m_originalCorners[m_corner[v]].push_back(static_cast<uint32_t>(v));
+			}
+		}
+
+		size_t PositionCount() const { return m_representative.size(); }
+
+		// Moves position p onto a neighbour when that keeps the surface,
+		// its mapping and everything around it unchanged.
+		bool TryCollapse(uint32_t p) {
+			// Drop dead and repeated entries from the fan while collecting it.
+			std::vector<uint32_t>& fan = m_triangles[p];
+			++m_epoch;
+			size_t live = 0;
+			for (uint32_t t : fan) {
+				if (m_alive[t] && m_triangleStamp[t] != m_epoch) {
+					m_triangleStamp[t] = m_epoch;
+					fan[live++] = t;
+				}
+			}
+			fan.resize(live);
+			if (fan.empty()) {
+				return false;
+			}
+			std::vector<uint32_t>& star = m_star;
+			star.assign(fan.begin(), fan.end());
+			const triangle_map_t& reference = m_maps[star[0]];
+			for (uint32_t t : star) {
+				if (!Compatible(m_maps[t], reference, m_wrap)) {
+					return false;
+				}
+			}
+
+			// Directed edges p -> next and previous -> p around the fan.
+			m_links.clear();
+			++m_epoch;
+			for (uint32_t t : star) {
+				int const i = CornerOf(t, p);
+				AddLink(m_corner[t * 3 + (i + 1) % 3], 1, 0);
+				AddLink(m_corner[t * 3 + (i + 2) % 3], 0, 1);
+			}
+			uint32_t border_out = UINT32_MAX;
+			uint32_t border_in = UINT32_MAX;
+			for (const link_t& link : m_links) {
+				if (link.out > 1 || link.in > 1) {
+					return false;
+				}
+				if (link.out && !link.in) {
+					if (border_out != UINT32_MAX) {
+						return false;
+					}
+					border_out = link.position;
+				}
+				else if (link.in && !link.out) {
+					if (border_in != UINT32_MAX) {
+						return false;
+					}
+					border_in = link.position;
+				}
+			}
+			bool const border = border_out != UINT32_MAX || border_in != UINT32_MAX;
+			if (border) {
+				if (border_out == UINT32_MAX || border_in == UINT32_MAX || !Collinear(border_in, p, border_out)) {
+					return false;
+				}
+				return Collapse(p, border_out, 1) || Collapse(p, border_in, 1);
+			}
+			// Prefer neighbours with small fans: better shaped triangles and
+			// no hub whose fan every later collapse has to walk.
+			std::sort(m_links.begin(), m_links.end(), [&](const link_t& a, const link_t& b) {
+				return m_triangles[a.position].size() < m_triangles[b.position].size();
+			});
+			for (const link_t& link : m_links) {
+				if (Collapse(p, link.position, 2)) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void Write(std::vector<vertex_t>& out) const {
+			out.clear();
+			for (size_t t = 0; t < m_alive.size(); ++t) {
+				if (!m_alive[t]) {
+					continue;
+				}
+				for (int k = 0; k < 3; ++k) {
+					out.push_back(m_modified[t] ? CornerVertex(t, m_corner[t * 3 + k]) : m_vertices[t * 3 + k]);
+				}
+			}
+		}
+
+	private:
+		struct link_t {
+			uint32_t position;
+			int out;
+			int in;
+		};
+
+		int CornerOf(size_t t, uint32_t p) const {
+			return m_corner[t * 3] == p ? 0 : m_corner[t * 3 + 1] == p ? 1 : 2;
+		}
+
+		bool Contains(size_t t, uint32_t p) const {
+			return m_corner[t * 3] == p || m_corner[t * 3 + 1] == p || m_corner[t * 3 + 2] == p;
+		}
+
+		const float* Position(uint32_t p) const {
+			return m_vertices[m_representative[p]].position;
+		}
+
+		void AddLink(uint32_t position, int out, int in) {
+			if (m_positionStamp[position] == m_epoch) {
+				link_t& link = m_links[m_positionSlot[position]];
+				link.out += out;
+				link.in += in;
+				return;
+			}
+			m_positionStamp[position] = m_epoch;
+			m_positionSlot[position] = static_cast<uint32_t>(m_links.size());
+			m_links.push_back({ position, out, in });
+		}
+
+		bool Collinear(uint32_t a, uint32_t b, uint32_t c) const {
+			double ab[3], bc[3], n[3];
+			Sub(Position(b), Position(a), ab);
+			Sub(Position(c), Position(b), bc);
+			Cross(ab, bc, n);
+			double const scale = Dot(ab, ab) * Dot(bc, bc);
+			return Dot(ab, bc) > 0.0 && Dot(n, n) <= 1e-12 * scale;
+		}
+
+		// Marks the neighbours of p with a fresh epoch and returns it.
+		uint32_t MarkNeighbours(uint32_t p) {
+			++m_epoch;
+			for (uint32_t t : m_triangles[p]) {
+				if (!m_alive[t]) {
+					continue;
+				}
+				for (int k = 0; k < 3; ++k) {
+					m_positionStamp[m_corner[t * 3 + k]] = m_epoch;
+				}
+			}
+			m_positionStamp[p] = 0;
+			return m_epoch;
+		}
+
+		bool Collapse(uint32_t p, uint32_t q, size_t expected_dying) {
+			// Triangles on the edge p-q disappear; their third corners must
+			// be the only positions p and q have in common (link condition).
+			m_dying.clear();
+			for (uint32_t t : m_star) {
+				if (Contains(t, q)) {
+					m_dying.push_back(t);
+				}
+			}
+			if (m_dying.size() != expected_dying || m_star.size() + m_triangles[q].size() > MAX_FAN_TRIANGLES + 2 * expected_dying) {
+				return false;
+			}
+			uint32_t const q_mark = MarkNeighbours(q);
+			size_t shared = 0;
+			for (const link_t& link : m_links) {
+				uint32_t const n = link.position;
+				if (n == q || m_positionStamp[n] != q_mark) {
+					continue;
+				}
+				bool third = false;
+				for (uint32_t t : m_dying) {
+					third |= Contains(t, n);
+				}
+				if (!third) {
+					return false;
+				}
+				++shared;
+			}
+			if (shared != expected_dying) {
+				return false;
+			}
+
+			// Surviving triangles must keep facing the same way.
+			const double* normal = m_maps[m_star[0]].normal;
+			for (uint32_t t : m_star) {
+				if (Contains(t, q)) {
+					continue;
+				}
+				const float* c[3];
+				for (int k = 0; k < 3; ++k) {
+					uint32_t const corner = m_corner[t * 3 + k];
+					c[k] = Position(corner == p ? q : corner);
+				}
+				double e1[3], e2[3], n[3];
+				Sub(c[1], c[0], e1);
+				Sub(c[2], c[0], e2);
+				Cross(e1, e2, n);
+				if (!(Dot(n, normal) > 1e-9 * sqrt(Dot(e1, e1) * Dot(e2, e2)))) {
+					return false;
+				}
+			}
+
+			for (uint32_t t : m_dying) {
+				m_alive[t] = 0;
+			}
+			for (uint32_t t : m_star) {
+				if (!m_alive[t]) {
+					continue;
+				}
+				m_corner[t * 3 + CornerOf(t, p)] = q;
+				m_modified[t] = 1;
+				m_triangles[q].push_back(t);
+			}
+			m_triangles[p].clear();
+			return true;
+		}
+
+		// Corner of a rewritten triangle, reusing an original vertex when one
+		// at that position has the same attributes so welding still matches.
+		vertex_t CornerVertex(size_t t, uint32_t p) const {
+			const triangle_map_t& m = m_maps[t];
+			double pos[3];
+			for (int k = 0; k < 3; ++k) {
+				pos[k] = Position(p)[k];
+			}
+			double const u = Dot(m.gu, pos) + m.cu;
+			double const v = Dot(m.gv, pos) + m.cv;
+			const vertex_t& source = m_vertices[t * 3];
+			for (uint32_t other : m_originalCorners[p]) {
+				const vertex_t& candidate = m_vertices[other];
+				if (memcmp(candidate.color, source.color, sizeof(source.color)) == 0 &&
+					fabs(candidate.tex_coord[0] - u) <= MAP_EPSILON && fabs(candidate.tex_coord[1] - v) <= MAP_EPSILON) {
+					return candidate;
+				}
+			}
+			vertex_t corner = source;
+			memcpy(corner.position, Position(p), sizeof(corner.position));
+			corner.tex_coord[0] = static_cast<float>(u);
+			corner.tex_coord[1] = static_cast<float>(v);
+			return corner;
+		}
+
+		const std::vector<vertex_t>& m_vertices;
+		bool m_wrap;
+		std::vector<uint32_t> m_corner;
+		std::vector<uint32_t> m_representative;
+		std::vector<triangle_map_t> m_maps;
+		std::vector<uint8_t> m_alive;
+		std::vector<uint8_t> m_modified;
+		std::vector<std::vector<uint32_t>> m_triangles;
+		std::vector<std::vector<uint32_t>> m_originalCorners;
+		std::vector<uint32_t> m_star;
+		std::vector<link_t> m_links;
+		std::vector<uint32_t> m_dying;
+		// Epoch stamps keep fan and neighbour lookups linear.
+		uint32_t m_epoch = 0;
+		std::vector<uint32_t> m_triangleStamp;
+		std::vector<uint32_t> m_positionStamp;
+		std::vector<uint32_t> m_positionSlot;
+	};
+}
+
+coplanar_merge_stats_t MergeCoplanarTriangles(std::vector<vertex_t>& vertices, bool wrap_uvs) {
+	coplanar_merge_stats_t stats = {};
+	vertices.resize(vertices.size() / 3 * 3);
+	stats.triangles_before = vertices.size() / 3;
+
+	PlanarCollapser collapser(vertices, wrap_uvs);
+	for (bool changed = true; changed;) {
+		changed = false;
+		for (uint32_t p = 0; p < collapser.PositionCount(); ++p) {
+			if (collapser.TryCollapse(p)) {
+				++stats.removed_vertices;
+				changed = true;
+			}
+		}
+	}
+
+	std::vector<vertex_t> merged;
+	collapser.Write(merged);
+	vertices.swap(merged);
+	stats.triangles_after = vertices.size() / 3;
+	return stats;
+}
+
+namespace {
+	struct reference_pixel_t {
+		float depth;
+		float tex_coord[2];
+		float color[4];
+	};
+
+	// Orthographic view down axis (sign picks the direction), nearest
+	// surface wins, both faces drawn.
+	void RasterizeReference(
+		const vertex_t* vertices, size_t count, int axis, float sign,
+		const float* bounds_min, const float* bounds_max, int resolution,
+		std::vector<reference_pixel_t>& image
+	) {
+		image.assign(static_cast<size_t>(resolution) * resolution, reference_pixel_t{ FLT_MAX, {}, {} });
+		int const ax = (axis + 1) % 3;
+		int const ay = (axis + 2) % 3;
+		float const sx = resolution / std::max(bounds_max[ax] - bounds_min[ax], FLT_MIN);
+		float const sy = resolution / std::max(bounds_max[ay] - bounds_min[ay], FLT_MIN);
+		for (size_t i = 0; i + 2 < count; i += 3) {
+			float x[3], y[3], z[3];
+			for (int k = 0; k < 3; ++k) {
+				x[k] = (vertices[i + k].position[ax] - bounds_min[ax]) * sx;
+				y[k] = (vertices[i + k].position[ay] - bounds_min[ay]) * sy;
+				z[k] = sign * vertices[i + k].position[axis];
+			}
+			float const area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+			if (area == 0.0f) {
+				continue;
+			}
+			int const x0 = std::max(0, static_cast<int>(floorf(std::min({ x[0], x[1], x[2] }))));
+			int const x1 = std::min(resolution - 1, static_cast<int>(ceilf(std::max({ x[0], x[1], x[2] }))));
+			int const y0 = std::max(0, static_cast<int>(floorf(std::min({ y[0], y[1], y[2] }))));
+			int const y1 = std::min(resolution - 1, static_cast<int>(ceilf(std::max({ y[0], y[1], y[2] }))));
+			for (int py = y0; py <= y1; ++py) {
+				for (int px = x0; px <= x1; ++px) {
+					float const cx = px + 0.5f;
+					float const cy = py + 0.5f;
+					float w[3];
+					for (int k = 0; k < 3; ++k) {
+						int const a = (k + 1) % 3;
+						int const b = (k + 2) % 3;
+						w[k] = ((x[b] - x[a]) * (cy - y[a]) - (y[b] - y[a]) * (cx - x[a])) / area;
+					}
+					if (w[0] < 0.0f || w[1] < 0.0f || w[2] < 0.0f) {
+						continue;
+					}
+					float const depth = w[0] * z[0] + w[1] * z[1] + w[2] * z[2];
+					reference_pixel_t& pixel = image[static_cast<size_t>(py) * resolution + px];
+					if (depth >= pixel.depth) {
+						continue;
+					}
+					pixel.depth = depth;
+					for (int c = 0; c < 2; ++c) {
+						pixel.tex_coord[c] = w[0] * vertices[i].tex_coord[c] + w[1] * vertices[i + 1].tex_coord[c] + w[2] * vertices[i + 2].tex_coord[c];
+					}
+					for (int c = 0; c < 4; ++c) {
+						pixel.color[c] = w[0] * vertices[i].color[c] + w[1] * vertices[i + 1].color[c] + w[2] * vertices[i + 2].color[c];
+					}
+				}
+			}
+		}
+	}
+}
+
+render_compare_t CompareRenders(
+	const vertex_t* a, size_t a_count, const vertex_t* b, size_t b_count,
+	int resolution, bool wrap_uvs
+) {
+	render_compare_t result = {};
+	float bounds_min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float bounds_max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (const vertex_t* list : { a, b }) {
+		size_t const count = list == a ? a_count : b_count;
+		for (size_t i = 0; i < count; ++i) {
+			for (int k = 0; k < 3; ++k) {
+				bounds_min[k] = std::min(bounds_min[k], list[i].position[k]);
+				bounds_max[k] = std::max(bounds_max[k], list[i].position[k]);
+			}
+		}
+	}
+	float extent = 0.0f;
+	for (int k = 0; k < 3; ++k) {
+		extent = std::max(extent, bounds_max[k] - bounds_min[k]);
+	}
+	float const depth_tolerance = 1e-5f * std::max(extent, 1.0f);
+	float const tex_coord_tolerance = 1e-4f;
+	float const color_tolerance = 1e-4f;
+
+	std::vector<reference_pixel_t> image_a, image_b;
+	for (int axis = 0; axis < 3; ++axis) {
+		for (float sign : { 1.0f, -1.0f }) {
+			RasterizeReference(a, a_count, axis, sign, bounds_min, bounds_max, resolution, image_a);
+			RasterizeReference(b, b_count, axis, sign, bounds_min, bounds_max, resolution, image_b);
+			for (size_t i = 0; i < image_a.size(); ++i) {
+				const reference_pixel_t& pa = image_a[i];
+				const reference_pixel_t& pb = image_b[i];
+				bool const covered_a = pa.depth != FLT_MAX;
+				bool const covered_b = pb.depth != FLT_MAX;
+				result.covered_pixels += covered_a || covered_b;
+				if (!covered_a && !covered_b) {
+					continue;
+				}
+				bool match = covered_a == covered_b && fabsf(pa.depth - pb.depth) <= depth_tolerance;
+				if (match) {
+					for (int c = 0; c < 2; ++c) {
+						float const error = fabsf(static_cast<float>(WrappedDifference(pa.tex_coord[c], pb.tex_coord[c], wrap_uvs)));
+						result.max_tex_coord_error = std::max(result.max_tex_coord_error, error);
+						match &= error <= tex_coord_tolerance;
+					}
+					for (int c = 0; c < 4; ++c) {
+						match &= fabsf(pa.color[c] - pb.color[c]) <= color_tolerance;
+					}
+				}
+				result.mismatched_pixels += !match;
+			}
+		}
+	}
+	return result;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Vertex.h"
+#include <cstddef>
+#include <vector>
+
+struct coplanar_merge_stats_t {
+    size_t triangles_before;
+    size_t triangles_after;
+    size_t removed_vertices;    // positions collapsed away
+};
+
+// Merges edge-adjacent triangles that lie in one plane, share one affine
+// texture mapping and one flat color, and retriangulates each merged
+// polygon without its interior and collinear border vertices. With
+// wrap_uvs the mappings may also differ by whole texture periods, which a
+// WRAP sampler renders identically. Positions that other surfaces still
+// use are kept, so no new T-junctions appear. vertices is a triangle list
+// and is rewritten in place; untouched triangles keep their exact vertices.
+coplanar_merge_stats_t MergeCoplanarTriangles(std::vector<vertex_t>& vertices, bool wrap_uvs = true);
+
+struct render_compare_t {
+    size_t covered_pixels;
+    size_t mismatched_pixels;
+    float max_tex_coord_error;
+};
+
+// Reference check for geometry rewrites: rasterizes both triangle lists
+// on the CPU along the six axis directions, resolution pixels square over
+// their common bounds, and compares coverage, depth, color and (wrapped)
+// texture coordinates pixel by pixel.
+render_compare_t CompareRenders(
+    const vertex_t* a, size_t a_count, const vertex_t* b, size_t b_count,
+    int resolution = 512, bool wrap_uvs = true
+);
@@ -0,0 +1,23 @@
+#include "ReportTools.h"
+#include "CoplanarMerge.h"
+#include "SceneAsset.h"
+
+// Merges the scene's coplanar triangles and checks the result against
+// the original with CPU reference renders.
+//   --merge-report [merge.txt]
+int MergeReportTool(const std::vector<std::string>& args) {
+	std::vector<vertex_t> const source = SceneSourceVertices();
+	std::vector<vertex_t> merged = source;
+	coplanar_merge_stats_t const stats = MergeCoplanarTriangles(merged, true);
+	render_compare_t const compare = CompareRenders(source.data(), source.size(), merged.data(), merged.size());
+
+	FILE* out = OpenReport(args, "merge.txt");
+	if (!out) {
+		return 1;
+	}
+	fprintf(out, "triangles %zu -> %zu, positions removed %zu\n",
+		stats.triangles_before, stats.triangles_after, stats.removed_vertices);
+	fprintf(out, "reference renders: %zu covered pixels, %zu mismatched, max tex coord error %g\n",
+		compare.covered_pixels, compare.mismatched_pixels, compare.max_tex_coord_error);
+	return CloseReport(out, compare.mismatched_pixels);
+}
@@ -1,58 +1,51 @@
-#include "stdafx.h"
+﻿#include "stdafx.h"
 #include "D3D12HelloTriangle.h"
-#include "SceneVertices.h"
+#include "ImageFile.h"
+#include "MeshAsset.h"
+#include "SceneAsset.h"
+#include "TextureAsset.h"
+#include "UploadRing.h"
 #include "vertex_shader.h"
 #include "pixel_shader.h"
+#include <algorithm>
 
 
-HRESULT D3D12HelloTriangle::LoadBitmapFromFile(
-	PCWSTR uri, UINT& width, UINT& height, BYTE** ppBits
-) {
-	HRESULT hr;
-	IWICBitmapDecoder* pDecoder = nullptr;
-	IWICBitmapFrameDecode* pSource = nullptr;
-	IWICFormatConverter* pConverter = nullptr;
-
-	hr = wic_factory->CreateDecoderFromFilename(
-		uri, nullptr, GENERIC_READ, WICDecodeMetadataCacheOnLoad,
-		&pDecoder
-	);
-
-	if (SUCCEEDED(hr)) {
-		hr = pDecoder->GetFrame(0, &pSource);
-	}
-
-	if (SUCCEEDED(hr)) {
-		hr = wic_factory->CreateFormatConverter(&pConverter);
-	}
+namespace {
+	// Allocates the bitmap once the decoder knows its size, so the pixels
+	// are decoded into it directly rather than copied over afterwards.
+	class BitmapSink : public ImageSink
+	{
+	public:
+		uint8_t* Begin(uint32_t image_width, uint32_t image_height, size_t& pitch) override {
+			width = image_width;
+			height = image_height;
+			bits = new BYTE[size_t(width) * height * 4];
+			pitch = size_t(width) * 4;
+			return bits;
+		}
 
+		UINT width = 0, height = 0;
+		BYTE* bits = nullptr;
+	};
+}
 
-	if (SUCCEEDED(hr)) {
-		hr = pConverter->Initialize(
-			pSource,
-			GUID_WICPixelFormat32bppRGBA,
-			WICBitmapDitherTypeNone,
-			nullptr,
-			0.0f,
-			WICBitmapPaletteTypeMedianCut
-		);
+// Decodes with the portable PNG decoder rather than WIC, so the fallback
+// path no longer needs COM.
+HRESULT D3D12HelloTriangle::LoadBitmapFromFile(
+	const char* path, UINT& width, UINT& height, BYTE** ppBits
+) {
+	BitmapSink sink;
+	try {
+		LoadImageFile(path, sink);
 	}
-
-	if (SUCCEEDED(hr)) {
-		hr = pConverter->GetSize(&width, &height);
+	catch (const std::exception&) {
+		delete[] sink.bits;
+		return E_FAIL;
 	}
-
-	if (SUCCEEDED(hr)) {
-		*ppBits = new BYTE[4 * width * height];
-		hr = pConverter->CopyPixels(
-			nullptr, 4 * width, 4 * width * height, *ppBits
-		);
-	}
-
-	if (pDecoder) pDecoder->Release();
-	if (pSource) pSource->Release();
-	if (pConverter) pConverter->Release();
-	return hr;
+	width = sink.width;
+	height = sink.height;
+	*ppBits = sink.bits;
+	return S_OK;
 }
 
 D3D12HelloTriangle::D3D12HelloTriangle(UINT width, UINT height, std::wstring name) :
@@ -62,7 +55,11 @@ D3D12HelloTriangle::D3D12HelloTriangle(UINT width, UINT height, std::wstring nam
 	m_frameIndex(0),
 	m_viewport(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height)),
 	m_scissorRect(0, 0, static_cast<LONG>(width), static_cast<LONG>(height)),
-	m_rtvDescriptorSize(0)
+	m_rtvDescriptorSize(0),
+	m_textureStreamer(*this, texture_streaming_config_t{
+		.memory_budget = TEXTURE_MEMORY_BUDGET,
+		.max_inflight_bytes = TEXTURE_STREAMING_INFLIGHT
+	})
 {
 	playerPos = { 0.0f, 1.5f, 0.0f };
 }
@@ -73,20 +70,28 @@ void D3D12HelloTriangle::SetKeyboard(INT key, BOOL val) {
 
 void D3D12HelloTriangle::OnInit(HWND hwnd)
 {
-	// Texture initialization
-	CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
-
-	CoCreateInstance(
-		CLSID_WICImagingFactory,
-		nullptr,
-		CLSCTX_INPROC_SERVER,
-		IID_PPV_ARGS(&wic_factory)
-	);
+	// Texture initialization. The baked texture already holds the mips in
+	// upload layout; only without it does startup decode the PNG, and it
+	// bakes the result for the next run.
+	if (!m_textureAsset.Open(TEXTURE_ASSET_PATH)) {
+		ThrowIfFailed(LoadBitmapFromFile(
+			"textures.png", bmp_width, bmp_height, &bmp_bits
+		)
+		);
 
-	ThrowIfFailed(LoadBitmapFromFile(
-		TEXT("textures.png"), bmp_width, bmp_height, &bmp_bits
-	)
-	);
+		// BC7 quarters the memory and bandwidth of RGBA8. Block formats need
+		// the top level in whole 4x4 blocks; other sizes stay uncompressed.
+		bool const compress = bmp_width % 4 == 0 && bmp_height % 4 == 0;
+		BakeTextureAsset(
+			TEXTURE_ASSET_PATH, bmp_bits, bmp_width, bmp_height, bmp_width * bmp_px_size,
+			compress ? texture_format_t::bc7 : texture_format_t::rgba8
+		);
+		delete[] bmp_bits;
+		bmp_bits = nullptr;
+		if (!m_textureAsset.Open(TEXTURE_ASSET_PATH)) {
+			throw std::runtime_error("Cannot open texture asset");
+		}
+	}
 
 	LoadPipeline(hwnd);
 	LoadAssets();
@@ -111,6 +116,10 @@ void D3D12HelloTriangle::LoadPipeline(HWND hwnd)
 
 	ThrowIfFailed(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_commandQueue)));
 
+	// Mip levels stream in on a copy queue beside the frames.
+	queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+	ThrowIfFailed(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_copyQueue)));
+
 	// Describe and create the swap chain.
 	DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
 	swapChainDesc.BufferCount = FrameCount;
@@ -170,13 +179,6 @@ void D3D12HelloTriangle::LoadAssets()
 	// Create an empty root signature.
 	{
 		D3D12_DESCRIPTOR_RANGE descRange[] = {
-			{
-				.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV,
-				.NumDescriptors = 1,
-				.BaseShaderRegister = 0,
-				.RegisterSpace = 0,
-				.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND
-			},
 			{
 				.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV,
 				.NumDescriptors = 1,
@@ -186,16 +188,19 @@ void D3D12HelloTriangle::LoadAssets()
 			}
 		};
 
+		// The constants are a root CBV: each frame writes them to a fresh
+		// slice of the upload ring and points b0 at it, so no descriptor
+		// is rewritten while the GPU may still read the previous one.
 		D3D12_ROOT_PARAMETER rootParam[] = {
 			{
-				.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE,
-				.DescriptorTable = { 1, &descRange[0] },
+				.ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV,
+				.Descriptor = {.ShaderRegister = 0, .RegisterSpace = 0 },
 				.ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX
 			},
 			{
 				.ParameterType =
 				  D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE,
-				.DescriptorTable = { 1, &descRange[1]},
+				.DescriptorTable = { 1, &descRange[0]},
 				.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL
 			 }
 		};
@@ -237,9 +242,13 @@ void D3D12HelloTriangle::LoadAssets()
 	{
 		D3D12_INPUT_ELEMENT_DESC inputElementDescs[] =
 		{
-			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+			{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_UNORM, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 1, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 2, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+			{ "WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 2, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+			{ "WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 2, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 },
+			{ "WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 2, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA, 1 }
 		};
 
 		D3D12_BLEND_DESC blendDesc = {
@@ -318,10 +327,151 @@ void D3D12HelloTriangle::LoadAssets()
 		ThrowIfFailed(m_commandList->Close());
 	}
 
-	// Create vertex buffer view 
+	// Create fence; the upload ring retires its allocations by it.
+	{
+		ThrowIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
+		m_fenceValue = 1;
+
+		// Create an event handle to use for frame synchronization.
+		m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		if (m_fenceEvent == nullptr)
+		{
+			ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+		}
+	}
+
+	// Create vertex and index buffers
 	{
-		size_t const VERTEX_BUFFER_SIZE = sizeof(vertices_data);
-		NUM_VERTICES = VERTEX_BUFFER_SIZE / sizeof(vertex_t);
+		// Geometry comes from a memory-mapped mesh asset; it is baked from
+		// the compiled-in scene the first time or when the format changes.
+		MeshAsset scene_asset;
+		if (!scene_asset.Open(SCENE_ASSET_PATH)) {
+			scene_bake_stats_t const bake = BakeSceneAsset(SCENE_ASSET_PATH);
+#ifdef _DEBUG
+			char bake_report[320] = {};
+			sprintf_s(bake_report,
+				"Scene asset: %zu -> %zu triangles merged, %zu -> %zu vertices, %zu objects, "
+				"%zu instanced (-%zu vertices, -%zu indices), %zu B/vertex, "
+				"ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, LOD triangles %zu/%zu/%zu/%zu\n",
+				bake.merge.triangles_before, bake.merge.triangles_after,
+				bake.source_vertices, bake.unique_vertices, bake.object_count,
+				bake.instancing.instanced_objects, bake.instancing.vertices_removed, bake.instancing.indices_removed,
+				bake.bytes_per_vertex,
+				bake.cache_before.acmr, bake.cache_after.acmr,
+				bake.cache_before.atvr, bake.cache_after.atvr,
+				bake.lod_triangles[0], bake.lod_triangles[1], bake.lod_triangles[2], bake.lod_triangles[3]);
+			OutputDebugStringA(bake_report);
+#else
+			(void)bake;
+#endif
+			if (!scene_asset.Open(SCENE_ASSET_PATH)) {
+				throw std::runtime_error("Cannot open scene asset");
+			}
+		}
+		const mesh_asset_header_t& header = scene_asset.Header();
+		NUM_INDICES = static_cast<UINT>(header.index_count);
+		m_objects.assign(scene_asset.Objects(), scene_asset.Objects() + header.object_count);
+		m_objectLods.assign(scene_asset.Lods(), scene_asset.Lods() + header.object_count);
+		m_objectLevels.assign(m_objects.size(), 0);
+		m_objectInstances.assign(scene_asset.Instances(), scene_asset.Instances() + header.object_count);
+		m_objectBounds.Clear();
+		m_drawList.clear();
+		for (UINT i = 0; i < m_objects.size(); ++i) {
+			m_objectBounds.Push(m_objects[i].aabb_min, m_objects[i].aabb_max);
+			m_drawList.push_back(i);
+		}
+
+		// Occluders: objects spanning a sizeable part of the scene with few
+		// enough triangles to rasterize on the CPU every frame.
+		float scene_extent = 0.0f;
+		for (int k = 0; k < 3; ++k) {
+			scene_extent = (std::max)(scene_extent, header.aabb_max[k] - header.aabb_min[k]);
+		}
+		m_occluderPositions.resize(3 * header.vertex_count);
+		DecodePositions(header.quantization, static_cast<const packed_vertex_t*>(scene_asset.Vertices()),
+			header.vertex_count, m_occluderPositions.data());
+		m_occluderIndices.assign(NUM_INDICES, 0);
+		for (UINT i = 0; i < NUM_INDICES; ++i) {
+			m_occluderIndices[i] = header.index_size == sizeof(uint16_t)
+				? static_cast<const uint16_t*>(scene_asset.Indices())[i]
+				: static_cast<const uint32_t*>(scene_asset.Indices())[i];
+		}
+		m_isOccluder.assign(m_objects.size(), false);
+		for (UINT i = 0; i < m_objects.size(); ++i) {
+			const scene_object_t& object = m_objects[i];
+			float extent = 0.0f;
+			for (int k = 0; k < 3; ++k) {
+				extent = (std::max)(extent, object.aabb_max[k] - object.aabb_min[k]);
+			}
+			m_isOccluder[i] = extent >= OCCLUDER_MIN_EXTENT * scene_extent
+				&& object.index_count <= 3 * OCCLUDER_MAX_TRIANGLES;
+		}
+		m_occluderOutline.assign(NUM_INDICES / 3, 7);
+		for (UINT i = 0; i < m_objects.size(); ++i) {
+			const scene_object_t& object = m_objects[i];
+			if (m_isOccluder[i]) {
+				std::vector<uint8_t> const outline = OccluderOutline(
+					m_occluderPositions.data(), m_occluderIndices.data() + object.first_index, object.index_count
+				);
+				std::copy(outline.begin(), outline.end(), m_occluderOutline.begin() + object.first_index / 3);
+			}
+		}
+
+		// The player collides with the full-detail triangles of every object,
+		// instances included, in world space.
+		std::vector<vertex_t> collision_vertices;
+		for (UINT i = 0; i < m_objects.size(); ++i) {
+			const scene_object_t& object = m_objects[i];
+			const float (&t)[4][3] = m_objectInstances[i].transform;
+			for (UINT j = object.first_index; j < object.first_index + object.index_count; ++j) {
+				const float* p = &m_occluderPositions[3 * static_cast<size_t>(m_occluderIndices[j])];
+				vertex_t v = {};
+				for (int k = 0; k < 3; ++k) {
+					v.position[k] = p[0] * t[0][k] + p[1] * t[1][k] + p[2] * t[2][k] + t[3][k];
+				}
+				collision_vertices.push_back(v);
+			}
+		}
+		std::vector<uint32_t> collision_indices(collision_vertices.size());
+		for (uint32_t i = 0; i < collision_indices.size(); ++i) {
+			collision_indices[i] = i;
+		}
+		m_collision.Build(collision_vertices.data(), collision_indices.data(), collision_indices.size());
+		// A spawn point grazing a wall would otherwise pin the player there.
+		float const spawn[3] = { playerPos.x, playerPos.y, playerPos.z };
+		float separated[3];
+		m_collision.SeparateSphere(spawn, PLAYER_RADIUS, separated);
+		playerPos = { separated[0], separated[1], separated[2] };
+
+		// Vertices are quantized against the scene bounds; the decode
+		// constants ride along in the vertex shader constant buffer.
+		const vertex_quantization_t& q = header.quantization;
+		m_constantBufferData.posScale = { q.position_scale[0], q.position_scale[1], q.position_scale[2], 0.0f };
+		m_constantBufferData.posOffset = { q.position_offset[0], q.position_offset[1], q.position_offset[2], 0.0f };
+		m_constantBufferData.texScaleOffset = {
+			q.tex_coord_scale[0], q.tex_coord_scale[1], q.tex_coord_offset[0], q.tex_coord_offset[1]
+		};
+
+		size_t const VERTEX_BUFFER_SIZE = scene_asset.VertexBytes();
+		size_t const COLOR_BUFFER_SIZE = scene_asset.ColorBytes();
+		size_t const INDEX_BUFFER_SIZE = scene_asset.IndexBytes();
+
+		// One upload buffer, mapped for good, stages the geometry at startup
+		// and then each frame's constants and instances. It is sized for the
+		// startup copies plus every frame in flight; texture levels have a
+		// ring of their own.
+		auto aligned = [](UINT64 size, UINT64 alignment) {
+			return (size + alignment - 1) & ~(alignment - 1);
+		};
+		UINT64 const frame_upload_size = aligned(sizeof(vs_const_buffer_t), UPLOAD_CONSTANT_ALIGNMENT) +
+			aligned((std::max)(m_objects.size(), size_t(1)) * sizeof(XMFLOAT4X4), UPLOAD_CONSTANT_ALIGNMENT);
+		UINT64 const startup_upload_size =
+			aligned(VERTEX_BUFFER_SIZE, UPLOAD_CONSTANT_ALIGNMENT) +
+			aligned(COLOR_BUFFER_SIZE, UPLOAD_CONSTANT_ALIGNMENT) +
+			aligned(INDEX_BUFFER_SIZE, UPLOAD_CONSTANT_ALIGNMENT);
+		UINT64 const UPLOAD_RING_SIZE = aligned(
+			(std::max)(startup_upload_size, frame_upload_size * (FrameCount + 1)), UPLOAD_TEXTURE_ALIGNMENT
+		);
 
 		D3D12_HEAP_PROPERTIES heapProp = {
 			.Type = D3D12_HEAP_TYPE_UPLOAD,
@@ -330,93 +480,97 @@ void D3D12HelloTriangle::LoadAssets()
 			.CreationNodeMask = 1,
 			.VisibleNodeMask = 1
 		};
-
-		D3D12_RESOURCE_DESC resourceDesc = {
-			.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER,
-			.Alignment = 0,
-			.Width = VERTEX_BUFFER_SIZE,
-			.Height = 1,
-			.DepthOrArraySize = 1,
-			.MipLevels = 1,
-			.Format = DXGI_FORMAT_UNKNOWN,
-			.SampleDesc = {.Count = 1, .Quality = 0 },
-			.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
-			.Flags = D3D12_RESOURCE_FLAG_NONE
+		D3D12_HEAP_PROPERTIES defaultHeapProp = heapProp;
+		defaultHeapProp.Type = D3D12_HEAP_TYPE_DEFAULT;
+
+		auto buffer_desc = [](UINT64 size) {
+			D3D12_RESOURCE_DESC resourceDesc = {
+				.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER,
+				.Alignment = 0,
+				.Width = size,
+				.Height = 1,
+				.DepthOrArraySize = 1,
+				.MipLevels = 1,
+				.Format = DXGI_FORMAT_UNKNOWN,
+				.SampleDesc = {.Count = 1, .Quality = 0 },
+				.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+				.Flags = D3D12_RESOURCE_FLAG_NONE
+			};
+			return resourceDesc;
 		};
 
+		D3D12_RESOURCE_DESC const uploadDesc = buffer_desc(UPLOAD_RING_SIZE);
 		ThrowIfFailed(m_device->CreateCommittedResource(
 			&heapProp,
 			D3D12_HEAP_FLAG_NONE,
-			&resourceDesc,
+			&uploadDesc,
 			D3D12_RESOURCE_STATE_GENERIC_READ,
 			nullptr,
-			IID_PPV_ARGS(&m_vertexBuffer)));
-
-		// Copy the triangle data to the vertex buffer.
-		UINT8* pVertexDataBegin;
+			IID_PPV_ARGS(&m_uploadBuffer)));
+		UINT8* pUploadBegin;
 		CD3DX12_RANGE readRange(0, 0);
-		ThrowIfFailed(m_vertexBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pVertexDataBegin)));
-		memcpy(pVertexDataBegin, vertices_data, sizeof(vertices_data));
-		m_vertexBuffer->Unmap(0, nullptr);
-
-		// Initialize the vertex buffer view.
-		m_vertexBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
-		m_vertexBufferView.StrideInBytes = sizeof(vertex_t);
-		m_vertexBufferView.SizeInBytes = VERTEX_BUFFER_SIZE;
+		ThrowIfFailed(m_uploadBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pUploadBegin)));
+		m_uploadRing.Reset(pUploadBegin, m_uploadBuffer->GetGPUVirtualAddress(), UPLOAD_RING_SIZE);
+
+		ThrowIfFailed(m_commandList->Reset(m_commandAllocator.Get(), m_pipelineState.Get()));
+
+		auto create_default_buffer = [&](const void* data, size_t size, D3D12_RESOURCE_STATES state, ComPtr<ID3D12Resource>& buffer) {
+			D3D12_RESOURCE_DESC const resourceDesc = buffer_desc(size);
+			ThrowIfFailed(m_device->CreateCommittedResource(
+				&defaultHeapProp,
+				D3D12_HEAP_FLAG_NONE,
+				&resourceDesc,
+				D3D12_RESOURCE_STATE_COPY_DEST,
+				nullptr,
+				IID_PPV_ARGS(&buffer)));
+
+			upload_allocation_t const staging = AllocateUpload(size, UPLOAD_CONSTANT_ALIGNMENT);
+			memcpy(staging.cpu, data, size);
+			m_commandList->CopyBufferRegion(buffer.Get(), 0, m_uploadBuffer.Get(), staging.offset, size);
+			D3D12_RESOURCE_BARRIER const barrier = CD3DX12_RESOURCE_BARRIER::Transition(
+				buffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, state
+			);
+			m_commandList->ResourceBarrier(1, &barrier);
+		};
+
+		create_default_buffer(scene_asset.Vertices(), VERTEX_BUFFER_SIZE, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, m_vertexBuffer);
+		create_default_buffer(scene_asset.Colors(), COLOR_BUFFER_SIZE, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, m_colorBuffer);
+		create_default_buffer(scene_asset.Indices(), INDEX_BUFFER_SIZE, D3D12_RESOURCE_STATE_INDEX_BUFFER, m_indexBuffer);
+
+		// Initialize the vertex and index buffer views. A constant color is
+		// stored once and read with a zero stride.
+		m_vertexBufferViews[0].BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
+		m_vertexBufferViews[0].StrideInBytes = sizeof(packed_vertex_t);
+		m_vertexBufferViews[0].SizeInBytes = static_cast<UINT>(VERTEX_BUFFER_SIZE);
+
+		m_vertexBufferViews[1].BufferLocation = m_colorBuffer->GetGPUVirtualAddress();
+		m_vertexBufferViews[1].StrideInBytes = header.color_count == 1 ? 0 : sizeof(uint32_t);
+		m_vertexBufferViews[1].SizeInBytes = static_cast<UINT>(COLOR_BUFFER_SIZE);
+
+		// Slot 2 is pointed at each frame's instances by OnUpdate.
+		m_vertexBufferViews[2].StrideInBytes = sizeof(XMFLOAT4X4);
+
+		m_indexBufferView.BufferLocation = m_indexBuffer->GetGPUVirtualAddress();
+		m_indexBufferView.Format = header.index_size == sizeof(uint16_t) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+		m_indexBufferView.SizeInBytes = static_cast<UINT>(INDEX_BUFFER_SIZE);
+
+		ThrowIfFailed(m_commandList->Close());
+		ID3D12CommandList* cmd_list = m_commandList.Get();
+		m_commandQueue->ExecuteCommandLists(1, &cmd_list);
+		WaitForPreviousFrame();
 	}
 
-	// Create the constant buffer.
+	// Create the descriptor heap for the texture SRV.
 	{
 		D3D12_DESCRIPTOR_HEAP_DESC cbvHeapDesc = {
 			.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
-			.NumDescriptors = 2,
+			.NumDescriptors = 1,
 			.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE,
 			.NodeMask = 0
 		};
 		ThrowIfFailed(m_device->CreateDescriptorHeap(&cbvHeapDesc, IID_PPV_ARGS(&m_cbvHeap)));
 
-		const UINT constantBufferSize = sizeof(vs_const_buffer_t);
-
-		D3D12_HEAP_PROPERTIES cbvHeapProps = {
-			.Type = D3D12_HEAP_TYPE_UPLOAD,
-			.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
-			.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN,
-			.CreationNodeMask = 1,
-			.VisibleNodeMask = 1
-		};
-
-		D3D12_RESOURCE_DESC cbvResourceDesc = {
-			.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER,
-			.Alignment = 0,
-			.Width = constantBufferSize,
-			.Height = 1,
-			.DepthOrArraySize = 1,
-			.MipLevels = 1,
-			.Format = DXGI_FORMAT_UNKNOWN,
-			.SampleDesc = {.Count = 1, .Quality = 0 },
-			.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
-			.Flags = D3D12_RESOURCE_FLAG_NONE
-		};
-
-		ThrowIfFailed(m_device->CreateCommittedResource(
-			&cbvHeapProps,
-			D3D12_HEAP_FLAG_NONE,
-			&cbvResourceDesc,
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr,
-			IID_PPV_ARGS(&m_constantBuffer)));
-
-		// Describe and create a constant buffer view.
-		D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc = {};
-		cbvDesc.BufferLocation = m_constantBuffer->GetGPUVirtualAddress();
-		cbvDesc.SizeInBytes = constantBufferSize;
-		m_device->CreateConstantBufferView(&cbvDesc, m_cbvHeap->GetCPUDescriptorHandleForHeapStart());
-
 		XMStoreFloat4x4(&m_constantBufferData.matWorldViewProj, XMMatrixIdentity());
-
-		CD3DX12_RANGE readRange(0, 0);
-		ThrowIfFailed(m_constantBuffer->Map(0, &readRange, reinterpret_cast<void**>(&m_pCbvDataBegin)));
-		memcpy(m_pCbvDataBegin, &m_constantBufferData, sizeof(m_constantBufferData));
 	}
 
 	// Create depth buffor
@@ -477,195 +631,94 @@ void D3D12HelloTriangle::LoadAssets()
 		);
 	}
 
-	// Create fence
-	{
-		ThrowIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
-		m_fenceValue = 1;
-
-		// Create an event handle to use for frame synchronization.
-		m_fenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-		if (m_fenceEvent == nullptr)
-		{
-			ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
-		}
-	}
-
 	// Create texture resources
 	{
-		// Texture resource
-		D3D12_HEAP_PROPERTIES tex_heap_prop = {
-		  .Type = D3D12_HEAP_TYPE_DEFAULT,
-		  .CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
-		  .MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN,
-		  .CreationNodeMask = 1,
-		  .VisibleNodeMask = 1
-		};
-		D3D12_RESOURCE_DESC tex_resource_desc = {
-		  .Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D,
-		  .Alignment = 0,
-		  .Width = 768, 
-		  .Height = 768,
-		  .DepthOrArraySize = 1,
-		  .MipLevels = 1,
-		  .Format = DXGI_FORMAT_R8G8B8A8_UNORM,
-		  .SampleDesc = {.Count = 1, .Quality = 0 },
-		  .Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN,
-		  .Flags = D3D12_RESOURCE_FLAG_NONE
-		};
-
-		m_device->CreateCommittedResource(
-			&tex_heap_prop,
-			D3D12_HEAP_FLAG_NONE,
-			&tex_resource_desc,
-			D3D12_RESOURCE_STATE_COPY_DEST,
-			nullptr,
-			IID_PPV_ARGS(&texture_resource));
-
-		// Helper buffer for reading texture into GPU
-		ComPtr<ID3D12Resource> texture_upload_buffer = nullptr;
-		UINT64 RequiredSize = 0;
-		auto Desc = texture_resource.Get()->GetDesc();
-		ID3D12Device* pDevice = nullptr;
-		texture_resource.Get()->GetDevice(
-			__uuidof(*pDevice), reinterpret_cast<void**>(&pDevice)
-		);
-		pDevice->GetCopyableFootprints(
-			&Desc, 0, 1, 0, nullptr, nullptr, nullptr, &RequiredSize
-		);
-		pDevice->Release();
-
-		D3D12_HEAP_PROPERTIES tex_upload_heap_prop = {
-		  .Type = D3D12_HEAP_TYPE_UPLOAD,
-		  .CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
-		  .MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN,
-		  .CreationNodeMask = 1,
-		  .VisibleNodeMask = 1
-		};
-		D3D12_RESOURCE_DESC tex_upload_resource_desc = {
-		  .Dimension = D3D12_RESOURCE_DIMENSION_BUFFER,
-		  .Alignment = 0,
-		  .Width = RequiredSize,
-		  .Height = 1,
-		  .DepthOrArraySize = 1,
-		  .MipLevels = 1,
-		  .Format = DXGI_FORMAT_UNKNOWN,
-		  .SampleDesc = {.Count = 1, .Quality = 0 },
-		  .Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
-		  .Flags = D3D12_RESOURCE_FLAG_NONE
-		};
-		m_device->CreateCommittedResource(
-			&tex_upload_heap_prop, D3D12_HEAP_FLAG_NONE,
-			&tex_upload_resource_desc,
-			D3D12_RESOURCE_STATE_GENERIC_READ,
-			nullptr, IID_PPV_ARGS(&texture_upload_buffer)
-		);
-
-		D3D12_SUBRESOURCE_DATA texture_data = {
-		  .pData = bmp_bits,
-		  .RowPitch = (LONG_PTR)(bmp_width * bmp_px_size),
-		  .SlicePitch = (LONG_PTR)(bmp_width * bmp_height * bmp_px_size)
-		};
-
-		ThrowIfFailed(m_commandList->Reset(m_commandAllocator.Get(), m_pipelineState.Get()));
-
-		UINT const MAX_SUBRESOURCES = 1;
-		RequiredSize = 0;
-		D3D12_PLACED_SUBRESOURCE_FOOTPRINT Layouts[MAX_SUBRESOURCES];
-		UINT NumRows[MAX_SUBRESOURCES];
-		UINT64 RowSizesInBytes[MAX_SUBRESOURCES];
-		Desc = texture_resource.Get()->GetDesc();
-		pDevice = nullptr;
-		texture_resource.Get()->GetDevice(
-			__uuidof(*pDevice), reinterpret_cast<void**>(&pDevice)
-		);
-		pDevice->GetCopyableFootprints(
-			&Desc, 0, 1, 0, Layouts, NumRows,
-			RowSizesInBytes, &RequiredSize
-		);
-		pDevice->Release();
+		// Minified texels would otherwise sample the full-size atlas and
+		// thrash the texture cache at a distance; the asset holds every level.
+		// They stream in on the copy queue from the mapped asset, coarse to
+		// fine as the screen footprint asks for them, within
+		// TEXTURE_MEMORY_BUDGET (see RecordTransition).
+		const texture_asset_header_t& texture_header = m_textureAsset.Header();
+		switch (texture_header.format) {
+		case texture_format_t::bc1: m_textureFormat = DXGI_FORMAT_BC1_UNORM; break;
+		case texture_format_t::bc3: m_textureFormat = DXGI_FORMAT_BC3_UNORM; break;
+		case texture_format_t::bc7: m_textureFormat = DXGI_FORMAT_BC7_UNORM; break;
+		default: m_textureFormat = DXGI_FORMAT_R8G8B8A8_UNORM; break;
+		}
 
-		BYTE* map_tex_data = nullptr;
-		texture_upload_buffer->Map(
-			0, nullptr, reinterpret_cast<void**>(&map_tex_data)
-		);
-		D3D12_MEMCPY_DEST DestData = {
-		  .pData = map_tex_data + Layouts[0].Offset,
-		  .RowPitch = Layouts[0].Footprint.RowPitch,
-		  .SlicePitch =
-			SIZE_T(Layouts[0].Footprint.RowPitch) * SIZE_T(NumRows[0])
+		streamed_texture_t texture = {
+			.width = texture_header.width,
+			.height = texture_header.height,
+			.level_count = texture_header.level_count,
+			.coarsest_top_level = texture_header.level_count - 1
 		};
-		for (UINT z = 0; z < Layouts[0].Footprint.Depth; ++z) {
-			auto pDestSlice =
-				static_cast<UINT8*>(DestData.pData)
-				+ DestData.SlicePitch * z;
-			auto pSrcSlice =
-				static_cast<const UINT8*>(texture_data.pData)
-				+ texture_data.SlicePitch * LONG_PTR(z);
-			for (UINT y = 0; y < NumRows[0]; ++y) {
-				memcpy(
-					pDestSlice + DestData.RowPitch * y,
-					pSrcSlice + texture_data.RowPitch * LONG_PTR(y),
-					static_cast<SIZE_T>(RowSizesInBytes[0])
-				);
+		if (texture_header.format != texture_format_t::rgba8) {
+			// The top level of a block-compressed texture is whole blocks.
+			texture.coarsest_top_level = 0;
+			while (texture.coarsest_top_level + 1 < texture.level_count &&
+				m_textureAsset.Level(texture.coarsest_top_level + 1).width % 4 == 0 &&
+				m_textureAsset.Level(texture.coarsest_top_level + 1).height % 4 == 0) {
+				++texture.coarsest_top_level;
 			}
 		}
-		texture_upload_buffer->Unmap(0, nullptr);
+		UINT64 largest_level = 0;
+		for (UINT level = 0; level < texture.level_count; ++level) {
+			const texture_asset_level_t& asset_level = m_textureAsset.Level(level);
+			texture.level_bytes.push_back(asset_level.row_pitch * asset_level.rows);
+			largest_level = (std::max)(largest_level, texture.level_bytes.back());
+		}
+		m_textureStreamer.AddTexture(texture);
+		m_pendingTextures.resize(1);
 
-		D3D12_TEXTURE_COPY_LOCATION Dst = {
-		  .pResource = texture_resource.Get(),
-		  .Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX,
-		  .SubresourceIndex = 0
-		};
-		D3D12_TEXTURE_COPY_LOCATION Src = {
-		  .pResource = texture_upload_buffer.Get(),
-		  .Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT,
-		  .PlacedFootprint = Layouts[0]
-		};
-		m_commandList->CopyTextureRegion(
-			&Dst, 0, 0, 0, &Src, nullptr
+		// Staging for the bytes in flight, or a single larger level, twice
+		// over so that an allocation skipping the end of the ring still fits.
+		UINT64 const STREAMING_RING_SIZE = 2 * (
+			(std::max)(TEXTURE_STREAMING_INFLIGHT, largest_level) + UPLOAD_TEXTURE_ALIGNMENT * texture.level_count
 		);
-		D3D12_RESOURCE_BARRIER tex_upload_resource_barrier = {
-		  .Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
-		  .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
-		  .Transition = {
-			.pResource = texture_resource.Get(),
-			.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
-			.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST,
-			.StateAfter =
-			  D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE },
+		D3D12_HEAP_PROPERTIES const upload_heap_prop = {
+			.Type = D3D12_HEAP_TYPE_UPLOAD,
+			.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+			.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN,
+			.CreationNodeMask = 1,
+			.VisibleNodeMask = 1
 		};
-		m_commandList->ResourceBarrier(
-			1, &tex_upload_resource_barrier
-		);
-		m_commandList->Close();
-		ID3D12CommandList* cmd_list = m_commandList.Get();
-		m_commandQueue->ExecuteCommandLists(1, &cmd_list);
-
-		// Create SRV for the texture
-		D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc = {
-		  .Format = tex_resource_desc.Format,
-		  .ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D,
-		  .Shader4ComponentMapping =
-			D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING,
-		  .Texture2D = {
-			.MostDetailedMip = 0,
+		D3D12_RESOURCE_DESC const streaming_desc = {
+			.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER,
+			.Alignment = 0,
+			.Width = STREAMING_RING_SIZE,
+			.Height = 1,
+			.DepthOrArraySize = 1,
 			.MipLevels = 1,
-			.PlaneSlice = 0,
-			.ResourceMinLODClamp = 0.0f
-		  },
+			.Format = DXGI_FORMAT_UNKNOWN,
+			.SampleDesc = {.Count = 1, .Quality = 0 },
+			.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+			.Flags = D3D12_RESOURCE_FLAG_NONE
 		};
-		D3D12_CPU_DESCRIPTOR_HANDLE cpu_desc_handle =
-			m_cbvHeap->
-			GetCPUDescriptorHandleForHeapStart();
-		cpu_desc_handle.ptr +=
-			m_device->GetDescriptorHandleIncrementSize(
-				D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV
-			);
-		m_device->CreateShaderResourceView(
-			texture_resource.Get(), &srv_desc, cpu_desc_handle
-		);
+		ThrowIfFailed(m_device->CreateCommittedResource(
+			&upload_heap_prop,
+			D3D12_HEAP_FLAG_NONE,
+			&streaming_desc,
+			D3D12_RESOURCE_STATE_GENERIC_READ,
+			nullptr,
+			IID_PPV_ARGS(&m_streamingBuffer)));
+		UINT8* pStreamingBegin;
+		CD3DX12_RANGE readRange(0, 0);
+		ThrowIfFailed(m_streamingBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pStreamingBegin)));
+		m_streamingRing.Reset(pStreamingBegin, m_streamingBuffer->GetGPUVirtualAddress(), STREAMING_RING_SIZE);
 
-		WaitForPreviousFrame();
+		for (UINT i = 0; i < CopyAllocatorCount; ++i) {
+			ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&m_copyAllocators[i])));
+		}
+		ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, m_copyAllocators[0].Get(), nullptr, IID_PPV_ARGS(&m_copyList)));
+		ThrowIfFailed(m_copyList->Close());
+		ThrowIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_copyFence)));
+
+		// The first frame waits only for the tail: the first update requests
+		// it, the second makes it resident once the copy queue is done.
+		float const unseen = 0.0f;
+		m_textureStreamer.Update(&unseen, 0);
+		WaitForCopyFence(m_copyFenceValue);
+		m_textureStreamer.Update(&unseen, m_copyFence->GetCompletedValue());
 	}
 }
 
@@ -678,14 +731,20 @@ void D3D12HelloTriangle::OnUpdate()
 	if (keyboard[2]) {
 		angle -= ROTSPEEDPERTIMER;
 	}
+	float step[3] = { 0.0f, 0.0f, 0.0f };
 	if (keyboard[1]) {
-		playerPos.x -= (FLOAT)sin(angle) * MOVESPEEDPERTIMER;
-		playerPos.z -= -(FLOAT)cos(angle) * MOVESPEEDPERTIMER;
+		step[0] -= (FLOAT)sin(angle) * MOVESPEEDPERTIMER;
+		step[2] -= -(FLOAT)cos(angle) * MOVESPEEDPERTIMER;
 	}
 	if (keyboard[3]) {
-		playerPos.x -= -(FLOAT)sin(angle) * MOVESPEEDPERTIMER;
-		playerPos.z -= (FLOAT)cos(angle) * MOVESPEEDPERTIMER;
+		step[0] -= -(FLOAT)sin(angle) * MOVESPEEDPERTIMER;
+		step[2] -= (FLOAT)cos(angle) * MOVESPEEDPERTIMER;
 	}
+	// Walls stop the player; glancing moves slide along them.
+	float const start[3] = { playerPos.x, playerPos.y, playerPos.z };
+	float end[3];
+	m_collision.MoveSphere(start, PLAYER_RADIUS, step, end);
+	playerPos = { end[0], end[1], end[2] };
 
 
 	XMMATRIX wvp_matrix;
@@ -696,22 +755,122 @@ void D3D12HelloTriangle::OnUpdate()
 	);
 
 
+	XMMATRIX const projection = XMMatrixPerspectiveFovLH(
+		45.0f, static_cast<float>(m_width) / static_cast<float>(m_height), 1.0f, 100.0f
+	);
 	wvp_matrix = XMMatrixMultiply(
 		wvp_matrix,
-		XMMatrixPerspectiveFovLH(
-			45.0f, static_cast<float>(m_width) / static_cast<float>(m_height), 1.0f, 100.0f
-		)
+		projection
 	);
+
+	// Only objects inside the view frustum are recorded this frame.
+	XMFLOAT4X4 view_proj;
+	XMStoreFloat4x4(&view_proj, wvp_matrix);
+	frustum_t const frustum = ExtractFrustumPlanes(&view_proj.m[0][0]);
+	m_drawList.resize(m_objectBounds.Size());
+	m_drawList.resize(CullAabbs(frustum, m_objectBounds, m_drawList.data()));
+
+	// Visible occluders fill a coarse CPU depth buffer; other objects hidden
+	// entirely behind them are dropped as well.
+	m_occlusion.Begin(&view_proj.m[0][0]);
+	for (UINT object_id : m_drawList) {
+		if (m_isOccluder[object_id]) {
+			const scene_object_t& object = m_objects[object_id];
+			m_occlusion.RasterizeOccluders(
+				m_occluderPositions.data(), m_occluderIndices.data() + object.first_index, object.index_count,
+				&m_objectInstances[object_id].transform[0][0], m_occluderOutline.data() + object.first_index / 3
+			);
+		}
+	}
+	m_occlusion.UpdateHierarchy();
+	m_drawList.erase(
+		std::remove_if(m_drawList.begin(), m_drawList.end(), [&](UINT object_id) {
+			const scene_object_t& object = m_objects[object_id];
+			return !m_isOccluder[object_id] && !m_occlusion.TestAabb(object.aabb_min, object.aabb_max);
+		}),
+		m_drawList.end()
+	);
+
+	// Each drawn object uses its coarsest LOD whose simplification error
+	// stays below LOD_PIXEL_ERROR on screen, measured from its nearest point.
+	XMFLOAT4X4 projection_values;
+	XMStoreFloat4x4(&projection_values, projection);
+	float const pixels_per_unit = 0.5f * static_cast<float>(m_height) * projection_values._22;
+	float const eye[3] = { playerPos.x, playerPos.y, playerPos.z };
+	for (UINT object_id : m_drawList) {
+		const scene_object_t& object = m_objects[object_id];
+		float distance_sq = 0.0f;
+		for (int k = 0; k < 3; ++k) {
+			float const d = (std::max)((std::max)(object.aabb_min[k] - eye[k], eye[k] - object.aabb_max[k]), 0.0f);
+			distance_sq += d * d;
+		}
+		m_objectLevels[object_id] = SelectLod(
+			m_objectLods[object_id], sqrtf(distance_sq), pixels_per_unit, LOD_PIXEL_ERROR
+		);
+	}
+
+	// The atlas is wanted at the level whose texels match the pixels the
+	// drawn objects cover between them; finished level copies become
+	// resident and the next ones are queued.
+	float const screen_pixels = static_cast<float>(m_width) * static_cast<float>(m_height);
+	float texture_footprint = 0.0f;
+	for (UINT object_id : m_drawList) {
+		const scene_object_t& object = m_objects[object_id];
+		texture_footprint += ProjectedAabbArea(
+			&view_proj.m[0][0], object.aabb_min, object.aabb_max,
+			static_cast<float>(m_width), static_cast<float>(m_height)
+		);
+	}
+	texture_footprint = (std::min)(texture_footprint, screen_pixels);
+	UINT64 const copies_completed = m_copyFence->GetCompletedValue();
+	m_streamingRing.Reclaim(copies_completed);
+	m_textureStreamer.Update(&texture_footprint, copies_completed);
+
+	// Copies of one prototype at one level differ only in placement: sort
+	// them together and draw each run with a single instanced call.
+	std::sort(m_drawList.begin(), m_drawList.end(), [&](UINT a, UINT b) {
+		UINT const prototype_a = m_objectInstances[a].prototype, prototype_b = m_objectInstances[b].prototype;
+		return prototype_a != prototype_b ? prototype_a < prototype_b : m_objectLevels[a] < m_objectLevels[b];
+	});
+	m_drawBatches.clear();
+	upload_allocation_t const instances = AllocateUpload(
+		(std::max)(m_drawList.size(), size_t(1)) * sizeof(XMFLOAT4X4), UPLOAD_CONSTANT_ALIGNMENT
+	);
+	XMFLOAT4X4* const instance_data = reinterpret_cast<XMFLOAT4X4*>(instances.cpu);
+	m_vertexBufferViews[2].BufferLocation = instances.gpu;
+	m_vertexBufferViews[2].SizeInBytes = static_cast<UINT>(m_drawList.size() * sizeof(XMFLOAT4X4));
+	for (UINT i = 0; i < m_drawList.size(); ++i) {
+		UINT const object_id = m_drawList[i];
+		const float (&t)[4][3] = m_objectInstances[object_id].transform;
+		instance_data[i] = XMFLOAT4X4(
+			t[0][0], t[0][1], t[0][2], 0.0f,
+			t[1][0], t[1][1], t[1][2], 0.0f,
+			t[2][0], t[2][1], t[2][2], 0.0f,
+			t[3][0], t[3][1], t[3][2], 1.0f
+		);
+
+		const object_lods_t& lods = m_objectLods[object_id];
+		UINT const level = m_objectLevels[object_id];
+		if (!m_drawBatches.empty()) {
+			draw_batch_t& last = m_drawBatches.back();
+			if (last.first_index == lods.first_index[level] && last.index_count == lods.index_count[level]) {
+				++last.instance_count;
+				continue;
+			}
+		}
+		m_drawBatches.push_back({ lods.index_count[level], lods.first_index[level], i, 1 });
+	}
+
 	wvp_matrix = XMMatrixTranspose(wvp_matrix);
 	XMStoreFloat4x4(
 		&m_constantBufferData.matWorldViewProj, 	
 		wvp_matrix
 	);
-	memcpy(
-		m_pCbvDataBegin, 		
-		&m_constantBufferData, 		
-		sizeof(m_constantBufferData)	
-	);
+	// The previous frame's constants may still be in flight, so each frame
+	// writes a new slice and points the root CBV at it.
+	upload_allocation_t const constants = AllocateUpload(sizeof(m_constantBufferData), UPLOAD_CONSTANT_ALIGNMENT);
+	memcpy(constants.cpu, &m_constantBufferData, sizeof(m_constantBufferData));
+	m_constantBufferAddress = constants.gpu;
 }
 
 // Render the scene.
@@ -735,6 +894,7 @@ void D3D12HelloTriangle::OnDestroy()
 	// Ensure that the GPU is no longer referencing resources that are about to be
 	// cleaned up by the destructor.
 	WaitForPreviousFrame();
+	WaitForCopyFence(m_copyFenceValue);
 
 	CloseHandle(m_fenceEvent);
 }
@@ -752,15 +912,11 @@ void D3D12HelloTriangle::PopulateCommandList()
 	ID3D12DescriptorHeap* ppHeaps[] = { m_cbvHeap.Get() };
 	m_commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
 
+	m_commandList->SetGraphicsRootConstantBufferView(0, m_constantBufferAddress);
+
 	D3D12_GPU_DESCRIPTOR_HANDLE gpu_desc_handle =
 		m_cbvHeap->
 		GetGPUDescriptorHandleForHeapStart();
-	m_commandList->SetGraphicsRootDescriptorTable(0, gpu_desc_handle);
-
-	gpu_desc_handle.ptr +=
-		m_device->GetDescriptorHandleIncrementSize(
-			D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV
-		);
 	m_commandList->SetGraphicsRootDescriptorTable(
 		1, gpu_desc_handle
 	);
@@ -783,8 +939,13 @@ void D3D12HelloTriangle::PopulateCommandList()
 	);
 
 	m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	m_commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
-	m_commandList->DrawInstanced(NUM_VERTICES, 1, 0, 0);
+	m_commandList->IASetVertexBuffers(0, _countof(m_vertexBufferViews), m_vertexBufferViews);
+	m_commandList->IASetIndexBuffer(&m_indexBufferView);
+	for (const draw_batch_t& batch : m_drawBatches) {
+		m_commandList->DrawIndexedInstanced(
+			batch.index_count, batch.instance_count, batch.first_index, 0, batch.first_instance
+		);
+	}
 
 	ThrowIfFailed(m_commandList->Close());
 }
@@ -795,6 +956,8 @@ void D3D12HelloTriangle::WaitForPreviousFrame()
 	const UINT64 fence = m_fenceValue;
 	ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), fence));
 	m_fenceValue++;
+	// Upload ring space written for this submission frees up with it.
+	m_uploadRing.Submit(fence);
 
 	// Wait until the previous frame is finished.
 	if (m_fence->GetCompletedValue() < fence)
@@ -802,6 +965,186 @@ void D3D12HelloTriangle::WaitForPreviousFrame()
 		ThrowIfFailed(m_fence->SetEventOnCompletion(fence, m_fenceEvent));
 		WaitForSingleObject(m_fenceEvent, INFINITE);
 	}
+	m_uploadRing.Reclaim(m_fence->GetCompletedValue());
+	// No frame samples the chains replaced before this one any longer.
+	m_retiredTextures.clear();
 
 	m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
 }
+
+upload_allocation_t D3D12HelloTriangle::AllocateUpload(UINT64 size, UINT64 alignment)
+{
+	upload_allocation_t allocation = m_uploadRing.Allocate(size, alignment);
+	// Full: wait for the oldest submission in flight to retire and try
+	// again. Nothing is signalled here; earlier allocations of this frame
+	// belong to the command list still being recorded and must stay live
+	// until its own fence.
+	while (!allocation.cpu) {
+		UINT64 const fence = m_uploadRing.OldestPendingFence();
+		if (fence == 0) {
+			throw std::runtime_error("Upload ring too small");
+		}
+		if (m_fence->GetCompletedValue() < fence)
+		{
+			ThrowIfFailed(m_fence->SetEventOnCompletion(fence, m_fenceEvent));
+			WaitForSingleObject(m_fenceEvent, INFINITE);
+		}
+		m_uploadRing.Reclaim(m_fence->GetCompletedValue());
+		allocation = m_uploadRing.Allocate(size, alignment);
+	}
+	return allocation;
+}
+
+void D3D12HelloTriangle::WaitForCopyFence(UINT64 fence)
+{
+	if (m_copyFence->GetCompletedValue() < fence)
+	{
+		ThrowIfFailed(m_copyFence->SetEventOnCompletion(fence, m_fenceEvent));
+		WaitForSingleObject(m_fenceEvent, INFINITE);
+	}
+}
+
+// A committed texture cannot release single levels, so every transition
+// fills a new one holding levels [new_top, ...): the levels added come from
+// the mapped asset through the streaming ring, the rest are copied over
+// from the chain the SRV views now. Both queues only read that chain, and
+// simultaneous access lets the copy queue write the new one from COMMON
+// with no barriers.
+void D3D12HelloTriangle::RecordTransition(uint32_t texture, uint32_t top, uint32_t new_top)
+{
+	if (!m_copyListOpen) {
+		// Reuse the oldest allocator once its submission has finished.
+		WaitForCopyFence(m_copyAllocatorFences[m_copyAllocatorIndex]);
+		ID3D12CommandAllocator* allocator = m_copyAllocators[m_copyAllocatorIndex].Get();
+		ThrowIfFailed(allocator->Reset());
+		ThrowIfFailed(m_copyList->Reset(allocator, nullptr));
+		m_copyListOpen = true;
+	}
+
+	const texture_asset_header_t& texture_header = m_textureAsset.Header();
+	UINT const level_count = texture_header.level_count;
+	UINT const new_levels = level_count - new_top;
+	D3D12_HEAP_PROPERTIES const tex_heap_prop = {
+	  .Type = D3D12_HEAP_TYPE_DEFAULT,
+	  .CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+	  .MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN,
+	  .CreationNodeMask = 1,
+	  .VisibleNodeMask = 1
+	};
+	D3D12_RESOURCE_DESC const tex_resource_desc = {
+	  .Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D,
+	  .Alignment = 0,
+	  .Width = m_textureAsset.Level(new_top).width,
+	  .Height = m_textureAsset.Level(new_top).height,
+	  .DepthOrArraySize = 1,
+	  .MipLevels = static_cast<UINT16>(new_levels),
+	  .Format = m_textureFormat,
+	  .SampleDesc = {.Count = 1, .Quality = 0 },
+	  .Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN,
+	  .Flags = D3D12_RESOURCE_FLAG_ALLOW_SIMULTANEOUS_ACCESS
+	};
+	ComPtr<ID3D12Resource>& pending = m_pendingTextures[texture];
+	ThrowIfFailed(m_device->CreateCommittedResource(
+		&tex_heap_prop,
+		D3D12_HEAP_FLAG_NONE,
+		&tex_resource_desc,
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(&pending)));
+
+	std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> Layouts(new_levels);
+	std::vector<UINT> NumRows(new_levels);
+	std::vector<UINT64> RowSizesInBytes(new_levels);
+	m_device->GetCopyableFootprints(
+		&tex_resource_desc, 0, new_levels, 0, Layouts.data(), NumRows.data(), RowSizesInBytes.data(), nullptr
+	);
+
+	for (UINT level = new_top; level < level_count; ++level) {
+		UINT const subresource = level - new_top;
+		D3D12_TEXTURE_COPY_LOCATION Dst = {
+		  .pResource = pending.Get(),
+		  .Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX,
+		  .SubresourceIndex = subresource
+		};
+		if (level >= top) {
+			D3D12_TEXTURE_COPY_LOCATION Src = {
+			  .pResource = texture_resource.Get(),
+			  .Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX,
+			  .SubresourceIndex = level - top
+			};
+			m_copyList->CopyTextureRegion(&Dst, 0, 0, 0, &Src, nullptr);
+			continue;
+		}
+
+		// NumRows counts rows of blocks for the compressed formats.
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = Layouts[subresource];
+		UINT64 const staging_size = footprint.Footprint.RowPitch * NumRows[subresource];
+		upload_allocation_t staging = m_streamingRing.Allocate(staging_size, UPLOAD_TEXTURE_ALIGNMENT);
+		if (!staging.cpu) {
+			// The streamer keeps the bytes in flight within the ring; only
+			// submissions it has not seen complete yet can be holding it.
+			WaitForCopyFence(m_copyFenceValue);
+			m_streamingRing.Reclaim(m_copyFence->GetCompletedValue());
+			staging = m_streamingRing.Allocate(staging_size, UPLOAD_TEXTURE_ALIGNMENT);
+			if (!staging.cpu) {
+				throw std::runtime_error("Streaming ring too small");
+			}
+		}
+		const texture_asset_level_t& asset_level = m_textureAsset.Level(level);
+		for (UINT y = 0; y < NumRows[subresource]; ++y) {
+			memcpy(
+				staging.cpu + SIZE_T(footprint.Footprint.RowPitch) * y,
+				m_textureAsset.LevelData(level) + SIZE_T(asset_level.row_pitch) * y,
+				static_cast<SIZE_T>(RowSizesInBytes[subresource])
+			);
+		}
+		footprint.Offset = staging.offset;
+		D3D12_TEXTURE_COPY_LOCATION Src = {
+		  .pResource = m_streamingBuffer.Get(),
+		  .Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT,
+		  .PlacedFootprint = footprint
+		};
+		m_copyList->CopyTextureRegion(&Dst, 0, 0, 0, &Src, nullptr);
+	}
+}
+
+uint64_t D3D12HelloTriangle::SubmitTransitions()
+{
+	ThrowIfFailed(m_copyList->Close());
+	ID3D12CommandList* cmd_list = m_copyList.Get();
+	m_copyQueue->ExecuteCommandLists(1, &cmd_list);
+	m_copyListOpen = false;
+
+	UINT64 const fence = ++m_copyFenceValue;
+	ThrowIfFailed(m_copyQueue->Signal(m_copyFence.Get(), fence));
+	m_copyAllocatorFences[m_copyAllocatorIndex] = fence;
+	m_copyAllocatorIndex = (m_copyAllocatorIndex + 1) % CopyAllocatorCount;
+	m_streamingRing.Submit(fence);
+	return fence;
+}
+
+// Called between frames, so the new chain is only sampled from the next
+// frame on; the previous one lives until that frame has finished.
+void D3D12HelloTriangle::LevelsResident(uint32_t texture, uint32_t top)
+{
+	if (texture_resource) {
+		m_retiredTextures.push_back(std::move(texture_resource));
+	}
+	texture_resource = std::move(m_pendingTextures[texture]);
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc = {
+	  .Format = m_textureFormat,
+	  .ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D,
+	  .Shader4ComponentMapping =
+		D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING,
+	  .Texture2D = {
+		.MostDetailedMip = 0,
+		.MipLevels = m_textureAsset.Header().level_count - top,
+		.PlaneSlice = 0,
+		.ResourceMinLODClamp = 0.0f
+	  },
+	};
+	m_device->CreateShaderResourceView(
+		texture_resource.Get(), &srv_desc, m_cbvHeap->GetCPUDescriptorHandleForHeapStart()
+	);
+}
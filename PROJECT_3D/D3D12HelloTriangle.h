@@ -1,12 +1,23 @@
 #pragma once
 
 #include "ExceptionHandler.h"
-#include <wincodec.h>
+#include "Collision.h"
+#include "Vertex.h"
+#include "ObjectSegmentation.h"
+#include "FrustumCulling.h"
+#include "InstanceDetect.h"
+#include "MeshSimplify.h"
+#include "OcclusionCulling.h"
+#include "TextureAsset.h"
+#include "TextureStreaming.h"
+#include "UploadRing.h"
 
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
 
-class D3D12HelloTriangle
+// Streams the texture's mip levels in on a copy queue as its own
+// TextureStreamingSink.
+class D3D12HelloTriangle : private TextureStreamingSink
 {
 public:
     D3D12HelloTriangle(UINT width, UINT height, std::wstring name);
@@ -22,17 +33,16 @@ public:
 
     void SetKeyboard(INT key, BOOL val);
 
-    struct vertex_t {
-        FLOAT position[3];
-        FLOAT color[4];
-        FLOAT tex_coord[2];
-    };
+    using vertex_t = ::vertex_t;
 
 private:
 
     struct vs_const_buffer_t {
         XMFLOAT4X4 matWorldViewProj;
-        XMFLOAT4 padding[(256 - sizeof(XMFLOAT4X4)) / sizeof(XMFLOAT4)];
+        XMFLOAT4 posScale;
+        XMFLOAT4 posOffset;
+        XMFLOAT4 texScaleOffset;
+        XMFLOAT4 padding[(256 - sizeof(XMFLOAT4X4) - 3 * sizeof(XMFLOAT4)) / sizeof(XMFLOAT4)];
     };
 
     struct playesPos_t {
@@ -47,13 +57,26 @@ private:
 
     const FLOAT ROTSPEEDPERTIMER = 0.02f;
     const FLOAT MOVESPEEDPERTIMER = 0.05f;
+    // The player collides with the scene as a sphere around the eye.
+    const FLOAT PLAYER_RADIUS = 0.25f;
+    // Occluders span at least this fraction of the scene's largest extent.
+    const FLOAT OCCLUDER_MIN_EXTENT = 0.1f;
+    const UINT OCCLUDER_MAX_TRIANGLES = 512;
+    // Largest on-screen simplification error, in pixels, before a finer LOD is used.
+    const FLOAT LOD_PIXEL_ERROR = 1.0f;
     static const UINT FrameCount = 2;
-    size_t const VERTEX_SIZE = sizeof(vertex_t) / sizeof(FLOAT);
+    // Copy queue submissions recorded while earlier ones run.
+    static const UINT CopyAllocatorCount = 3;
+    // GPU memory for resident mip levels, counting both chains while one
+    // replaces the other.
+    const UINT64 TEXTURE_MEMORY_BUDGET = 64ull << 20;
+    // Level bytes read from the asset by copies in flight.
+    const UINT64 TEXTURE_STREAMING_INFLIGHT = 4ull << 20;
 
     BOOL keyboard[4] = { FALSE, FALSE, FALSE, FALSE };
     playesPos_t playerPos;
     FLOAT angle = 0.0f;
-    UINT NUM_VERTICES = 0;
+    UINT NUM_INDICES = 0;
 
     // Pipeline objects.
     CD3DX12_VIEWPORT m_viewport;
@@ -63,6 +86,7 @@ private:
     ComPtr<ID3D12Resource> m_renderTargets[FrameCount];
     ComPtr<ID3D12CommandAllocator> m_commandAllocator;
     ComPtr<ID3D12CommandQueue> m_commandQueue;
+    ComPtr<ID3D12CommandQueue> m_copyQueue;
     ComPtr<ID3D12RootSignature> m_rootSignature;
     ComPtr<ID3D12DescriptorHeap> m_rtvHeap;
     ComPtr<ID3D12DescriptorHeap> m_cbvHeap;
@@ -71,11 +95,39 @@ private:
     UINT m_rtvDescriptorSize;
 
     // App resources.
+    // Staging for every CPU-to-GPU copy, then each frame's constants and
+    // instance matrices; one persistently mapped buffer reclaimed by fence.
+    ComPtr<ID3D12Resource> m_uploadBuffer;
+    UploadRing m_uploadRing;
     ComPtr<ID3D12Resource> m_vertexBuffer;
-    D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;
-    ComPtr<ID3D12Resource> m_constantBuffer;
+    ComPtr<ID3D12Resource> m_colorBuffer;
+    // Slot 2 streams one world matrix per instance from the upload ring.
+    D3D12_VERTEX_BUFFER_VIEW m_vertexBufferViews[3];
+    ComPtr<ID3D12Resource> m_indexBuffer;
+    D3D12_INDEX_BUFFER_VIEW m_indexBufferView;
+    std::vector<scene_object_t> m_objects;
+    aabb_soa_t m_objectBounds;
+    std::vector<UINT> m_drawList;
+    std::vector<object_lods_t> m_objectLods;
+    std::vector<UINT> m_objectLevels;
+    std::vector<object_instance_t> m_objectInstances;
+    // Visible objects sharing a prototype and LOD level draw as one batch.
+    struct draw_batch_t {
+        UINT index_count;
+        UINT first_index;
+        UINT first_instance;
+        UINT instance_count;
+    };
+    std::vector<draw_batch_t> m_drawBatches;
+    // CPU copies of the geometry of large objects that fill m_occlusion.
+    std::vector<float> m_occluderPositions;
+    std::vector<uint32_t> m_occluderIndices;
+    std::vector<bool> m_isOccluder;
+    std::vector<uint8_t> m_occluderOutline;     // per triangle, of each occluder object
+    OcclusionBuffer m_occlusion;
+    CollisionWorld m_collision;
     vs_const_buffer_t m_constantBufferData;
-    UINT8* m_pCbvDataBegin;
+    D3D12_GPU_VIRTUAL_ADDRESS m_constantBufferAddress = 0;
     ComPtr<ID3D12Resource> m_depthBuffer;
     ComPtr<ID3D12DescriptorHeap> m_depthHeap;
 
@@ -84,18 +136,41 @@ private:
     HANDLE m_fenceEvent;
     ComPtr<ID3D12Fence> m_fence;
     UINT64 m_fenceValue;
+    // The copy queue's own, for mip level transitions.
+    ComPtr<ID3D12Fence> m_copyFence;
+    UINT64 m_copyFenceValue = 0;
 
     // Texture resources
-    IWICImagingFactory* wic_factory = nullptr;
+    TextureAsset m_textureAsset;    // mapped for as long as levels stream from it
     UINT const bmp_px_size = 4;
     UINT bmp_width = 0, bmp_height = 0;
     BYTE* bmp_bits = nullptr;
-    ComPtr<ID3D12Resource> texture_resource;
-    ComPtr<ID3D12Resource> m_texture;
-    HRESULT LoadBitmapFromFile(PCWSTR uri, UINT& width, UINT& height, BYTE** ppBits);
+    ComPtr<ID3D12Resource> texture_resource;   // the resident chain the SRV views
+    DXGI_FORMAT m_textureFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
+    TextureStreamer m_textureStreamer;
+    // Staging for levels on their way in, reclaimed by the copy fence.
+    ComPtr<ID3D12Resource> m_streamingBuffer;
+    UploadRing m_streamingRing;
+    ComPtr<ID3D12CommandAllocator> m_copyAllocators[CopyAllocatorCount];
+    UINT64 m_copyAllocatorFences[CopyAllocatorCount] = {};
+    UINT m_copyAllocatorIndex = 0;
+    ComPtr<ID3D12GraphicsCommandList> m_copyList;
+    bool m_copyListOpen = false;
+    // Per texture, the chain a transition is filling until it is resident.
+    std::vector<ComPtr<ID3D12Resource>> m_pendingTextures;
+    // Replaced chains, released once the frames that sampled them finish.
+    std::vector<ComPtr<ID3D12Resource>> m_retiredTextures;
+    HRESULT LoadBitmapFromFile(const char* path, UINT& width, UINT& height, BYTE** ppBits);
 
     void LoadPipeline(HWND hwnd);
     void LoadAssets();
     void PopulateCommandList();
     void WaitForPreviousFrame();
+    upload_allocation_t AllocateUpload(UINT64 size, UINT64 alignment);
+    void WaitForCopyFence(UINT64 fence);
+
+    // TextureStreamingSink
+    void RecordTransition(uint32_t texture, uint32_t top, uint32_t new_top) override;
+    uint64_t SubmitTransitions() override;
+    void LevelsResident(uint32_t texture, uint32_t top) override;
 };
\ No newline at end of file
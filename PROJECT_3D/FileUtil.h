@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdio>
+
+// fopen wrapper; MSVC with SDL checks rejects plain fopen.
+inline FILE* OpenFile(const char* path, const char* mode)
+{
+#ifdef _MSC_VER
+    FILE* file = nullptr;
+    return fopen_s(&file, path, mode) == 0 ? file : nullptr;
+#else
+    return fopen(path, mode);
+#endif
+}
@@ -0,0 +1,161 @@
+#include "FrustumCulling.h"
+#include <cmath>
+
+#if defined(__AVX2__)
+#define CULL_USE_AVX2 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define CULL_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+void aabb_soa_t::Push(const float aabb_min[3], const float aabb_max[3]) {
+	center_x.push_back(0.5f * (aabb_min[0] + aabb_max[0]));
+	center_y.push_back(0.5f * (aabb_min[1] + aabb_max[1]));
+	center_z.push_back(0.5f * (aabb_min[2] + aabb_max[2]));
+	extent_x.push_back(0.5f * (aabb_max[0] - aabb_min[0]));
+	extent_y.push_back(0.5f * (aabb_max[1] - aabb_min[1]));
+	extent_z.push_back(0.5f * (aabb_max[2] - aabb_min[2]));
+}
+
+void aabb_soa_t::Clear() {
+	center_x.clear();
+	center_y.clear();
+	center_z.clear();
+	extent_x.clear();
+	extent_y.clear();
+	extent_z.clear();
+}
+
+frustum_t ExtractFrustumPlanes(const float view_proj[16]) {
+	// Column j of the matrix produces clip component j.
+	auto column = [&](int j, int k) { return view_proj[k * 4 + j]; };
+
+	frustum_t f;
+	for (int k = 0; k < 4; ++k) {
+		f.planes[0][k] = column(3, k) + column(0, k);  // left
+		f.planes[1][k] = column(3, k) - column(0, k);  // right
+		f.planes[2][k] = column(3, k) + column(1, k);  // bottom
+		f.planes[3][k] = column(3, k) - column(1, k);  // top
+		f.planes[4][k] = column(2, k);                 // near
+		f.planes[5][k] = column(3, k) - column(2, k);  // far
+	}
+	for (auto& p : f.planes) {
+		float const length = sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+		if (length > 0.0f) {
+			for (float& c : p) {
+				c /= length;
+			}
+		}
+	}
+	return f;
+}
+
+namespace {
+	bool AabbVisible(const frustum_t& frustum, const aabb_soa_t& b, size_t i) {
+		// Same operation order as the SIMD paths, so results match exactly.
+		for (const auto& p : frustum.planes) {
+			float d = p[0] * b.center_x[i] + p[3];
+			d += p[1] * b.center_y[i];
+			d += p[2] * b.center_z[i];
+			d += fabsf(p[0]) * b.extent_x[i];
+			d += fabsf(p[1]) * b.extent_y[i];
+			d += fabsf(p[2]) * b.extent_z[i];
+			if (!(d >= 0.0f)) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+size_t CullAabbsScalar(const frustum_t& frustum, const aabb_soa_t& bounds, uint32_t* visible) {
+	size_t count = 0;
+	for (size_t i = 0; i < bounds.Size(); ++i) {
+		if (AabbVisible(frustum, bounds, i)) {
+			visible[count++] = static_cast<uint32_t>(i);
+		}
+	}
+	return count;
+}
+
+size_t CullAabbs(const frustum_t& frustum, const aabb_soa_t& bounds, uint32_t* visible) {
+	size_t const n = bounds.Size();
+	size_t count = 0;
+	size_t i = 0;
+
+#if defined(CULL_USE_AVX2)
+	__m256 const sign_mask = _mm256_set1_ps(-0.0f);
+	for (; i + 8 <= n; i += 8) {
+		__m256 const cx = _mm256_loadu_ps(&bounds.center_x[i]);
+		__m256 const cy = _mm256_loadu_ps(&bounds.center_y[i]);
+		__m256 const cz = _mm256_loadu_ps(&bounds.center_z[i]);
+		__m256 const ex = _mm256_loadu_ps(&bounds.extent_x[i]);
+		__m256 const ey = _mm256_loadu_ps(&bounds.extent_y[i]);
+		__m256 const ez = _mm256_loadu_ps(&bounds.extent_z[i]);
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (const auto& p : frustum.planes) {
+			__m256 const a = _mm256_set1_ps(p[0]);
+			__m256 const b = _mm256_set1_ps(p[1]);
+			__m256 const c = _mm256_set1_ps(p[2]);
+			__m256 d = _mm256_add_ps(_mm256_mul_ps(a, cx), _mm256_set1_ps(p[3]));
+			d = _mm256_add_ps(d, _mm256_mul_ps(b, cy));
+			d = _mm256_add_ps(d, _mm256_mul_ps(c, cz));
+			d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_andnot_ps(sign_mask, a), ex));
+			d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_andnot_ps(sign_mask, b), ey));
+			d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_andnot_ps(sign_mask, c), ez));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+		unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(inside));
+		while (mask) {
+			unsigned long bit = 0;
+#ifdef _MSC_VER
+			_BitScanForward(&bit, mask);
+#else
+			bit = static_cast<unsigned long>(__builtin_ctz(mask));
+#endif
+			visible[count++] = static_cast<uint32_t>(i + bit);
+			mask &= mask - 1;
+		}
+	}
+#elif defined(CULL_USE_SSE)
+	__m128 const sign_mask = _mm_set1_ps(-0.0f);
+	for (; i + 4 <= n; i += 4) {
+		__m128 const cx = _mm_loadu_ps(&bounds.center_x[i]);
+		__m128 const cy = _mm_loadu_ps(&bounds.center_y[i]);
+		__m128 const cz = _mm_loadu_ps(&bounds.center_z[i]);
+		__m128 const ex = _mm_loadu_ps(&bounds.extent_x[i]);
+		__m128 const ey = _mm_loadu_ps(&bounds.extent_y[i]);
+		__m128 const ez = _mm_loadu_ps(&bounds.extent_z[i]);
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (const auto& p : frustum.planes) {
+			__m128 const a = _mm_set1_ps(p[0]);
+			__m128 const b = _mm_set1_ps(p[1]);
+			__m128 const c = _mm_set1_ps(p[2]);
+			__m128 d = _mm_add_ps(_mm_mul_ps(a, cx), _mm_set1_ps(p[3]));
+			d = _mm_add_ps(d, _mm_mul_ps(b, cy));
+			d = _mm_add_ps(d, _mm_mul_ps(c, cz));
+			d = _mm_add_ps(d, _mm_mul_ps(_mm_andnot_ps(sign_mask, a), ex));
+			d = _mm_add_ps(d, _mm_mul_ps(_mm_andnot_ps(sign_mask, b), ey));
+			d = _mm_add_ps(d, _mm_mul_ps(_mm_andnot_ps(sign_mask, c), ez));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(d, _mm_setzero_ps()));
+		}
+		int const mask = _mm_movemask_ps(inside);
+		for (int bit = 0; bit < 4; ++bit) {
+			if (mask & (1 << bit)) {
+				visible[count++] = static_cast<uint32_t>(i + bit);
+			}
+		}
+	}
+#endif
+
+	for (; i < n; ++i) {
+		if (AabbVisible(frustum, bounds, i)) {
+			visible[count++] = static_cast<uint32_t>(i);
+		}
+	}
+	return count;
+}
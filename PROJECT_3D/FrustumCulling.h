@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Planes as (a, b, c, d) with a*x + b*y + c*z + d >= 0 on the inside.
+struct frustum_t {
+    float planes[6][4];
+};
+
+// Object bounds in structure-of-arrays form for batched tests.
+struct aabb_soa_t {
+    std::vector<float> center_x, center_y, center_z;
+    std::vector<float> extent_x, extent_y, extent_z;
+
+    void Push(const float aabb_min[3], const float aabb_max[3]);
+    void Clear();
+    size_t Size() const { return center_x.size(); }
+};
+
+// view_proj is row-major for row vectors (clip = v * M), as stored by
+// XMStoreFloat4x4 before the transpose for HLSL. D3D depth range [0, w].
+frustum_t ExtractFrustumPlanes(const float view_proj[16]);
+
+// Writes the indices of boxes intersecting the frustum into visible (room
+// for bounds.Size() entries) and returns how many were written. Uses AVX2
+// when the compiler targets it, SSE otherwise.
+size_t CullAabbs(const frustum_t& frustum, const aabb_soa_t& bounds, uint32_t* visible);
+size_t CullAabbsScalar(const frustum_t& frustum, const aabb_soa_t& bounds, uint32_t* visible);
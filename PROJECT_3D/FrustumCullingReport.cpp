@@ -0,0 +1,121 @@
+#include "ReportTools.h"
+#include "FrustumCulling.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// Culls random boxes around a camera looking into them with CullAabbs
+// and CullAabbsScalar and checks that both keep the same boxes, that the
+// extracted planes agree with clipping random points by the matrix, and
+// that every culled box lies wholly outside one plane. Prints objects/ns
+// for both, best of several runs.
+//   --cull-report [cull.txt] [objects]
+int CullReportTool(const std::vector<std::string>& args) {
+	size_t const object_count = args.size() > 2 ? static_cast<size_t>(std::stoull(args[2])) : 1000000;
+	int const RUNS = 20;
+	int const VIEWS = 8;
+	size_t const POINTS = 100000;
+
+	uint32_t noise = 1;
+	auto random = [&](float lo, float hi) {
+		noise = noise * 1664525u + 1013904223u;
+		return lo + (hi - lo) * static_cast<float>(noise >> 8) / 16777216.0f;
+	};
+	aabb_soa_t bounds;
+	for (size_t i = 0; i < object_count; ++i) {
+		float lo[3], hi[3];
+		for (int k = 0; k < 3; ++k) {
+			float const center = random(-500.0f, 500.0f), half = random(0.1f, 5.0f);
+			lo[k] = center - half;
+			hi[k] = center + half;
+		}
+		bounds.Push(lo, hi);
+	}
+
+	FILE* out = OpenReport(args, "cull.txt");
+	if (!out) {
+		return 1;
+	}
+#if defined(__AVX2__)
+	const char* const simd = "AVX2";
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+	const char* const simd = "SSE";
+#else
+	const char* const simd = "scalar";
+#endif
+	std::vector<uint32_t> visible(object_count), reference(object_count);
+	double simd_seconds = 0.0, scalar_seconds = 0.0;
+	size_t mismatched_views = 0, plane_errors = 0, cull_errors = 0, visible_total = 0;
+	for (int view = 0; view < VIEWS; ++view) {
+		float const eye[3] = { random(-400.0f, 400.0f), random(-400.0f, 400.0f), random(-400.0f, 400.0f) };
+		float const at[3] = { random(-400.0f, 400.0f), random(-400.0f, 400.0f), random(-400.0f, 400.0f) };
+		float view_proj[16];
+		LookAtPerspective(eye, at, 0.25f * 3.14159265f + view * 0.1f, 16.0f / 9.0f, 0.1f, 400.0f, view_proj);
+		frustum_t const frustum = ExtractFrustumPlanes(view_proj);
+
+		size_t count = 0, reference_count = 0;
+		double best[2] = { 1e30, 1e30 };
+		for (int run = 0; run < RUNS; ++run) {
+			auto start = std::chrono::steady_clock::now();
+			count = CullAabbs(frustum, bounds, visible.data());
+			auto const middle = std::chrono::steady_clock::now();
+			reference_count = CullAabbsScalar(frustum, bounds, reference.data());
+			auto const end = std::chrono::steady_clock::now();
+			best[0] = (std::min)(best[0], std::chrono::duration<double>(middle - start).count());
+			best[1] = (std::min)(best[1], std::chrono::duration<double>(end - middle).count());
+		}
+		simd_seconds += best[0];
+		scalar_seconds += best[1];
+		visible_total += reference_count;
+		mismatched_views += count != reference_count || !std::equal(visible.begin(), visible.begin() + count, reference.begin());
+
+		// Planes against the clip test, away from the boundary.
+		for (size_t i = 0; i < POINTS; ++i) {
+			float const p[3] = { random(-500.0f, 500.0f), random(-500.0f, 500.0f), random(-500.0f, 500.0f) };
+			// In double: z and w nearly cancel at the far plane.
+			double clip[4];
+			for (int j = 0; j < 4; ++j) {
+				clip[j] = static_cast<double>(p[0]) * view_proj[j] + static_cast<double>(p[1]) * view_proj[4 + j] +
+					static_cast<double>(p[2]) * view_proj[8 + j] + view_proj[12 + j];
+			}
+			bool const clipped_inside = fabs(clip[0]) <= clip[3] && fabs(clip[1]) <= clip[3] && clip[2] >= 0.0 && clip[2] <= clip[3];
+			bool planes_inside = true;
+			float nearest = FLT_MAX;
+			for (const auto& plane : frustum.planes) {
+				float const d = plane[0] * p[0] + plane[1] * p[1] + plane[2] * p[2] + plane[3];
+				planes_inside = planes_inside && d >= 0.0f;
+				nearest = (std::min)(nearest, fabsf(d));
+			}
+			plane_errors += clipped_inside != planes_inside && nearest > 1e-2f;
+		}
+
+		// Every culled box has all eight corners behind one plane.
+		size_t next = 0;
+		for (size_t i = 0; i < object_count; ++i) {
+			if (next < reference_count && reference[next] == i) {
+				++next;
+				continue;
+			}
+			bool outside = false;
+			for (const auto& plane : frustum.planes) {
+				bool all_behind = true;
+				for (int corner = 0; corner < 8 && all_behind; ++corner) {
+					float const x = bounds.center_x[i] + (corner & 1 ? bounds.extent_x[i] : -bounds.extent_x[i]);
+					float const y = bounds.center_y[i] + (corner & 2 ? bounds.extent_y[i] : -bounds.extent_y[i]);
+					float const z = bounds.center_z[i] + (corner & 4 ? bounds.extent_z[i] : -bounds.extent_z[i]);
+					all_behind = plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 1e-3f;
+				}
+				outside = outside || all_behind;
+			}
+			cull_errors += !outside;
+		}
+	}
+
+	double const objects = static_cast<double>(object_count) * VIEWS;
+	fprintf(out, "%zu objects, %d views, %.1f%% visible\n", object_count, VIEWS, 100.0 * visible_total / objects);
+	fprintf(out, "CullAabbs (%s): %.3f objects/ns\n", simd, objects / simd_seconds / 1e9);
+	fprintf(out, "CullAabbsScalar: %.3f objects/ns\n", objects / scalar_seconds / 1e9);
+	fprintf(out, "%zu views differ from the scalar reference, %zu plane errors, %zu boxes culled inside the frustum\n",
+		mismatched_views, plane_errors, cull_errors);
+	return CloseReport(out, mismatched_views + plane_errors + cull_errors);
+}
@@ -0,0 +1,39 @@
+#include "ImageFile.h"
+#include "MappedFile.h"
+#include "PngDecoder.h"
+#include <stdexcept>
+#include <string>
+
+PitchedImageSink::PitchedImageSink(uint8_t* data, size_t pitch, size_t capacity) :
+	m_data(data),
+	m_pitch(pitch),
+	m_capacity(capacity)
+{
+}
+
+uint8_t* PitchedImageSink::Begin(uint32_t width, uint32_t height, size_t& pitch) {
+	size_t const row_bytes = size_t(width) * 4;
+	if (row_bytes > m_pitch || (height > 0 && m_pitch * (height - 1) + row_bytes > m_capacity)) {
+		throw std::runtime_error("Image: " + std::to_string(width) + "x" + std::to_string(height) + " does not fit the destination");
+	}
+	m_width = width;
+	m_height = height;
+	pitch = m_pitch;
+	return m_data;
+}
+
+rgba_image_t LoadImageFile(const char* path) {
+	MappedFile file;
+	if (!file.Open(path)) {
+		throw std::runtime_error(std::string("Image: cannot open ") + path);
+	}
+	return DecodePng(file.Data(), file.Size());
+}
+
+void LoadImageFile(const char* path, ImageSink& sink) {
+	MappedFile file;
+	if (!file.Open(path)) {
+		throw std::runtime_error(std::string("Image: cannot open ") + path);
+	}
+	DecodePng(file.Data(), file.Size(), sink);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// RGBA8 image with tightly packed rows of width * 4 bytes.
+struct rgba_image_t {
+    uint32_t width;
+    uint32_t height;
+    std::vector<uint8_t> pixels;
+};
+
+// Where a decoder writes RGBA8 pixels. Begin is told the image size before
+// any pixel is written and returns row 0; row y starts pitch * y bytes
+// after it, and pitch is at least width * 4. Rows may be written in any
+// order and more than once (Adam7 passes revisit them), never outside
+// width * 4 bytes of each.
+class ImageSink
+{
+public:
+    virtual ~ImageSink() = default;
+    virtual uint8_t* Begin(uint32_t width, uint32_t height, size_t& pitch) = 0;
+};
+
+// Decodes into memory the caller already holds, such as a mapped upload
+// buffer laid out by its footprint: rows pitch bytes apart in capacity
+// bytes. Begin throws std::runtime_error when the image does not fit.
+class PitchedImageSink : public ImageSink
+{
+public:
+    PitchedImageSink(uint8_t* data, size_t pitch, size_t capacity);
+    uint8_t* Begin(uint32_t width, uint32_t height, size_t& pitch) override;
+
+    // The size Begin was given; 0 x 0 until then.
+    uint32_t Width() const { return m_width; }
+    uint32_t Height() const { return m_height; }
+
+private:
+    uint8_t* m_data;
+    size_t m_pitch;
+    size_t m_capacity;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+};
+
+// Maps and decodes a PNG file, e.g. textures.png, to RGBA8 with DecodePng.
+// Throws std::runtime_error when the file cannot be opened or decoded.
+rgba_image_t LoadImageFile(const char* path);
+
+// The same, writing the pixels straight into sink with no image-sized
+// buffer of its own.
+void LoadImageFile(const char* path, ImageSink& sink);
@@ -0,0 +1,227 @@
+#include "InstanceDetect.h"
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <map>
+
+namespace {
+	// Row i of the rotation has sign[i] in column axis[i].
+	struct axis_rotation_t {
+		int axis[3];
+		float sign[3];
+	};
+
+	// The 24 proper rotations that map coordinate axes onto axes; improper
+	// ones would flip the winding.
+	std::vector<axis_rotation_t> AxisRotations() {
+		std::vector<axis_rotation_t> rotations;
+		int permutation[3] = { 0, 1, 2 };
+		do {
+			int inversions = 0;
+			for (int i = 0; i < 3; ++i) {
+				for (int j = i + 1; j < 3; ++j) {
+					inversions += permutation[i] > permutation[j];
+				}
+			}
+			for (int signs = 0; signs < 8; ++signs) {
+				axis_rotation_t r;
+				float determinant = inversions % 2 ? -1.0f : 1.0f;
+				for (int i = 0; i < 3; ++i) {
+					r.axis[i] = permutation[i];
+					r.sign[i] = (signs >> i) & 1 ? -1.0f : 1.0f;
+					determinant *= r.sign[i];
+				}
+				if (determinant > 0.0f) {
+					rotations.push_back(r);
+				}
+			}
+		} while (std::next_permutation(permutation, permutation + 3));
+		return rotations;
+	}
+
+	void Rotate(const axis_rotation_t& r, const float* p, float* out) {
+		for (int i = 0; i < 3; ++i) {
+			out[i] = r.sign[i] * p[r.axis[i]];
+		}
+	}
+
+	// Per corner: position relative to the rotated bounds, tex coord, color.
+	int const CORNER_KEY_SIZE = 9;
+	using triangle_key_t = std::array<int64_t, 3 * CORNER_KEY_SIZE>;
+
+	struct canonical_form_t {
+		std::vector<int64_t> key;
+		float offset[3];
+	};
+
+	// Order-independent description of an object as seen through rotation r:
+	// quantized corners, each triangle starting at its smallest corner
+	// (winding kept), triangles sorted.
+	void Canonicalize(
+		const vertex_t* vertices, const uint32_t* indices, const scene_object_t& object,
+		const axis_rotation_t& r, float tolerance, canonical_form_t& form, std::vector<triangle_key_t>& triangles
+	) {
+		for (int k = 0; k < 3; ++k) {
+			form.offset[k] = FLT_MAX;
+		}
+		for (uint32_t i = 0; i < object.index_count; ++i) {
+			float p[3];
+			Rotate(r, vertices[indices[object.first_index + i]].position, p);
+			for (int k = 0; k < 3; ++k) {
+				form.offset[k] = std::min(form.offset[k], p[k]);
+			}
+		}
+
+		triangles.resize(object.index_count / 3);
+		for (size_t t = 0; t < triangles.size(); ++t) {
+			int64_t corners[3][CORNER_KEY_SIZE];
+			for (int c = 0; c < 3; ++c) {
+				const vertex_t& v = vertices[indices[object.first_index + t * 3 + c]];
+				float p[3];
+				Rotate(r, v.position, p);
+				for (int k = 0; k < 3; ++k) {
+					corners[c][k] = llround((p[k] - form.offset[k]) / tolerance);
+				}
+				corners[c][3] = llround(v.tex_coord[0] * 1e6);
+				corners[c][4] = llround(v.tex_coord[1] * 1e6);
+				for (int k = 0; k < 4; ++k) {
+					corners[c][5 + k] = llround(v.color[k] * 255.0f);
+				}
+			}
+			int first = 0;
+			for (int c = 1; c < 3; ++c) {
+				if (std::lexicographical_compare(corners[c], corners[c] + CORNER_KEY_SIZE, corners[first], corners[first] + CORNER_KEY_SIZE)) {
+					first = c;
+				}
+			}
+			for (int c = 0; c < 3; ++c) {
+				std::copy(corners[(first + c) % 3], corners[(first + c) % 3] + CORNER_KEY_SIZE, triangles[t].begin() + c * CORNER_KEY_SIZE);
+			}
+		}
+		std::sort(triangles.begin(), triangles.end());
+
+		form.key.clear();
+		for (const triangle_key_t& triangle : triangles) {
+			form.key.insert(form.key.end(), triangle.begin(), triangle.end());
+		}
+	}
+}
+
+std::vector<object_instance_t> DetectInstances(
+	const vertex_t* vertices, size_t vertex_count, const std::vector<uint32_t>& indices,
+	const std::vector<scene_object_t>& objects, float tolerance
+) {
+	(void)vertex_count;
+	std::vector<axis_rotation_t> const rotations = AxisRotations();
+
+	struct prototype_t {
+		uint32_t object;
+		axis_rotation_t rotation;
+		float offset[3];
+	};
+	std::map<std::vector<int64_t>, prototype_t> prototypes;
+
+	std::vector<object_instance_t> instances(objects.size());
+	canonical_form_t form, best;
+	std::vector<triangle_key_t> scratch;
+	for (size_t i = 0; i < objects.size(); ++i) {
+		// The smallest form over all rotations is the same for every
+		// congruent copy, whichever way it is turned.
+		axis_rotation_t best_rotation = rotations[0];
+		best.key.clear();
+		for (size_t r = 0; r < rotations.size(); ++r) {
+			Canonicalize(vertices, indices.data(), objects[i], rotations[r], tolerance, form, scratch);
+			if (r == 0 || form.key < best.key) {
+				std::swap(best, form);
+				best_rotation = rotations[r];
+			}
+		}
+
+		object_instance_t& instance = instances[i];
+		instance = {};
+		auto const found = prototypes.find(best.key);
+		if (found == prototypes.end()) {
+			instance.prototype = static_cast<uint32_t>(i);
+			for (int k = 0; k < 3; ++k) {
+				instance.transform[k][k] = 1.0f;
+			}
+			prototype_t prototype = { static_cast<uint32_t>(i), best_rotation, {} };
+			std::copy(best.offset, best.offset + 3, prototype.offset);
+			prototypes.emplace(best.key, prototype);
+			continue;
+		}
+
+		// Both objects map onto one canonical frame: Ra * p_a - oa = Rb * p_b - ob,
+		// so p_b = Rb^T * Ra * p_a + Rb^T * (ob - oa).
+		const prototype_t& prototype = found->second;
+		float ra[3][3] = {}, rb[3][3] = {};
+		for (int k = 0; k < 3; ++k) {
+			ra[k][prototype.rotation.axis[k]] = prototype.rotation.sign[k];
+			rb[k][best_rotation.axis[k]] = best_rotation.sign[k];
+		}
+		instance.prototype = prototype.object;
+		for (int row = 0; row < 3; ++row) {
+			for (int col = 0; col < 3; ++col) {
+				// transform is the transpose of Rb^T * Ra for row vectors.
+				float m = 0.0f;
+				for (int k = 0; k < 3; ++k) {
+					m += rb[k][col] * ra[k][row];
+				}
+				instance.transform[row][col] = m;
+			}
+			float t = 0.0f;
+			for (int k = 0; k < 3; ++k) {
+				t += rb[k][row] * (best.offset[k] - prototype.offset[k]);
+			}
+			instance.transform[3][row] = t;
+		}
+	}
+	return instances;
+}
+
+instance_stats_t ShareInstanceGeometry(
+	indexed_mesh_t& mesh, std::vector<scene_object_t>& objects,
+	const std::vector<object_instance_t>& instances
+) {
+	instance_stats_t stats = {};
+
+	// Prototype ranges keep their triangle order; instances point at them.
+	std::vector<uint32_t> indices;
+	std::vector<uint32_t> first_index(objects.size(), 0);
+	for (size_t i = 0; i < objects.size(); ++i) {
+		if (instances[i].prototype != i) {
+			++stats.instanced_objects;
+			continue;
+		}
+		++stats.prototypes;
+		first_index[i] = static_cast<uint32_t>(indices.size());
+		indices.insert(
+			indices.end(),
+			mesh.indices.begin() + objects[i].first_index,
+			mesh.indices.begin() + objects[i].first_index + objects[i].index_count
+		);
+	}
+	for (size_t i = 0; i < objects.size(); ++i) {
+		uint32_t const prototype = instances[i].prototype;
+		objects[i].first_index = first_index[prototype];
+		objects[i].index_count = objects[prototype].index_count;
+	}
+	stats.indices_removed = mesh.indices.size() - indices.size();
+
+	// Keep referenced vertices in first-use order.
+	std::vector<uint32_t> remap(mesh.vertices.size(), UINT32_MAX);
+	std::vector<vertex_t> vertices;
+	for (uint32_t& index : indices) {
+		if (remap[index] == UINT32_MAX) {
+			remap[index] = static_cast<uint32_t>(vertices.size());
+			vertices.push_back(mesh.vertices[index]);
+		}
+		index = remap[index];
+	}
+	stats.vertices_removed = mesh.vertices.size() - vertices.size();
+
+	mesh.vertices.swap(vertices);
+	mesh.indices.swap(indices);
+	return stats;
+}
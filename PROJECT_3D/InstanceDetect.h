@@ -0,0 +1,37 @@
+#pragma once
+
+#include "MeshWeld.h"
+#include "ObjectSegmentation.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Placement of one object. Objects that are their own prototype carry the
+// identity; the others reuse the prototype's draw range.
+struct object_instance_t {
+    uint32_t prototype;
+    float transform[4][3];      // prototype space -> world, row vectors (p' = p * R + t)
+};
+
+struct instance_stats_t {
+    size_t prototypes;          // objects that keep their own geometry
+    size_t instanced_objects;   // objects drawn as another object's instance
+    size_t vertices_removed;
+    size_t indices_removed;
+};
+
+// Finds objects congruent to an earlier object: same triangles, texture
+// coordinates and colors after a translation and one of the 24
+// axis-aligned rotations. Positions match within tolerance.
+std::vector<object_instance_t> DetectInstances(
+    const vertex_t* vertices, size_t vertex_count, const std::vector<uint32_t>& indices,
+    const std::vector<scene_object_t>& objects, float tolerance = 1e-4f
+);
+
+// Drops the geometry of every instanced object: its draw range becomes
+// the prototype's, and vertices nothing references any more are removed.
+// Object bounds stay in world space.
+instance_stats_t ShareInstanceGeometry(
+    indexed_mesh_t& mesh, std::vector<scene_object_t>& objects,
+    const std::vector<object_instance_t>& instances
+);
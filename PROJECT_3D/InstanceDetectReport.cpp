@@ -0,0 +1,119 @@
+#include "ReportTools.h"
+#include "CoplanarMerge.h"
+#include "InstanceDetect.h"
+#include "MeshWeld.h"
+#include "ObjectSegmentation.h"
+#include "VertexQuantize.h"
+#include <cmath>
+#include <set>
+#include <utility>
+
+// Runs the bake's merge, weld, segmentation and instance detection on
+// the room and on grids of rooms, shares the instanced geometry, and
+// checks that drawing every object from its shared range through its
+// transform gives back its own triangles. Prints draw calls with one
+// draw per object against one per prototype, the vertex and index
+// memory saved net of the per-instance transforms, and detection speed.
+// Fails on any object that does not come back.
+//   --instance-report [instances.txt] [columns] [rows]
+int InstanceReportTool(const std::vector<std::string>& args) {
+	float const POSITION_TOLERANCE = 1e-3f;
+	size_t const INSTANCE_BYTES = 64;
+
+	// The grid twice: rooms turned freely, then only translated.
+	std::vector<report_input_t> inputs = ReportInputs(args, 8);
+	inputs[1].name = "rooms turned freely";
+	inputs.push_back({ "rooms translated", ReportInputs(args, 8, false)[1].vertices });
+
+	FILE* out = OpenReport(args, "instances.txt");
+	if (!out) {
+		return 1;
+	}
+	size_t failures = 0;
+	for (report_input_t& input : inputs) {
+		MergeCoplanarTriangles(input.vertices, true);
+		indexed_mesh_t mesh = WeldVertices(input.vertices.data(), input.vertices.size());
+		std::vector<scene_object_t> objects = SegmentObjects(mesh.vertices.data(), mesh.vertices.size(), mesh.indices);
+		indexed_mesh_t const original = mesh;
+		std::vector<scene_object_t> const original_objects = objects;
+
+		auto const start = std::chrono::steady_clock::now();
+		std::vector<object_instance_t> const instances = DetectInstances(
+			mesh.vertices.data(), mesh.vertices.size(), mesh.indices, objects
+		);
+		double const seconds = Seconds(start);
+		instance_stats_t const stats = ShareInstanceGeometry(mesh, objects, instances);
+
+		// Every object's triangles, matched one to one and winding kept
+		// against its shared range moved by its transform.
+		size_t object_errors = 0;
+		std::vector<vertex_t> placed;
+		std::vector<bool> used;
+		for (size_t i = 0; i < objects.size(); ++i) {
+			const scene_object_t& o = objects[i];
+			const scene_object_t& source = original_objects[i];
+			const float (&m)[4][3] = instances[i].transform;
+			bool matched = o.index_count == source.index_count && o.first_index + o.index_count <= mesh.indices.size();
+			placed.clear();
+			for (uint32_t k = 0; matched && k < o.index_count; ++k) {
+				vertex_t v = mesh.vertices[mesh.indices[o.first_index + k]];
+				float const p[3] = { v.position[0], v.position[1], v.position[2] };
+				for (int c = 0; c < 3; ++c) {
+					v.position[c] = p[0] * m[0][c] + p[1] * m[1][c] + p[2] * m[2][c] + m[3][c];
+				}
+				placed.push_back(v);
+			}
+			auto const same = [&](const vertex_t& a, const vertex_t& b) {
+				bool equal = true;
+				for (int c = 0; c < 3; ++c) {
+					equal = equal && fabsf(a.position[c] - b.position[c]) <= POSITION_TOLERANCE;
+				}
+				for (int c = 0; c < 2; ++c) {
+					equal = equal && fabsf(a.tex_coord[c] - b.tex_coord[c]) <= 1e-5f;
+				}
+				for (int c = 0; c < 4; ++c) {
+					equal = equal && fabsf(a.color[c] - b.color[c]) <= 1.0f / 255.0f;
+				}
+				return equal;
+			};
+			used.assign(o.index_count / 3, false);
+			for (uint32_t t = 0; matched && t < source.index_count; t += 3) {
+				const uint32_t* corners = &original.indices[source.first_index + t];
+				bool found = false;
+				for (uint32_t candidate = 0; !found && candidate < o.index_count; candidate += 3) {
+					for (int turn = 0; !found && turn < 3 && !used[candidate / 3]; ++turn) {
+						found = same(original.vertices[corners[0]], placed[candidate + turn]) &&
+							same(original.vertices[corners[1]], placed[candidate + (turn + 1) % 3]) &&
+							same(original.vertices[corners[2]], placed[candidate + (turn + 2) % 3]);
+						if (found) {
+							used[candidate / 3] = true;
+						}
+					}
+				}
+				matched = found;
+			}
+			object_errors += !matched;
+		}
+
+		// One draw per object before; after, one instanced draw per
+		// prototype, every object drawn at its finest level.
+		std::set<std::pair<uint32_t, uint32_t>> ranges;
+		for (const scene_object_t& o : objects) {
+			ranges.insert({ o.first_index, o.index_count });
+		}
+		size_t const bytes_per_vertex = QuantizeVertices(original.vertices.data(), original.vertices.size()).BytesPerVertex();
+		size_t const bytes_before = original.vertices.size() * bytes_per_vertex + original.indices.size() * sizeof(uint32_t);
+		size_t const bytes_after = mesh.vertices.size() * bytes_per_vertex + mesh.indices.size() * sizeof(uint32_t) +
+			objects.size() * INSTANCE_BYTES;
+		size_t const triangle_count = original.indices.size() / 3;
+		fprintf(out, "%s: %zu triangles, %zu objects, %zu prototypes, %zu instanced; detection %.3f s (%.2f M tris/s)\n",
+			input.name, triangle_count, objects.size(), stats.prototypes, stats.instanced_objects, seconds,
+			seconds > 0.0 ? triangle_count / seconds / 1e6 : 0.0);
+		fprintf(out, "%s: draw calls %zu -> %zu; %zu vertices and %zu indices removed; %zu -> %zu bytes with %zu-byte "
+			"transforms (%+.1f%%); %zu objects not reproduced\n",
+			input.name, original_objects.size(), ranges.size(), stats.vertices_removed, stats.indices_removed,
+			bytes_before, bytes_after, INSTANCE_BYTES, 100.0 * bytes_after / bytes_before - 100.0, object_errors);
+		failures += object_errors + (ranges.size() != stats.prototypes);
+	}
+	return CloseReport(out, failures);
+}
@@ -1,10 +1,33 @@
 #include "stdafx.h"
 #include "D3D12HelloTriangle.h"
 #include "Win32Application.h"
+#include "CommandLineTools.h"
+
+static std::vector<std::string> GetToolArgs()
+{
+    std::vector<std::string> args;
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    for (int i = 1; argv && i < argc; ++i)
+    {
+        int const size = WideCharToMultiByte(CP_ACP, 0, argv[i], -1, nullptr, 0, nullptr, nullptr);
+        std::string arg(size > 0 ? size - 1 : 0, '\0');
+        WideCharToMultiByte(CP_ACP, 0, argv[i], -1, arg.data(), size, nullptr, nullptr);
+        args.push_back(arg);
+    }
+    LocalFree(argv);
+    return args;
+}
 
 _Use_decl_annotations_
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
 {
+    int exit_code = 0;
+    if (RunCommandLineTool(GetToolArgs(), exit_code))
+    {
+        return exit_code;
+    }
+
     D3D12HelloTriangle sample(1280, 720, L"3D Scene");
     return Win32Application::Run(&sample, hInstance, nCmdShow);
 }
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+
+// Read-only view of a whole file, backed by mmap or MapViewOfFile so the
+// contents can be copied straight into GPU upload memory.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Returns false when the file does not exist or cannot be mapped.
+    bool Open(const char* path);
+    void Close();
+
+    const unsigned char* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+private:
+    const unsigned char* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
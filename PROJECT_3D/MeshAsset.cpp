@@ -0,0 +1,170 @@
+#include "MeshAsset.h"
+#include "FileUtil.h"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+namespace {
+	uint64_t AlignUp(uint64_t value) {
+		return (value + MESH_ASSET_ALIGNMENT - 1) & ~static_cast<uint64_t>(MESH_ASSET_ALIGNMENT - 1);
+	}
+
+	void WriteAt(FILE* file, uint64_t& position, uint64_t offset, const void* data, size_t size) {
+		static const char zeros[MESH_ASSET_ALIGNMENT] = {};
+		while (position < offset) {
+			size_t const pad = static_cast<size_t>(std::min<uint64_t>(offset - position, MESH_ASSET_ALIGNMENT));
+			if (fwrite(zeros, 1, pad, file) != pad) {
+				throw std::runtime_error("Mesh asset: write failed");
+			}
+			position += pad;
+		}
+		if (size && fwrite(data, 1, size, file) != size) {
+			throw std::runtime_error("Mesh asset: write failed");
+		}
+		position += size;
+	}
+
+	template <typename Index>
+	bool IndicesValid(const void* data, uint64_t count, uint64_t vertex_count) {
+		const Index* indices = static_cast<const Index*>(data);
+		return std::all_of(indices, indices + count, [vertex_count](Index index) { return index < vertex_count; });
+	}
+
+	bool RangeValid(uint64_t first_index, uint64_t index_count, uint64_t total) {
+		return index_count % 3 == 0 && first_index + index_count <= total;
+	}
+
+	// Every index names a vertex and every draw range, LOD level and
+	// prototype lies inside its table, so a corrupt file cannot make the
+	// renderer read or draw out of bounds.
+	bool ContentsValid(const unsigned char* data, const mesh_asset_header_t& header) {
+		bool const indices_valid = header.index_size == sizeof(uint16_t) ?
+			IndicesValid<uint16_t>(data + header.index_offset, header.index_count, header.vertex_count) :
+			IndicesValid<uint32_t>(data + header.index_offset, header.index_count, header.vertex_count);
+		if (!indices_valid) {
+			return false;
+		}
+		auto objects = reinterpret_cast<const scene_object_t*>(data + header.object_offset);
+		auto lods = reinterpret_cast<const object_lods_t*>(data + header.lod_offset);
+		auto instances = reinterpret_cast<const object_instance_t*>(data + header.instance_offset);
+		for (uint64_t i = 0; i < header.object_count; ++i) {
+			if (!RangeValid(objects[i].first_index, objects[i].index_count, header.index_count) ||
+				lods[i].level_count == 0 || lods[i].level_count > MAX_LOD_LEVELS ||
+				instances[i].prototype >= header.object_count) {
+				return false;
+			}
+			for (uint32_t level = 0; level < lods[i].level_count; ++level) {
+				if (!RangeValid(lods[i].first_index[level], lods[i].index_count[level], header.index_count)) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+}
+
+void WriteMeshAsset(
+	const char* path, const quantized_vertices_t& vertices, const std::vector<uint32_t>& indices,
+	const std::vector<scene_object_t>& objects, const std::vector<object_lods_t>& lods,
+	const std::vector<object_instance_t>& instances
+) {
+	if (lods.size() != objects.size() || instances.size() != objects.size()) {
+		throw std::runtime_error("Mesh asset: one LOD chain and placement per object expected");
+	}
+	bool const index16 = vertices.vertices.size() <= 0xFFFF;
+
+	mesh_asset_header_t header = {};
+	header.magic = MESH_ASSET_MAGIC;
+	header.version = MESH_ASSET_VERSION;
+	header.vertex_stride = sizeof(packed_vertex_t);
+	header.index_size = index16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	header.vertex_count = vertices.vertices.size();
+	header.color_count = vertices.colors.size();
+	header.index_count = indices.size();
+	header.object_count = objects.size();
+	header.vertex_offset = AlignUp(sizeof(mesh_asset_header_t));
+	header.color_offset = AlignUp(header.vertex_offset + header.vertex_count * header.vertex_stride);
+	header.index_offset = AlignUp(header.color_offset + header.color_count * sizeof(uint32_t));
+	header.object_offset = AlignUp(header.index_offset + header.index_count * header.index_size);
+	header.lod_offset = AlignUp(header.object_offset + header.object_count * sizeof(scene_object_t));
+	header.instance_offset = AlignUp(header.lod_offset + header.object_count * sizeof(object_lods_t));
+	header.file_size = header.instance_offset + header.object_count * sizeof(object_instance_t);
+	header.quantization = vertices.quantization;
+	for (int k = 0; k < 3; ++k) {
+		header.aabb_min[k] = vertices.quantization.position_offset[k] - vertices.quantization.position_scale[k];
+		header.aabb_max[k] = vertices.quantization.position_offset[k] + vertices.quantization.position_scale[k];
+	}
+
+	std::vector<uint16_t> indices16;
+	if (index16) {
+		indices16.assign(indices.size(), 0);
+		for (size_t i = 0; i < indices.size(); ++i) {
+			indices16[i] = static_cast<uint16_t>(indices[i]);
+		}
+	}
+
+	FILE* file = OpenFile(path, "wb");
+	if (!file) {
+		throw std::runtime_error(std::string("Mesh asset: cannot create ") + path);
+	}
+	try {
+		uint64_t position = 0;
+		WriteAt(file, position, 0, &header, sizeof(header));
+		WriteAt(file, position, header.vertex_offset, vertices.vertices.data(), static_cast<size_t>(header.vertex_count * header.vertex_stride));
+		WriteAt(file, position, header.color_offset, vertices.colors.data(), static_cast<size_t>(header.color_count * sizeof(uint32_t)));
+		if (index16) {
+			WriteAt(file, position, header.index_offset, indices16.data(), indices16.size() * sizeof(uint16_t));
+		}
+		else {
+			WriteAt(file, position, header.index_offset, indices.data(), indices.size() * sizeof(uint32_t));
+		}
+		WriteAt(file, position, header.object_offset, objects.data(), objects.size() * sizeof(scene_object_t));
+		WriteAt(file, position, header.lod_offset, lods.data(), lods.size() * sizeof(object_lods_t));
+		WriteAt(file, position, header.instance_offset, instances.data(), instances.size() * sizeof(object_instance_t));
+	}
+	catch (...) {
+		fclose(file);
+		throw;
+	}
+	if (fclose(file) != 0) {
+		throw std::runtime_error("Mesh asset: write failed");
+	}
+}
+
+bool MeshAsset::Open(const char* path) {
+	m_header = nullptr;
+	if (!m_file.Open(path)) {
+		return false;
+	}
+	if (m_file.Size() < sizeof(mesh_asset_header_t)) {
+		m_file.Close();
+		return false;
+	}
+
+	auto header = reinterpret_cast<const mesh_asset_header_t*>(m_file.Data());
+	bool const valid =
+		header->magic == MESH_ASSET_MAGIC &&
+		header->version == MESH_ASSET_VERSION &&
+		header->vertex_stride == sizeof(packed_vertex_t) &&
+		(header->index_size == 2 || header->index_size == 4) &&
+		header->file_size == m_file.Size() &&
+		// Counts past the file size could wrap the bounds below.
+		header->vertex_count <= header->file_size && header->color_count <= header->file_size &&
+		header->index_count <= header->file_size && header->object_count <= header->file_size &&
+		header->vertex_offset + header->vertex_count * header->vertex_stride <= header->file_size &&
+		header->color_offset + header->color_count * sizeof(uint32_t) <= header->file_size &&
+		header->index_offset + header->index_count * header->index_size <= header->file_size &&
+		header->object_offset + header->object_count * sizeof(scene_object_t) <= header->file_size &&
+		header->lod_offset + header->object_count * sizeof(object_lods_t) <= header->file_size &&
+		header->instance_offset + header->object_count * sizeof(object_instance_t) <= header->file_size &&
+		(header->color_count == header->vertex_count || header->color_count == 1) &&
+		ContentsValid(m_file.Data(), *header);
+	if (!valid) {
+		m_file.Close();
+		return false;
+	}
+
+	m_header = header;
+	return true;
+}
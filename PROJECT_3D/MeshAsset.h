@@ -0,0 +1,79 @@
+#pragma once
+
+#include "InstanceDetect.h"
+#include "MappedFile.h"
+#include "MeshSimplify.h"
+#include "ObjectSegmentation.h"
+#include "VertexQuantize.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Binary mesh container. The header is followed by the vertex, color and
+// index streams, the object table and the per-object LOD and instance tables, each starting on a MESH_ASSET_ALIGNMENT boundary, so a
+// mapped file can be copied into an upload heap without any parsing.
+// Coarser LOD index ranges follow the full-detail objects in the index stream;
+// instanced objects share their prototype's ranges.
+uint32_t const MESH_ASSET_MAGIC = 0x4D443350; // "P3DM"
+uint32_t const MESH_ASSET_VERSION = 4;
+size_t const MESH_ASSET_ALIGNMENT = 256;
+
+struct mesh_asset_header_t {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertex_stride;
+    uint32_t index_size;
+    uint64_t vertex_count;
+    uint64_t color_count;
+    uint64_t index_count;
+    uint64_t object_count;
+    uint64_t vertex_offset;
+    uint64_t color_offset;
+    uint64_t index_offset;
+    uint64_t object_offset;
+    uint64_t lod_offset;
+    uint64_t instance_offset;
+    uint64_t file_size;
+    float aabb_min[3];
+    float aabb_max[3];
+    vertex_quantization_t quantization;
+};
+
+// Writes quantized vertices, indices, the object draw ranges and one LOD
+// chain and placement per object, using 16-bit indices when the vertex
+// count allows it. Throws std::runtime_error on I/O failure.
+void WriteMeshAsset(
+    const char* path, const quantized_vertices_t& vertices, const std::vector<uint32_t>& indices,
+    const std::vector<scene_object_t>& objects, const std::vector<object_lods_t>& lods,
+    const std::vector<object_instance_t>& instances
+);
+
+class MeshAsset
+{
+public:
+    // Maps the file and validates the header, every index and every draw
+    // range. Returns false for a missing, truncated, outdated or corrupt
+    // file.
+    bool Open(const char* path);
+
+    const mesh_asset_header_t& Header() const { return *m_header; }
+    const void* Vertices() const { return m_file.Data() + m_header->vertex_offset; }
+    const void* Colors() const { return m_file.Data() + m_header->color_offset; }
+    const void* Indices() const { return m_file.Data() + m_header->index_offset; }
+    const scene_object_t* Objects() const {
+        return reinterpret_cast<const scene_object_t*>(m_file.Data() + m_header->object_offset);
+    }
+    const object_lods_t* Lods() const {
+        return reinterpret_cast<const object_lods_t*>(m_file.Data() + m_header->lod_offset);
+    }
+    const object_instance_t* Instances() const {
+        return reinterpret_cast<const object_instance_t*>(m_file.Data() + m_header->instance_offset);
+    }
+    size_t VertexBytes() const { return static_cast<size_t>(m_header->vertex_count * m_header->vertex_stride); }
+    size_t ColorBytes() const { return static_cast<size_t>(m_header->color_count * sizeof(uint32_t)); }
+    size_t IndexBytes() const { return static_cast<size_t>(m_header->index_count * m_header->index_size); }
+
+private:
+    MappedFile m_file;
+    const mesh_asset_header_t* m_header = nullptr;
+};
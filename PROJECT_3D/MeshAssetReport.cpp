@@ -0,0 +1,187 @@
+#include "ReportTools.h"
+#include "FileUtil.h"
+#include "MeshAsset.h"
+#include "ObjectSegmentation.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	// Word-wise hash of a stream; chunks of a multiple of 8 bytes may be
+	// hashed one after the other.
+	uint64_t HashBytes(const unsigned char* data, size_t size, uint64_t hash) {
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8) {
+			uint64_t word;
+			memcpy(&word, data + i, 8);
+			hash = (hash ^ word) * 0x100000001B3ull;
+		}
+		for (; i < size; ++i) {
+			hash = (hash ^ data[i]) * 0x100000001B3ull;
+		}
+		return hash;
+	}
+
+	// Writes back and drops a file's cached pages, so the next read comes
+	// from the disk. Returns false where that is not supported.
+	bool EvictFileCache(const char* path) {
+#ifdef _WIN32
+		(void)path;
+		return false;
+#else
+		int const fd = open(path, O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		bool const evicted = fdatasync(fd) == 0 && posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+		close(fd);
+		return evicted;
+#endif
+	}
+}
+
+// Writes a mesh asset of about the given size, drops it from the file
+// cache and loads it the way the renderer does: map, read the header,
+// then copy the streams through a 64 MB staging buffer that stands in for
+// the upload heap. Prints the time to the first vertex byte and the load
+// throughput, cold and then warm. Then breaks a small asset in each way
+// Open must catch. Fails when the asset does not open, the streams read
+// back differ from the ones written, or a broken asset opens.
+//   --load-report [load.txt] [gigabytes]
+int LoadReportTool(const std::vector<std::string>& args) {
+	double const gigabytes = args.size() > 2 ? std::stod(args[2]) : 2.0;
+	const char* asset_path = "load_report.p3dm";
+	// 12-byte vertices and two 32-bit indices per vertex.
+	size_t const vertex_count = (std::max)(static_cast<size_t>(gigabytes * 1e9 / 20.0), size_t(0x10000));
+	size_t const staging_size = size_t(64) << 20;
+
+	quantized_vertices_t vertices = {};
+	for (int k = 0; k < 3; ++k) {
+		vertices.quantization.position_scale[k] = 1.0f;
+	}
+	vertices.quantization.tex_coord_scale[0] = vertices.quantization.tex_coord_scale[1] = 1.0f;
+	vertices.vertices.resize(vertex_count);
+	vertices.colors.assign(1, 0xFFFFFFFF);
+	uint32_t noise = 1;
+	for (packed_vertex_t& v : vertices.vertices) {
+		noise = noise * 1664525u + 1013904223u;
+		v = { { static_cast<int16_t>(noise >> 16), static_cast<int16_t>(noise), static_cast<int16_t>(noise >> 8), 32767 },
+			{ static_cast<uint16_t>(noise >> 12), static_cast<uint16_t>(noise >> 4) } };
+	}
+	std::vector<uint32_t> indices(vertex_count * 2);
+	for (size_t i = 0; i < indices.size(); ++i) {
+		indices[i] = static_cast<uint32_t>((i / 2 + i % 3) % vertex_count);
+	}
+	std::vector<scene_object_t> const objects = {
+		{ { -1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, 1.0f }, 0, static_cast<uint32_t>(indices.size() / 3 * 3) }
+	};
+	object_lods_t lods = {};
+	lods.level_count = 1;
+	lods.index_count[0] = objects[0].index_count;
+	object_instance_t const instance = { 0, { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 0.0f } } };
+
+	auto start = std::chrono::steady_clock::now();
+	WriteMeshAsset(asset_path, vertices, indices, objects, { lods }, { instance });
+	bool const cold = EvictFileCache(asset_path);
+	double const write_seconds = Seconds(start);
+	uint64_t const expected_vertices = HashBytes(
+		reinterpret_cast<const unsigned char*>(vertices.vertices.data()), vertex_count * sizeof(packed_vertex_t), 0
+	);
+	uint64_t const expected_indices = HashBytes(
+		reinterpret_cast<const unsigned char*>(indices.data()), indices.size() * sizeof(uint32_t), 0
+	);
+	// Leaves the memory to the file cache.
+	std::vector<packed_vertex_t>().swap(vertices.vertices);
+	std::vector<uint32_t>().swap(indices);
+
+	FILE* out = OpenReport(args, "load.txt");
+	if (!out) {
+		remove(asset_path);
+		return 1;
+	}
+	std::vector<unsigned char> staging(staging_size);
+	bool matches = true;
+	for (int pass = 0; pass < 2; ++pass) {
+		start = std::chrono::steady_clock::now();
+		MeshAsset asset;
+		if (!asset.Open(asset_path)) {
+			fprintf(out, "%s: cannot open\n", asset_path);
+			matches = false;
+			break;
+		}
+		staging[0] = *static_cast<const unsigned char*>(asset.Vertices());
+		double const first_byte_seconds = Seconds(start);
+
+		uint64_t hashes[2] = {};
+		const std::pair<const void*, size_t> streams[2] = {
+			{ asset.Vertices(), asset.VertexBytes() }, { asset.Indices(), asset.IndexBytes() }
+		};
+		size_t total_bytes = 0;
+		for (int s = 0; s < 2; ++s) {
+			auto const data = static_cast<const unsigned char*>(streams[s].first);
+			for (size_t offset = 0; offset < streams[s].second; offset += staging_size) {
+				size_t const size = (std::min)(staging_size, streams[s].second - offset);
+				memcpy(staging.data(), data + offset, size);
+				hashes[s] = HashBytes(staging.data(), size, hashes[s]);
+			}
+			total_bytes += streams[s].second;
+		}
+		double const seconds = Seconds(start);
+		bool const same = asset.Header().vertex_count == vertex_count && hashes[0] == expected_vertices &&
+			hashes[1] == expected_indices;
+		matches = matches && same;
+		fprintf(out, "%s: %.2f GB, first byte after %.3f ms, loaded in %.3f s, %.2f GB/s; %s\n",
+			pass == 0 ? (cold ? "cold" : "uncached load unavailable, warm") : "warm",
+			total_bytes / 1e9, first_byte_seconds * 1e3, seconds, total_bytes / 1e9 / seconds,
+			same ? "streams match" : "STREAMS DIFFER");
+	}
+	fprintf(out, "written in %.2f s\n", write_seconds);
+
+	// A one-triangle asset opens; with any index, draw range, LOD level or
+	// prototype out of range, or cut short, it must not.
+	const char* const cases[] = {
+		"intact", "index past the vertices", "object past the indices", "LOD level past the indices",
+		"prototype past the objects", "truncated",
+	};
+	size_t wrongly_opened = 0;
+	for (int broken = 0; broken < 6; ++broken) {
+		quantized_vertices_t small = vertices;
+		small.vertices.assign(3, packed_vertex_t{});
+		std::vector<uint32_t> small_indices = { 0, 1, 2 };
+		std::vector<scene_object_t> small_objects = objects;
+		small_objects[0].index_count = 3;
+		object_lods_t small_lods = lods;
+		small_lods.index_count[0] = 3;
+		object_instance_t small_instance = instance;
+		small_indices[2] += broken == 1 ? 3 : 0;
+		small_objects[0].first_index += broken == 2 ? 3 : 0;
+		small_lods.first_index[0] += broken == 3 ? 3 : 0;
+		small_instance.prototype += broken == 4 ? 1 : 0;
+		WriteMeshAsset(asset_path, small, small_indices, small_objects, { small_lods }, { small_instance });
+		if (broken == 5) {
+			std::vector<unsigned char> bytes;
+			if (FILE* file = OpenFile(asset_path, "rb")) {
+				for (int c; (c = fgetc(file)) != EOF;) {
+					bytes.push_back(static_cast<unsigned char>(c));
+				}
+				fclose(file);
+			}
+			bytes.resize(bytes.size() - 4);
+			if (FILE* file = OpenFile(asset_path, "wb")) {
+				fwrite(bytes.data(), 1, bytes.size(), file);
+				fclose(file);
+			}
+		}
+		MeshAsset asset;
+		bool const opened = asset.Open(asset_path);
+		wrongly_opened += opened != (broken == 0);
+		fprintf(out, "%s: %s\n", cases[broken], opened ? "opens" : "rejected");
+	}
+	remove(asset_path);
+	return CloseReport(out, matches ? wrongly_opened : 1);
+}
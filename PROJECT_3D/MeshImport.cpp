@@ -0,0 +1,984 @@
+#include "MeshImport.h"
+#include "MappedFile.h"
+#include "ParallelFor.h"
+#include "VertexStream.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace {
+	// OBJ chunks are at least this large so threads do not fight over tiny files.
+	size_t const OBJ_MIN_CHUNK_BYTES = 1 << 20;
+	size_t const OBJ_CHUNKS_PER_THREAD = 4;
+	size_t const GLB_TRIANGLES_PER_TASK = 1 << 16;
+	uint32_t const NO_TEX_COORD = UINT32_MAX;
+	int const JSON_MAX_DEPTH = 64;
+
+	void SetVertex(vertex_t& v, const float* position, const float* color, const float* tex_coord) {
+		// Mirroring z turns the right-handed source into the engine's
+		// left-handed space.
+		v.position[0] = position[0];
+		v.position[1] = position[1];
+		v.position[2] = -position[2];
+		std::copy(color, color + 4, v.color);
+		std::copy(tex_coord, tex_coord + 2, v.tex_coord);
+	}
+
+	// --- Wavefront OBJ ---
+
+	enum obj_keyword_t {
+		OBJ_POSITION,
+		OBJ_TEX_COORD,
+		OBJ_FACE,
+		OBJ_OTHER
+	};
+
+	struct obj_chunk_t {
+		const char* begin;
+		const char* end;
+		size_t position_count;
+		size_t tex_coord_count;
+		size_t first_position;
+		size_t first_tex_coord;
+		size_t faces;
+		// Position and tex coord index of every triangle corner.
+		std::vector<uint32_t> corners;
+	};
+
+	bool IsSpace(char c) {
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	const char* SkipSpaces(const char* p, const char* end) {
+		while (p < end && IsSpace(*p)) {
+			++p;
+		}
+		return p;
+	}
+
+	const char* LineEnd(const char* p, const char* end) {
+		const void* newline = memchr(p, '\n', static_cast<size_t>(end - p));
+		return newline ? static_cast<const char*>(newline) : end;
+	}
+
+	// Both passes classify lines with this, so their counts agree. p is left
+	// after the keyword.
+	obj_keyword_t ClassifyObjLine(const char*& p, const char* end) {
+		p = SkipSpaces(p, end);
+		size_t const length = static_cast<size_t>(end - p);
+		if (length >= 2 && p[0] == 'v' && IsSpace(p[1])) {
+			p += 1;
+			return OBJ_POSITION;
+		}
+		if (length >= 3 && p[0] == 'v' && p[1] == 't' && IsSpace(p[2])) {
+			p += 2;
+			return OBJ_TEX_COORD;
+		}
+		if (length >= 2 && p[0] == 'f' && IsSpace(p[1])) {
+			p += 1;
+			return OBJ_FACE;
+		}
+		return OBJ_OTHER;
+	}
+
+	bool ParseFloat(const char*& p, const char* end, float& value) {
+		p = SkipSpaces(p, end);
+		if (p < end && *p == '+') {
+			++p;
+		}
+		std::from_chars_result const result = std::from_chars(p, end, value);
+		if (result.ec != std::errc()) {
+			return false;
+		}
+		p = result.ptr;
+		return true;
+	}
+
+	// 1-based, or negative counting back from the latest element.
+	uint32_t ResolveObjIndex(int64_t index, size_t defined) {
+		int64_t const resolved = index > 0 ? index - 1 : static_cast<int64_t>(defined) + index;
+		if (index == 0 || resolved < 0 || resolved >= static_cast<int64_t>(UINT32_MAX)) {
+			throw std::runtime_error("OBJ: invalid face index");
+		}
+		return static_cast<uint32_t>(resolved);
+	}
+
+	void CountObjElements(obj_chunk_t& chunk) {
+		for (const char* line = chunk.begin; line < chunk.end;) {
+			const char* const line_end = LineEnd(line, chunk.end);
+			switch (ClassifyObjLine(line, line_end)) {
+			case OBJ_POSITION:
+				++chunk.position_count;
+				break;
+			case OBJ_TEX_COORD:
+				++chunk.tex_coord_count;
+				break;
+			default:
+				break;
+			}
+			line = line_end + 1;
+		}
+	}
+
+	void ParseObjChunk(obj_chunk_t& chunk, float* positions, float* colors, float* tex_coords) {
+		size_t position = chunk.first_position;
+		size_t tex_coord = chunk.first_tex_coord;
+		std::vector<uint32_t> polygon;
+		for (const char* line = chunk.begin; line < chunk.end;) {
+			const char* const line_end = LineEnd(line, chunk.end);
+			const char* p = line;
+			switch (ClassifyObjLine(p, line_end)) {
+			case OBJ_POSITION: {
+				// "x y z", "x y z w" or "x y z r g b"
+				float values[7];
+				int count = 0;
+				while (count < 7 && ParseFloat(p, line_end, values[count])) {
+					++count;
+				}
+				if (count < 3) {
+					throw std::runtime_error("OBJ: malformed vertex");
+				}
+				std::copy(values, values + 3, positions + 3 * position);
+				float* color = colors + 4 * position;
+				if (count >= 6) {
+					std::copy(values + 3, values + 6, color);
+				}
+				else {
+					std::fill(color, color + 3, 1.0f);
+				}
+				color[3] = 1.0f;
+				++position;
+				break;
+			}
+			case OBJ_TEX_COORD: {
+				float u = 0.0f, v = 0.0f;
+				if (!ParseFloat(p, line_end, u)) {
+					throw std::runtime_error("OBJ: malformed tex coord");
+				}
+				ParseFloat(p, line_end, v);
+				// OBJ puts the origin at the bottom left.
+				tex_coords[2 * tex_coord + 0] = u;
+				tex_coords[2 * tex_coord + 1] = 1.0f - v;
+				++tex_coord;
+				break;
+			}
+			case OBJ_FACE: {
+				// Corners are "v", "v/vt", "v//vn" or "v/vt/vn".
+				polygon.clear();
+				for (p = SkipSpaces(p, line_end); p < line_end; p = SkipSpaces(p, line_end)) {
+					int64_t index = 0;
+					std::from_chars_result result = std::from_chars(p, line_end, index);
+					if (result.ec != std::errc()) {
+						throw std::runtime_error("OBJ: malformed face");
+					}
+					p = result.ptr;
+					polygon.push_back(ResolveObjIndex(index, position));
+					uint32_t tex_coord_index = NO_TEX_COORD;
+					if (p < line_end && *p == '/') {
+						++p;
+						if (p < line_end && *p != '/') {
+							result = std::from_chars(p, line_end, index);
+							if (result.ec != std::errc()) {
+								throw std::runtime_error("OBJ: malformed face");
+							}
+							p = result.ptr;
+							tex_coord_index = ResolveObjIndex(index, tex_coord);
+						}
+						if (p < line_end && *p == '/') {
+							++p;
+							result = std::from_chars(p, line_end, index);
+							p = result.ptr;
+						}
+					}
+					polygon.push_back(tex_coord_index);
+					if (p < line_end && !IsSpace(*p)) {
+						throw std::runtime_error("OBJ: malformed face");
+					}
+				}
+				size_t const corner_count = polygon.size() / 2;
+				if (corner_count < 3) {
+					break;
+				}
+				// Fan, with the winding reversed along with the mirrored z.
+				++chunk.faces;
+				for (size_t i = 1; i + 1 < corner_count; ++i) {
+					size_t const fan[3] = { 0, i + 1, i };
+					for (size_t corner : fan) {
+						chunk.corners.push_back(polygon[2 * corner + 0]);
+						chunk.corners.push_back(polygon[2 * corner + 1]);
+					}
+				}
+				break;
+			}
+			default:
+				break;
+			}
+			line = line_end + 1;
+		}
+	}
+
+	// --- glTF 2.0 ---
+
+	struct json_value_t {
+		enum type_t {
+			NULL_VALUE,
+			BOOLEAN,
+			NUMBER,
+			STRING,
+			ARRAY,
+			OBJECT
+		};
+
+		type_t type = NULL_VALUE;
+		bool boolean = false;
+		double number = 0.0;
+		std::string string;
+		std::vector<json_value_t> items;
+		std::vector<std::pair<std::string, json_value_t>> members;
+
+		const json_value_t* Find(const char* key) const {
+			for (const auto& member : members) {
+				if (member.first == key) {
+					return &member.second;
+				}
+			}
+			return nullptr;
+		}
+	};
+
+	// Just enough JSON for glTF: no comments, UTF-8 passed through.
+	class JsonParser
+	{
+	public:
+		JsonParser(const char* begin, const char* end) : m_p(begin), m_end(end) {}
+
+		json_value_t ParseDocument() {
+			json_value_t value = ParseValue(0);
+			SkipWhitespace();
+			if (m_p != m_end) {
+				Fail();
+			}
+			return value;
+		}
+
+	private:
+		[[noreturn]] void Fail() const {
+			throw std::runtime_error("glTF: malformed JSON");
+		}
+
+		void SkipWhitespace() {
+			while (m_p < m_end && (*m_p == ' ' || *m_p == '\t' || *m_p == '\n' || *m_p == '\r')) {
+				++m_p;
+			}
+		}
+
+		void Expect(char c) {
+			SkipWhitespace();
+			if (m_p == m_end || *m_p != c) {
+				Fail();
+			}
+			++m_p;
+		}
+
+		bool Consume(const char* literal) {
+			size_t const length = strlen(literal);
+			if (static_cast<size_t>(m_end - m_p) < length || memcmp(m_p, literal, length) != 0) {
+				return false;
+			}
+			m_p += length;
+			return true;
+		}
+
+		void AppendUtf8(std::string& out, uint32_t code) {
+			if (code < 0x80) {
+				out += static_cast<char>(code);
+			}
+			else if (code < 0x800) {
+				out += static_cast<char>(0xC0 | (code >> 6));
+				out += static_cast<char>(0x80 | (code & 0x3F));
+			}
+			else {
+				out += static_cast<char>(0xE0 | (code >> 12));
+				out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+				out += static_cast<char>(0x80 | (code & 0x3F));
+			}
+		}
+
+		std::string ParseString() {
+			Expect('"');
+			std::string out;
+			while (true) {
+				if (m_p == m_end) {
+					Fail();
+				}
+				char const c = *m_p++;
+				if (c == '"') {
+					return out;
+				}
+				if (c != '\\') {
+					out += c;
+					continue;
+				}
+				if (m_p == m_end) {
+					Fail();
+				}
+				char const escape = *m_p++;
+				switch (escape) {
+				case '"': out += '"'; break;
+				case '\\': out += '\\'; break;
+				case '/': out += '/'; break;
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'n': out += '\n'; break;
+				case 'r': out += '\r'; break;
+				case 't': out += '\t'; break;
+				case 'u': {
+					uint32_t code = 0;
+					if (m_end - m_p < 4) {
+						Fail();
+					}
+					std::from_chars_result const result = std::from_chars(m_p, m_p + 4, code, 16);
+					if (result.ec != std::errc() || result.ptr != m_p + 4) {
+						Fail();
+					}
+					m_p += 4;
+					AppendUtf8(out, code);
+					break;
+				}
+				default:
+					Fail();
+				}
+			}
+		}
+
+		json_value_t ParseValue(int depth) {
+			if (depth > JSON_MAX_DEPTH) {
+				Fail();
+			}
+			SkipWhitespace();
+			if (m_p == m_end) {
+				Fail();
+			}
+			json_value_t value;
+			if (*m_p == '{') {
+				++m_p;
+				value.type = json_value_t::OBJECT;
+				SkipWhitespace();
+				if (m_p < m_end && *m_p == '}') {
+					++m_p;
+					return value;
+				}
+				do {
+					std::string key = ParseString();
+					Expect(':');
+					value.members.emplace_back(std::move(key), ParseValue(depth + 1));
+					SkipWhitespace();
+				} while (m_p < m_end && *m_p == ',' && ++m_p);
+				Expect('}');
+			}
+			else if (*m_p == '[') {
+				++m_p;
+				value.type = json_value_t::ARRAY;
+				SkipWhitespace();
+				if (m_p < m_end && *m_p == ']') {
+					++m_p;
+					return value;
+				}
+				do {
+					value.items.push_back(ParseValue(depth + 1));
+					SkipWhitespace();
+				} while (m_p < m_end && *m_p == ',' && ++m_p);
+				Expect(']');
+			}
+			else if (*m_p == '"') {
+				value.type = json_value_t::STRING;
+				value.string = ParseString();
+			}
+			else if (Consume("true") || Consume("false")) {
+				value.type = json_value_t::BOOLEAN;
+				value.boolean = m_p[-1] == 'e' && m_p[-2] == 'u';
+			}
+			else if (Consume("null")) {
+				value.type = json_value_t::NULL_VALUE;
+			}
+			else {
+				value.type = json_value_t::NUMBER;
+				std::from_chars_result const result = std::from_chars(m_p, m_end, value.number);
+				if (result.ec != std::errc()) {
+					Fail();
+				}
+				m_p = result.ptr;
+			}
+			return value;
+		}
+
+		const char* m_p;
+		const char* m_end;
+	};
+
+	const json_value_t& Item(const json_value_t* array, size_t index, const char* what) {
+		if (!array || array->type != json_value_t::ARRAY || index >= array->items.size()) {
+			throw std::runtime_error(std::string("glTF: missing ") + what);
+		}
+		return array->items[index];
+	}
+
+	double Number(const json_value_t* value, double fallback) {
+		return value && value->type == json_value_t::NUMBER ? value->number : fallback;
+	}
+
+	size_t Index(const json_value_t* value, const char* what) {
+		if (!value || value->type != json_value_t::NUMBER || value->number < 0.0 ||
+			value->number != std::floor(value->number)) {
+			throw std::runtime_error(std::string("glTF: invalid ") + what);
+		}
+		return static_cast<size_t>(value->number);
+	}
+
+	struct gltf_t {
+		json_value_t json;
+		const unsigned char* binary;
+		size_t binary_size;
+	};
+
+	// Typed, strided view of an accessor inside the binary chunk.
+	struct accessor_t {
+		const unsigned char* data;
+		size_t count;
+		size_t stride;
+		int components;
+		int component_type;
+		bool normalized;
+
+		float Float(size_t i, int c) const {
+			const unsigned char* p = data + i * stride;
+			switch (component_type) {
+			case 5120: {
+				int8_t v;
+				memcpy(&v, p + c, sizeof(v));
+				return normalized ? std::max(v / 127.0f, -1.0f) : v;
+			}
+			case 5121: {
+				uint8_t v;
+				memcpy(&v, p + c, sizeof(v));
+				return normalized ? v / 255.0f : v;
+			}
+			case 5122: {
+				int16_t v;
+				memcpy(&v, p + 2 * c, sizeof(v));
+				return normalized ? std::max(v / 32767.0f, -1.0f) : v;
+			}
+			case 5123: {
+				uint16_t v;
+				memcpy(&v, p + 2 * c, sizeof(v));
+				return normalized ? v / 65535.0f : v;
+			}
+			case 5125: {
+				uint32_t v;
+				memcpy(&v, p + 4 * c, sizeof(v));
+				return static_cast<float>(v);
+			}
+			default: {
+				float v;
+				memcpy(&v, p + 4 * c, sizeof(v));
+				return v;
+			}
+			}
+		}
+
+		uint32_t Index(size_t i) const {
+			const unsigned char* p = data + i * stride;
+			switch (component_type) {
+			case 5121:
+				return *p;
+			case 5123: {
+				uint16_t v;
+				memcpy(&v, p, sizeof(v));
+				return v;
+			}
+			default: {
+				uint32_t v;
+				memcpy(&v, p, sizeof(v));
+				return v;
+			}
+			}
+		}
+	};
+
+	accessor_t ReadAccessor(const gltf_t& gltf, size_t index) {
+		const json_value_t& accessor = Item(gltf.json.Find("accessors"), index, "accessor");
+		if (accessor.Find("sparse") || !accessor.Find("bufferView")) {
+			throw std::runtime_error("glTF: sparse or buffer-less accessors are not supported");
+		}
+		const json_value_t& view = Item(gltf.json.Find("bufferViews"), Index(accessor.Find("bufferView"), "bufferView"), "bufferView");
+		if (Index(view.Find("buffer"), "buffer") != 0 || !gltf.binary) {
+			throw std::runtime_error("glTF: only the GLB binary chunk is supported as a buffer");
+		}
+
+		accessor_t result = {};
+		result.count = Index(accessor.Find("count"), "accessor count");
+		result.component_type = static_cast<int>(Index(accessor.Find("componentType"), "componentType"));
+		const json_value_t* normalized = accessor.Find("normalized");
+		result.normalized = normalized && normalized->boolean;
+		size_t component_size = 0;
+		switch (result.component_type) {
+		case 5120: case 5121: component_size = 1; break;
+		case 5122: case 5123: component_size = 2; break;
+		case 5125: case 5126: component_size = 4; break;
+		default: throw std::runtime_error("glTF: invalid componentType");
+		}
+		const json_value_t* type = accessor.Find("type");
+		std::string const type_name = type ? type->string : "";
+		result.components = type_name == "SCALAR" ? 1 : type_name == "VEC2" ? 2 : type_name == "VEC3" ? 3 : type_name == "VEC4" ? 4 : 0;
+		if (result.components == 0) {
+			throw std::runtime_error("glTF: unsupported accessor type");
+		}
+
+		size_t const element_size = component_size * result.components;
+		size_t const view_offset = static_cast<size_t>(Number(view.Find("byteOffset"), 0.0));
+		size_t const view_length = Index(view.Find("byteLength"), "byteLength");
+		size_t const offset = static_cast<size_t>(Number(accessor.Find("byteOffset"), 0.0));
+		result.stride = static_cast<size_t>(Number(view.Find("byteStride"), static_cast<double>(element_size)));
+		if (view_offset > gltf.binary_size || view_length > gltf.binary_size - view_offset ||
+			result.stride < element_size ||
+			(result.count > 0 && (offset > view_length ||
+				(result.count - 1) > (view_length - offset - std::min(element_size, view_length - offset)) / result.stride ||
+				offset + (result.count - 1) * result.stride + element_size > view_length))) {
+			throw std::runtime_error("glTF: accessor out of bounds");
+		}
+		result.data = gltf.binary + view_offset + offset;
+		return result;
+	}
+
+	// Column-major 4x4, as glTF stores it.
+	struct matrix_t {
+		float m[16];
+	};
+
+	matrix_t Multiply(const matrix_t& a, const matrix_t& b) {
+		matrix_t r = {};
+		for (int col = 0; col < 4; ++col) {
+			for (int row = 0; row < 4; ++row) {
+				float sum = 0.0f;
+				for (int k = 0; k < 4; ++k) {
+					sum += a.m[k * 4 + row] * b.m[col * 4 + k];
+				}
+				r.m[col * 4 + row] = sum;
+			}
+		}
+		return r;
+	}
+
+	matrix_t NodeMatrix(const json_value_t& node) {
+		matrix_t local = { { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 } };
+		if (const json_value_t* matrix = node.Find("matrix")) {
+			for (int i = 0; i < 16; ++i) {
+				local.m[i] = static_cast<float>(Number(&Item(matrix, i, "matrix element"), 0.0));
+			}
+			return local;
+		}
+		float t[3] = { 0, 0, 0 }, q[4] = { 0, 0, 0, 1 }, s[3] = { 1, 1, 1 };
+		if (const json_value_t* translation = node.Find("translation")) {
+			for (int i = 0; i < 3; ++i) {
+				t[i] = static_cast<float>(Number(&Item(translation, i, "translation"), 0.0));
+			}
+		}
+		if (const json_value_t* rotation = node.Find("rotation")) {
+			for (int i = 0; i < 4; ++i) {
+				q[i] = static_cast<float>(Number(&Item(rotation, i, "rotation"), 0.0));
+			}
+		}
+		if (const json_value_t* scale = node.Find("scale")) {
+			for (int i = 0; i < 3; ++i) {
+				s[i] = static_cast<float>(Number(&Item(scale, i, "scale"), 1.0));
+			}
+		}
+		float const x = q[0], y = q[1], z = q[2], w = q[3];
+		float const rotation[9] = {
+			1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w),
+			2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w),
+			2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y)
+		};
+		for (int col = 0; col < 3; ++col) {
+			for (int row = 0; row < 3; ++row) {
+				local.m[col * 4 + row] = rotation[col * 3 + row] * s[col];
+			}
+		}
+		std::copy(t, t + 3, local.m + 12);
+		return local;
+	}
+
+	struct gltf_primitive_t {
+		matrix_t world;
+		bool flip;                  // the node transform mirrors, so the winding does too
+		int mode;
+		accessor_t positions;
+		bool has_indices;
+		accessor_t indices;
+		bool has_tex_coords;
+		accessor_t tex_coords;
+		bool has_colors;
+		accessor_t colors;
+		float base_color[4];
+		size_t triangles;
+		size_t first_vertex;        // in the output triangle list
+
+		uint32_t Vertex(size_t k) const {
+			uint32_t const v = has_indices ? indices.Index(k) : static_cast<uint32_t>(k);
+			if (v >= positions.count) {
+				throw std::runtime_error("glTF: vertex index out of range");
+			}
+			return v;
+		}
+
+		void Emit(size_t triangle, vertex_t* out) const {
+			size_t corner[3];
+			if (mode == 4) {
+				corner[0] = 3 * triangle;
+				corner[1] = 3 * triangle + 1;
+				corner[2] = 3 * triangle + 2;
+			}
+			else if (mode == 5) {
+				// Odd strip triangles are stored with the opposite winding.
+				corner[0] = triangle + (triangle & 1);
+				corner[1] = triangle + 1 - (triangle & 1);
+				corner[2] = triangle + 2;
+			}
+			else {
+				corner[0] = 0;
+				corner[1] = triangle + 1;
+				corner[2] = triangle + 2;
+			}
+			// Counter-clockwise glTF fronts become clockwise once z is mirrored.
+			if (!flip) {
+				std::swap(corner[1], corner[2]);
+			}
+			for (int c = 0; c < 3; ++c) {
+				uint32_t const v = Vertex(corner[c]);
+				float p[3];
+				for (int row = 0; row < 3; ++row) {
+					p[row] = world.m[row] * positions.Float(v, 0) + world.m[4 + row] * positions.Float(v, 1) +
+						world.m[8 + row] * positions.Float(v, 2) + world.m[12 + row];
+				}
+				float color[4];
+				std::copy(base_color, base_color + 4, color);
+				if (has_colors) {
+					for (int k = 0; k < colors.components && k < 4; ++k) {
+						color[k] *= colors.Float(v, k);
+					}
+				}
+				float tex_coord[2] = { 0.0f, 0.0f };
+				if (has_tex_coords) {
+					tex_coord[0] = tex_coords.Float(v, 0);
+					tex_coord[1] = tex_coords.Float(v, 1);
+				}
+				SetVertex(out[c], p, color, tex_coord);
+			}
+		}
+	};
+
+	void CollectPrimitives(
+		const gltf_t& gltf, size_t node_index, const matrix_t& parent, int depth,
+		std::vector<gltf_primitive_t>& primitives
+	) {
+		if (depth > JSON_MAX_DEPTH) {
+			throw std::runtime_error("glTF: node hierarchy too deep");
+		}
+		const json_value_t& node = Item(gltf.json.Find("nodes"), node_index, "node");
+		matrix_t const world = Multiply(parent, NodeMatrix(node));
+
+		if (const json_value_t* mesh_index = node.Find("mesh")) {
+			const json_value_t& mesh = Item(gltf.json.Find("meshes"), Index(mesh_index, "mesh"), "mesh");
+			const float* m = world.m;
+			float const determinant =
+				m[0] * (m[5] * m[10] - m[9] * m[6]) - m[4] * (m[1] * m[10] - m[9] * m[2]) + m[8] * (m[1] * m[6] - m[5] * m[2]);
+			const json_value_t* mesh_primitives = mesh.Find("primitives");
+			for (size_t p = 0; mesh_primitives && p < mesh_primitives->items.size(); ++p) {
+				const json_value_t& primitive = mesh_primitives->items[p];
+				int const mode = static_cast<int>(Number(primitive.Find("mode"), 4.0));
+				if (mode < 4 || mode > 6) {
+					continue;
+				}
+				const json_value_t* attributes = primitive.Find("attributes");
+				const json_value_t* position = attributes ? attributes->Find("POSITION") : nullptr;
+				if (!position) {
+					continue;
+				}
+
+				gltf_primitive_t out = {};
+				out.world = world;
+				out.flip = determinant < 0.0f;
+				out.mode = mode;
+				out.positions = ReadAccessor(gltf, Index(position, "POSITION"));
+				if (out.positions.components != 3) {
+					throw std::runtime_error("glTF: POSITION must be VEC3");
+				}
+				if (const json_value_t* indices = primitive.Find("indices")) {
+					out.has_indices = true;
+					out.indices = ReadAccessor(gltf, Index(indices, "indices"));
+					if (out.indices.components != 1 || out.indices.component_type == 5126 ||
+						out.indices.component_type == 5120 || out.indices.component_type == 5122) {
+						throw std::runtime_error("glTF: invalid index accessor");
+					}
+				}
+				if (const json_value_t* tex_coord = attributes->Find("TEXCOORD_0")) {
+					out.has_tex_coords = true;
+					out.tex_coords = ReadAccessor(gltf, Index(tex_coord, "TEXCOORD_0"));
+					if (out.tex_coords.components != 2 || out.tex_coords.count < out.positions.count) {
+						throw std::runtime_error("glTF: invalid TEXCOORD_0");
+					}
+				}
+				if (const json_value_t* color = attributes->Find("COLOR_0")) {
+					out.has_colors = true;
+					out.colors = ReadAccessor(gltf, Index(color, "COLOR_0"));
+					if (out.colors.components < 3 || out.colors.count < out.positions.count) {
+						throw std::runtime_error("glTF: invalid COLOR_0");
+					}
+				}
+				std::fill(out.base_color, out.base_color + 4, 1.0f);
+				if (const json_value_t* material_index = primitive.Find("material")) {
+					const json_value_t& material = Item(gltf.json.Find("materials"), Index(material_index, "material"), "material");
+					const json_value_t* pbr = material.Find("pbrMetallicRoughness");
+					const json_value_t* factor = pbr ? pbr->Find("baseColorFactor") : nullptr;
+					for (int k = 0; factor && k < 4; ++k) {
+						out.base_color[k] = static_cast<float>(Number(&Item(factor, k, "baseColorFactor"), 1.0));
+					}
+				}
+				size_t const corners = out.has_indices ? out.indices.count : out.positions.count;
+				out.triangles = mode == 4 ? corners / 3 : corners >= 3 ? corners - 2 : 0;
+				primitives.push_back(out);
+			}
+		}
+
+		if (const json_value_t* children = node.Find("children")) {
+			for (const json_value_t& child : children->items) {
+				CollectPrimitives(gltf, Index(&child, "child node"), world, depth + 1, primitives);
+			}
+		}
+	}
+
+	uint32_t ReadU32(const unsigned char* p) {
+		return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+			static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+	}
+}
+
+std::vector<vertex_t> ImportObj(const char* text, size_t size, unsigned thread_count, import_stats_t* stats) {
+	thread_count = ResolveThreadCount(thread_count);
+
+	// Line-aligned chunks; each is parsed independently.
+	size_t const chunk_count = std::max<size_t>(1, std::min<size_t>(
+		thread_count * OBJ_CHUNKS_PER_THREAD, size / OBJ_MIN_CHUNK_BYTES
+	));
+	std::vector<obj_chunk_t> chunks(chunk_count);
+	const char* const end = text + size;
+	const char* begin = text;
+	for (size_t i = 0; i < chunk_count; ++i) {
+		const char* split = i + 1 == chunk_count ? end : text + size / chunk_count * (i + 1);
+		split = std::max(split, begin);
+		if (split < end) {
+			split = LineEnd(split, end);
+			split = split < end ? split + 1 : end;
+		}
+		chunks[i] = {};
+		chunks[i].begin = begin;
+		chunks[i].end = split;
+		begin = split;
+	}
+
+	// Faces may use negative indices, so every chunk needs to know how many
+	// positions and tex coords come before it.
+	ParallelFor(chunk_count, thread_count, [&](size_t i) { CountObjElements(chunks[i]); });
+	size_t position_count = 0, tex_coord_count = 0;
+	for (obj_chunk_t& chunk : chunks) {
+		chunk.first_position = position_count;
+		chunk.first_tex_coord = tex_coord_count;
+		position_count += chunk.position_count;
+		tex_coord_count += chunk.tex_coord_count;
+	}
+	std::vector<float> positions(3 * position_count);
+	std::vector<float> colors(4 * position_count);
+	std::vector<float> tex_coords(2 * tex_coord_count);
+	ParallelFor(chunk_count, thread_count, [&](size_t i) {
+		ParseObjChunk(chunks[i], positions.data(), colors.data(), tex_coords.data());
+	});
+
+	std::vector<size_t> first_vertex(chunk_count + 1, 0);
+	size_t faces = 0;
+	for (size_t i = 0; i < chunk_count; ++i) {
+		first_vertex[i + 1] = first_vertex[i] + chunks[i].corners.size() / 2;
+		faces += chunks[i].faces;
+	}
+	std::vector<vertex_t> vertices(first_vertex[chunk_count]);
+	ParallelFor(chunk_count, thread_count, [&](size_t i) {
+		const std::vector<uint32_t>& corners = chunks[i].corners;
+		vertex_t* out = vertices.data() + first_vertex[i];
+		float const no_tex_coord[2] = { 0.0f, 0.0f };
+		for (size_t c = 0; c < corners.size(); c += 2) {
+			uint32_t const position = corners[c];
+			uint32_t const tex_coord = corners[c + 1];
+			if (position >= position_count || (tex_coord != NO_TEX_COORD && tex_coord >= tex_coord_count)) {
+				throw std::runtime_error("OBJ: face index out of range");
+			}
+			SetVertex(*out++, &positions[3 * static_cast<size_t>(position)], &colors[4 * static_cast<size_t>(position)],
+				tex_coord == NO_TEX_COORD ? no_tex_coord : &tex_coords[2 * static_cast<size_t>(tex_coord)]);
+		}
+	});
+
+	if (stats) {
+		stats->bytes = size;
+		stats->positions = position_count;
+		stats->faces = faces;
+		stats->triangles = vertices.size() / 3;
+	}
+	return vertices;
+}
+
+std::vector<vertex_t> ImportGlb(const unsigned char* data, size_t size, unsigned thread_count, import_stats_t* stats) {
+	thread_count = ResolveThreadCount(thread_count);
+
+	// 12-byte header, then a JSON chunk and an optional binary chunk.
+	if (size < 20 || ReadU32(data) != 0x46546C67 || ReadU32(data + 4) != 2 || ReadU32(data + 8) > size) {
+		throw std::runtime_error("glTF: not a version 2 GLB file");
+	}
+	size_t const length = ReadU32(data + 8);
+	gltf_t gltf = {};
+	for (size_t offset = 12; offset + 8 <= length;) {
+		size_t const chunk_length = ReadU32(data + offset);
+		uint32_t const chunk_type = ReadU32(data + offset + 4);
+		const unsigned char* chunk = data + offset + 8;
+		if (chunk_length > length - offset - 8) {
+			throw std::runtime_error("glTF: chunk out of bounds");
+		}
+		if (chunk_type == 0x4E4F534A && offset == 12) {
+			const char* json = reinterpret_cast<const char*>(chunk);
+			gltf.json = JsonParser(json, json + chunk_length).ParseDocument();
+		}
+		else if (chunk_type == 0x004E4942 && !gltf.binary) {
+			gltf.binary = chunk;
+			gltf.binary_size = chunk_length;
+		}
+		offset += 8 + chunk_length;
+	}
+	if (gltf.json.type != json_value_t::OBJECT) {
+		throw std::runtime_error("glTF: missing JSON chunk");
+	}
+	if (const json_value_t* buffers = gltf.json.Find("buffers")) {
+		for (const json_value_t& buffer : buffers->items) {
+			if (buffer.Find("uri")) {
+				throw std::runtime_error("glTF: external buffers are not supported");
+			}
+		}
+	}
+
+	// The default scene, or every root node when the file has none.
+	std::vector<size_t> roots;
+	const json_value_t* scenes = gltf.json.Find("scenes");
+	if (scenes && !scenes->items.empty()) {
+		const json_value_t* scene_index = gltf.json.Find("scene");
+		const json_value_t& scene = Item(scenes, scene_index ? Index(scene_index, "scene") : 0, "scene");
+		if (const json_value_t* nodes = scene.Find("nodes")) {
+			for (const json_value_t& node : nodes->items) {
+				roots.push_back(Index(&node, "scene node"));
+			}
+		}
+	}
+	else if (const json_value_t* nodes = gltf.json.Find("nodes")) {
+		std::vector<bool> is_child(nodes->items.size(), false);
+		for (const json_value_t& node : nodes->items) {
+			if (const json_value_t* children = node.Find("children")) {
+				for (const json_value_t& child : children->items) {
+					size_t const index = Index(&child, "child node");
+					if (index < is_child.size()) {
+						is_child[index] = true;
+					}
+				}
+			}
+		}
+		for (size_t i = 0; i < is_child.size(); ++i) {
+			if (!is_child[i]) {
+				roots.push_back(i);
+			}
+		}
+	}
+
+	std::vector<gltf_primitive_t> primitives;
+	matrix_t const identity = { { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 } };
+	for (size_t root : roots) {
+		CollectPrimitives(gltf, root, identity, 0, primitives);
+	}
+
+	// Fixed-size triangle ranges keep threads busy on uneven primitives.
+	struct task_t {
+		size_t primitive;
+		size_t first_triangle;
+		size_t triangle_count;
+	};
+	std::vector<task_t> tasks;
+	size_t vertex_count = 0;
+	size_t positions = 0;
+	for (size_t p = 0; p < primitives.size(); ++p) {
+		gltf_primitive_t& primitive = primitives[p];
+		primitive.first_vertex = vertex_count;
+		vertex_count += 3 * primitive.triangles;
+		positions += primitive.positions.count;
+		for (size_t t = 0; t < primitive.triangles; t += GLB_TRIANGLES_PER_TASK) {
+			tasks.push_back({ p, t, std::min(GLB_TRIANGLES_PER_TASK, primitive.triangles - t) });
+		}
+	}
+	std::vector<vertex_t> vertices(vertex_count);
+	ParallelFor(tasks.size(), thread_count, [&](size_t i) {
+		const task_t& task = tasks[i];
+		const gltf_primitive_t& primitive = primitives[task.primitive];
+		vertex_t* out = vertices.data() + primitive.first_vertex + 3 * task.first_triangle;
+		for (size_t t = 0; t < task.triangle_count; ++t) {
+			primitive.Emit(task.first_triangle + t, out + 3 * t);
+		}
+	});
+
+	if (stats) {
+		stats->bytes = size;
+		stats->positions = positions;
+		stats->faces = vertex_count / 3;
+		stats->triangles = vertex_count / 3;
+	}
+	return vertices;
+}
+
+std::vector<vertex_t> ImportMesh(const char* path, unsigned thread_count, import_stats_t* stats) {
+	std::string extension = path;
+	size_t const dot = extension.find_last_of('.');
+	extension = dot == std::string::npos ? "" : extension.substr(dot + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {
+		return static_cast<char>(std::tolower(c));
+	});
+	if (extension == "p3dv") {
+		std::vector<vertex_t> vertices = ReadVertexStream(path);
+		if (stats) {
+			*stats = {};
+			stats->bytes = sizeof(vertex_stream_header_t) + vertices.size() * sizeof(vertex_t);
+			stats->positions = vertices.size();
+			stats->faces = vertices.size() / 3;
+			stats->triangles = vertices.size() / 3;
+		}
+		return vertices;
+	}
+	if (extension != "obj" && extension != "glb") {
+		throw std::runtime_error("Import: unsupported file type, expected .obj, .glb or .p3dv");
+	}
+
+	MappedFile file;
+	if (!file.Open(path)) {
+		throw std::runtime_error("Import: cannot open file");
+	}
+	if (extension == "obj") {
+		return ImportObj(reinterpret_cast<const char*>(file.Data()), file.Size(), thread_count, stats);
+	}
+	return ImportGlb(file.Data(), file.Size(), thread_count, stats);
+}
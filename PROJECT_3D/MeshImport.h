@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Vertex.h"
+#include <cstddef>
+#include <vector>
+
+struct import_stats_t {
+    size_t bytes;               // size of the parsed file
+    size_t positions;           // source positions: OBJ "v" lines or glTF POSITION elements
+    size_t faces;               // source polygons before triangulation
+    size_t triangles;
+};
+
+// Imported geometry follows the engine's conventions: left-handed (z is
+// negated), clockwise front faces and tex coords with a top-left origin.
+// Output is a plain triangle list, as BakeMeshAsset expects.
+// thread_count 0 uses every hardware thread. Malformed or unsupported
+// input throws std::runtime_error.
+
+// Picks the format by extension: .obj, .glb or a .p3dv vertex stream, which
+// is already in engine conventions and is read as is.
+std::vector<vertex_t> ImportMesh(const char* path, unsigned thread_count = 0, import_stats_t* stats = nullptr);
+
+// Wavefront OBJ, parsed in parallel line-aligned chunks. Polygons are
+// fan-triangulated. Materials and normals are ignored; colors come from the
+// common "v x y z r g b" extension and default to white.
+std::vector<vertex_t> ImportObj(
+    const char* text, size_t size, unsigned thread_count = 0, import_stats_t* stats = nullptr
+);
+
+// Binary glTF 2.0 with its buffer in the GLB binary chunk. Every triangle,
+// strip and fan primitive reachable from the default scene is flattened
+// with its node transform; COLOR_0 is multiplied by the material's base
+// color factor.
+std::vector<vertex_t> ImportGlb(
+    const unsigned char* data, size_t size, unsigned thread_count = 0, import_stats_t* stats = nullptr
+);
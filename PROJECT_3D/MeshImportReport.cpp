@@ -0,0 +1,273 @@
+#include "ReportTools.h"
+#include "FileUtil.h"
+#include "MeshImport.h"
+#include "MeshWeld.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+	// A GLB file around a JSON chunk and a binary chunk, both padded to four
+	// bytes as the format requires.
+	std::vector<unsigned char> MakeGlb(std::string json, std::vector<unsigned char> binary) {
+		json.resize((json.size() + 3) & ~size_t(3), ' ');
+		binary.resize((binary.size() + 3) & ~size_t(3), 0);
+		std::vector<unsigned char> glb;
+		auto const push_u32 = [&](size_t value) {
+			for (int i = 0; i < 4; ++i) {
+				glb.push_back(static_cast<unsigned char>(value >> (8 * i)));
+			}
+		};
+		push_u32(0x46546C67);
+		push_u32(2);
+		push_u32(12 + 8 + json.size() + (binary.empty() ? 0 : 8 + binary.size()));
+		push_u32(json.size());
+		push_u32(0x4E4F534A);
+		glb.insert(glb.end(), json.begin(), json.end());
+		if (!binary.empty()) {
+			push_u32(binary.size());
+			push_u32(0x004E4942);
+			glb.insert(glb.end(), binary.begin(), binary.end());
+		}
+		return glb;
+	}
+
+	template <typename T>
+	void AppendBytes(std::vector<unsigned char>& bytes, const T* data, size_t count) {
+		const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+		bytes.insert(bytes.end(), p, p + count * sizeof(T));
+	}
+
+	// Equal vertex lists; tex coords within tolerance.
+	bool SameVertices(const std::vector<vertex_t>& a, const std::vector<vertex_t>& b, float tex_coord_tolerance) {
+		if (a.size() != b.size()) {
+			return false;
+		}
+		for (size_t i = 0; i < a.size(); ++i) {
+			for (int k = 0; k < 3; ++k) {
+				if (a[i].position[k] != b[i].position[k]) {
+					return false;
+				}
+			}
+			for (int k = 0; k < 4; ++k) {
+				if (a[i].color[k] != b[i].color[k]) {
+					return false;
+				}
+			}
+			for (int k = 0; k < 2; ++k) {
+				if (fabsf(a[i].tex_coord[k] - b[i].tex_coord[k]) > tex_coord_tolerance) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+}
+
+// Imports small OBJ and GLB models against their expected triangles,
+// in engine conventions, and checks that malformed files are rejected.
+// Then writes a grid of rooms as OBJ and GLB, imports both files on one
+// thread and on all of them, and checks that every import gives back
+// the grid exactly, printing MB/s parsed. Fails on any mismatch.
+//   --import-report [import.txt] [columns] [rows]
+int ImportReportTool(const std::vector<std::string>& args) {
+	FILE* out = OpenReport(args, "import.txt");
+	if (!out) {
+		return 1;
+	}
+	size_t failures = 0;
+
+	// Reference models: z mirrored, winding reversed, OBJ tex coords
+	// flipped to a top-left origin, glTF colors times the base color.
+	std::string const quad_obj =
+		"# quad with one red corner\r\n"
+		"v 0 0 1 1 0 0\r\nv 1 0 1\r\nv 1 1 1\r\nv 0 1 1\r\n"
+		"vt 0 0\r\nvt 1 0\r\nvt 1 1\r\nvt 0 1\r\nvn 0 0 1\r\n"
+		"g quad\r\ns off\r\n\r\n"
+		"f 1/1/1 2/2/1 3/3/1 -1/-1/1\r\n";
+	vertex_t const quad_corners[4] = {
+		{ { 0, 0, -1 }, { 1, 0, 0, 1 }, { 0, 1 } }, { { 1, 0, -1 }, { 1, 1, 1, 1 }, { 1, 1 } },
+		{ { 1, 1, -1 }, { 1, 1, 1, 1 }, { 1, 0 } }, { { 0, 1, -1 }, { 1, 1, 1, 1 }, { 0, 0 } },
+	};
+	std::vector<vertex_t> const quad = {
+		quad_corners[0], quad_corners[2], quad_corners[1], quad_corners[0], quad_corners[3], quad_corners[2]
+	};
+	std::string const triangle_obj = "v 0 0 0\nv 1 0 0\nv 0 1 0\nvn 0 0 1\nf 1//1 2//1 3//1";
+	std::vector<vertex_t> const triangle = {
+		{ { 0, 0, 0 }, { 1, 1, 1, 1 }, { 0, 0 } }, { { 0, 1, 0 }, { 1, 1, 1, 1 }, { 0, 0 } },
+		{ { 1, 0, 0 }, { 1, 1, 1, 1 }, { 0, 0 } },
+	};
+
+	// A textured, colored triangle under a translated node and a strip
+	// of two triangles under a mirrored child node, which keeps the
+	// winding.
+	std::vector<unsigned char> binary;
+	float const positions[12] = { 0, 0, 1, 1, 0, 1, 0, 1, 1, 1, 1, 1 };
+	float const tex_coords[8] = { 0, 0, 1, 0, 0, 1, 1, 1 };
+	uint8_t const colors[16] = { 255, 0, 0, 255, 0, 255, 0, 255, 0, 0, 255, 255, 255, 255, 255, 0 };
+	uint16_t const triangle_indices[3] = { 0, 1, 2 };
+	AppendBytes(binary, positions, 12);
+	AppendBytes(binary, tex_coords, 8);
+	AppendBytes(binary, colors, 16);
+	AppendBytes(binary, triangle_indices, 3);
+	auto const model_json = [](int position_count) {
+		return std::string(
+			"{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],"
+			"\"nodes\":[{\"mesh\":0,\"translation\":[1,2,3],\"children\":[1]},{\"mesh\":1,\"scale\":[-1,1,1]}],"
+			"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"TEXCOORD_0\":1,\"COLOR_0\":2},\"indices\":3,\"material\":0}]},"
+			"{\"primitives\":[{\"attributes\":{\"POSITION\":0},\"mode\":5}]}],"
+			"\"materials\":[{\"pbrMetallicRoughness\":{\"baseColorFactor\":[0.5,1,1,1]}}],"
+			"\"buffers\":[{\"byteLength\":104}],"
+			"\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":48},{\"buffer\":0,\"byteOffset\":48,\"byteLength\":32},"
+			"{\"buffer\":0,\"byteOffset\":80,\"byteLength\":16},{\"buffer\":0,\"byteOffset\":96,\"byteLength\":6}],"
+			"\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":") + std::to_string(position_count) +
+			",\"type\":\"VEC3\"},"
+			"{\"bufferView\":1,\"componentType\":5126,\"count\":4,\"type\":\"VEC2\"},"
+			"{\"bufferView\":2,\"componentType\":5121,\"normalized\":true,\"count\":4,\"type\":\"VEC4\"},"
+			"{\"bufferView\":3,\"componentType\":5123,\"count\":3,\"type\":\"SCALAR\"}]}";
+	};
+	std::vector<unsigned char> const model_glb = MakeGlb(model_json(4), binary);
+	std::vector<vertex_t> const model = {
+		{ { 1, 2, -4 }, { 0.5f, 0, 0, 1 }, { 0, 0 } }, { { 1, 3, -4 }, { 0, 0, 1, 1 }, { 0, 1 } },
+		{ { 2, 2, -4 }, { 0, 1, 0, 1 }, { 1, 0 } },
+		{ { 1, 2, -4 }, { 1, 1, 1, 1 }, { 0, 0 } }, { { 0, 2, -4 }, { 1, 1, 1, 1 }, { 0, 0 } },
+		{ { 1, 3, -4 }, { 1, 1, 1, 1 }, { 0, 0 } },
+		{ { 1, 3, -4 }, { 1, 1, 1, 1 }, { 0, 0 } }, { { 0, 2, -4 }, { 1, 1, 1, 1 }, { 0, 0 } },
+		{ { 0, 3, -4 }, { 1, 1, 1, 1 }, { 0, 0 } },
+	};
+	auto const check = [&](const char* name, const std::vector<vertex_t>& imported, const std::vector<vertex_t>& expected) {
+		bool const same = SameVertices(imported, expected, 0.0f);
+		fprintf(out, "%s: %zu triangles, %s\n", name, imported.size() / 3, same ? "as expected" : "DIFFERS");
+		failures += !same;
+	};
+	check("OBJ quad", ImportObj(quad_obj.data(), quad_obj.size()), quad);
+	check("OBJ triangle", ImportObj(triangle_obj.data(), triangle_obj.size()), triangle);
+	check("GLB nodes", ImportGlb(model_glb.data(), model_glb.size()), model);
+
+	std::string const malformed_obj[] = {
+		"v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 4\n",
+		"v 0 0 0\nv 1 0 0\nv 0 1 0\nf 0 1 2\n",
+		"v 0 0 0\nv 1 0 0\nv 0 1\nf 1 2 3\n",
+		"v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 x\n",
+		"v 0 0 0\nv 1 0 0\nv 0 1 0\nvt 0 0\nf 1/1 2/2 3/1\n",
+	};
+	std::vector<unsigned char> bad_magic = model_glb;
+	bad_magic[0] = 'x';
+	std::string external_json = model_json(4);
+	external_json.replace(external_json.find("{\"byteLength\":104}"), 18, "{\"byteLength\":104,\"uri\":\"model.bin\"}");
+	std::vector<unsigned char> const malformed_glb[] = {
+		std::vector<unsigned char>(model_glb.begin(), model_glb.end() - 8),
+		bad_magic,
+		MakeGlb(model_json(5), binary),
+		MakeGlb(external_json, binary),
+	};
+	size_t accepted = 0;
+	for (const std::string& text : malformed_obj) {
+		try {
+			ImportObj(text.data(), text.size());
+			++accepted;
+		}
+		catch (const std::runtime_error&) {
+		}
+	}
+	for (const std::vector<unsigned char>& glb : malformed_glb) {
+		try {
+			ImportGlb(glb.data(), glb.size());
+			++accepted;
+		}
+		catch (const std::runtime_error&) {
+		}
+	}
+	fprintf(out, "%zu malformed files, %zu accepted\n", std::size(malformed_obj) + std::size(malformed_glb), accepted);
+	failures += accepted;
+
+	// Round trip through files: written in source conventions from the
+	// welded grid, imported back into the grid's triangle list.
+	std::vector<vertex_t> const grid = ReportInputs(args, 16)[1].vertices;
+	indexed_mesh_t const mesh = WeldVertices(grid.data(), grid.size());
+	std::vector<vertex_t> expected(mesh.indices.size());
+	for (size_t i = 0; i < expected.size(); ++i) {
+		expected[i] = mesh.vertices[mesh.indices[i]];
+	}
+	std::string const out_path = args.size() > 1 ? args[1] : "import.txt";
+	std::string const obj_path = out_path + ".obj";
+	std::string const glb_path = out_path + ".glb";
+	FILE* obj = OpenFile(obj_path.c_str(), "w");
+	if (!obj) {
+		fclose(out);
+		return 1;
+	}
+	for (const vertex_t& v : mesh.vertices) {
+		fprintf(obj, "v %.9g %.9g %.9g %.9g %.9g %.9g\n", v.position[0], v.position[1], -v.position[2], v.color[0], v.color[1], v.color[2]);
+	}
+	for (const vertex_t& v : mesh.vertices) {
+		fprintf(obj, "vt %.9g %.9g\n", v.tex_coord[0], 1.0f - v.tex_coord[1]);
+	}
+	for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+		uint32_t const a = mesh.indices[i] + 1, b = mesh.indices[i + 2] + 1, c = mesh.indices[i + 1] + 1;
+		fprintf(obj, "f %u/%u %u/%u %u/%u\n", a, a, b, b, c, c);
+	}
+	bool written = fclose(obj) == 0;
+
+	std::vector<unsigned char> grid_binary;
+	for (const vertex_t& v : mesh.vertices) {
+		float const p[3] = { v.position[0], v.position[1], -v.position[2] };
+		AppendBytes(grid_binary, p, 3);
+	}
+	for (const vertex_t& v : mesh.vertices) {
+		AppendBytes(grid_binary, v.tex_coord, 2);
+	}
+	for (const vertex_t& v : mesh.vertices) {
+		AppendBytes(grid_binary, v.color, 4);
+	}
+	for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+		uint32_t const corners[3] = { mesh.indices[i], mesh.indices[i + 2], mesh.indices[i + 1] };
+		AppendBytes(grid_binary, corners, 3);
+	}
+	size_t const n = mesh.vertices.size();
+	std::string const views =
+		"{\"buffer\":0,\"byteOffset\":0,\"byteLength\":" + std::to_string(12 * n) + "}," +
+		"{\"buffer\":0,\"byteOffset\":" + std::to_string(12 * n) + ",\"byteLength\":" + std::to_string(8 * n) + "}," +
+		"{\"buffer\":0,\"byteOffset\":" + std::to_string(20 * n) + ",\"byteLength\":" + std::to_string(16 * n) + "}," +
+		"{\"buffer\":0,\"byteOffset\":" + std::to_string(36 * n) + ",\"byteLength\":" + std::to_string(4 * mesh.indices.size()) + "}";
+	std::string const grid_json =
+		"{\"asset\":{\"version\":\"2.0\"},\"nodes\":[{\"mesh\":0}],"
+		"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"TEXCOORD_0\":1,\"COLOR_0\":2},\"indices\":3}]}],"
+		"\"buffers\":[{\"byteLength\":" + std::to_string(grid_binary.size()) + "}],"
+		"\"bufferViews\":[" + views + "],"
+		"\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":" + std::to_string(n) + ",\"type\":\"VEC3\"},"
+		"{\"bufferView\":1,\"componentType\":5126,\"count\":" + std::to_string(n) + ",\"type\":\"VEC2\"},"
+		"{\"bufferView\":2,\"componentType\":5126,\"count\":" + std::to_string(n) + ",\"type\":\"VEC4\"},"
+		"{\"bufferView\":3,\"componentType\":5125,\"count\":" + std::to_string(mesh.indices.size()) + ",\"type\":\"SCALAR\"}]}";
+	std::vector<unsigned char> const grid_glb = MakeGlb(grid_json, std::move(grid_binary));
+	FILE* glb = OpenFile(glb_path.c_str(), "wb");
+	if (!glb) {
+		remove(obj_path.c_str());
+		fclose(out);
+		return 1;
+	}
+	written = fwrite(grid_glb.data(), 1, grid_glb.size(), glb) == grid_glb.size() && written;
+	written = fclose(glb) == 0 && written;
+
+	// At least four threads, so the OBJ is split into chunks on any machine.
+	unsigned const threads = (std::max)(ResolveThreadCount(0), 4u);
+	for (const std::string& path : { obj_path, glb_path }) {
+		for (unsigned thread_count : { 1u, threads }) {
+			import_stats_t stats = {};
+			auto const start = std::chrono::steady_clock::now();
+			std::vector<vertex_t> const imported = ImportMesh(path.c_str(), thread_count, &stats);
+			double const seconds = Seconds(start);
+			// Tex coords pass through 1 - v twice in OBJ.
+			bool const same = SameVertices(imported, expected, path == obj_path ? 1e-6f : 0.0f);
+			fprintf(out, "%s, %u thread%s: %.1f MB, %zu triangles in %.3f s, %.1f MB/s, %s\n",
+				path.c_str(), thread_count, thread_count == 1 ? "" : "s", stats.bytes / 1e6, stats.triangles, seconds,
+				seconds > 0.0 ? stats.bytes / seconds / 1e6 : 0.0, same ? "grid given back" : "DIFFERS FROM THE GRID");
+			failures += !same;
+		}
+	}
+	remove(obj_path.c_str());
+	remove(glb_path.c_str());
+	return CloseReport(out, written ? failures : 1);
+}
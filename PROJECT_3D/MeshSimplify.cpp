@@ -0,0 +1,441 @@
+#include "MeshSimplify.h"
+#include "VertexCache.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+	// Border planes are weighted up so open edges keep their outline.
+	double const BORDER_WEIGHT = 10.0;
+
+	enum vertex_kind_t : uint8_t {
+		KIND_MANIFOLD,
+		KIND_BORDER,
+		KIND_LOCKED,
+	};
+
+	// Symmetric 4x4 sum of plane outer products: xx xy xz xw yy yz yw zz zw ww.
+	struct quadric_t {
+		double a[10];
+	};
+
+	void AddPlane(quadric_t& q, double nx, double ny, double nz, double d, double weight) {
+		q.a[0] += weight * nx * nx;
+		q.a[1] += weight * nx * ny;
+		q.a[2] += weight * nx * nz;
+		q.a[3] += weight * nx * d;
+		q.a[4] += weight * ny * ny;
+		q.a[5] += weight * ny * nz;
+		q.a[6] += weight * ny * d;
+		q.a[7] += weight * nz * nz;
+		q.a[8] += weight * nz * d;
+		q.a[9] += weight * d * d;
+	}
+
+	void AddQuadric(quadric_t& q, const quadric_t& other) {
+		for (int k = 0; k < 10; ++k) {
+			q.a[k] += other.a[k];
+		}
+	}
+
+	// Weighted sum of squared distances from p to the accumulated planes.
+	double Evaluate(const quadric_t& q, const float* p) {
+		double const x = p[0], y = p[1], z = p[2];
+		double const e =
+			q.a[0] * x * x + q.a[4] * y * y + q.a[7] * z * z + q.a[9] +
+			2.0 * (q.a[1] * x * y + q.a[2] * x * z + q.a[5] * y * z + q.a[3] * x + q.a[6] * y + q.a[8] * z);
+		return std::max(e, 0.0);
+	}
+
+	void Cross(const float* a, const float* b, const float* c, double* n) {
+		double const u[3] = { double(b[0]) - a[0], double(b[1]) - a[1], double(b[2]) - a[2] };
+		double const v[3] = { double(c[0]) - a[0], double(c[1]) - a[1], double(c[2]) - a[2] };
+		n[0] = u[1] * v[2] - u[2] * v[1];
+		n[1] = u[2] * v[0] - u[0] * v[2];
+		n[2] = u[0] * v[1] - u[1] * v[0];
+	}
+
+	uint64_t EdgeKey(uint32_t a, uint32_t b) {
+		return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+	}
+
+	bool IsBorderEdge(const std::vector<uint64_t>& sorted_keys, uint64_t key) {
+		auto const range = std::equal_range(sorted_keys.begin(), sorted_keys.end(), key);
+		return range.second - range.first == 1;
+	}
+
+	// 1 for every vertex that shares its position with another vertex.
+	std::vector<uint8_t> FindSeams(const vertex_t* vertices, size_t vertex_count) {
+		std::vector<uint32_t> order(vertex_count);
+		std::iota(order.begin(), order.end(), 0u);
+		auto less = [&](uint32_t a, uint32_t b) {
+			return std::lexicographical_compare(
+				vertices[a].position, vertices[a].position + 3, vertices[b].position, vertices[b].position + 3
+			);
+		};
+		std::sort(order.begin(), order.end(), less);
+
+		std::vector<uint8_t> seam(vertex_count, 0);
+		for (size_t i = 1; i < vertex_count; ++i) {
+			if (!less(order[i - 1], order[i])) {
+				seam[order[i - 1]] = 1;
+				seam[order[i]] = 1;
+			}
+		}
+		return seam;
+	}
+
+	struct collapse_t {
+		uint32_t from;
+		uint32_t to;
+		double cost;
+	};
+
+	// The vertices an index range uses, renumbered in the order of their
+	// index in the full buffer, so the simplifier's cost follows the range
+	// rather than the buffer and its tie-breaks stay the same.
+	struct compact_range_t {
+		std::vector<vertex_t> vertices;
+		std::vector<uint8_t> seam;
+		std::vector<uint32_t> indices;
+		std::vector<uint32_t> global;       // buffer index of each vertex
+	};
+
+	void CompactRange(
+		const vertex_t* vertices, const std::vector<uint8_t>& seam,
+		const uint32_t* indices, size_t index_count, compact_range_t& range
+	) {
+		range.global.assign(indices, indices + index_count);
+		std::sort(range.global.begin(), range.global.end());
+		range.global.erase(std::unique(range.global.begin(), range.global.end()), range.global.end());
+		range.vertices.resize(range.global.size());
+		range.seam.resize(range.global.size());
+		for (size_t v = 0; v < range.global.size(); ++v) {
+			range.vertices[v] = vertices[range.global[v]];
+			range.seam[v] = seam[range.global[v]];
+		}
+		range.indices.resize(index_count);
+		for (size_t i = 0; i < index_count; ++i) {
+			range.indices[i] = static_cast<uint32_t>(
+				std::lower_bound(range.global.begin(), range.global.end(), indices[i]) - range.global.begin()
+			);
+		}
+	}
+
+	// SimplifyMesh with the seams already found.
+	size_t Simplify(
+		const vertex_t* vertices, size_t vertex_count, const uint8_t* seam,
+		const uint32_t* indices, size_t index_count,
+		size_t target_index_count, float max_error,
+		uint32_t* destination, float* result_error, uint32_t* collapsed_to
+	) {
+		std::vector<uint32_t> result(indices, indices + index_count / 3 * 3);
+		auto position = [&](uint32_t v) { return vertices[v].position; };
+		if (collapsed_to) {
+			std::iota(collapsed_to, collapsed_to + vertex_count, 0u);
+		}
+
+		std::vector<uint64_t> keys(result.size());
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (int e = 0; e < 3; ++e) {
+				keys[i + e] = EdgeKey(result[i + e], result[i + (e + 1) % 3]);
+			}
+		}
+		std::sort(keys.begin(), keys.end());
+
+		// Triangle planes, plus a plane through each border edge perpendicular
+		// to its triangle.
+		std::vector<quadric_t> quadrics(vertex_count, quadric_t{});
+		for (size_t i = 0; i < result.size(); i += 3) {
+			double n[3];
+			Cross(position(result[i]), position(result[i + 1]), position(result[i + 2]), n);
+			double const length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (length == 0.0) {
+				continue;
+			}
+			for (double& c : n) {
+				c /= length;
+			}
+			const float* p0 = position(result[i]);
+			double const d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+			for (int k = 0; k < 3; ++k) {
+				AddPlane(quadrics[result[i + k]], n[0], n[1], n[2], d, 1.0);
+			}
+			for (int e = 0; e < 3; ++e) {
+				uint32_t const a = result[i + e];
+				uint32_t const b = result[i + (e + 1) % 3];
+				if (!IsBorderEdge(keys, EdgeKey(a, b))) {
+					continue;
+				}
+				const float* pa = position(a);
+				const float* pb = position(b);
+				double const edge[3] = { double(pb[0]) - pa[0], double(pb[1]) - pa[1], double(pb[2]) - pa[2] };
+				double m[3] = {
+					edge[1] * n[2] - edge[2] * n[1],
+					edge[2] * n[0] - edge[0] * n[2],
+					edge[0] * n[1] - edge[1] * n[0],
+				};
+				double const m_length = sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+				if (m_length == 0.0) {
+					continue;
+				}
+				for (double& c : m) {
+					c /= m_length;
+				}
+				double const md = -(m[0] * pa[0] + m[1] * pa[1] + m[2] * pa[2]);
+				AddPlane(quadrics[a], m[0], m[1], m[2], md, BORDER_WEIGHT);
+				AddPlane(quadrics[b], m[0], m[1], m[2], md, BORDER_WEIGHT);
+			}
+		}
+
+		// Each pass scores every edge, then performs the cheapest collapses
+		// that do not touch each other's neighbourhoods.
+		double const max_cost = double(max_error) * max_error;
+		size_t const target_triangles = target_index_count / 3;
+		double worst = 0.0;
+		std::vector<uint32_t> tri_offsets(vertex_count + 1);
+		std::vector<uint32_t> tri_list;
+		std::vector<uint8_t> border_edges(vertex_count);
+		std::vector<uint8_t> kind(vertex_count);
+		std::vector<collapse_t> collapses;
+		std::vector<uint32_t> remap(vertex_count);
+		std::vector<uint8_t> touched(vertex_count);
+		while (result.size() / 3 > target_triangles) {
+			size_t const tri_count = result.size() / 3;
+
+			std::fill(tri_offsets.begin(), tri_offsets.end(), 0u);
+			for (uint32_t v : result) {
+				++tri_offsets[v + 1];
+			}
+			std::partial_sum(tri_offsets.begin(), tri_offsets.end(), tri_offsets.begin());
+			tri_list.resize(result.size());
+			{
+				std::vector<uint32_t> fill(tri_offsets.begin(), tri_offsets.end() - 1);
+				for (size_t i = 0; i < result.size(); ++i) {
+					tri_list[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+				}
+			}
+
+			keys.resize(result.size());
+			for (size_t i = 0; i < result.size(); i += 3) {
+				for (int e = 0; e < 3; ++e) {
+					keys[i + e] = EdgeKey(result[i + e], result[i + (e + 1) % 3]);
+				}
+			}
+			std::sort(keys.begin(), keys.end());
+
+			std::fill(border_edges.begin(), border_edges.end(), uint8_t(0));
+			for (size_t i = 0; i < keys.size();) {
+				size_t j = i + 1;
+				while (j < keys.size() && keys[j] == keys[i]) {
+					++j;
+				}
+				if (j - i == 1) {
+					uint32_t const a = static_cast<uint32_t>(keys[i] >> 32);
+					uint32_t const b = static_cast<uint32_t>(keys[i]);
+					border_edges[a] = static_cast<uint8_t>(std::min(border_edges[a] + 1, 3));
+					border_edges[b] = static_cast<uint8_t>(std::min(border_edges[b] + 1, 3));
+				}
+				i = j;
+			}
+			for (size_t v = 0; v < vertex_count; ++v) {
+				kind[v] = seam[v] || border_edges[v] > 2 ? KIND_LOCKED : border_edges[v] ? KIND_BORDER : KIND_MANIFOLD;
+			}
+
+			collapses.clear();
+			for (size_t i = 0; i < keys.size();) {
+				size_t j = i + 1;
+				while (j < keys.size() && keys[j] == keys[i]) {
+					++j;
+				}
+				bool const border = j - i == 1;
+				uint32_t const ends[2] = { static_cast<uint32_t>(keys[i] >> 32), static_cast<uint32_t>(keys[i]) };
+				collapse_t best = { 0, 0, -1.0 };
+				for (int d = 0; d < 2; ++d) {
+					uint32_t const from = ends[d];
+					uint32_t const to = ends[1 - d];
+					if (kind[from] == KIND_LOCKED || (kind[from] == KIND_BORDER && !border)) {
+						continue;
+					}
+					double const cost = Evaluate(quadrics[from], position(to)) + Evaluate(quadrics[to], position(to));
+					if (best.cost < 0.0 || cost < best.cost) {
+						best = { from, to, cost };
+					}
+				}
+				if (best.cost >= 0.0 && best.cost <= max_cost) {
+					collapses.push_back(best);
+				}
+				i = j;
+			}
+			if (collapses.empty()) {
+				break;
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const collapse_t& a, const collapse_t& b) {
+				return a.cost < b.cost;
+			});
+
+			std::iota(remap.begin(), remap.end(), 0u);
+			std::fill(touched.begin(), touched.end(), uint8_t(0));
+			size_t const excess = tri_count - target_triangles;
+			size_t removed = 0;
+			for (const collapse_t& c : collapses) {
+				if (touched[c.from] || touched[c.to]) {
+					continue;
+				}
+
+				// Reject collapses that would flip a surviving triangle.
+				bool flips = false;
+				size_t dying = 0;
+				for (uint32_t t = tri_offsets[c.from]; t < tri_offsets[c.from + 1] && !flips; ++t) {
+					const uint32_t* tri = &result[tri_list[t] * 3];
+					if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) {
+						++dying;
+						continue;
+					}
+					const float* p[3];
+					const float* q[3];
+					for (int k = 0; k < 3; ++k) {
+						p[k] = position(tri[k]);
+						q[k] = position(tri[k] == c.from ? c.to : tri[k]);
+					}
+					double before[3], after[3];
+					Cross(p[0], p[1], p[2], before);
+					Cross(q[0], q[1], q[2], after);
+					flips = before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0;
+				}
+				if (flips) {
+					continue;
+				}
+
+				remap[c.from] = c.to;
+				AddQuadric(quadrics[c.to], quadrics[c.from]);
+				worst = std::max(worst, c.cost);
+				touched[c.to] = 1;
+				for (uint32_t t = tri_offsets[c.from]; t < tri_offsets[c.from + 1]; ++t) {
+					const uint32_t* tri = &result[tri_list[t] * 3];
+					touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+				}
+				removed += dying;
+				if (removed >= excess) {
+					break;
+				}
+			}
+			if (removed == 0) {
+				break;
+			}
+
+			if (collapsed_to) {
+				for (size_t v = 0; v < vertex_count; ++v) {
+					collapsed_to[v] = remap[collapsed_to[v]];
+				}
+			}
+
+			size_t write = 0;
+			for (size_t i = 0; i < result.size(); i += 3) {
+				uint32_t const a = remap[result[i]];
+				uint32_t const b = remap[result[i + 1]];
+				uint32_t const c = remap[result[i + 2]];
+				if (a != b && b != c && c != a) {
+					result[write++] = a;
+					result[write++] = b;
+					result[write++] = c;
+				}
+			}
+			result.resize(write);
+		}
+
+		std::copy(result.begin(), result.end(), destination);
+		if (result_error) {
+			*result_error = static_cast<float>(sqrt(worst));
+		}
+		return result.size();
+	}
+}
+
+size_t SimplifyMesh(
+	const vertex_t* vertices, size_t vertex_count,
+	const uint32_t* indices, size_t index_count,
+	size_t target_index_count, float max_error,
+	uint32_t* destination, float* result_error, uint32_t* collapsed_to
+) {
+	compact_range_t range;
+	CompactRange(vertices, FindSeams(vertices, vertex_count), indices, index_count, range);
+	std::vector<uint32_t> local(range.indices.size());
+	std::vector<uint32_t> local_collapsed(collapsed_to ? range.global.size() : 0);
+	size_t const count = Simplify(
+		range.vertices.data(), range.vertices.size(), range.seam.data(), range.indices.data(), range.indices.size(),
+		target_index_count, max_error, local.data(), result_error, collapsed_to ? local_collapsed.data() : nullptr
+	);
+	for (size_t i = 0; i < count; ++i) {
+		destination[i] = range.global[local[i]];
+	}
+	if (collapsed_to) {
+		std::iota(collapsed_to, collapsed_to + vertex_count, 0u);
+		for (size_t v = 0; v < range.global.size(); ++v) {
+			collapsed_to[range.global[v]] = range.global[local_collapsed[v]];
+		}
+	}
+	return count;
+}
+
+std::vector<object_lods_t> BuildLodChains(
+	const vertex_t* vertices, size_t vertex_count, std::vector<uint32_t>& indices,
+	const std::vector<scene_object_t>& objects, float max_relative_error
+) {
+	std::vector<object_lods_t> chains(objects.size());
+	// Seams are found once over the whole buffer, so vertices an object
+	// shares a position with in another object stay put as well.
+	std::vector<uint8_t> const seam = FindSeams(vertices, vertex_count);
+	compact_range_t source;
+	std::vector<uint32_t> lod;
+	for (size_t i = 0; i < objects.size(); ++i) {
+		const scene_object_t& object = objects[i];
+		object_lods_t& chain = chains[i];
+		chain = {};
+		chain.level_count = 1;
+		chain.first_index[0] = object.first_index;
+		chain.index_count[0] = object.index_count;
+
+		float diagonal = 0.0f;
+		for (int k = 0; k < 3; ++k) {
+			float const d = object.aabb_max[k] - object.aabb_min[k];
+			diagonal += d * d;
+		}
+		diagonal = sqrtf(diagonal);
+
+		// Every level starts from the full object, so its error is measured
+		// against the original surface rather than the previous level.
+		CompactRange(vertices, seam, indices.data() + object.first_index, object.index_count, source);
+		lod.resize(source.indices.size());
+		for (uint32_t level = 1; level < MAX_LOD_LEVELS; ++level) {
+			uint32_t const previous = chain.index_count[level - 1];
+			float error = 0.0f;
+			size_t const count = Simplify(
+				source.vertices.data(), source.vertices.size(), source.seam.data(), source.indices.data(), source.indices.size(),
+				previous / 6 * 3, max_relative_error * diagonal, lod.data(), &error, nullptr
+			);
+			if (count * 5 > size_t(previous) * 4) {
+				break;
+			}
+			OptimizeVertexCache(lod.data(), count, source.vertices.size());
+			chain.first_index[level] = static_cast<uint32_t>(indices.size());
+			chain.index_count[level] = static_cast<uint32_t>(count);
+			chain.error[level] = std::max(error, chain.error[level - 1]);
+			chain.level_count = level + 1;
+			for (size_t k = 0; k < count; ++k) {
+				indices.push_back(source.global[lod[k]]);
+			}
+		}
+	}
+	return chains;
+}
+
+uint32_t SelectLod(const object_lods_t& lods, float distance, float pixels_per_unit, float max_pixel_error) {
+	uint32_t level = 0;
+	for (uint32_t k = 1; k < lods.level_count; ++k) {
+		if (lods.error[k] * pixels_per_unit <= max_pixel_error * distance) {
+			level = k;
+		}
+	}
+	return level;
+}
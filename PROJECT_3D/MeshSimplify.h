@@ -0,0 +1,54 @@
+#pragma once
+
+#include "ObjectSegmentation.h"
+#include "Vertex.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Edge-collapse simplification ordered by quadric error (Garland and
+// Heckbert 1997). Vertices collapse onto an existing neighbour, so the
+// result indexes the same vertex buffer. Seam vertices (several vertices
+// sharing a position, e.g. across a UV or color discontinuity) never
+// move, and open borders only collapse along themselves.
+// Writes at most index_count indices to destination and returns how many.
+// Stops at target_index_count or before any collapse whose error would
+// exceed max_error. result_error, if given, receives an upper bound on the
+// distance from a moved vertex to the original planes around it.
+// collapsed_to, if given, receives for each of the vertex_count vertices
+// the one it now stands at, itself if it did not move.
+size_t SimplifyMesh(
+    const vertex_t* vertices, size_t vertex_count,
+    const uint32_t* indices, size_t index_count,
+    size_t target_index_count, float max_error,
+    uint32_t* destination, float* result_error = nullptr, uint32_t* collapsed_to = nullptr
+);
+
+uint32_t const MAX_LOD_LEVELS = 4;
+
+// LOD chain of one object inside a shared index buffer. Level 0 is the
+// object's own range with zero error; each level has roughly half the
+// triangles of the previous one.
+struct object_lods_t {
+    uint32_t level_count;
+    uint32_t first_index[MAX_LOD_LEVELS];
+    uint32_t index_count[MAX_LOD_LEVELS];
+    float error[MAX_LOD_LEVELS];
+};
+
+// Simplifies every object and appends its coarser levels to indices,
+// each in vertex cache order. A level is kept only if it removes at least
+// a fifth of the triangles while its error stays within
+// max_relative_error times the object's AABB diagonal. Seams are found
+// once for the whole buffer and each object is simplified on the vertices
+// it uses, so the cost follows the objects' sizes, not their count times
+// the buffer's.
+std::vector<object_lods_t> BuildLodChains(
+    const vertex_t* vertices, size_t vertex_count, std::vector<uint32_t>& indices,
+    const std::vector<scene_object_t>& objects, float max_relative_error = 0.02f
+);
+
+// Coarsest level whose error, seen from distance, projects to at most
+// max_pixel_error pixels. pixels_per_unit is the height in pixels of a
+// unit length at unit distance: viewport height * projection._22 / 2.
+uint32_t SelectLod(const object_lods_t& lods, float distance, float pixels_per_unit, float max_pixel_error);
@@ -0,0 +1,136 @@
+#include "ReportTools.h"
+#include "MeshSimplify.h"
+#include "MeshWeld.h"
+#include "ObjectSegmentation.h"
+#include "SceneAsset.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <set>
+#include <utility>
+
+namespace {
+	// Distance from p to the plane of triangle (a, b, c), or 0 for a
+	// degenerate triangle.
+	double PlaneDistance(const float* p, const float* a, const float* b, const float* c) {
+		double const u[3] = { double(b[0]) - a[0], double(b[1]) - a[1], double(b[2]) - a[2] };
+		double const v[3] = { double(c[0]) - a[0], double(c[1]) - a[1], double(c[2]) - a[2] };
+		double const n[3] = { u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0] };
+		double const length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (length == 0.0) {
+			return 0.0;
+		}
+		return fabs(n[0] * (p[0] - a[0]) + n[1] * (p[1] - a[1]) + n[2] * (p[2] - a[2])) / length;
+	}
+}
+
+// Simplifies every object of the room to half its triangles and checks
+// the reported error: each vertex stands, after the collapses, within
+// it of the plane of every original triangle around it, and every
+// triangle left is an original one with its vertices moved. Then bakes
+// LOD chains for grids of rooms, timing them and checking each level's
+// vertices, size and error limit. Fails on any broken check.
+//   --simplify-report [simplify.txt] [columns] [rows]
+int SimplifyReportTool(const std::vector<std::string>& args) {
+	uint32_t const columns = args.size() > 2 ? static_cast<uint32_t>(std::stoul(args[2])) : 16;
+	uint32_t const rows = args.size() > 3 ? static_cast<uint32_t>(std::stoul(args[3])) : 16;
+	float const MAX_RELATIVE_ERROR = 0.02f;
+
+	FILE* out = OpenReport(args, "simplify.txt");
+	if (!out) {
+		return 1;
+	}
+	size_t failures = 0;
+
+	// Error bounds, object by object.
+	std::vector<vertex_t> const room = SceneSourceVertices();
+	{
+		indexed_mesh_t mesh = WeldVertices(room.data(), room.size());
+		std::vector<scene_object_t> const objects = SegmentObjects(mesh.vertices.data(), mesh.vertices.size(), mesh.indices);
+		std::vector<uint32_t> collapsed_to(mesh.vertices.size());
+		std::vector<uint32_t> simplified(mesh.indices.size());
+		size_t before = 0, after = 0, bound_errors = 0, triangle_errors = 0;
+		double worst_ratio = 0.0;
+		for (const scene_object_t& o : objects) {
+			const uint32_t* source = mesh.indices.data() + o.first_index;
+			float error = 0.0f;
+			size_t const count = SimplifyMesh(
+				mesh.vertices.data(), mesh.vertices.size(), source, o.index_count, o.index_count / 6 * 3, FLT_MAX,
+				simplified.data(), &error, collapsed_to.data()
+			);
+			std::set<std::array<uint32_t, 3>> moved;
+			for (uint32_t i = 0; i < o.index_count; i += 3) {
+				const float* p[3];
+				for (int k = 0; k < 3; ++k) {
+					p[k] = mesh.vertices[source[i + k]].position;
+				}
+				for (int k = 0; k < 3; ++k) {
+					double const d = PlaneDistance(mesh.vertices[collapsed_to[source[i + k]]].position, p[0], p[1], p[2]);
+					bound_errors += d > error * (1.0 + 1e-4) + 1e-6;
+					if (error > 0.0f) {
+						worst_ratio = (std::max)(worst_ratio, d / error);
+					}
+				}
+				moved.insert({ collapsed_to[source[i]], collapsed_to[source[i + 1]], collapsed_to[source[i + 2]] });
+			}
+			for (size_t i = 0; i < count; i += 3) {
+				uint32_t const* t = &simplified[i];
+				triangle_errors += t[0] == t[1] || t[1] == t[2] || t[2] == t[0] || !moved.count({ t[0], t[1], t[2] });
+			}
+			before += o.index_count / 3;
+			after += count / 3;
+		}
+		fprintf(out, "room objects halved: %zu -> %zu triangles; farthest vertex at %.3f of the reported error; "
+			"%zu bound errors, %zu triangle errors\n", before, after, worst_ratio, bound_errors, triangle_errors);
+		failures += bound_errors + triangle_errors;
+	}
+
+	// LOD chains for growing grids.
+	std::pair<uint32_t, uint32_t> const sizes[] = { { 4, 4 }, { 8, 8 }, { columns, rows } };
+	for (const auto& size : sizes) {
+		std::vector<vertex_t> const grid = ReportGrid(room, size.first, size.second);
+		indexed_mesh_t mesh = WeldVertices(grid.data(), grid.size());
+		std::vector<scene_object_t> const objects = SegmentObjects(mesh.vertices.data(), mesh.vertices.size(), mesh.indices);
+		std::vector<uint32_t> indices = mesh.indices;
+		auto const start = std::chrono::steady_clock::now();
+		std::vector<object_lods_t> const chains = BuildLodChains(
+			mesh.vertices.data(), mesh.vertices.size(), indices, objects, MAX_RELATIVE_ERROR
+		);
+		double const seconds = Seconds(start);
+
+		size_t level_triangles[MAX_LOD_LEVELS] = {};
+		size_t chain_errors = 0;
+		for (size_t i = 0; i < objects.size(); ++i) {
+			const scene_object_t& o = objects[i];
+			const object_lods_t& chain = chains[i];
+			std::set<uint32_t> const used(mesh.indices.begin() + o.first_index, mesh.indices.begin() + o.first_index + o.index_count);
+			float diagonal = 0.0f;
+			for (int k = 0; k < 3; ++k) {
+				diagonal += (o.aabb_max[k] - o.aabb_min[k]) * (o.aabb_max[k] - o.aabb_min[k]);
+			}
+			diagonal = sqrtf(diagonal);
+			chain_errors += chain.level_count < 1 || chain.first_index[0] != o.first_index || chain.index_count[0] != o.index_count;
+			for (uint32_t level = 0; level < chain.level_count; ++level) {
+				level_triangles[level] += chain.index_count[level] / 3;
+				if (level == 0) {
+					continue;
+				}
+				chain_errors += size_t(chain.index_count[level]) * 5 > size_t(chain.index_count[level - 1]) * 4 ||
+					chain.error[level] < chain.error[level - 1] || chain.error[level] > MAX_RELATIVE_ERROR * diagonal * 1.0001f ||
+					chain.first_index[level] + chain.index_count[level] > indices.size();
+				for (uint32_t k = 0; k < chain.index_count[level] && chain.first_index[level] + k < indices.size(); ++k) {
+					chain_errors += !used.count(indices[chain.first_index[level] + k]);
+				}
+			}
+		}
+		fprintf(out, "%u x %u rooms: %zu triangles in %zu objects, LODs in %.3f s (%.2f M tris/s); triangles per level",
+			size.first, size.second, mesh.indices.size() / 3, objects.size(), seconds,
+			seconds > 0.0 ? mesh.indices.size() / 3 / seconds / 1e6 : 0.0);
+		for (uint32_t level = 0; level < MAX_LOD_LEVELS; ++level) {
+			fprintf(out, " %zu", level_triangles[level]);
+		}
+		fprintf(out, "; %zu chain errors\n", chain_errors);
+		failures += chain_errors;
+	}
+	return CloseReport(out, failures);
+}
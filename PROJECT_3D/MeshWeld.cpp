@@ -0,0 +1,81 @@
+#include "MeshWeld.h"
+#include <cstring>
+
+namespace {
+	size_t const VERTEX_WORDS = sizeof(vertex_t) / sizeof(uint32_t);
+
+	// Bit pattern of a vertex with -0.0f folded into 0.0f, so that both
+	// weld together while every other value is compared exactly.
+	void CanonicalWords(const vertex_t& v, uint32_t (&words)[VERTEX_WORDS]) {
+		memcpy(words, &v, sizeof(vertex_t));
+		for (auto& w : words) {
+			if (w == 0x80000000u) {
+				w = 0;
+			}
+		}
+	}
+
+	uint64_t HashWords(const uint32_t (&words)[VERTEX_WORDS]) {
+		uint64_t h = 0xcbf29ce484222325ull;
+		for (auto w : words) {
+			h = (h ^ w) * 0x100000001b3ull;
+			h ^= h >> 29;
+		}
+		return h;
+	}
+}
+
+indexed_mesh_t WeldVertices(const vertex_t* vertices, size_t count) {
+	indexed_mesh_t mesh;
+	mesh.indices.resize(count);
+
+	size_t capacity = 16;
+	while (capacity < count * 2) {
+		capacity <<= 1;
+	}
+	size_t const mask = capacity - 1;
+	uint32_t const EMPTY = UINT32_MAX;
+	std::vector<uint32_t> table(capacity, EMPTY);
+	std::vector<uint64_t> hashes;
+
+	for (size_t i = 0; i < count; ++i) {
+		uint32_t words[VERTEX_WORDS];
+		CanonicalWords(vertices[i], words);
+		uint64_t const h = HashWords(words);
+
+		size_t slot = static_cast<size_t>(h) & mask;
+		for (;;) {
+			uint32_t const id = table[slot];
+			if (id == EMPTY) {
+				table[slot] = static_cast<uint32_t>(mesh.vertices.size());
+				mesh.indices[i] = table[slot];
+				mesh.vertices.push_back(vertices[i]);
+				hashes.push_back(h);
+				break;
+			}
+			if (hashes[id] == h) {
+				uint32_t other[VERTEX_WORDS];
+				CanonicalWords(mesh.vertices[id], other);
+				if (memcmp(words, other, sizeof(words)) == 0) {
+					mesh.indices[i] = id;
+					break;
+				}
+			}
+			slot = (slot + 1) & mask;
+		}
+	}
+
+	return mesh;
+}
+
+bool FitsIndex16(const indexed_mesh_t& mesh) {
+	return mesh.vertices.size() <= 0xFFFF;
+}
+
+std::vector<uint16_t> PackIndices16(const std::vector<uint32_t>& indices) {
+	std::vector<uint16_t> packed(indices.size());
+	for (size_t i = 0; i < indices.size(); ++i) {
+		packed[i] = static_cast<uint16_t>(indices[i]);
+	}
+	return packed;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Vertex.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct indexed_mesh_t {
+    std::vector<vertex_t> vertices;
+    std::vector<uint32_t> indices;
+};
+
+// Merges identical vertices of a triangle list into a compact vertex array
+// plus an index buffer. Vertex order follows first occurrence, so the
+// triangles come out in the same order and winding as the input.
+indexed_mesh_t WeldVertices(const vertex_t* vertices, size_t count);
+
+// True when every index fits into a DXGI_FORMAT_R16_UINT index buffer.
+bool FitsIndex16(const indexed_mesh_t& mesh);
+
+std::vector<uint16_t> PackIndices16(const std::vector<uint32_t>& indices);
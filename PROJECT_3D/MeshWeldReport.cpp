@@ -0,0 +1,61 @@
+#include "ReportTools.h"
+#include "MeshWeld.h"
+#include <set>
+
+// Welds the room and a grid of rooms, rebuilds each triangle list from the
+// welded vertices and indices and compares it with the original, value for
+// value (-0 and 0 weld together). Also checks that no two welded vertices
+// are equal and times the weld.
+//   --weld-report [weld.txt] [columns] [rows]
+int WeldReportTool(const std::vector<std::string>& args) {
+	std::vector<report_input_t> const inputs = ReportInputs(args, 16);
+	auto same = [](const vertex_t& a, const vertex_t& b) {
+		return a.position[0] == b.position[0] && a.position[1] == b.position[1] && a.position[2] == b.position[2] &&
+			a.color[0] == b.color[0] && a.color[1] == b.color[1] && a.color[2] == b.color[2] && a.color[3] == b.color[3] &&
+			a.tex_coord[0] == b.tex_coord[0] && a.tex_coord[1] == b.tex_coord[1];
+	};
+	auto key = [](const vertex_t& v) {
+		std::vector<float> values(v.position, v.position + 3);
+		values.insert(values.end(), v.color, v.color + 4);
+		values.insert(values.end(), v.tex_coord, v.tex_coord + 2);
+		for (float& value : values) {
+			value += 0.0f;
+		}
+		return values;
+	};
+
+	FILE* out = OpenReport(args, "weld.txt");
+	if (!out) {
+		return 1;
+	}
+	size_t failures = 0;
+	for (const report_input_t& input : inputs) {
+		const std::vector<vertex_t>& source = input.vertices;
+		auto const start = std::chrono::steady_clock::now();
+		indexed_mesh_t const mesh = WeldVertices(source.data(), source.size());
+		double const seconds = Seconds(start);
+
+		size_t mismatched = mesh.indices.size() == source.size() ? 0 : source.size();
+		for (size_t i = 0; i < mesh.indices.size() && i < source.size(); ++i) {
+			mismatched += mesh.indices[i] >= mesh.vertices.size() || !same(mesh.vertices[mesh.indices[i]], source[i]);
+		}
+		std::set<std::vector<float>> distinct;
+		for (const vertex_t& v : mesh.vertices) {
+			distinct.insert(key(v));
+		}
+		size_t const duplicates = mesh.vertices.size() - distinct.size();
+		size_t index16_errors = 0;
+		if (FitsIndex16(mesh)) {
+			std::vector<uint16_t> const packed = PackIndices16(mesh.indices);
+			for (size_t i = 0; i < packed.size(); ++i) {
+				index16_errors += packed[i] != mesh.indices[i];
+			}
+		}
+		fprintf(out, "%s: %zu -> %zu vertices, %s indices, %.1f M vertices/s\n", input.name, source.size(), mesh.vertices.size(),
+			FitsIndex16(mesh) ? "16-bit" : "32-bit", seconds > 0.0 ? source.size() / seconds / 1e6 : 0.0);
+		fprintf(out, "%s: round trip mismatches %zu, duplicate vertices %zu, 16-bit index errors %zu\n",
+			input.name, mismatched, duplicates, index16_errors);
+		failures += mismatched + duplicates + index16_errors;
+	}
+	return CloseReport(out, failures);
+}
@@ -0,0 +1,461 @@
+#include "Meshlet.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+	// How much a triangle turned away from a meshlet counts against its
+	// distance when the meshlet continues elsewhere.
+	float const CONE_WEIGHT = 1.0f;
+
+	float Dot(const float* a, const float* b) {
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	float Length(const float* a) {
+		return sqrtf(Dot(a, a));
+	}
+
+	// Ritter's bounding sphere: start from a far pair, then grow.
+	void BoundingSphere(const std::vector<const float*>& points, float* center, float& radius) {
+		const float* a = points[0];
+		const float* b = a;
+		float best = -1.0f;
+		for (const float* p : points) {
+			float const d[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+			if (Dot(d, d) > best) {
+				best = Dot(d, d);
+				b = p;
+			}
+		}
+		const float* c = b;
+		best = -1.0f;
+		for (const float* p : points) {
+			float const d[3] = { p[0] - b[0], p[1] - b[1], p[2] - b[2] };
+			if (Dot(d, d) > best) {
+				best = Dot(d, d);
+				c = p;
+			}
+		}
+		for (int k = 0; k < 3; ++k) {
+			center[k] = 0.5f * (b[k] + c[k]);
+		}
+		radius = 0.5f * sqrtf(best);
+
+		for (const float* p : points) {
+			float const d[3] = { p[0] - center[0], p[1] - center[1], p[2] - center[2] };
+			float const dist = Length(d);
+			if (dist > radius) {
+				float const grown = 0.5f * (radius + dist);
+				float const shift = (grown - radius) / dist;
+				for (int k = 0; k < 3; ++k) {
+					center[k] += d[k] * shift;
+				}
+				radius = grown;
+			}
+		}
+	}
+
+	meshlet_bounds_t ComputeBounds(
+		const vertex_t* vertices, const uint32_t* meshlet_vertices,
+		const uint8_t* meshlet_triangles, const meshlet_t& m
+	) {
+		meshlet_bounds_t b = {};
+		std::vector<const float*> points(m.vertex_count);
+		for (int k = 0; k < 3; ++k) {
+			b.aabb_min[k] = FLT_MAX;
+			b.aabb_max[k] = -FLT_MAX;
+		}
+		for (uint32_t i = 0; i < m.vertex_count; ++i) {
+			points[i] = vertices[meshlet_vertices[i]].position;
+			for (int k = 0; k < 3; ++k) {
+				b.aabb_min[k] = std::min(b.aabb_min[k], points[i][k]);
+				b.aabb_max[k] = std::max(b.aabb_max[k], points[i][k]);
+			}
+		}
+		BoundingSphere(points, b.center, b.radius);
+
+		// Normal cone from the unit face normals.
+		std::vector<float> normals;
+		normals.reserve(m.triangle_count * 3);
+		float axis[3] = { 0.0f, 0.0f, 0.0f };
+		for (uint32_t t = 0; t < m.triangle_count; ++t) {
+			const float* p0 = points[meshlet_triangles[t * 3 + 0]];
+			const float* p1 = points[meshlet_triangles[t * 3 + 1]];
+			const float* p2 = points[meshlet_triangles[t * 3 + 2]];
+			float const e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float const e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float n[3] = {
+				e1[1] * e2[2] - e1[2] * e2[1],
+				e1[2] * e2[0] - e1[0] * e2[2],
+				e1[0] * e2[1] - e1[1] * e2[0]
+			};
+			float const length = Length(n);
+			if (length <= 0.0f) {
+				continue;
+			}
+			for (int k = 0; k < 3; ++k) {
+				n[k] /= length;
+				axis[k] += n[k];
+			}
+			normals.insert(normals.end(), n, n + 3);
+		}
+
+		float const axis_length = Length(axis);
+		size_t const normal_count = normals.size() / 3;
+		// Without a usable cone the cluster is never backface culled.
+		for (int k = 0; k < 3; ++k) {
+			b.cone_apex[k] = b.center[k];
+		}
+		b.cone_cutoff = 1.0f;
+		if (normal_count == 0 || axis_length <= 0.0f) {
+			return b;
+		}
+		float const unit_axis[3] = { axis[0] / axis_length, axis[1] / axis_length, axis[2] / axis_length };
+		float min_dot = 1.0f;
+		for (size_t i = 0; i < normal_count; ++i) {
+			min_dot = std::min(min_dot, Dot(&normals[i * 3], unit_axis));
+		}
+		// The axis stays zero otherwise: with a cutoff of 1 a unit axis
+		// would still cull an eye that rounding puts exactly on it.
+		if (min_dot <= 0.1f) {
+			return b;
+		}
+		for (int k = 0; k < 3; ++k) {
+			b.cone_axis[k] = unit_axis[k];
+		}
+
+		// Move the apex back along the axis until it lies behind every
+		// triangle plane, so the cone test is conservative for any eye.
+		float max_t = 0.0f;
+		size_t n_index = 0;
+		for (uint32_t t = 0; t < m.triangle_count; ++t) {
+			const float* p0 = points[meshlet_triangles[t * 3 + 0]];
+			const float* p1 = points[meshlet_triangles[t * 3 + 1]];
+			const float* p2 = points[meshlet_triangles[t * 3 + 2]];
+			float const e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float const e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float const n[3] = {
+				e1[1] * e2[2] - e1[2] * e2[1],
+				e1[2] * e2[0] - e1[0] * e2[2],
+				e1[0] * e2[1] - e1[1] * e2[0]
+			};
+			if (Length(n) <= 0.0f) {
+				continue;
+			}
+			const float* unit = &normals[n_index++ * 3];
+			float const to_center[3] = { b.center[0] - p0[0], b.center[1] - p0[1], b.center[2] - p0[2] };
+			float const t_plane = Dot(to_center, unit) / Dot(b.cone_axis, unit);
+			max_t = std::max(max_t, t_plane);
+		}
+		for (int k = 0; k < 3; ++k) {
+			b.cone_apex[k] = b.center[k] - b.cone_axis[k] * max_t;
+		}
+		b.cone_cutoff = sqrtf(1.0f - min_dot * min_dot);
+		return b;
+	}
+
+	// Uniform grid over triangle centroids that finds the unused triangle
+	// nearest to a point, where a new meshlet or a cluster that ran out of
+	// neighbours continues.
+	class CentroidGrid
+	{
+	public:
+		CentroidGrid(const vertex_t* vertices, const uint32_t* indices, size_t tri_count) :
+			m_centroids(tri_count * 3),
+			m_normals(tri_count * 3, 0.0f)
+		{
+			float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			for (size_t t = 0; t < tri_count; ++t) {
+				const float* p0 = vertices[indices[t * 3 + 0]].position;
+				const float* p1 = vertices[indices[t * 3 + 1]].position;
+				const float* p2 = vertices[indices[t * 3 + 2]].position;
+				float const e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+				float const e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+				float const n[3] = {
+					e1[1] * e2[2] - e1[2] * e2[1],
+					e1[2] * e2[0] - e1[0] * e2[2],
+					e1[0] * e2[1] - e1[1] * e2[0]
+				};
+				float const length = Length(n);
+				if (length > 0.0f) {
+					for (int k = 0; k < 3; ++k) {
+						m_normals[t * 3 + k] = n[k] / length;
+					}
+				}
+				for (int k = 0; k < 3; ++k) {
+					float const c = (vertices[indices[t * 3 + 0]].position[k] + vertices[indices[t * 3 + 1]].position[k] +
+						vertices[indices[t * 3 + 2]].position[k]) / 3.0f;
+					m_centroids[t * 3 + k] = c;
+					lo[k] = std::min(lo[k], c);
+					hi[k] = std::max(hi[k], c);
+				}
+			}
+			// Cubic cells of about four triangles each, over the axes the
+			// centroids actually spread along.
+			double volume = 1.0;
+			int axes = 0;
+			for (int k = 0; k < 3; ++k) {
+				if (hi[k] > lo[k]) {
+					volume *= hi[k] - lo[k];
+					++axes;
+				}
+			}
+			float const cell_size = axes ? static_cast<float>(std::pow(volume / std::max(tri_count / 4.0, 1.0), 1.0 / axes)) : 1.0f;
+			for (int k = 0; k < 3; ++k) {
+				m_lo[k] = lo[k];
+				m_dim[k] = std::min(std::max(static_cast<int>(std::ceil((hi[k] - lo[k]) / cell_size)), 1), 1024);
+				m_scale[k] = hi[k] > lo[k] ? m_dim[k] / (hi[k] - lo[k]) : 0.0f;
+				if (hi[k] > lo[k]) {
+					m_cellSize = std::min(m_cellSize, (hi[k] - lo[k]) / m_dim[k]);
+				}
+			}
+			size_t const cells = static_cast<size_t>(m_dim[0]) * m_dim[1] * m_dim[2];
+
+			m_cellFirst.assign(cells + 1, 0);
+			std::vector<uint32_t> cell_of(tri_count);
+			for (size_t t = 0; t < tri_count; ++t) {
+				int c[3];
+				Cell(&m_centroids[t * 3], c);
+				cell_of[t] = static_cast<uint32_t>((c[2] * m_dim[1] + c[1]) * m_dim[0] + c[0]);
+				++m_cellFirst[cell_of[t] + 1];
+			}
+			for (size_t c = 1; c < m_cellFirst.size(); ++c) {
+				m_cellFirst[c] += m_cellFirst[c - 1];
+			}
+			m_cellTriangles.resize(tri_count);
+			m_cellNext.assign(m_cellFirst.begin(), m_cellFirst.end() - 1);
+			for (size_t t = 0; t < tri_count; ++t) {
+				m_cellTriangles[m_cellNext[cell_of[t]]++] = static_cast<uint32_t>(t);
+			}
+			m_cellNext.assign(m_cellFirst.begin(), m_cellFirst.end() - 1);
+		}
+
+		const float* Centroid(size_t t) const { return &m_centroids[t * 3]; }
+		const float* Normal(size_t t) const { return &m_normals[t * 3]; }
+
+		// Searches shells of cells around the point's cell until no closer
+		// triangle can lie further out. The distance of a triangle facing
+		// away from axis (unit or zero) counts up to 1 + 2 * cone_weight
+		// times, so clusters keep a usable normal cone. Returns -1 when no
+		// triangle is unused.
+		int64_t Nearest(const float* point, const float* axis, float cone_weight, const std::vector<bool>& used) {
+			int center[3];
+			Cell(point, center);
+			int const max_ring = std::max({ m_dim[0], m_dim[1], m_dim[2] });
+			int64_t best = -1;
+			float best_distance = FLT_MAX;
+			for (int ring = 0; ring <= max_ring; ++ring) {
+				int const z0 = std::max(center[2] - ring, 0), z1 = std::min(center[2] + ring, m_dim[2] - 1);
+				int const y0 = std::max(center[1] - ring, 0), y1 = std::min(center[1] + ring, m_dim[1] - 1);
+				for (int z = z0; z <= z1; ++z) {
+					for (int y = y0; y <= y1; ++y) {
+						bool const shell_yz = std::abs(z - center[2]) == ring || std::abs(y - center[1]) == ring;
+						for (int x = center[0] - ring; x <= center[0] + ring; x += shell_yz || ring == 0 ? 1 : 2 * ring) {
+							if (x < 0 || x >= m_dim[0]) {
+								continue;
+							}
+							size_t const cell = static_cast<size_t>((z * m_dim[1] + y) * m_dim[0] + x);
+							// Used triangles at the front of a cell are skipped for good.
+							uint32_t& next = m_cellNext[cell];
+							while (next < m_cellFirst[cell + 1] && used[m_cellTriangles[next]]) {
+								++next;
+							}
+							for (uint32_t i = next; i < m_cellFirst[cell + 1]; ++i) {
+								uint32_t const t = m_cellTriangles[i];
+								if (used[t]) {
+									continue;
+								}
+								const float* c = Centroid(t);
+								float const d[3] = { c[0] - point[0], c[1] - point[1], c[2] - point[2] };
+								float const penalty = 1.0f + cone_weight * (1.0f - Dot(Normal(t), axis));
+								float const distance = Dot(d, d) * penalty * penalty;
+								if (distance < best_distance) {
+									best_distance = distance;
+									best = t;
+								}
+							}
+						}
+					}
+				}
+				// Cells of the next shell are at least ring cells away.
+				float const reach = ring * m_cellSize;
+				if (best >= 0 && best_distance <= reach * reach) {
+					break;
+				}
+			}
+			return best;
+		}
+
+	private:
+		void Cell(const float* p, int* c) const {
+			for (int k = 0; k < 3; ++k) {
+				c[k] = std::min(std::max(static_cast<int>((p[k] - m_lo[k]) * m_scale[k]), 0), m_dim[k] - 1);
+			}
+		}
+
+		std::vector<float> m_centroids;
+		std::vector<float> m_normals;
+		float m_lo[3];
+		float m_scale[3];
+		int m_dim[3];
+		float m_cellSize = FLT_MAX;     // smallest edge of a cell
+		std::vector<uint32_t> m_cellFirst;
+		std::vector<uint32_t> m_cellTriangles;
+		std::vector<uint32_t> m_cellNext;
+	};
+}
+
+meshlet_set_t BuildMeshlets(
+	const vertex_t* vertices, size_t vertex_count,
+	const uint32_t* indices, size_t index_count,
+	size_t max_vertices, size_t max_triangles
+) {
+	max_vertices = std::min<size_t>(std::max<size_t>(max_vertices, 3), 255);
+	max_triangles = std::max<size_t>(max_triangles, 1);
+
+	meshlet_set_t set;
+	size_t const tri_count = index_count / 3;
+
+	std::vector<uint32_t> adjacency_offset(vertex_count + 1, 0);
+	for (size_t i = 0; i < tri_count * 3; ++i) {
+		++adjacency_offset[indices[i] + 1];
+	}
+	for (size_t v = 0; v < vertex_count; ++v) {
+		adjacency_offset[v + 1] += adjacency_offset[v];
+	}
+	std::vector<uint32_t> adjacency(tri_count * 3);
+	{
+		std::vector<uint32_t> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+		for (size_t t = 0; t < tri_count; ++t) {
+			for (int k = 0; k < 3; ++k) {
+				adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+			}
+		}
+	}
+
+	std::vector<bool> used(tri_count, false);
+	// Local index of a mesh vertex in the meshlet being built, 0xFF if
+	// absent; this is why clusters are capped at 255 vertices.
+	std::vector<uint8_t> local(vertex_count, 0xFF);
+	meshlet_t current = {};
+	CentroidGrid grid(vertices, indices, tri_count);
+	// Sum of the centroids of the meshlet's triangles, and the centroid of
+	// the last triangle placed, where the next meshlet starts.
+	float centroid_sum[3] = { 0.0f, 0.0f, 0.0f };
+	float last_centroid[3] = { 0.0f, 0.0f, 0.0f };
+	float normal_sum[3] = { 0.0f, 0.0f, 0.0f };
+
+	auto new_vertices = [&](size_t t) {
+		int count = 0;
+		for (int k = 0; k < 3; ++k) {
+			count += local[indices[t * 3 + k]] == 0xFF;
+		}
+		return count;
+	};
+
+	auto flush = [&]() {
+		if (current.triangle_count == 0) {
+			return;
+		}
+		for (uint32_t i = 0; i < current.vertex_count; ++i) {
+			local[set.vertices[current.vertex_offset + i]] = 0xFF;
+		}
+		set.meshlets.push_back(current);
+		for (int k = 0; k < 3; ++k) {
+			centroid_sum[k] = 0.0f;
+			normal_sum[k] = 0.0f;
+		}
+		current.vertex_offset = static_cast<uint32_t>(set.vertices.size());
+		current.triangle_offset = static_cast<uint32_t>(set.triangles.size());
+		current.vertex_count = 0;
+		current.triangle_count = 0;
+	};
+
+	for (size_t emitted = 0; emitted < tri_count; ++emitted) {
+		float axis[3] = { 0.0f, 0.0f, 0.0f };
+		float const axis_length = Length(normal_sum);
+		if (axis_length > 0.0f) {
+			for (int k = 0; k < 3; ++k) {
+				axis[k] = normal_sum[k] / axis_length;
+			}
+		}
+
+		// Prefer the adjacent triangle that adds the fewest new vertices and
+		// then the one that faces most like the meshlet, which keeps the
+		// normal cone narrow.
+		int64_t best = -1;
+		int best_new = 4;
+		float best_dot = -2.0f;
+		for (uint32_t i = 0; i < current.vertex_count; ++i) {
+			uint32_t const v = set.vertices[current.vertex_offset + i];
+			for (uint32_t a = adjacency_offset[v]; a < adjacency_offset[v + 1]; ++a) {
+				uint32_t const t = adjacency[a];
+				if (used[t]) {
+					continue;
+				}
+				float const dot = Dot(grid.Normal(t), axis);
+				int const extra = new_vertices(t);
+				if (extra < best_new || (extra == best_new && dot > best_dot)) {
+					best_new = extra;
+					best_dot = dot;
+					best = t;
+				}
+			}
+		}
+		if (best < 0) {
+			// No unused neighbour: continue with the triangle nearest to the
+			// meshlet, or to where the last one ended, so clusters stay
+			// compact even on meshes of many small disconnected parts.
+			float point[3];
+			for (int k = 0; k < 3; ++k) {
+				point[k] = current.triangle_count ? centroid_sum[k] / current.triangle_count : last_centroid[k];
+			}
+			best = grid.Nearest(point, axis, CONE_WEIGHT, used);
+			best_new = new_vertices(static_cast<size_t>(best));
+		}
+
+		if (current.vertex_count + best_new > max_vertices || current.triangle_count + 1 > max_triangles) {
+			flush();
+			best_new = new_vertices(static_cast<size_t>(best));
+		}
+
+		for (int k = 0; k < 3; ++k) {
+			uint32_t const v = indices[best * 3 + k];
+			if (local[v] == 0xFF) {
+				local[v] = static_cast<uint8_t>(current.vertex_count++);
+				set.vertices.push_back(v);
+			}
+			set.triangles.push_back(local[v]);
+		}
+		++current.triangle_count;
+		used[best] = true;
+		for (int k = 0; k < 3; ++k) {
+			last_centroid[k] = grid.Centroid(static_cast<size_t>(best))[k];
+			centroid_sum[k] += last_centroid[k];
+			normal_sum[k] += grid.Normal(static_cast<size_t>(best))[k];
+		}
+	}
+	flush();
+
+	set.bounds.reserve(set.meshlets.size());
+	for (const meshlet_t& m : set.meshlets) {
+		set.bounds.push_back(ComputeBounds(
+			vertices, &set.vertices[m.vertex_offset], &set.triangles[m.triangle_offset], m
+		));
+	}
+	return set;
+}
+
+bool MeshletBackfacing(const meshlet_bounds_t& bounds, const float eye[3]) {
+	float d[3] = {
+		bounds.cone_apex[0] - eye[0],
+		bounds.cone_apex[1] - eye[1],
+		bounds.cone_apex[2] - eye[2]
+	};
+	float const length = Length(d);
+	if (length <= 0.0f) {
+		return false;
+	}
+	return Dot(d, bounds.cone_axis) >= bounds.cone_cutoff * length;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Vertex.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+size_t const MESHLET_MAX_VERTICES = 64;
+size_t const MESHLET_MAX_TRIANGLES = 124;
+
+struct meshlet_t {
+    uint32_t vertex_offset;     // into meshlet_set_t::vertices
+    uint32_t triangle_offset;   // into meshlet_set_t::triangles, in bytes
+    uint32_t vertex_count;
+    uint32_t triangle_count;
+};
+
+struct meshlet_bounds_t {
+    float center[3];
+    float radius;
+    float aabb_min[3];
+    float aabb_max[3];
+    // Backface cone: every triangle faces away from a viewer for whom
+    // dot(normalize(cone_apex - eye), cone_axis) >= cone_cutoff.
+    float cone_apex[3];
+    float cone_axis[3];
+    float cone_cutoff;
+};
+
+struct meshlet_set_t {
+    std::vector<meshlet_t> meshlets;
+    std::vector<meshlet_bounds_t> bounds;
+    std::vector<uint32_t> vertices;     // mesh vertex indices
+    std::vector<uint8_t> triangles;     // meshlet-local indices, 3 per triangle
+};
+
+// Greedily splits an indexed triangle list into clusters of at most
+// max_vertices / max_triangles, growing each cluster through shared
+// vertices, favouring triangles that face like it. A cluster without
+// unused neighbours continues at the nearest unused triangle, and a new one
+// starts next to where the last ended. Every triangle lands in exactly one
+// meshlet.
+meshlet_set_t BuildMeshlets(
+    const vertex_t* vertices, size_t vertex_count,
+    const uint32_t* indices, size_t index_count,
+    size_t max_vertices = MESHLET_MAX_VERTICES,
+    size_t max_triangles = MESHLET_MAX_TRIANGLES
+);
+
+bool MeshletBackfacing(const meshlet_bounds_t& bounds, const float eye[3]);
@@ -0,0 +1,115 @@
+#include "ReportTools.h"
+#include "MeshWeld.h"
+#include "Meshlet.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <set>
+
+// Splits the welded room and a grid of rooms into meshlets and
+// checks them: every triangle in exactly one meshlet, the size limits,
+// bounds that hold every vertex, and cones that only cull meshlets whose
+// triangles all face away, from random eyes around each mesh. Prints the
+// meshlet size and fill, the share of meshlets culled by their cone and
+// the build throughput. Fails on any broken check.
+//   --meshlet-report [meshlets.txt] [columns] [rows]
+int MeshletReportTool(const std::vector<std::string>& args) {
+	std::vector<report_input_t> const inputs = ReportInputs(args, 16);
+	int const EYES = 64;
+
+	FILE* out = OpenReport(args, "meshlets.txt");
+	if (!out) {
+		return 1;
+	}
+	size_t failures = 0;
+	for (const report_input_t& input : inputs) {
+		indexed_mesh_t const mesh = WeldVertices(input.vertices.data(), input.vertices.size());
+		auto const start = std::chrono::steady_clock::now();
+		meshlet_set_t const set = BuildMeshlets(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size());
+		double const seconds = Seconds(start);
+
+		// Coverage and limits.
+		std::vector<uint32_t> rebuilt;
+		size_t limit_errors = 0, bounds_errors = 0;
+		double radius_sum = 0.0, vertex_sum = 0.0, triangle_sum = 0.0;
+		for (size_t m = 0; m < set.meshlets.size(); ++m) {
+			const meshlet_t& meshlet = set.meshlets[m];
+			const meshlet_bounds_t& b = set.bounds[m];
+			limit_errors += meshlet.vertex_count > MESHLET_MAX_VERTICES || meshlet.triangle_count > MESHLET_MAX_TRIANGLES ||
+				meshlet.triangle_count == 0;
+			std::set<uint32_t> const distinct(
+				set.vertices.begin() + meshlet.vertex_offset, set.vertices.begin() + meshlet.vertex_offset + meshlet.vertex_count
+			);
+			limit_errors += distinct.size() != meshlet.vertex_count;
+			for (uint32_t i = 0; i < meshlet.triangle_count * 3; ++i) {
+				uint8_t const local = set.triangles[meshlet.triangle_offset + i];
+				limit_errors += local >= meshlet.vertex_count;
+				rebuilt.push_back(local < meshlet.vertex_count ? set.vertices[meshlet.vertex_offset + local] : 0xFFFFFFFF);
+			}
+			for (uint32_t i = 0; i < meshlet.vertex_count; ++i) {
+				const float* p = mesh.vertices[set.vertices[meshlet.vertex_offset + i]].position;
+				float const d[3] = { p[0] - b.center[0], p[1] - b.center[1], p[2] - b.center[2] };
+				bounds_errors += sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) > b.radius * 1.0001f + 1e-5f;
+				for (int k = 0; k < 3; ++k) {
+					bounds_errors += p[k] < b.aabb_min[k] || p[k] > b.aabb_max[k];
+				}
+			}
+			radius_sum += b.radius;
+			vertex_sum += meshlet.vertex_count;
+			triangle_sum += meshlet.triangle_count;
+		}
+		bool const covered = SortedTriangles(rebuilt) == SortedTriangles(mesh.indices);
+
+		// Cone culling from eyes spread over the mesh bounds and around them.
+		float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (const vertex_t& v : mesh.vertices) {
+			for (int k = 0; k < 3; ++k) {
+				lo[k] = (std::min)(lo[k], v.position[k]);
+				hi[k] = (std::max)(hi[k], v.position[k]);
+			}
+		}
+		uint32_t noise = 1;
+		size_t culled = 0, cone_errors = 0;
+		for (int e = 0; e < EYES; ++e) {
+			float eye[3];
+			for (int k = 0; k < 3; ++k) {
+				noise = noise * 1664525u + 1013904223u;
+				float const extent = hi[k] - lo[k];
+				eye[k] = lo[k] - 0.25f * extent + 1.5f * extent * static_cast<float>(noise >> 8) / 16777216.0f;
+			}
+			for (size_t m = 0; m < set.meshlets.size(); ++m) {
+				if (!MeshletBackfacing(set.bounds[m], eye)) {
+					continue;
+				}
+				++culled;
+				const meshlet_t& meshlet = set.meshlets[m];
+				for (uint32_t t = 0; t < meshlet.triangle_count; ++t) {
+					const float* p[3];
+					for (int k = 0; k < 3; ++k) {
+						p[k] = mesh.vertices[set.vertices[meshlet.vertex_offset + set.triangles[meshlet.triangle_offset + t * 3 + k]]].position;
+					}
+					float const e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+					float const e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+					float const n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+					float const to_eye[3] = { eye[0] - p[0][0], eye[1] - p[0][1], eye[2] - p[0][2] };
+					float const facing = n[0] * to_eye[0] + n[1] * to_eye[1] + n[2] * to_eye[2];
+					float const scale = sqrtf((n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) *
+						(to_eye[0] * to_eye[0] + to_eye[1] * to_eye[1] + to_eye[2] * to_eye[2]));
+					cone_errors += facing > 1e-4f * scale;
+				}
+			}
+		}
+
+		size_t const count = set.meshlets.size();
+		size_t const triangle_count = mesh.indices.size() / 3;
+		fprintf(out, "%s: %zu triangles in %zu meshlets, %.1f vertices (%.0f%%) and %.1f triangles (%.0f%%) each, "
+			"average radius %.3f; %.1f%% culled by cone over %d eyes; %.2f M tris/s\n",
+			input.name, triangle_count, count, vertex_sum / count, 100.0 * vertex_sum / count / MESHLET_MAX_VERTICES,
+			triangle_sum / count, 100.0 * triangle_sum / count / MESHLET_MAX_TRIANGLES, radius_sum / count,
+			100.0 * culled / (static_cast<double>(count) * EYES), EYES, seconds > 0.0 ? triangle_count / seconds / 1e6 : 0.0);
+		fprintf(out, "%s: coverage %s, %zu limit errors, %zu bounds errors, %zu cone errors\n",
+			input.name, covered ? "exact" : "BROKEN", limit_errors, bounds_errors, cone_errors);
+		failures += !covered + limit_errors + bounds_errors + cone_errors;
+	}
+	return CloseReport(out, failures);
+}
@@ -0,0 +1,341 @@
+#include "MipGenerator.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MIPS_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+	// Kaiser filter half-width in destination texels, and window shape.
+	float const KAISER_WIDTH = 2.0f;
+	float const KAISER_ALPHA = 4.0f;
+	// Levels smaller than this are filtered on the calling thread alone.
+	size_t const MIN_PARALLEL_PIXELS = 1 << 16;
+	size_t const ROWS_PER_TASK = 16;
+	// Linear values are encoded through a table of this many steps; near
+	// black, where sRGB is steepest, one step is 0.05 of an 8-bit value.
+	int const ENCODE_TABLE_SIZE = 1 << 16;
+
+	float SrgbToLinear(float c) {
+		return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float LinearToSrgb(float c) {
+		return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+	}
+
+	uint8_t ToByte(float c) {
+		return static_cast<uint8_t>(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+
+	struct srgb_tables_t {
+		float decode[256];
+		uint8_t encode[ENCODE_TABLE_SIZE];
+
+		srgb_tables_t() {
+			for (int i = 0; i < 256; ++i) {
+				decode[i] = SrgbToLinear(i / 255.0f);
+			}
+			for (int i = 0; i < ENCODE_TABLE_SIZE; ++i) {
+				encode[i] = ToByte(LinearToSrgb(static_cast<float>(i) / (ENCODE_TABLE_SIZE - 1)));
+			}
+		}
+	};
+
+	const srgb_tables_t& SrgbTables() {
+		static srgb_tables_t const tables;
+		return tables;
+	}
+
+	float Sinc(float x) {
+		return std::abs(x) < 1e-6f ? 1.0f : std::sin(3.14159265f * x) / (3.14159265f * x);
+	}
+
+	float BesselI0(float x) {
+		// Power series; converges quickly for the arguments a window uses.
+		float sum = 1.0f, term = 1.0f;
+		for (int k = 1; k < 32 && term > sum * 1e-8f; ++k) {
+			term *= (x * 0.5f / k) * (x * 0.5f / k);
+			sum += term;
+		}
+		return sum;
+	}
+
+	// Source texels and weights for each destination texel along one axis.
+	// taps[first[d] .. first[d + 1]) belong to destination d.
+	struct filter_taps_t {
+		std::vector<uint32_t> first;
+		std::vector<uint32_t> index;
+		std::vector<float> weight;
+	};
+
+	filter_taps_t BuildTaps(uint32_t source, uint32_t dest, mip_filter_t filter) {
+		filter_taps_t taps;
+		float const ratio = static_cast<float>(source) / dest;
+		float const reach = filter == mip_filter_t::box ? 0.5f * ratio : KAISER_WIDTH * ratio;
+		std::vector<float> weights;
+		for (uint32_t d = 0; d < dest; ++d) {
+			// Source texels the footprint reaches, clamped to the edges.
+			float const center = (d + 0.5f) * ratio;
+			int const begin = static_cast<int>(std::floor(center - reach));
+			int const end = static_cast<int>(std::ceil(center + reach));
+			int const first = std::max(begin, 0);
+			int const last = std::min(end, static_cast<int>(source) - 1);
+			weights.assign(last - first + 1, 0.0f);
+			for (int s = begin; s <= end; ++s) {
+				float weight;
+				if (filter == mip_filter_t::box) {
+					// Overlap of the texel with the destination footprint.
+					weight = std::max(0.0f, std::min(center + reach, s + 1.0f) - std::max(center - reach, static_cast<float>(s)));
+				}
+				else {
+					float const x = (s + 0.5f - center) / ratio;
+					if (std::abs(x) >= KAISER_WIDTH) {
+						continue;
+					}
+					float const t = x / KAISER_WIDTH;
+					weight = Sinc(x) * BesselI0(KAISER_ALPHA * std::sqrt(1.0f - t * t)) / BesselI0(KAISER_ALPHA);
+				}
+				weights[std::clamp(s, first, last) - first] += weight;
+			}
+
+			float total = 0.0f;
+			for (float w : weights) {
+				total += w;
+			}
+			taps.first.push_back(static_cast<uint32_t>(taps.index.size()));
+			for (int s = first; s <= last; ++s) {
+				if (weights[s - first] != 0.0f) {
+					taps.index.push_back(static_cast<uint32_t>(s));
+					taps.weight.push_back(weights[s - first] / total);
+				}
+			}
+		}
+		taps.first.push_back(static_cast<uint32_t>(taps.index.size()));
+		return taps;
+	}
+
+	mip_chain_t AllocateChain(uint32_t width, uint32_t height) {
+		if (width == 0 || height == 0) {
+			throw std::runtime_error("GenerateMipChain: empty image");
+		}
+		mip_chain_t chain;
+		size_t offset = 0;
+		for (uint32_t level = 0, count = MipLevelCount(width, height); level < count; ++level) {
+			chain.levels.push_back({ width, height, offset });
+			offset += static_cast<size_t>(width) * height * 4;
+			width = std::max(1u, width / 2);
+			height = std::max(1u, height / 2);
+		}
+		chain.pixels.resize(offset);
+		return chain;
+	}
+
+	void CopyLevel0(mip_chain_t& chain, const uint8_t* rgba, size_t pitch) {
+		const mip_level_t& level = chain.levels[0];
+		for (uint32_t y = 0; y < level.height; ++y) {
+			memcpy(chain.pixels.data() + static_cast<size_t>(y) * level.width * 4, rgba + y * pitch, level.width * 4);
+		}
+	}
+
+	// Runs task(first, end) over bands of rows [0, count), on one thread for
+	// small levels.
+	template <typename Task>
+	void ForBands(uint32_t count, size_t pixels, unsigned thread_count, const Task& task) {
+		size_t const bands = (count + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+		ParallelFor(bands, pixels < MIN_PARALLEL_PIXELS ? 1 : thread_count, [&](size_t band) {
+			uint32_t const first = static_cast<uint32_t>(band * ROWS_PER_TASK);
+			task(first, static_cast<uint32_t>(std::min<size_t>(count, first + ROWS_PER_TASK)));
+		});
+	}
+
+	void DecodeRow(const srgb_tables_t& tables, const uint8_t* in, uint32_t width, float* out) {
+		for (uint32_t x = 0; x < width; ++x, in += 4, out += 4) {
+			out[0] = tables.decode[in[0]];
+			out[1] = tables.decode[in[1]];
+			out[2] = tables.decode[in[2]];
+			out[3] = in[3] * (1.0f / 255.0f);
+		}
+	}
+
+	// One texel is one SSE register, so filtering is a multiply-add per tap.
+	void FilterRow(const float* in, const filter_taps_t& taps, uint32_t width, bool halving, float* out) {
+#ifdef MIPS_USE_SSE
+		if (halving) {
+			__m128 const half = _mm_set1_ps(0.5f);
+			for (uint32_t x = 0; x < width; ++x) {
+				_mm_storeu_ps(out + 4 * x, _mm_mul_ps(half, _mm_add_ps(_mm_loadu_ps(in + 8 * x), _mm_loadu_ps(in + 8 * x + 4))));
+			}
+			return;
+		}
+		for (uint32_t x = 0; x < width; ++x) {
+			__m128 sum = _mm_setzero_ps();
+			for (uint32_t t = taps.first[x]; t < taps.first[x + 1]; ++t) {
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(taps.weight[t]), _mm_loadu_ps(in + 4 * taps.index[t])));
+			}
+			_mm_storeu_ps(out + 4 * x, sum);
+		}
+#else
+		(void)halving;
+		for (uint32_t x = 0; x < width; ++x) {
+			float sum[4] = {};
+			for (uint32_t t = taps.first[x]; t < taps.first[x + 1]; ++t) {
+				for (int c = 0; c < 4; ++c) {
+					sum[c] += taps.weight[t] * in[4 * taps.index[t] + c];
+				}
+			}
+			std::copy(sum, sum + 4, out + 4 * x);
+		}
+#endif
+	}
+
+	void AccumulateRow(const float* in, float weight, size_t floats, float* out) {
+#ifdef MIPS_USE_SSE
+		__m128 const w = _mm_set1_ps(weight);
+		for (size_t i = 0; i < floats; i += 4) {
+			_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(w, _mm_loadu_ps(in + i))));
+		}
+#else
+		for (size_t i = 0; i < floats; ++i) {
+			out[i] += weight * in[i];
+		}
+#endif
+	}
+
+	// Negative lobes of the Kaiser filter and rounding can leave [0, 1].
+	void EncodeRow(const srgb_tables_t& tables, const float* in, uint32_t width, uint8_t* out) {
+#ifdef MIPS_USE_SSE
+		__m128 const zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+		__m128 const scale = _mm_setr_ps(ENCODE_TABLE_SIZE - 1.0f, ENCODE_TABLE_SIZE - 1.0f, ENCODE_TABLE_SIZE - 1.0f, 255.0f);
+		for (uint32_t x = 0; x < width; ++x) {
+			__m128 const v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + 4 * x), zero), one);
+			alignas(16) int32_t q[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(q), _mm_cvtps_epi32(_mm_mul_ps(v, scale)));
+			out[4 * x + 0] = tables.encode[q[0]];
+			out[4 * x + 1] = tables.encode[q[1]];
+			out[4 * x + 2] = tables.encode[q[2]];
+			out[4 * x + 3] = static_cast<uint8_t>(q[3]);
+		}
+#else
+		for (uint32_t x = 0; x < width; ++x) {
+			for (int c = 0; c < 3; ++c) {
+				float const v = std::clamp(in[4 * x + c], 0.0f, 1.0f);
+				out[4 * x + c] = tables.encode[static_cast<int>(v * (ENCODE_TABLE_SIZE - 1) + 0.5f)];
+			}
+			out[4 * x + 3] = ToByte(in[4 * x + 3]);
+		}
+#endif
+	}
+}
+
+uint32_t MipLevelCount(uint32_t width, uint32_t height) {
+	uint32_t levels = 1;
+	for (uint32_t size = std::max(width, height); size > 1; size /= 2) {
+		++levels;
+	}
+	return levels;
+}
+
+mip_chain_t GenerateMipChain(
+	const uint8_t* rgba, uint32_t width, uint32_t height, size_t pitch, mip_filter_t filter, unsigned thread_count
+) {
+	thread_count = ResolveThreadCount(thread_count);
+	mip_chain_t chain = AllocateChain(width, height);
+	CopyLevel0(chain, rgba, pitch);
+	const srgb_tables_t& tables = SrgbTables();
+
+	// Linear RGBA, four floats per texel, of the level being filtered from;
+	// level 0 is decoded a row at a time as it is read. Each band of
+	// destination rows filters the source rows it needs horizontally into a
+	// small buffer and combines those vertically, so the intermediate image
+	// never leaves the cache.
+	std::vector<float> source, dest;
+	for (size_t l = 1; l < chain.levels.size(); ++l) {
+		uint32_t const sw = chain.levels[l - 1].width, sh = chain.levels[l - 1].height;
+		uint32_t const dw = chain.levels[l].width, dh = chain.levels[l].height;
+		filter_taps_t const taps_x = BuildTaps(sw, dw, filter);
+		filter_taps_t const taps_y = BuildTaps(sh, dh, filter);
+		bool const halving = filter == mip_filter_t::box && sw == 2 * dw;
+		size_t const floats = static_cast<size_t>(dw) * 4;
+		dest.resize(floats * dh);
+		uint8_t* level_pixels = chain.pixels.data() + chain.levels[l].offset;
+
+		ForBands(dh, static_cast<size_t>(sw) * sh, thread_count, [&](uint32_t first, uint32_t end) {
+			thread_local std::vector<float> decoded, rows;
+			// Taps are in ascending source order, so the band reads one range.
+			uint32_t const lo = taps_y.index[taps_y.first[first]];
+			uint32_t const hi = taps_y.index[taps_y.first[end] - 1];
+			rows.resize(floats * (hi - lo + 1));
+			for (uint32_t y = lo; y <= hi; ++y) {
+				const float* in = source.data() + static_cast<size_t>(y) * sw * 4;
+				if (l == 1) {
+					decoded.resize(static_cast<size_t>(sw) * 4);
+					DecodeRow(tables, rgba + y * pitch, sw, decoded.data());
+					in = decoded.data();
+				}
+				FilterRow(in, taps_x, dw, halving, rows.data() + (y - lo) * floats);
+			}
+
+			for (uint32_t y = first; y < end; ++y) {
+				float* out = dest.data() + y * floats;
+				std::fill(out, out + floats, 0.0f);
+				for (uint32_t t = taps_y.first[y]; t < taps_y.first[y + 1]; ++t) {
+					AccumulateRow(rows.data() + (taps_y.index[t] - lo) * floats, taps_y.weight[t], floats, out);
+				}
+				EncodeRow(tables, out, dw, level_pixels + y * floats);
+			}
+		});
+		source.swap(dest);
+	}
+	return chain;
+}
+
+mip_chain_t GenerateMipChainReference(
+	const uint8_t* rgba, uint32_t width, uint32_t height, size_t pitch, mip_filter_t filter
+) {
+	mip_chain_t chain = AllocateChain(width, height);
+	CopyLevel0(chain, rgba, pitch);
+
+	std::vector<double> source(static_cast<size_t>(width) * height * 4);
+	for (uint32_t y = 0; y < height; ++y) {
+		for (uint32_t x = 0; x < width; ++x) {
+			for (int c = 0; c < 4; ++c) {
+				float const v = rgba[y * pitch + 4 * x + c] / 255.0f;
+				source[(static_cast<size_t>(y) * width + x) * 4 + c] = c < 3 ? SrgbToLinear(v) : v;
+			}
+		}
+	}
+
+	for (size_t l = 1; l < chain.levels.size(); ++l) {
+		uint32_t const sw = chain.levels[l - 1].width, sh = chain.levels[l - 1].height;
+		uint32_t const dw = chain.levels[l].width, dh = chain.levels[l].height;
+		filter_taps_t const taps_x = BuildTaps(sw, dw, filter);
+		filter_taps_t const taps_y = BuildTaps(sh, dh, filter);
+		std::vector<double> dest(static_cast<size_t>(dw) * dh * 4);
+		uint8_t* pixels = chain.pixels.data() + chain.levels[l].offset;
+		for (uint32_t y = 0; y < dh; ++y) {
+			for (uint32_t x = 0; x < dw; ++x) {
+				for (int c = 0; c < 4; ++c) {
+					double sum = 0.0;
+					for (uint32_t ty = taps_y.first[y]; ty < taps_y.first[y + 1]; ++ty) {
+						for (uint32_t tx = taps_x.first[x]; tx < taps_x.first[x + 1]; ++tx) {
+							size_t const s = (static_cast<size_t>(taps_y.index[ty]) * sw + taps_x.index[tx]) * 4 + c;
+							sum += static_cast<double>(taps_y.weight[ty]) * taps_x.weight[tx] * source[s];
+						}
+					}
+					size_t const d = (static_cast<size_t>(y) * dw + x) * 4 + c;
+					dest[d] = sum;
+					float const v = std::clamp(static_cast<float>(sum), 0.0f, 1.0f);
+					pixels[d] = ToByte(c < 3 ? LinearToSrgb(v) : v);
+				}
+			}
+		}
+		source.swap(dest);
+	}
+	return chain;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class mip_filter_t {
+    box,                        // area average; exact 2x2 on even sizes
+    kaiser,                     // Kaiser-windowed sinc, sharper at a distance
+};
+
+struct mip_level_t {
+    uint32_t width;
+    uint32_t height;
+    size_t offset;              // of the level's first row in mip_chain_t::pixels
+};
+
+// RGBA8 levels, largest first, each with tightly packed rows of width * 4
+// bytes. Level 0 is a copy of the source.
+struct mip_chain_t {
+    std::vector<mip_level_t> levels;
+    std::vector<uint8_t> pixels;
+};
+
+// Levels in a full chain down to 1x1, as D3D12 counts them.
+uint32_t MipLevelCount(uint32_t width, uint32_t height);
+
+// Builds the full chain of an RGBA8 image whose rows are pitch bytes apart.
+// Every level halves each side, rounding down, and is filtered from the
+// float result of the previous level, so rounding does not accumulate.
+// Color channels are sRGB encoded and filtered in linear light; alpha is
+// filtered as stored. Edges clamp. Each level is split across thread_count
+// threads (0: every hardware thread) and vectorized with SSE where
+// available.
+mip_chain_t GenerateMipChain(
+    const uint8_t* rgba, uint32_t width, uint32_t height, size_t pitch,
+    mip_filter_t filter = mip_filter_t::box, unsigned thread_count = 0
+);
+
+// Same filter one channel at a time with exact sRGB conversions; what the
+// fast path is checked against. Levels differ by at most one step.
+mip_chain_t GenerateMipChainReference(
+    const uint8_t* rgba, uint32_t width, uint32_t height, size_t pitch,
+    mip_filter_t filter = mip_filter_t::box
+);
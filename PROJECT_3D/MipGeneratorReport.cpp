@@ -0,0 +1,65 @@
+#include "ReportTools.h"
+#include "MipGenerator.h"
+#include <algorithm>
+#include <cmath>
+
+// Times mip chain generation on a synthetic image and compares every
+// level against the scalar reference.
+//   --mip-report [mips.txt] [width] [height]
+int MipReportTool(const std::vector<std::string>& args) {
+	uint32_t const width = args.size() > 2 ? static_cast<uint32_t>(std::stoul(args[2])) : 2048;
+	uint32_t const height = args.size() > 3 ? static_cast<uint32_t>(std::stoul(args[3])) : width;
+	if (width == 0 || height == 0) {
+		return 1;
+	}
+
+	// Fine checkers over smooth gradients and noise: the detail a wrong
+	// filter or gamma shows up in.
+	std::vector<uint8_t> image(static_cast<size_t>(width) * height * 4);
+	uint32_t noise = 1;
+	for (uint32_t y = 0; y < height; ++y) {
+		for (uint32_t x = 0; x < width; ++x) {
+			noise = noise * 1664525u + 1013904223u;
+			uint8_t* p = &image[(static_cast<size_t>(y) * width + x) * 4];
+			bool const check = ((x ^ y) & 1) != 0;
+			p[0] = check ? 255 : 0;
+			p[1] = static_cast<uint8_t>(x * 255 / width);
+			p[2] = static_cast<uint8_t>(noise >> 24);
+			p[3] = static_cast<uint8_t>(y * 255 / height);
+		}
+	}
+
+	FILE* out = OpenReport(args, "mips.txt");
+	if (!out) {
+		return 1;
+	}
+	fprintf(out, "%ux%u, %u levels\n", width, height, MipLevelCount(width, height));
+	int max_error = 0;
+	for (mip_filter_t filter : { mip_filter_t::box, mip_filter_t::kaiser }) {
+		// Best of three runs, so the first one's table setup and page
+		// faults are not counted.
+		mip_chain_t chain;
+		double seconds[2] = { 1e30, 1e30 };
+		unsigned const threads[2] = { 1, 0 };
+		for (int run = 0; run < 6; ++run) {
+			auto const start = std::chrono::steady_clock::now();
+			chain = GenerateMipChain(image.data(), width, height, width * 4, filter, threads[run % 2]);
+			double const elapsed = Seconds(start);
+			seconds[run % 2] = (std::min)(seconds[run % 2], elapsed);
+		}
+		mip_chain_t const reference = GenerateMipChainReference(image.data(), width, height, width * 4, filter);
+		int filter_error = 0;
+		size_t differing = 0;
+		for (size_t i = 0; i < chain.pixels.size(); ++i) {
+			int const error = std::abs(chain.pixels[i] - reference.pixels[i]);
+			filter_error = (std::max)(filter_error, error);
+			differing += error != 0;
+		}
+		max_error = (std::max)(max_error, filter_error);
+		double const megapixels = static_cast<double>(width) * height / 1e6;
+		fprintf(out, "%s: %.0f MP/s on 1 thread, %.0f MP/s on all; max error %d, %zu of %zu values differ\n",
+			filter == mip_filter_t::box ? "box" : "kaiser", megapixels / seconds[0], megapixels / seconds[1],
+			filter_error, differing, chain.pixels.size());
+	}
+	return CloseReport(out, max_error <= 1 ? 0 : 1);
+}
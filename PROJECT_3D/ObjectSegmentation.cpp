@@ -0,0 +1,136 @@
+#include "ObjectSegmentation.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+	uint32_t Find(std::vector<uint32_t>& parent, uint32_t x) {
+		while (parent[x] != x) {
+			parent[x] = parent[parent[x]];
+			x = parent[x];
+		}
+		return x;
+	}
+
+	void Union(std::vector<uint32_t>& parent, uint32_t a, uint32_t b) {
+		a = Find(parent, a);
+		b = Find(parent, b);
+		if (a != b) {
+			parent[std::max(a, b)] = std::min(a, b);
+		}
+	}
+
+	// Ids shared by all vertices with bitwise equal positions (-0 == 0).
+	std::vector<uint32_t> PositionIds(const vertex_t* vertices, size_t vertex_count) {
+		std::vector<uint32_t> order(vertex_count);
+		std::vector<uint32_t> keys(vertex_count * 3);
+		for (size_t v = 0; v < vertex_count; ++v) {
+			order[v] = static_cast<uint32_t>(v);
+			memcpy(&keys[v * 3], vertices[v].position, 3 * sizeof(uint32_t));
+			for (int k = 0; k < 3; ++k) {
+				if (keys[v * 3 + k] == 0x80000000u) {
+					keys[v * 3 + k] = 0;
+				}
+			}
+		}
+		auto less = [&](uint32_t a, uint32_t b) {
+			return std::lexicographical_compare(&keys[a * 3], &keys[a * 3 + 3], &keys[b * 3], &keys[b * 3 + 3]);
+		};
+		std::sort(order.begin(), order.end(), less);
+
+		std::vector<uint32_t> ids(vertex_count);
+		uint32_t id = 0;
+		for (size_t i = 0; i < vertex_count; ++i) {
+			if (i > 0 && less(order[i - 1], order[i])) {
+				++id;
+			}
+			ids[order[i]] = id;
+		}
+		return ids;
+	}
+}
+
+std::vector<scene_object_t> SegmentObjects(
+	const vertex_t* vertices, size_t vertex_count,
+	std::vector<uint32_t>& indices, float uv_region_size
+) {
+	size_t const tri_count = indices.size() / 3;
+	std::vector<uint32_t> const position_id = PositionIds(vertices, vertex_count);
+
+	std::vector<uint32_t> parent(vertex_count);
+	for (size_t i = 0; i < vertex_count; ++i) {
+		parent[i] = static_cast<uint32_t>(i);
+	}
+	for (size_t t = 0; t < tri_count; ++t) {
+		uint32_t const a = position_id[indices[t * 3 + 0]];
+		Union(parent, a, position_id[indices[t * 3 + 1]]);
+		Union(parent, a, position_id[indices[t * 3 + 2]]);
+	}
+
+	// Object key: component root, plus the UV cell when requested. Objects
+	// are numbered in order of first appearance.
+	std::unordered_map<uint64_t, uint32_t> object_of_key;
+	std::vector<uint32_t> tri_object(tri_count);
+	std::vector<uint32_t> object_tris;
+	for (size_t t = 0; t < tri_count; ++t) {
+		uint64_t key = Find(parent, position_id[indices[t * 3]]);
+		if (uv_region_size > 0.0f) {
+			float u = 0.0f, v = 0.0f;
+			for (int k = 0; k < 3; ++k) {
+				u += vertices[indices[t * 3 + k]].tex_coord[0] / 3.0f;
+				v += vertices[indices[t * 3 + k]].tex_coord[1] / 3.0f;
+			}
+			uint64_t const cell_u = static_cast<uint16_t>(static_cast<int32_t>(floorf(u / uv_region_size)));
+			uint64_t const cell_v = static_cast<uint16_t>(static_cast<int32_t>(floorf(v / uv_region_size)));
+			key |= (cell_u << 32) | (cell_v << 48);
+		}
+		auto it = object_of_key.emplace(key, static_cast<uint32_t>(object_tris.size())).first;
+		if (it->second == object_tris.size()) {
+			object_tris.push_back(0);
+		}
+		tri_object[t] = it->second;
+		++object_tris[it->second];
+	}
+
+	std::vector<scene_object_t> objects(object_tris.size());
+	uint32_t first = 0;
+	for (size_t o = 0; o < objects.size(); ++o) {
+		objects[o].first_index = first;
+		objects[o].index_count = 0;
+		for (int k = 0; k < 3; ++k) {
+			objects[o].aabb_min[k] = FLT_MAX;
+			objects[o].aabb_max[k] = -FLT_MAX;
+		}
+		first += object_tris[o] * 3;
+	}
+
+	// Stable counting sort of triangles by object.
+	std::vector<uint32_t> sorted(tri_count * 3);
+	for (size_t t = 0; t < tri_count; ++t) {
+		scene_object_t& o = objects[tri_object[t]];
+		for (int k = 0; k < 3; ++k) {
+			uint32_t const v = indices[t * 3 + k];
+			sorted[o.first_index + o.index_count++] = v;
+			for (int c = 0; c < 3; ++c) {
+				o.aabb_min[c] = std::min(o.aabb_min[c], vertices[v].position[c]);
+				o.aabb_max[c] = std::max(o.aabb_max[c], vertices[v].position[c]);
+			}
+		}
+	}
+	indices.swap(sorted);
+	return objects;
+}
+
+void DumpObjects(FILE* out, const scene_object_t* objects, size_t count) {
+	fprintf(out, "%zu objects\n", count);
+	fprintf(out, "%6s %10s %10s  %s\n", "id", "first", "triangles", "bounds");
+	for (size_t i = 0; i < count; ++i) {
+		const scene_object_t& o = objects[i];
+		fprintf(out, "%6zu %10u %10u  (%.3f, %.3f, %.3f) - (%.3f, %.3f, %.3f)\n",
+			i, o.first_index, o.index_count / 3,
+			o.aabb_min[0], o.aabb_min[1], o.aabb_min[2],
+			o.aabb_max[0], o.aabb_max[1], o.aabb_max[2]);
+	}
+}
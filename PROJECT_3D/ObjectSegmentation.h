@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Vertex.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+struct scene_object_t {
+    float aabb_min[3];
+    float aabb_max[3];
+    uint32_t first_index;
+    uint32_t index_count;
+};
+
+// Splits an indexed triangle list into objects: connected components of
+// triangles that share a vertex position. With uv_region_size > 0 each
+// component is split further by the atlas cell its triangles sample from.
+// indices is reordered so every object is one contiguous range; triangle
+// order inside an object is preserved.
+std::vector<scene_object_t> SegmentObjects(
+    const vertex_t* vertices, size_t vertex_count,
+    std::vector<uint32_t>& indices, float uv_region_size = 0.0f
+);
+
+// Writes one line per object with its draw range and bounds.
+void DumpObjects(FILE* out, const scene_object_t* objects, size_t count);
@@ -0,0 +1,144 @@
+#include "ReportTools.h"
+#include "MeshWeld.h"
+#include "ObjectSegmentation.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <map>
+
+// Segments the welded room and a grid of rooms into objects,
+// by shared positions alone and split by atlas cell, and checks the
+// objects against components found independently by a flood fill over
+// the triangles: one object per component and cell, contiguous ranges
+// that keep the triangle order, and tight bounds. Fails on any broken
+// check.
+//   --segment-report [segments.txt] [columns] [rows]
+int SegmentReportTool(const std::vector<std::string>& args) {
+	std::vector<report_input_t> const inputs = ReportInputs(args, 8);
+
+	FILE* out = OpenReport(args, "segments.txt");
+	if (!out) {
+		return 1;
+	}
+	size_t failures = 0;
+	for (const report_input_t& input : inputs) {
+		indexed_mesh_t const mesh = WeldVertices(input.vertices.data(), input.vertices.size());
+		size_t const triangle_count = mesh.indices.size() / 3;
+
+		// Reference components: flood fill over triangles sharing a
+		// position, -0 and 0 alike.
+		std::map<std::array<float, 3>, std::vector<uint32_t>> triangles_at;
+		for (size_t t = 0; t < triangle_count; ++t) {
+			for (int k = 0; k < 3; ++k) {
+				const float* p = mesh.vertices[mesh.indices[t * 3 + k]].position;
+				triangles_at[{ p[0] + 0.0f, p[1] + 0.0f, p[2] + 0.0f }].push_back(static_cast<uint32_t>(t));
+			}
+		}
+		std::vector<uint32_t> component(triangle_count, UINT32_MAX);
+		uint32_t component_count = 0;
+		for (size_t seed = 0; seed < triangle_count; ++seed) {
+			if (component[seed] != UINT32_MAX) {
+				continue;
+			}
+			std::vector<uint32_t> open = { static_cast<uint32_t>(seed) };
+			component[seed] = component_count;
+			while (!open.empty()) {
+				uint32_t const t = open.back();
+				open.pop_back();
+				for (int k = 0; k < 3; ++k) {
+					const float* p = mesh.vertices[mesh.indices[t * 3 + k]].position;
+					for (uint32_t n : triangles_at[{ p[0] + 0.0f, p[1] + 0.0f, p[2] + 0.0f }]) {
+						if (component[n] == UINT32_MAX) {
+							component[n] = component_count;
+							open.push_back(n);
+						}
+					}
+				}
+			}
+			++component_count;
+		}
+
+		for (float uv_region_size : { 0.0f, 0.25f }) {
+			std::vector<uint32_t> indices = mesh.indices;
+			auto const start = std::chrono::steady_clock::now();
+			std::vector<scene_object_t> const objects = SegmentObjects(mesh.vertices.data(), mesh.vertices.size(), indices, uv_region_size);
+			double const seconds = Seconds(start);
+
+			// Ranges and bounds.
+			size_t range_errors = 0, bounds_errors = 0;
+			uint32_t next = 0;
+			for (const scene_object_t& o : objects) {
+				range_errors += o.first_index != next || o.index_count == 0 || o.index_count % 3 != 0;
+				next = o.first_index + o.index_count;
+				if (next > indices.size()) {
+					break;
+				}
+				float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+				for (uint32_t i = o.first_index; i < next; ++i) {
+					for (int k = 0; k < 3; ++k) {
+						lo[k] = (std::min)(lo[k], mesh.vertices[indices[i]].position[k]);
+						hi[k] = (std::max)(hi[k], mesh.vertices[indices[i]].position[k]);
+					}
+				}
+				for (int k = 0; k < 3; ++k) {
+					bounds_errors += lo[k] != o.aabb_min[k] || hi[k] != o.aabb_max[k];
+				}
+			}
+			range_errors += next != indices.size();
+
+			// Every source triangle, in order, is the next one of the
+			// object its component and cell map to, and no two keys
+			// share an object.
+			size_t partition_errors = 0;
+			std::map<uint64_t, size_t> object_of_key;
+			std::vector<uint32_t> cursor(objects.size());
+			for (size_t o = 0; o < objects.size(); ++o) {
+				cursor[o] = objects[o].first_index;
+			}
+			std::map<std::array<uint32_t, 3>, std::vector<size_t>> objects_starting_with;
+			for (size_t o = objects.size(); o-- > 0 && range_errors == 0;) {
+				const uint32_t* first = &indices[objects[o].first_index];
+				objects_starting_with[{ first[0], first[1], first[2] }].push_back(o);
+			}
+			for (size_t t = 0; t < triangle_count && range_errors == 0; ++t) {
+				uint64_t key = component[t];
+				if (uv_region_size > 0.0f) {
+					float u = 0.0f, v = 0.0f;
+					for (int k = 0; k < 3; ++k) {
+						u += mesh.vertices[mesh.indices[t * 3 + k]].tex_coord[0] / 3.0f;
+						v += mesh.vertices[mesh.indices[t * 3 + k]].tex_coord[1] / 3.0f;
+					}
+					key |= static_cast<uint64_t>(static_cast<uint16_t>(static_cast<int32_t>(floorf(u / uv_region_size)))) << 32 |
+						static_cast<uint64_t>(static_cast<uint16_t>(static_cast<int32_t>(floorf(v / uv_region_size)))) << 48;
+				}
+				// The object holding the triangle's slot in the output.
+				auto it = object_of_key.find(key);
+				if (it == object_of_key.end()) {
+					std::vector<size_t>& candidates = objects_starting_with[{ mesh.indices[t * 3], mesh.indices[t * 3 + 1], mesh.indices[t * 3 + 2] }];
+					if (candidates.empty()) {
+						++partition_errors;
+						continue;
+					}
+					it = object_of_key.emplace(key, candidates.back()).first;
+					candidates.pop_back();
+				}
+				size_t const o = it->second;
+				if (cursor[o] >= objects[o].first_index + objects[o].index_count ||
+					!std::equal(&mesh.indices[t * 3], &mesh.indices[t * 3 + 3], &indices[cursor[o]])) {
+					++partition_errors;
+					continue;
+				}
+				cursor[o] += 3;
+			}
+			partition_errors += object_of_key.size() != objects.size();
+
+			fprintf(out, "%s, %s: %zu triangles, %u components, %zu objects, %.2f M tris/s\n",
+				input.name, uv_region_size > 0.0f ? "by atlas cell" : "by position", triangle_count, component_count,
+				objects.size(), seconds > 0.0 ? triangle_count / seconds / 1e6 : 0.0);
+			fprintf(out, "%s, %s: %zu range errors, %zu bounds errors, %zu partition errors\n",
+				input.name, uv_region_size > 0.0f ? "by atlas cell" : "by position", range_errors, bounds_errors, partition_errors);
+			failures += range_errors + bounds_errors + partition_errors;
+		}
+	}
+	return CloseReport(out, failures);
+}
@@ -0,0 +1,303 @@
+#include "OcclusionCulling.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define OCCLUSION_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+	// Clip w below which a vertex is treated as crossing the near plane.
+	float const MIN_CLIP_W = 1e-4f;
+
+	// Relative distance of a neighbour's far vertex from a triangle's plane
+	// below which the two count as one flat surface.
+	float const COPLANAR_TOLERANCE = 1e-5f;
+
+	struct edge_t {
+		float a[3];
+		float b[3];
+		uint32_t triangle;
+		int opposite;           // vertex of the triangle not on the edge
+	};
+
+	bool PositionLess(const float* a, const float* b) {
+		return std::lexicographical_compare(a, a + 3, b, b + 3);
+	}
+
+	bool SameEdge(const edge_t& e, const edge_t& f) {
+		return std::equal(e.a, e.a + 3, f.a) && std::equal(e.b, e.b + 3, f.b);
+	}
+
+	void Normal(const float* p0, const float* p1, const float* p2, float* n) {
+		float const e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+		float const e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+		n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+	}
+}
+
+OcclusionBuffer::OcclusionBuffer(int width, int height) {
+	m_tilesX = std::max(1, (width + TILE_WIDTH - 1) / TILE_WIDTH);
+	m_tilesY = std::max(1, (height + TILE_HEIGHT - 1) / TILE_HEIGHT);
+	m_width = m_tilesX * TILE_WIDTH;
+	m_height = m_tilesY * TILE_HEIGHT;
+	m_depth.assign(static_cast<size_t>(m_width) * m_height, 1.0f);
+	m_tileMax.assign(static_cast<size_t>(m_tilesX) * m_tilesY, 1.0f);
+	std::fill(m_viewProj, m_viewProj + 16, 0.0f);
+}
+
+void OcclusionBuffer::Begin(const float view_proj[16]) {
+	std::copy(view_proj, view_proj + 16, m_viewProj);
+	std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+	std::fill(m_tileMax.begin(), m_tileMax.end(), 1.0f);
+}
+
+void OcclusionBuffer::Transform(const float* p, float* clip) const {
+	for (int j = 0; j < 4; ++j) {
+		clip[j] = p[0] * m_viewProj[j] + p[1] * m_viewProj[4 + j] + p[2] * m_viewProj[8 + j] + m_viewProj[12 + j];
+	}
+}
+
+std::vector<uint8_t> OccluderOutline(const float* positions, const uint32_t* indices, size_t index_count) {
+	// Edges shared by two coplanar triangles facing the same way are inside
+	// a flat surface; every other edge is on the outline.
+	size_t const triangle_count = index_count / 3;
+	std::vector<uint8_t> outline(triangle_count, 7);
+	std::vector<edge_t> edges;
+	edges.reserve(triangle_count * 3);
+	for (size_t t = 0; t < triangle_count; ++t) {
+		for (int k = 0; k < 3; ++k) {
+			const float* a = positions + 3 * static_cast<size_t>(indices[t * 3 + (k + 1) % 3]);
+			const float* b = positions + 3 * static_cast<size_t>(indices[t * 3 + (k + 2) % 3]);
+			if (PositionLess(b, a)) {
+				std::swap(a, b);
+			}
+			edge_t e = { { a[0], a[1], a[2] }, { b[0], b[1], b[2] }, static_cast<uint32_t>(t), k };
+			edges.push_back(e);
+		}
+	}
+	std::sort(edges.begin(), edges.end(), [](const edge_t& e, const edge_t& f) {
+		return PositionLess(e.a, f.a) || (std::equal(e.a, e.a + 3, f.a) && PositionLess(e.b, f.b));
+	});
+	for (size_t i = 0; i + 1 < edges.size(); ++i) {
+		const edge_t& e = edges[i];
+		const edge_t& f = edges[i + 1];
+		// An edge of three or more triangles stays on the outline.
+		if (!SameEdge(e, f) || (i + 2 < edges.size() && SameEdge(f, edges[i + 2])) || (i > 0 && SameEdge(edges[i - 1], e))) {
+			continue;
+		}
+		const uint32_t* te = indices + e.triangle * 3;
+		const uint32_t* tf = indices + f.triangle * 3;
+		float n[3], m[3];
+		Normal(positions + 3 * static_cast<size_t>(te[0]), positions + 3 * static_cast<size_t>(te[1]), positions + 3 * static_cast<size_t>(te[2]), n);
+		Normal(positions + 3 * static_cast<size_t>(tf[0]), positions + 3 * static_cast<size_t>(tf[1]), positions + 3 * static_cast<size_t>(tf[2]), m);
+		const float* far = positions + 3 * static_cast<size_t>(tf[f.opposite]);
+		float const d[3] = { far[0] - e.a[0], far[1] - e.a[1], far[2] - e.a[2] };
+		float const n_length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		float const d_length = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+		if (n[0] * m[0] + n[1] * m[1] + n[2] * m[2] > 0.0f &&
+			fabsf(n[0] * d[0] + n[1] * d[1] + n[2] * d[2]) <= COPLANAR_TOLERANCE * n_length * d_length) {
+			outline[e.triangle] &= ~(1u << e.opposite);
+			outline[f.triangle] &= ~(1u << f.opposite);
+		}
+	}
+	return outline;
+}
+
+void OcclusionBuffer::RasterizeOccluders(
+	const float* positions, const uint32_t* indices, size_t index_count, const float* world, const uint8_t* outline
+) {
+	for (size_t i = 0; i + 2 < index_count; i += 3) {
+		float clip[3][4];
+		bool behind = false;
+		for (int k = 0; k < 3; ++k) {
+			const float* p = positions + 3 * static_cast<size_t>(indices[i + k]);
+			float placed[3];
+			if (world) {
+				for (int j = 0; j < 3; ++j) {
+					placed[j] = p[0] * world[j] + p[1] * world[3 + j] + p[2] * world[6 + j] + world[9 + j];
+				}
+				p = placed;
+			}
+			Transform(p, clip[k]);
+			behind |= !(clip[k][3] > MIN_CLIP_W);
+		}
+		// Skipping an occluder is always safe; clipping it is not worth it
+		// at this resolution.
+		if (behind) {
+			continue;
+		}
+		float screen[3][3];
+		for (int k = 0; k < 3; ++k) {
+			float const inv_w = 1.0f / clip[k][3];
+			screen[k][0] = (clip[k][0] * inv_w * 0.5f + 0.5f) * m_width;
+			screen[k][1] = (0.5f - clip[k][1] * inv_w * 0.5f) * m_height;
+			screen[k][2] = clip[k][2] * inv_w;
+		}
+		RasterizeTriangle(screen[0], screen[1], screen[2], outline ? outline[i / 3] : 7u);
+	}
+}
+
+void OcclusionBuffer::RasterizeTriangle(const float* v0, const float* v1, const float* v2, unsigned outline) {
+	// Clockwise in y-down screen space is front facing, as in the PSO.
+	float const area = (v1[0] - v0[0]) * (v2[1] - v0[1]) - (v1[1] - v0[1]) * (v2[0] - v0[0]);
+	if (!(area > 0.0f)) {
+		return;
+	}
+	// Any occluder depth beyond the far plane cannot hide anything.
+	if (v0[2] > 1.0f && v1[2] > 1.0f && v2[2] > 1.0f) {
+		return;
+	}
+
+	int const x_begin = std::max(0, static_cast<int>(floorf(std::min({ v0[0], v1[0], v2[0] }))) & ~3);
+	int const x_end = std::min(m_width, static_cast<int>(ceilf(std::max({ v0[0], v1[0], v2[0] }))) + 1);
+	int const y_begin = std::max(0, static_cast<int>(floorf(std::min({ v0[1], v1[1], v2[1] }))));
+	int const y_end = std::min(m_height, static_cast<int>(ceilf(std::max({ v0[1], v1[1], v2[1] }))) + 1);
+	if (x_begin >= x_end || y_begin >= y_end) {
+		return;
+	}
+
+	// Edge k is opposite vertex k, positive inside. It is evaluated from
+	// its lexicographically smaller endpoint, so the two triangles sharing
+	// an edge compute identical values of opposite sign and leave no cracks.
+	// Outline edges are tested at the pixel's outermost corner instead of
+	// its center: a pixel only partly covered there, e.g. by a wall next to
+	// a gap narrower than a pixel, must not hide what shows through.
+	const float* const v[3] = { v0, v1, v2 };
+	float edge_x[3], edge_y[3], edge_dx[3], edge_dy[3], edge_sign[3], edge_min[3];
+	for (int k = 0; k < 3; ++k) {
+		const float* p = v[(k + 1) % 3];
+		const float* q = v[(k + 2) % 3];
+		edge_sign[k] = 1.0f;
+		if (q[0] < p[0] || (q[0] == p[0] && q[1] < p[1])) {
+			std::swap(p, q);
+			edge_sign[k] = -1.0f;
+		}
+		edge_x[k] = p[0];
+		edge_y[k] = p[1];
+		edge_dx[k] = q[0] - p[0];
+		edge_dy[k] = q[1] - p[1];
+		edge_min[k] = outline & (1u << k) ? 0.5f * (fabsf(edge_dx[k]) + fabsf(edge_dy[k])) : 0.0f;
+	}
+	// Screen-space depth plane z = z_a * x + z_b * y + z_c.
+	float const inv_area = 1.0f / area;
+	float const z_a = ((v1[2] - v0[2]) * (v2[1] - v0[1]) - (v2[2] - v0[2]) * (v1[1] - v0[1])) * inv_area;
+	float const z_b = ((v2[2] - v0[2]) * (v1[0] - v0[0]) - (v1[2] - v0[2]) * (v2[0] - v0[0])) * inv_area;
+	// Written as the farthest depth over each pixel, so partly covered
+	// pixels along shared edges stay behind both triangles.
+	float const z_c = v0[2] - z_a * v0[0] - z_b * v0[1] + 0.5f * (fabsf(z_a) + fabsf(z_b));
+
+	for (int y = y_begin; y < y_end; ++y) {
+		float const py = y + 0.5f;
+		float* const row = &m_depth[static_cast<size_t>(y) * m_width];
+#if OCCLUSION_USE_SSE
+		__m128 const offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		__m128 const zero = _mm_setzero_ps();
+		for (int x = x_begin; x < x_end; x += 4) {
+			__m128 const px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+			__m128 inside = _mm_cmpeq_ps(zero, zero);
+			for (int k = 0; k < 3; ++k) {
+				__m128 const dx = _mm_sub_ps(px, _mm_set1_ps(edge_x[k]));
+				__m128 const e = _mm_sub_ps(_mm_set1_ps(edge_dx[k] * (py - edge_y[k])), _mm_mul_ps(_mm_set1_ps(edge_dy[k]), dx));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_mul_ps(e, _mm_set1_ps(edge_sign[k])), _mm_set1_ps(edge_min[k])));
+			}
+			if (_mm_movemask_ps(inside) == 0) {
+				continue;
+			}
+			__m128 const z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(z_a), px), _mm_set1_ps(z_b * py + z_c));
+			__m128 const old = _mm_loadu_ps(row + x);
+			__m128 const nearer = _mm_min_ps(old, z);
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+		}
+#else
+		for (int x = x_begin; x < x_end; ++x) {
+			float const px = x + 0.5f;
+			bool inside = true;
+			for (int k = 0; k < 3; ++k) {
+				float const e = edge_dx[k] * (py - edge_y[k]) - edge_dy[k] * (px - edge_x[k]);
+				inside &= e * edge_sign[k] >= edge_min[k];
+			}
+			if (inside) {
+				row[x] = std::min(row[x], z_a * px + (z_b * py + z_c));
+			}
+		}
+#endif
+	}
+}
+
+void OcclusionBuffer::UpdateHierarchy() {
+	for (int ty = 0; ty < m_tilesY; ++ty) {
+		for (int tx = 0; tx < m_tilesX; ++tx) {
+			float z = 0.0f;
+			for (int y = 0; y < TILE_HEIGHT; ++y) {
+				const float* row = &m_depth[static_cast<size_t>(ty * TILE_HEIGHT + y) * m_width + tx * TILE_WIDTH];
+				for (int x = 0; x < TILE_WIDTH; ++x) {
+					z = std::max(z, row[x]);
+				}
+			}
+			m_tileMax[static_cast<size_t>(ty) * m_tilesX + tx] = z;
+		}
+	}
+}
+
+bool OcclusionBuffer::TestAabb(const float aabb_min[3], const float aabb_max[3]) const {
+	float x_min = 1e30f, y_min = 1e30f, z_min = 1e30f;
+	float x_max = -1e30f, y_max = -1e30f;
+	for (int corner = 0; corner < 8; ++corner) {
+		float const p[3] = {
+			(corner & 1) ? aabb_max[0] : aabb_min[0],
+			(corner & 2) ? aabb_max[1] : aabb_min[1],
+			(corner & 4) ? aabb_max[2] : aabb_min[2],
+		};
+		float clip[4];
+		Transform(p, clip);
+		// Boxes reaching the camera are never occluded.
+		if (!(clip[3] > MIN_CLIP_W)) {
+			return true;
+		}
+		float const inv_w = 1.0f / clip[3];
+		float const sx = (clip[0] * inv_w * 0.5f + 0.5f) * m_width;
+		float const sy = (0.5f - clip[1] * inv_w * 0.5f) * m_height;
+		x_min = std::min(x_min, sx);
+		x_max = std::max(x_max, sx);
+		y_min = std::min(y_min, sy);
+		y_max = std::max(y_max, sy);
+		z_min = std::min(z_min, clip[2] * inv_w);
+	}
+
+	// Conservative pixel rectangle: every pixel the box can touch.
+	int const x0 = std::max(0, static_cast<int>(floorf(x_min)));
+	int const x1 = std::min(m_width - 1, static_cast<int>(floorf(x_max)));
+	int const y0 = std::max(0, static_cast<int>(floorf(y_min)));
+	int const y1 = std::min(m_height - 1, static_cast<int>(floorf(y_max)));
+	if (x0 > x1 || y0 > y1) {
+		return false;
+	}
+
+	for (int ty = y0 / TILE_HEIGHT; ty <= y1 / TILE_HEIGHT; ++ty) {
+		for (int tx = x0 / TILE_WIDTH; tx <= x1 / TILE_WIDTH; ++tx) {
+			if (z_min > m_tileMax[static_cast<size_t>(ty) * m_tilesX + tx]) {
+				continue;
+			}
+			// The tile's farthest pixel is behind the box; look at the
+			// covered pixels themselves.
+			int const px0 = std::max(x0, tx * TILE_WIDTH);
+			int const px1 = std::min(x1, tx * TILE_WIDTH + TILE_WIDTH - 1);
+			int const py0 = std::max(y0, ty * TILE_HEIGHT);
+			int const py1 = std::min(y1, ty * TILE_HEIGHT + TILE_HEIGHT - 1);
+			for (int y = py0; y <= py1; ++y) {
+				const float* row = &m_depth[static_cast<size_t>(y) * m_width];
+				for (int x = px0; x <= px1; ++x) {
+					if (z_min <= row[x]) {
+						return true;
+					}
+				}
+			}
+		}
+	}
+	return false;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// One mask per triangle of an occluder mesh, bit k set when the edge
+// opposite vertex k is on the mesh's outline: not shared with exactly one
+// coplanar triangle facing the same way. Depends only on the mesh, so it
+// is computed once and handed to every RasterizeOccluders call.
+std::vector<uint8_t> OccluderOutline(const float* positions, const uint32_t* indices, size_t index_count);
+
+// Low resolution software depth buffer for occlusion culling. Occluder
+// triangles are rasterized with their interpolated depth, then occludee
+// boxes are tested first against per-tile maximum depth and, only where
+// that is inconclusive, against individual pixels. Occluders only cover
+// pixels they fill entirely, along their outline, and at the farthest
+// depth they reach in each, so a box is never reported hidden when part
+// of it shows, e.g. through a gap narrower than a pixel.
+// Depth follows D3D: z/w in [0, 1], smaller is nearer, cleared to 1.
+class OcclusionBuffer
+{
+public:
+    static int const TILE_WIDTH = 8;
+    static int const TILE_HEIGHT = 4;
+
+    // Sizes are rounded up to whole tiles.
+    OcclusionBuffer(int width = 256, int height = 144);
+
+    // view_proj is row-major for row vectors, as in FrustumCulling.h.
+    void Begin(const float view_proj[16]);
+    // positions are packed float3. Triangles crossing the near plane or
+    // facing away (clockwise front faces, as in the PSO) are skipped.
+    // world, when given, is a 4x3 row-vector placement applied first.
+    // outline, when given, is OccluderOutline of the same triangles;
+    // without it every edge is treated as on the outline.
+    void RasterizeOccluders(
+        const float* positions, const uint32_t* indices, size_t index_count, const float* world = nullptr,
+        const uint8_t* outline = nullptr
+    );
+    // Refreshes the tile maxima; call after the last RasterizeOccluders.
+    void UpdateHierarchy();
+    // False only when the box is hidden behind rasterized occluders.
+    bool TestAabb(const float aabb_min[3], const float aabb_max[3]) const;
+
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+    const float* Depth() const { return m_depth.data(); }
+
+private:
+    void Transform(const float* p, float* clip) const;
+    // Bit k of outline is set when the edge opposite vertex k is on the
+    // occluders' outline rather than shared with a coplanar triangle.
+    void RasterizeTriangle(const float* v0, const float* v1, const float* v2, unsigned outline);
+
+    int m_width;
+    int m_height;
+    int m_tilesX;
+    int m_tilesY;
+    float m_viewProj[16];
+    std::vector<float> m_depth;
+    std::vector<float> m_tileMax;
+};
@@ -0,0 +1,273 @@
+#include "ReportTools.h"
+#include "FrustumCulling.h"
+#include "MeshWeld.h"
+#include "ObjectSegmentation.h"
+#include "OcclusionCulling.h"
+#include "SceneAsset.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+	// Rasterizes a world-space triangle at the sample centers of a width x
+	// height target with the OcclusionBuffer's projection, calling visit
+	// with each covered sample's index and depth. Returns false, drawing
+	// nothing, when the triangle crosses the near plane.
+	template <typename Visit>
+	bool RasterizeSamples(const float* view_proj, int width, int height, const float* const (&p)[3], bool cull_back, Visit visit) {
+		float s[3][3];
+		for (int k = 0; k < 3; ++k) {
+			float clip[4];
+			for (int j = 0; j < 4; ++j) {
+				clip[j] = p[k][0] * view_proj[j] + p[k][1] * view_proj[4 + j] + p[k][2] * view_proj[8 + j] + view_proj[12 + j];
+			}
+			if (!(clip[3] > 1e-4f)) {
+				return false;
+			}
+			s[k][0] = (clip[0] / clip[3] * 0.5f + 0.5f) * width;
+			s[k][1] = (0.5f - clip[1] / clip[3] * 0.5f) * height;
+			s[k][2] = clip[2] / clip[3];
+		}
+		float const area = (s[1][0] - s[0][0]) * (s[2][1] - s[0][1]) - (s[1][1] - s[0][1]) * (s[2][0] - s[0][0]);
+		if (area == 0.0f || (cull_back && area < 0.0f)) {
+			return true;
+		}
+		int const x0 = (std::max)(0, static_cast<int>(floorf((std::min)({ s[0][0], s[1][0], s[2][0] }))));
+		int const x1 = (std::min)(width - 1, static_cast<int>(ceilf((std::max)({ s[0][0], s[1][0], s[2][0] }))));
+		int const y0 = (std::max)(0, static_cast<int>(floorf((std::min)({ s[0][1], s[1][1], s[2][1] }))));
+		int const y1 = (std::min)(height - 1, static_cast<int>(ceilf((std::max)({ s[0][1], s[1][1], s[2][1] }))));
+		for (int y = y0; y <= y1; ++y) {
+			for (int x = x0; x <= x1; ++x) {
+				float const px = x + 0.5f, py = y + 0.5f;
+				float w[3];
+				for (int k = 0; k < 3; ++k) {
+					const float* a = s[(k + 1) % 3];
+					const float* b = s[(k + 2) % 3];
+					w[k] = ((b[0] - a[0]) * (py - a[1]) - (b[1] - a[1]) * (px - a[0])) / area;
+				}
+				if (w[0] >= 0.0f && w[1] >= 0.0f && w[2] >= 0.0f) {
+					visit(static_cast<size_t>(y) * width + x, w[0] * s[0][2] + w[1] * s[1][2] + w[2] * s[2][2]);
+				}
+			}
+		}
+		return true;
+	}
+
+	// Checks an OcclusionBuffer against a reference depth buffer REFERENCE_SCALE
+	// times finer in each direction, drawn from the same occluders: a box
+	// the buffer hides must have no sample of its faces in front of them.
+	class OcclusionReference
+	{
+	public:
+		static int const REFERENCE_SCALE = 8;
+
+		OcclusionReference(const OcclusionBuffer& buffer, const float* view_proj) :
+			m_width(buffer.Width() * REFERENCE_SCALE),
+			m_height(buffer.Height() * REFERENCE_SCALE),
+			m_viewProj(view_proj),
+			m_depth(static_cast<size_t>(m_width) * m_height, 1.0f)
+		{}
+
+		// Front-facing triangles that do not cross the near plane, as the
+		// buffer rasterizes them.
+		void AddOccluder(const float* p0, const float* p1, const float* p2) {
+			const float* const p[3] = { p0, p1, p2 };
+			RasterizeSamples(m_viewProj, m_width, m_height, p, true, [&](size_t i, float z) {
+				m_depth[i] = (std::min)(m_depth[i], z);
+			});
+		}
+
+		bool Visible(const float aabb_min[3], const float aabb_max[3]) const {
+			float corners[8][3];
+			for (int c = 0; c < 8; ++c) {
+				for (int k = 0; k < 3; ++k) {
+					corners[c][k] = (c >> k) & 1 ? aabb_max[k] : aabb_min[k];
+				}
+			}
+			// Two triangles per face; faces facing away are hidden by the
+			// others, so both sides are drawn.
+			static int const FACES[6][4] = { { 0, 2, 6, 4 }, { 1, 5, 7, 3 }, { 0, 4, 5, 1 }, { 2, 3, 7, 6 }, { 0, 1, 3, 2 }, { 4, 6, 7, 5 } };
+			bool visible = false;
+			for (const auto& face : FACES) {
+				for (int half = 0; half < 2 && !visible; ++half) {
+					const float* const p[3] = { corners[face[0]], corners[face[1 + half]], corners[face[2 + half]] };
+					bool const drawn = RasterizeSamples(m_viewProj, m_width, m_height, p, false, [&](size_t i, float z) {
+						visible = visible || (z >= 0.0f && z < m_depth[i] - 1e-5f);
+					});
+					visible = visible || !drawn;
+				}
+			}
+			return visible;
+		}
+
+	private:
+		int m_width;
+		int m_height;
+		const float* m_viewProj;
+		std::vector<float> m_depth;
+	};
+}
+
+// Walks a camera through a grid of rooms, rasterizing the
+// large objects of the rooms around it as occluders and testing the
+// others, and checks every box the buffer hides against a finer
+// reference. Then looks through slits narrower than a buffer pixel at
+// boxes behind walls, which must stay visible. Prints the share of
+// boxes hidden and the time per view. Fails on any box hidden wrongly.
+//   --occlusion-report [occlusion.txt] [columns] [rows] [views]
+int OcclusionReportTool(const std::vector<std::string>& args) {
+	uint32_t const columns = args.size() > 2 ? static_cast<uint32_t>(std::stoul(args[2])) : 16;
+	uint32_t const rows = args.size() > 3 ? static_cast<uint32_t>(std::stoul(args[3])) : 16;
+	int const views = args.size() > 4 ? std::stoi(args[4]) : 64;
+	// As the renderer picks them, relative to one room.
+	float const OCCLUDER_MIN_EXTENT = 0.1f;
+	int const SLITS = 200;
+
+	std::vector<vertex_t> const room = SceneSourceVertices();
+	std::vector<vertex_t> const grid = ReportGrid(room, columns, rows);
+	indexed_mesh_t mesh = WeldVertices(grid.data(), grid.size());
+	std::vector<scene_object_t> const objects = SegmentObjects(mesh.vertices.data(), mesh.vertices.size(), mesh.indices);
+	std::vector<float> positions(mesh.vertices.size() * 3);
+	for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+		std::copy(mesh.vertices[i].position, mesh.vertices[i].position + 3, &positions[i * 3]);
+	}
+	float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX }, room_extent = 0.0f;
+	for (int k = 0; k < 3; ++k) {
+		float room_lo = FLT_MAX, room_hi = -FLT_MAX;
+		for (const vertex_t& v : room) {
+			room_lo = (std::min)(room_lo, v.position[k]);
+			room_hi = (std::max)(room_hi, v.position[k]);
+		}
+		room_extent = (std::max)(room_extent, room_hi - room_lo);
+		for (const scene_object_t& o : objects) {
+			lo[k] = (std::min)(lo[k], o.aabb_min[k]);
+			hi[k] = (std::max)(hi[k], o.aabb_max[k]);
+		}
+	}
+	std::vector<bool> occluder(objects.size());
+	std::vector<uint8_t> outline(mesh.indices.size() / 3, 7);
+	size_t occluder_count = 0;
+	for (size_t i = 0; i < objects.size(); ++i) {
+		const scene_object_t& o = objects[i];
+		float extent = 0.0f;
+		for (int k = 0; k < 3; ++k) {
+			extent = (std::max)(extent, o.aabb_max[k] - o.aabb_min[k]);
+		}
+		occluder[i] = extent >= OCCLUDER_MIN_EXTENT * room_extent;
+		if (occluder[i]) {
+			std::vector<uint8_t> const mask = OccluderOutline(positions.data(), mesh.indices.data() + o.first_index, o.index_count);
+			std::copy(mask.begin(), mask.end(), outline.begin() + o.first_index / 3);
+			++occluder_count;
+		}
+	}
+
+	FILE* out = OpenReport(args, "occlusion.txt");
+	if (!out) {
+		return 1;
+	}
+
+	// A circle through the grid at eye height, turning as it goes.
+	aabb_soa_t bounds;
+	for (const scene_object_t& o : objects) {
+		bounds.Push(o.aabb_min, o.aabb_max);
+	}
+	OcclusionBuffer buffer;
+	size_t tested = 0, hidden = 0, wrongly_hidden = 0;
+	double seconds = 0.0;
+	for (int view = 0; view < views; ++view) {
+		float const a = 6.2831853f * view / views;
+		float const eye[3] = {
+			0.5f * (lo[0] + hi[0]) + 0.35f * (hi[0] - lo[0]) * cosf(a), lo[1] + 1.5f, 0.5f * (lo[2] + hi[2]) + 0.35f * (hi[2] - lo[2]) * sinf(a)
+		};
+		float const at[3] = { eye[0] + cosf(3.0f * a), eye[1], eye[2] + sinf(3.0f * a) };
+		float view_proj[16];
+		LookAtPerspective(eye, at, 0.25f * 3.14159265f, 16.0f / 9.0f, 0.1f, 100.0f, view_proj);
+		frustum_t const frustum = ExtractFrustumPlanes(view_proj);
+		std::vector<uint32_t> visible(objects.size());
+		visible.resize(CullAabbs(frustum, bounds, visible.data()));
+
+		auto const start = std::chrono::steady_clock::now();
+		buffer.Begin(view_proj);
+		for (uint32_t id : visible) {
+			if (occluder[id]) {
+				buffer.RasterizeOccluders(
+					positions.data(), mesh.indices.data() + objects[id].first_index, objects[id].index_count, nullptr,
+					outline.data() + objects[id].first_index / 3
+				);
+			}
+		}
+		buffer.UpdateHierarchy();
+		std::vector<uint32_t> culled;
+		for (uint32_t id : visible) {
+			if (!occluder[id] && !buffer.TestAabb(objects[id].aabb_min, objects[id].aabb_max)) {
+				culled.push_back(id);
+			}
+		}
+		seconds += Seconds(start);
+
+		OcclusionReference reference(buffer, view_proj);
+		for (uint32_t id : visible) {
+			if (occluder[id]) {
+				const scene_object_t& o = objects[id];
+				for (uint32_t i = o.first_index; i < o.first_index + o.index_count; i += 3) {
+					reference.AddOccluder(
+						&positions[mesh.indices[i] * 3], &positions[mesh.indices[i + 1] * 3], &positions[mesh.indices[i + 2] * 3]
+					);
+				}
+			}
+			else {
+				++tested;
+			}
+		}
+		for (uint32_t id : culled) {
+			wrongly_hidden += reference.Visible(objects[id].aabb_min, objects[id].aabb_max);
+		}
+		hidden += culled.size();
+	}
+	fprintf(out, "%u x %u rooms: %zu objects, %zu occluders; %d views\n", columns, rows, objects.size(), occluder_count, views);
+	fprintf(out, "%zu of %zu boxes in the frustum hidden (%.1f%%), %.3f ms per view, %zu hidden wrongly\n",
+		hidden, tested, tested ? 100.0 * hidden / tested : 0.0, 1e3 * seconds / views, wrongly_hidden);
+
+	// Slits: a wall of two quads 10 units ahead, a gap between them
+	// narrower than a buffer pixel, and a box behind it that only shows
+	// through the gap.
+	uint32_t noise = 1;
+	auto random = [&](float lo, float hi) {
+		noise = noise * 1664525u + 1013904223u;
+		return lo + (hi - lo) * static_cast<float>(noise >> 8) / 16777216.0f;
+	};
+	size_t slit_visible = 0, slit_hidden_wrongly = 0;
+	for (int slit = 0; slit < SLITS; ++slit) {
+		float const eye[3] = { 0.0f, 0.0f, 0.0f }, at[3] = { 0.0f, 0.0f, 1.0f };
+		float view_proj[16];
+		LookAtPerspective(eye, at, 0.25f * 3.14159265f, 16.0f / 9.0f, 0.1f, 100.0f, view_proj);
+		// At z = 10 one buffer pixel spans 2 * 10 * tan(fov / 2) * aspect / width.
+		float const pixel = 2.0f * 10.0f * tanf(0.125f * 3.14159265f) * (16.0f / 9.0f) / buffer.Width();
+		float const center = random(-3.0f, 3.0f), half_gap = 0.5f * pixel * random(0.2f, 0.9f);
+		float const wall[8][3] = {
+			{ -8.0f, -5.0f, 10.0f }, { center - half_gap, -5.0f, 10.0f }, { center - half_gap, 5.0f, 10.0f }, { -8.0f, 5.0f, 10.0f },
+			{ center + half_gap, -5.0f, 10.0f }, { 8.0f, -5.0f, 10.0f }, { 8.0f, 5.0f, 10.0f }, { center + half_gap, 5.0f, 10.0f },
+		};
+		std::vector<float> wall_positions(&wall[0][0], &wall[0][0] + 24);
+		// Clockwise seen from the eye.
+		uint32_t const wall_indices[12] = { 0, 2, 1, 0, 3, 2, 4, 6, 5, 4, 7, 6 };
+		buffer.Begin(view_proj);
+		std::vector<uint8_t> const wall_outline = OccluderOutline(wall_positions.data(), wall_indices, 12);
+		buffer.RasterizeOccluders(wall_positions.data(), wall_indices, 12, nullptr, wall_outline.data());
+		buffer.UpdateHierarchy();
+		OcclusionReference reference(buffer, view_proj);
+		for (int i = 0; i < 12; i += 3) {
+			reference.AddOccluder(&wall[wall_indices[i]][0], &wall[wall_indices[i + 1]][0], &wall[wall_indices[i + 2]][0]);
+		}
+		float const y = random(-2.0f, 2.0f);
+		float const box_min[3] = { center * 2.0f - 0.5f, y - 0.5f, 19.5f }, box_max[3] = { center * 2.0f + 0.5f, y + 0.5f, 20.5f };
+		if (reference.Visible(box_min, box_max)) {
+			++slit_visible;
+			slit_hidden_wrongly += !buffer.TestAabb(box_min, box_max);
+		}
+	}
+	fprintf(out, "%d slits of 0.2 to 0.9 buffer pixels: %zu boxes showing through, %zu hidden wrongly\n",
+		SLITS, slit_visible, slit_hidden_wrongly);
+
+	return CloseReport(out, slit_visible > 0 ? wrongly_hidden + slit_hidden_wrongly : 1);
+}
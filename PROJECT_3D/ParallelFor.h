@@ -0,0 +1,51 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+// thread_count 0 means every hardware thread.
+inline unsigned ResolveThreadCount(unsigned thread_count)
+{
+    return thread_count ? thread_count : std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Runs task(i) for every i in [0, count) on up to thread_count threads,
+// the caller included. The first exception is rethrown on the caller.
+template <typename Task>
+void ParallelFor(size_t count, unsigned thread_count, const Task& task)
+{
+    size_t const workers = std::min<size_t>(thread_count, count);
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    std::vector<std::exception_ptr> errors(workers);
+    auto worker = [&](size_t w) {
+        try {
+            for (size_t i = next++; i < count && !failed; i = next++) {
+                task(i);
+            }
+        }
+        catch (...) {
+            errors[w] = std::current_exception();
+            failed = true;
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t w = 1; w < workers; ++w) {
+        threads.emplace_back(worker, w);
+    }
+    if (workers > 0) {
+        worker(0);
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
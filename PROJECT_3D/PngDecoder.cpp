@@ -0,0 +1,1086 @@
+#include "PngDecoder.h"
+#include "MappedFile.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define PNG_USE_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+	uint8_t const PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	// Images above this many pixels are rejected rather than allocated.
+	uint64_t const MAX_PIXELS = uint64_t(1) << 30;
+	// Match copies may write this far past their end.
+	size_t const INFLATE_SLACK = 32;
+
+	uint8_t const ADAM7_X[7] = { 0, 4, 0, 2, 0, 1, 0 };
+	uint8_t const ADAM7_Y[7] = { 0, 0, 4, 0, 2, 0, 1 };
+	uint8_t const ADAM7_DX[7] = { 8, 8, 4, 4, 2, 2, 1 };
+	uint8_t const ADAM7_DY[7] = { 8, 8, 8, 4, 4, 2, 2 };
+
+	uint16_t const LENGTH_BASE[29] = {
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+	};
+	uint8_t const LENGTH_EXTRA[29] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+	};
+	uint16_t const DISTANCE_BASE[30] = {
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+	};
+	uint8_t const DISTANCE_EXTRA[30] = {
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+	};
+	uint8_t const CODE_LENGTH_ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	[[noreturn]] void Fail(const char* message) {
+		throw std::runtime_error(std::string("PNG: ") + message);
+	}
+
+	uint32_t ReadBe32(const uint8_t* p) {
+		return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | p[3];
+	}
+
+	struct png_info_t {
+		uint32_t width;
+		uint32_t height;
+		uint8_t bit_depth;
+		uint8_t color_type;
+		uint8_t channels;
+		bool interlaced;
+		uint32_t palette[256];          // RGBA8 as stored in memory
+		uint32_t palette_size;
+		bool has_key;                   // tRNS color key for gray and RGB
+		uint16_t key[3];
+		std::vector<uint8_t> zlib;      // the IDAT chunks back to back
+	};
+
+	uint32_t PackRgba(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+		uint8_t const bytes[4] = { r, g, b, a };
+		uint32_t value;
+		memcpy(&value, bytes, 4);
+		return value;
+	}
+
+	png_info_t ParsePng(const uint8_t* data, size_t size) {
+		if (!IsPng(data, size)) {
+			Fail("not a PNG file");
+		}
+		png_info_t info = {};
+		bool has_header = false, has_end = false;
+		size_t position = 8;
+		while (!has_end) {
+			if (size - position < 12) {
+				Fail("truncated chunk");
+			}
+			uint32_t const length = ReadBe32(data + position);
+			const uint8_t* type = data + position + 4;
+			const uint8_t* body = data + position + 8;
+			if (length > size - position - 12) {
+				Fail("truncated chunk");
+			}
+			if (memcmp(type, "IHDR", 4) == 0) {
+				if (length != 13 || has_header) {
+					Fail("bad IHDR");
+				}
+				info.width = ReadBe32(body);
+				info.height = ReadBe32(body + 4);
+				info.bit_depth = body[8];
+				info.color_type = body[9];
+				info.interlaced = body[12] == 1;
+				static uint8_t const CHANNELS[7] = { 1, 0, 3, 1, 2, 0, 4 };
+				info.channels = info.color_type < 7 ? CHANNELS[info.color_type] : 0;
+				uint8_t const depth = info.bit_depth;
+				bool const depth_valid =
+					(info.color_type == 0 && (depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16)) ||
+					(info.color_type == 3 && (depth == 1 || depth == 2 || depth == 4 || depth == 8)) ||
+					((info.color_type == 2 || info.color_type == 4 || info.color_type == 6) && (depth == 8 || depth == 16));
+				if (info.channels == 0 || !depth_valid || body[10] != 0 || body[11] != 0 || body[12] > 1 ||
+					info.width == 0 || info.height == 0 || uint64_t(info.width) * info.height > MAX_PIXELS) {
+					Fail("unsupported IHDR");
+				}
+				has_header = true;
+			}
+			else if (!has_header) {
+				Fail("IHDR is not the first chunk");
+			}
+			else if (memcmp(type, "PLTE", 4) == 0) {
+				if (length % 3 != 0 || length / 3 > 256) {
+					Fail("bad PLTE");
+				}
+				info.palette_size = length / 3;
+				for (uint32_t i = 0; i < info.palette_size; ++i) {
+					info.palette[i] = PackRgba(body[i * 3], body[i * 3 + 1], body[i * 3 + 2], 255);
+				}
+			}
+			else if (memcmp(type, "tRNS", 4) == 0) {
+				if (info.color_type == 3) {
+					for (uint32_t i = 0; i < length && i < 256; ++i) {
+						uint8_t bytes[4];
+						memcpy(bytes, &info.palette[i], 4);
+						info.palette[i] = PackRgba(bytes[0], bytes[1], bytes[2], body[i]);
+					}
+				}
+				else if (info.color_type == 0 && length >= 2) {
+					info.has_key = true;
+					info.key[0] = static_cast<uint16_t>(body[0] << 8 | body[1]);
+				}
+				else if (info.color_type == 2 && length >= 6) {
+					info.has_key = true;
+					for (int c = 0; c < 3; ++c) {
+						info.key[c] = static_cast<uint16_t>(body[c * 2] << 8 | body[c * 2 + 1]);
+					}
+				}
+			}
+			else if (memcmp(type, "IDAT", 4) == 0) {
+				info.zlib.insert(info.zlib.end(), body, body + length);
+			}
+			else if (memcmp(type, "IEND", 4) == 0) {
+				has_end = true;
+			}
+			else if (!(type[0] & 0x20)) {
+				Fail("unknown critical chunk");
+			}
+			position += size_t(length) + 12;
+		}
+		if (info.color_type == 3 && info.palette_size == 0) {
+			Fail("palette image without PLTE");
+		}
+		if (info.zlib.size() < 2 || (info.zlib[0] & 0x0F) != 8 || (info.zlib[0] >> 4) > 7 ||
+			(info.zlib[0] << 8 | info.zlib[1]) % 31 != 0 || (info.zlib[1] & 0x20)) {
+			Fail("bad zlib header");
+		}
+		return info;
+	}
+
+	size_t RowBytes(const png_info_t& info, uint32_t width) {
+		return (size_t(width) * info.channels * info.bit_depth + 7) / 8;
+	}
+
+	// Bytes between corresponding samples of neighboring pixels, as the
+	// filters count them; at least 1.
+	size_t FilterStride(const png_info_t& info) {
+		return (std::max)(size_t(1), size_t(info.channels) * info.bit_depth / 8);
+	}
+
+	struct pass_t {
+		uint32_t x, y, dx, dy;
+		uint32_t width, height;
+	};
+
+	// One pass covering every pixel, or the seven Adam7 passes (empty
+	// ones included, which store no rows).
+	std::vector<pass_t> Passes(const png_info_t& info) {
+		std::vector<pass_t> passes;
+		if (!info.interlaced) {
+			passes.push_back({ 0, 0, 1, 1, info.width, info.height });
+			return passes;
+		}
+		for (int p = 0; p < 7; ++p) {
+			pass_t pass = { ADAM7_X[p], ADAM7_Y[p], ADAM7_DX[p], ADAM7_DY[p], 0, 0 };
+			pass.width = info.width > pass.x ? (info.width - pass.x + pass.dx - 1) / pass.dx : 0;
+			pass.height = info.height > pass.y ? (info.height - pass.y + pass.dy - 1) / pass.dy : 0;
+			if (pass.width == 0) {
+				pass.height = 0;
+			}
+			passes.push_back(pass);
+		}
+		return passes;
+	}
+
+	size_t FilteredSize(const png_info_t& info) {
+		size_t size = 0;
+		for (const pass_t& pass : Passes(info)) {
+			size += size_t(pass.height) * (1 + RowBytes(info, pass.width));
+		}
+		return size;
+	}
+
+	// Inflate. A table entry holds the bits to consume, the extra bits that
+	// follow, a kind and a value: the literal, the base length or distance,
+	// or the offset of a subtable for codes longer than the primary bits.
+	uint32_t const KIND_LITERAL = 0x000;
+	uint32_t const KIND_LENGTH = 0x100;
+	uint32_t const KIND_END = 0x200;
+	uint32_t const KIND_SUBTABLE = 0x400;
+	uint32_t const KIND_INVALID = 0x800;
+	int const LITLEN_PRIMARY_BITS = 10;
+	int const DISTANCE_PRIMARY_BITS = 8;
+	int const CODE_LENGTH_PRIMARY_BITS = 7;
+
+	enum class huffman_kind_t { litlen, distance, code_length };
+
+	uint32_t Entry(uint32_t value, uint32_t kind, uint32_t extra, uint32_t bits) {
+		return value << 16 | kind | extra << 4 | bits;
+	}
+
+	uint32_t SymbolEntry(huffman_kind_t kind, uint32_t symbol, uint32_t bits) {
+		switch (kind) {
+		case huffman_kind_t::litlen:
+			if (symbol < 256) return Entry(symbol, KIND_LITERAL, 0, bits);
+			if (symbol == 256) return Entry(0, KIND_END, 0, bits);
+			if (symbol < 286) return Entry(LENGTH_BASE[symbol - 257], KIND_LENGTH, LENGTH_EXTRA[symbol - 257], bits);
+			return Entry(0, KIND_INVALID, 0, bits);
+		case huffman_kind_t::distance:
+			if (symbol < 30) return Entry(DISTANCE_BASE[symbol], KIND_LITERAL, DISTANCE_EXTRA[symbol], bits);
+			return Entry(0, KIND_INVALID, 0, bits);
+		default:
+			return Entry(symbol, KIND_LITERAL, 0, bits);
+		}
+	}
+
+	uint32_t ReverseBits(uint32_t code, int length) {
+		uint32_t reversed = 0;
+		for (int i = 0; i < length; ++i) {
+			reversed = reversed << 1 | (code >> i & 1);
+		}
+		return reversed;
+	}
+
+	// Canonical Huffman code from code lengths, indexed by the next
+	// primary_bits input bits (deflate sends codes most significant bit
+	// first, so table indices are bit-reversed codes). Incomplete codes are
+	// allowed, their unused entries decode as invalid.
+	void BuildTable(const uint8_t* lengths, int count, int primary_bits, huffman_kind_t kind, std::vector<uint32_t>& table) {
+		int length_count[16] = {};
+		for (int s = 0; s < count; ++s) {
+			++length_count[lengths[s]];
+		}
+		length_count[0] = 0;
+		int left = 1;
+		uint32_t next_code[16] = {};
+		for (int length = 1; length < 16; ++length) {
+			left = (left << 1) - length_count[length];
+			if (left < 0) {
+				Fail("over-subscribed Huffman code");
+			}
+			next_code[length] = (next_code[length - 1] + length_count[length - 1]) << 1;
+		}
+
+		uint32_t const primary_size = 1u << primary_bits;
+		table.assign(primary_size, Entry(0, KIND_INVALID, 0, 0));
+		uint32_t codes[288] = {};
+		uint8_t longest[1 << LITLEN_PRIMARY_BITS] = {};
+		{
+			uint32_t code[16];
+			std::copy(next_code, next_code + 16, code);
+			for (int s = 0; s < count; ++s) {
+				int const length = lengths[s];
+				if (length == 0) {
+					continue;
+				}
+				codes[s] = ReverseBits(code[length]++, length);
+				if (length > primary_bits) {
+					uint8_t& l = longest[codes[s] & (primary_size - 1)];
+					l = (std::max)(l, static_cast<uint8_t>(length));
+				}
+			}
+		}
+		for (uint32_t prefix = 0; prefix < primary_size; ++prefix) {
+			if (longest[prefix]) {
+				uint32_t const sub_bits = longest[prefix] - primary_bits;
+				table[prefix] = Entry(static_cast<uint32_t>(table.size()), KIND_SUBTABLE, 0, sub_bits);
+				table.resize(table.size() + (size_t(1) << sub_bits), Entry(0, KIND_INVALID, 0, 0));
+			}
+		}
+		for (int s = 0; s < count; ++s) {
+			int const length = lengths[s];
+			if (length == 0) {
+				continue;
+			}
+			if (length <= primary_bits) {
+				uint32_t const entry = SymbolEntry(kind, s, length);
+				for (uint32_t i = codes[s]; i < primary_size; i += 1u << length) {
+					table[i] = entry;
+				}
+			}
+			else {
+				uint32_t const pointer = table[codes[s] & (primary_size - 1)];
+				uint32_t const sub_size = 1u << (pointer & 15);
+				uint32_t const entry = SymbolEntry(kind, s, length - primary_bits);
+				for (uint32_t i = codes[s] >> primary_bits; i < sub_size; i += 1u << (length - primary_bits)) {
+					table[(pointer >> 16) + i] = entry;
+				}
+			}
+		}
+	}
+
+	// Little-endian bit buffer kept at 56 bits or more by Refill, so one
+	// length and distance with their extra bits decode without refilling.
+	// Reading past the input yields zero bits; Finish rejects consuming them.
+	struct bit_reader_t {
+		const uint8_t* next;
+		const uint8_t* end;
+		uint64_t bits;
+		unsigned count;
+		size_t overrun;
+
+		void Refill() {
+			if (end - next >= 8) {
+				uint64_t word;
+				memcpy(&word, next, 8);
+				bits |= word << count;
+				next += (63 - count) >> 3;
+				count |= 56;
+				return;
+			}
+			while (count <= 56) {
+				if (next < end) {
+					bits |= uint64_t(*next++) << count;
+				}
+				else {
+					++overrun;
+				}
+				count += 8;
+			}
+		}
+
+		uint32_t Peek(unsigned n) const { return static_cast<uint32_t>(bits & ((uint64_t(1) << n) - 1)); }
+		void Skip(unsigned n) { bits >>= n; count -= n; }
+		uint32_t Take(unsigned n) {
+			uint32_t const value = Peek(n);
+			Skip(n);
+			return value;
+		}
+
+		// Drops the bits of a partial byte and hands back the buffered
+		// whole bytes to the byte pointer, for stored blocks.
+		void AlignToByte() {
+			Skip(count & 7);
+			size_t const buffered = count / 8;
+			size_t const real = buffered > overrun ? buffered - overrun : 0;
+			if (buffered < overrun) {
+				Fail("truncated zlib stream");
+			}
+			next -= real;
+			overrun = 0;
+			bits = 0;
+			count = 0;
+		}
+
+		void Finish() const {
+			if (size_t(overrun) * 8 > count) {
+				Fail("truncated zlib stream");
+			}
+		}
+	};
+
+	uint32_t Decode(bit_reader_t& reader, const uint32_t* table, int primary_bits) {
+		uint32_t entry = table[reader.Peek(primary_bits)];
+		if (entry & KIND_SUBTABLE) {
+			reader.Skip(primary_bits);
+			entry = table[(entry >> 16) + reader.Peek(entry & 15)];
+		}
+		reader.Skip(entry & 15);
+		return entry;
+	}
+
+	void CopyMatch(uint8_t* out, size_t distance, size_t length) {
+		const uint8_t* source = out - distance;
+		uint8_t* const stop = out + length;
+		if (distance >= 16) {
+			// Each 16-byte load only reads bytes already written; the last
+			// store may run up to 15 bytes past the match into the slack.
+			do {
+#ifdef PNG_USE_SSE
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_loadu_si128(reinterpret_cast<const __m128i*>(source)));
+#else
+				memcpy(out, source, 16);
+#endif
+				out += 16;
+				source += 16;
+			} while (out < stop);
+		}
+		else if (distance == 1) {
+			memset(out, out[-1], length);
+		}
+		else if (distance >= 8) {
+			do {
+				memcpy(out, source, 8);
+				out += 8;
+				source += 8;
+			} while (out < stop);
+		}
+		else {
+			while (out < stop) {
+				*out++ = *source++;
+			}
+		}
+	}
+
+	struct fixed_tables_t {
+		std::vector<uint32_t> litlen;
+		std::vector<uint32_t> distance;
+
+		fixed_tables_t() {
+			uint8_t lengths[288];
+			std::fill(lengths, lengths + 144, uint8_t(8));
+			std::fill(lengths + 144, lengths + 256, uint8_t(9));
+			std::fill(lengths + 256, lengths + 280, uint8_t(7));
+			std::fill(lengths + 280, lengths + 288, uint8_t(8));
+			BuildTable(lengths, 288, LITLEN_PRIMARY_BITS, huffman_kind_t::litlen, litlen);
+			std::fill(lengths, lengths + 30, uint8_t(5));
+			BuildTable(lengths, 30, DISTANCE_PRIMARY_BITS, huffman_kind_t::distance, distance);
+		}
+	};
+
+	const fixed_tables_t& FixedTables() {
+		static fixed_tables_t const tables;
+		return tables;
+	}
+
+	void ReadDynamicTables(bit_reader_t& reader, std::vector<uint32_t>& litlen, std::vector<uint32_t>& distance) {
+		reader.Refill();
+		uint32_t const litlen_count = reader.Take(5) + 257;
+		uint32_t const distance_count = reader.Take(5) + 1;
+		uint32_t const code_length_count = reader.Take(4) + 4;
+		if (litlen_count > 286 || distance_count > 30) {
+			Fail("bad dynamic block header");
+		}
+		uint8_t code_lengths[19] = {};
+		for (uint32_t i = 0; i < code_length_count; ++i) {
+			reader.Refill();
+			code_lengths[CODE_LENGTH_ORDER[i]] = static_cast<uint8_t>(reader.Take(3));
+		}
+		std::vector<uint32_t> code_length_table;
+		BuildTable(code_lengths, 19, CODE_LENGTH_PRIMARY_BITS, huffman_kind_t::code_length, code_length_table);
+
+		uint8_t lengths[286 + 30] = {};
+		uint32_t const total = litlen_count + distance_count;
+		for (uint32_t i = 0; i < total;) {
+			reader.Refill();
+			uint32_t const entry = Decode(reader, code_length_table.data(), CODE_LENGTH_PRIMARY_BITS);
+			if (entry & KIND_INVALID) {
+				Fail("bad code length code");
+			}
+			uint32_t const symbol = entry >> 16;
+			if (symbol < 16) {
+				lengths[i++] = static_cast<uint8_t>(symbol);
+				continue;
+			}
+			uint8_t value = 0;
+			uint32_t repeat;
+			if (symbol == 16) {
+				if (i == 0) {
+					Fail("repeat without a previous length");
+				}
+				value = lengths[i - 1];
+				repeat = 3 + reader.Take(2);
+			}
+			else if (symbol == 17) {
+				repeat = 3 + reader.Take(3);
+			}
+			else {
+				repeat = 11 + reader.Take(7);
+			}
+			if (i + repeat > total) {
+				Fail("code lengths overflow");
+			}
+			std::fill(lengths + i, lengths + i + repeat, value);
+			i += repeat;
+		}
+		if (lengths[256] == 0) {
+			Fail("no end-of-block code");
+		}
+		BuildTable(lengths, litlen_count, LITLEN_PRIMARY_BITS, huffman_kind_t::litlen, litlen);
+		BuildTable(lengths + litlen_count, distance_count, DISTANCE_PRIMARY_BITS, huffman_kind_t::distance, distance);
+	}
+
+	// Inflates a zlib stream into exactly size bytes at out, which has
+	// INFLATE_SLACK writable bytes beyond them.
+	void Inflate(const std::vector<uint8_t>& zlib, uint8_t* out, size_t size) {
+		bit_reader_t reader = { zlib.data() + 2, zlib.data() + zlib.size(), 0, 0, 0 };
+		uint8_t* const begin = out;
+		uint8_t* const end = out + size;
+		std::vector<uint32_t> dynamic_litlen, dynamic_distance;
+		bool last = false;
+		while (!last) {
+			reader.Refill();
+			last = reader.Take(1) != 0;
+			uint32_t const type = reader.Take(2);
+			if (type == 0) {
+				reader.AlignToByte();
+				if (reader.end - reader.next < 4) {
+					Fail("truncated stored block");
+				}
+				uint32_t const length = reader.next[0] | reader.next[1] << 8;
+				uint32_t const check = reader.next[2] | reader.next[3] << 8;
+				reader.next += 4;
+				if ((length ^ 0xFFFF) != check || size_t(reader.end - reader.next) < length) {
+					Fail("bad stored block");
+				}
+				if (size_t(end - out) < length) {
+					Fail("more data than the image holds");
+				}
+				memcpy(out, reader.next, length);
+				out += length;
+				reader.next += length;
+				continue;
+			}
+			if (type == 3) {
+				Fail("bad block type");
+			}
+			const uint32_t* litlen;
+			const uint32_t* distance;
+			if (type == 1) {
+				litlen = FixedTables().litlen.data();
+				distance = FixedTables().distance.data();
+			}
+			else {
+				ReadDynamicTables(reader, dynamic_litlen, dynamic_distance);
+				litlen = dynamic_litlen.data();
+				distance = dynamic_distance.data();
+			}
+
+			while (true) {
+				reader.Refill();
+				uint32_t entry = Decode(reader, litlen, LITLEN_PRIMARY_BITS);
+				if (!(entry & (KIND_LENGTH | KIND_END | KIND_INVALID))) {
+					// A second literal usually fits in what is left.
+					if (out == end) {
+						Fail("more data than the image holds");
+					}
+					*out++ = static_cast<uint8_t>(entry >> 16);
+					if (reader.count < 15) {
+						continue;
+					}
+					entry = Decode(reader, litlen, LITLEN_PRIMARY_BITS);
+					if (!(entry & (KIND_LENGTH | KIND_END | KIND_INVALID))) {
+						if (out == end) {
+							Fail("more data than the image holds");
+						}
+						*out++ = static_cast<uint8_t>(entry >> 16);
+						continue;
+					}
+					reader.Refill();
+				}
+				if (entry & KIND_END) {
+					break;
+				}
+				if (entry & KIND_INVALID) {
+					Fail("bad literal/length code");
+				}
+				size_t const length = (entry >> 16) + reader.Take(entry >> 4 & 15);
+				uint32_t const distance_entry = Decode(reader, distance, DISTANCE_PRIMARY_BITS);
+				if (distance_entry & KIND_INVALID) {
+					Fail("bad distance code");
+				}
+				size_t const match_distance = (distance_entry >> 16) + reader.Take(distance_entry >> 4 & 15);
+				if (match_distance > size_t(out - begin)) {
+					Fail("distance before the start of the data");
+				}
+				if (length > size_t(end - out)) {
+					Fail("more data than the image holds");
+				}
+				CopyMatch(out, match_distance, length);
+				out += length;
+			}
+		}
+		reader.Finish();
+		if (out != end) {
+			Fail("less data than the image holds");
+		}
+	}
+
+	// Unfiltering. The filters predict each byte from the byte stride to
+	// its left (a), above (b) and above-left (c).
+	uint8_t Paeth(int a, int b, int c) {
+		int const pa = std::abs(b - c), pb = std::abs(a - c), pc = std::abs(a + b - 2 * c);
+		return static_cast<uint8_t>(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+	}
+
+	void UnfilterRowScalar(uint8_t filter, uint8_t* row, const uint8_t* prior, size_t bytes, size_t stride) {
+		switch (filter) {
+		case 0:
+			break;
+		case 1:
+			for (size_t i = stride; i < bytes; ++i) row[i] = static_cast<uint8_t>(row[i] + row[i - stride]);
+			break;
+		case 2:
+			for (size_t i = 0; i < bytes; ++i) row[i] = static_cast<uint8_t>(row[i] + prior[i]);
+			break;
+		case 3:
+			for (size_t i = 0; i < stride && i < bytes; ++i) row[i] = static_cast<uint8_t>(row[i] + (prior[i] >> 1));
+			for (size_t i = stride; i < bytes; ++i) row[i] = static_cast<uint8_t>(row[i] + ((row[i - stride] + prior[i]) >> 1));
+			break;
+		case 4:
+			for (size_t i = 0; i < stride && i < bytes; ++i) row[i] = static_cast<uint8_t>(row[i] + prior[i]);
+			for (size_t i = stride; i < bytes; ++i) row[i] = static_cast<uint8_t>(row[i] + Paeth(row[i - stride], prior[i], prior[i - stride]));
+			break;
+		default:
+			Fail("bad filter type");
+		}
+	}
+
+#ifdef PNG_USE_SSE
+	__m128i LoadPixel(const uint8_t* p, size_t stride) {
+		uint32_t value = 0;
+		memcpy(&value, p, stride);
+		return _mm_cvtsi32_si128(static_cast<int>(value));
+	}
+
+	void StorePixel(uint8_t* p, __m128i pixel, size_t stride) {
+		uint32_t const value = static_cast<uint32_t>(_mm_cvtsi128_si32(pixel));
+		memcpy(p, &value, stride);
+	}
+
+	// Sub, Average and Paeth depend on the pixel to the left, so one pixel
+	// of 3 or 4 bytes is one register and the channels go in parallel; Up
+	// and Sub on 4-byte pixels take 16 bytes at a time.
+	void UnfilterRowSse(uint8_t filter, uint8_t* row, const uint8_t* prior, size_t bytes, size_t stride) {
+		__m128i const zero = _mm_setzero_si128();
+		size_t i = 0;
+		switch (filter) {
+		case 0:
+			return;
+		case 1:
+			if (stride == 4) {
+				__m128i left = zero;
+				for (; i + 16 <= bytes; i += 16) {
+					__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+					x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+					x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+					x = _mm_add_epi8(x, left);
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), x);
+					left = _mm_shuffle_epi32(x, 0xFF);
+				}
+				for (i = (std::max)(i, stride); i < bytes; ++i) {
+					row[i] = static_cast<uint8_t>(row[i] + row[i - stride]);
+				}
+				return;
+			}
+			{
+				__m128i left = zero;
+				for (; i + stride <= bytes; i += stride) {
+					left = _mm_add_epi8(LoadPixel(row + i, stride), left);
+					StorePixel(row + i, left, stride);
+				}
+			}
+			return;
+		case 2:
+			for (; i + 16 <= bytes; i += 16) {
+				__m128i const x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+				__m128i const b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prior + i));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), _mm_add_epi8(x, b));
+			}
+			for (; i < bytes; ++i) {
+				row[i] = static_cast<uint8_t>(row[i] + prior[i]);
+			}
+			return;
+		case 3: {
+			// _mm_avg_epu8 rounds up; the filter's average rounds down.
+			__m128i const one = _mm_set1_epi8(1);
+			__m128i left = zero;
+			for (; i + stride <= bytes; i += stride) {
+				__m128i const b = LoadPixel(prior + i, stride);
+				__m128i const average = _mm_sub_epi8(_mm_avg_epu8(left, b), _mm_and_si128(_mm_xor_si128(left, b), one));
+				left = _mm_add_epi8(LoadPixel(row + i, stride), average);
+				StorePixel(row + i, left, stride);
+			}
+			return;
+		}
+		case 4: {
+			// In 16-bit lanes: pa = |b - c|, pb = |a - c|, pc = |pa' + pb'|
+			// with the signed differences, then the first of a, b, c with
+			// the smallest distance.
+			__m128i a = zero, c = zero;
+			for (; i + stride <= bytes; i += stride) {
+				__m128i const b = _mm_unpacklo_epi8(LoadPixel(prior + i, stride), zero);
+				__m128i const x = LoadPixel(row + i, stride);
+				__m128i const b_c = _mm_sub_epi16(b, c);
+				__m128i const a_c = _mm_sub_epi16(a, c);
+				__m128i const sum = _mm_add_epi16(b_c, a_c);
+				__m128i const pa = _mm_max_epi16(b_c, _mm_sub_epi16(zero, b_c));
+				__m128i const pb = _mm_max_epi16(a_c, _mm_sub_epi16(zero, a_c));
+				__m128i const pc = _mm_max_epi16(sum, _mm_sub_epi16(zero, sum));
+				__m128i const use_c = _mm_and_si128(_mm_cmplt_epi16(pc, pa), _mm_cmplt_epi16(pc, pb));
+				__m128i const use_b = _mm_andnot_si128(use_c, _mm_cmplt_epi16(pb, pa));
+				__m128i const use_a = _mm_andnot_si128(_mm_or_si128(use_b, use_c), _mm_set1_epi16(-1));
+				__m128i const predicted = _mm_or_si128(
+					_mm_or_si128(_mm_and_si128(use_a, a), _mm_and_si128(use_b, b)), _mm_and_si128(use_c, c)
+				);
+				__m128i const result = _mm_add_epi8(x, _mm_packus_epi16(predicted, zero));
+				StorePixel(row + i, result, stride);
+				a = _mm_unpacklo_epi8(result, zero);
+				c = b;
+			}
+			return;
+		}
+		default:
+			Fail("bad filter type");
+		}
+	}
+#endif
+
+	void UnfilterRow(uint8_t filter, uint8_t* row, const uint8_t* prior, size_t bytes, size_t stride) {
+#ifdef PNG_USE_SSE
+		if ((stride == 3 || stride == 4) && bytes % stride == 0) {
+			UnfilterRowSse(filter, row, prior, bytes, stride);
+			return;
+		}
+#endif
+		UnfilterRowScalar(filter, row, prior, bytes, stride);
+	}
+
+	// Conversion of one unfiltered row of width pixels to RGBA8.
+	void ConvertRow(const png_info_t& info, const uint8_t* row, uint32_t width, uint8_t* out) {
+		uint8_t const depth = info.bit_depth;
+		switch (info.color_type) {
+		case 6:
+			if (depth == 8) {
+				memcpy(out, row, size_t(width) * 4);
+			}
+			else {
+				for (size_t i = 0; i < size_t(width) * 4; ++i) out[i] = row[i * 2];
+			}
+			return;
+		case 2:
+			for (uint32_t x = 0; x < width; ++x) {
+				const uint8_t* p = row + size_t(x) * 3 * (depth / 8);
+				size_t const step = depth / 8;
+				out[x * 4 + 0] = p[0];
+				out[x * 4 + 1] = p[step];
+				out[x * 4 + 2] = p[step * 2];
+				bool keyed = false;
+				if (info.has_key) {
+					keyed = depth == 8
+						? p[0] == info.key[0] && p[1] == info.key[1] && p[2] == info.key[2]
+						: (p[0] << 8 | p[1]) == info.key[0] && (p[2] << 8 | p[3]) == info.key[1] && (p[4] << 8 | p[5]) == info.key[2];
+				}
+				out[x * 4 + 3] = keyed ? 0 : 255;
+			}
+			return;
+		case 4:
+			for (uint32_t x = 0; x < width; ++x) {
+				const uint8_t* p = row + size_t(x) * 2 * (depth / 8);
+				out[x * 4 + 0] = out[x * 4 + 1] = out[x * 4 + 2] = p[0];
+				out[x * 4 + 3] = p[depth / 8];
+			}
+			return;
+		case 0:
+			if (depth == 16) {
+				for (uint32_t x = 0; x < width; ++x) {
+					const uint8_t* p = row + size_t(x) * 2;
+					out[x * 4 + 0] = out[x * 4 + 1] = out[x * 4 + 2] = p[0];
+					out[x * 4 + 3] = info.has_key && (p[0] << 8 | p[1]) == info.key[0] ? 0 : 255;
+				}
+				return;
+			}
+			[[fallthrough]];
+		default: {
+			// Gray or palette samples of up to 8 bits, most significant
+			// first within each byte, through a table of every value.
+			uint32_t lookup[256];
+			uint32_t const values = 1u << depth;
+			for (uint32_t v = 0; v < values; ++v) {
+				if (info.color_type == 3) {
+					lookup[v] = v < info.palette_size ? info.palette[v] : PackRgba(0, 0, 0, 255);
+				}
+				else {
+					uint8_t const gray = static_cast<uint8_t>(v * 255 / (values - 1));
+					lookup[v] = PackRgba(gray, gray, gray, info.has_key && v == info.key[0] ? 0 : 255);
+				}
+			}
+			uint32_t const mask = values - 1;
+			for (uint32_t x = 0; x < width; ++x) {
+				size_t const bit = size_t(x) * depth;
+				uint32_t const v = row[bit >> 3] >> (8 - depth - (bit & 7)) & mask;
+				memcpy(out + size_t(x) * 4, &lookup[v], 4);
+			}
+			return;
+		}
+		}
+	}
+
+	// Decodes into an rgba_image_t's own tightly packed pixels.
+	class ImageBufferSink : public ImageSink
+	{
+	public:
+		explicit ImageBufferSink(rgba_image_t& image) : m_image(image) {}
+		uint8_t* Begin(uint32_t width, uint32_t height, size_t& pitch) override {
+			m_image.width = width;
+			m_image.height = height;
+			m_image.pixels.resize(size_t(width) * height * 4);
+			pitch = size_t(width) * 4;
+			return m_image.pixels.data();
+		}
+
+	private:
+		rgba_image_t& m_image;
+	};
+
+	// Reference inflate: one bit at a time, codes decoded by walking the
+	// canonical code length by length.
+	struct reference_bits_t {
+		const uint8_t* data;
+		size_t size;
+		size_t bit;
+
+		uint32_t Bit() {
+			if (bit / 8 >= size) {
+				Fail("truncated zlib stream");
+			}
+			uint32_t const value = data[bit / 8] >> (bit % 8) & 1;
+			++bit;
+			return value;
+		}
+		uint32_t Bits(int n) {
+			uint32_t value = 0;
+			for (int i = 0; i < n; ++i) value |= Bit() << i;
+			return value;
+		}
+	};
+
+	struct reference_code_t {
+		int count[16];
+		std::vector<int> symbols;
+	};
+
+	reference_code_t ReferenceCode(const uint8_t* lengths, int n) {
+		reference_code_t code = {};
+		for (int s = 0; s < n; ++s) ++code.count[lengths[s]];
+		code.count[0] = 0;
+		for (int length = 1; length < 16; ++length) {
+			for (int s = 0; s < n; ++s) {
+				if (lengths[s] == length) code.symbols.push_back(s);
+			}
+		}
+		return code;
+	}
+
+	int ReferenceDecode(reference_bits_t& bits, const reference_code_t& code) {
+		int value = 0, first = 0, index = 0;
+		for (int length = 1; length < 16; ++length) {
+			value |= static_cast<int>(bits.Bit());
+			int const count = code.count[length];
+			if (value - first < count) {
+				return code.symbols[index + value - first];
+			}
+			index += count;
+			first = (first + count) << 1;
+			value <<= 1;
+		}
+		Fail("bad Huffman code");
+	}
+
+	std::vector<uint8_t> ReferenceInflate(const std::vector<uint8_t>& zlib) {
+		reference_bits_t bits = { zlib.data(), zlib.size(), 16 };
+		std::vector<uint8_t> out;
+		for (bool last = false; !last;) {
+			last = bits.Bit() != 0;
+			uint32_t const type = bits.Bits(2);
+			if (type == 0) {
+				bits.bit = (bits.bit + 7) & ~size_t(7);
+				uint32_t const length = bits.Bits(16);
+				if ((bits.Bits(16) ^ 0xFFFF) != length) {
+					Fail("bad stored block");
+				}
+				for (uint32_t i = 0; i < length; ++i) out.push_back(static_cast<uint8_t>(bits.Bits(8)));
+				continue;
+			}
+			uint8_t lengths[320] = {};
+			int litlen_count = 288, distance_count = 30;
+			if (type == 1) {
+				for (int s = 0; s < 288; ++s) lengths[s] = s < 144 ? 8 : s < 256 ? 9 : s < 280 ? 7 : 8;
+				for (int s = 0; s < 30; ++s) lengths[288 + s] = 5;
+			}
+			else if (type == 2) {
+				litlen_count = static_cast<int>(bits.Bits(5)) + 257;
+				distance_count = static_cast<int>(bits.Bits(5)) + 1;
+				int const code_length_count = static_cast<int>(bits.Bits(4)) + 4;
+				uint8_t code_lengths[19] = {};
+				for (int i = 0; i < code_length_count; ++i) code_lengths[CODE_LENGTH_ORDER[i]] = static_cast<uint8_t>(bits.Bits(3));
+				reference_code_t const code_length_code = ReferenceCode(code_lengths, 19);
+				std::vector<uint8_t> all;
+				while (all.size() < size_t(litlen_count + distance_count)) {
+					int const symbol = ReferenceDecode(bits, code_length_code);
+					if (symbol < 16) all.push_back(static_cast<uint8_t>(symbol));
+					else if (symbol == 16) {
+						if (all.empty()) Fail("repeat without a previous length");
+						all.insert(all.end(), 3 + bits.Bits(2), all.back());
+					}
+					else if (symbol == 17) all.insert(all.end(), 3 + bits.Bits(3), uint8_t(0));
+					else all.insert(all.end(), 11 + bits.Bits(7), uint8_t(0));
+				}
+				if (all.size() != size_t(litlen_count + distance_count)) {
+					Fail("code lengths overflow");
+				}
+				std::copy(all.begin(), all.begin() + litlen_count, lengths);
+				std::copy(all.begin() + litlen_count, all.end(), lengths + 288);
+			}
+			else {
+				Fail("bad block type");
+			}
+			reference_code_t const litlen = ReferenceCode(lengths, litlen_count);
+			reference_code_t const distance = ReferenceCode(lengths + 288, distance_count);
+			while (true) {
+				int const symbol = ReferenceDecode(bits, litlen);
+				if (symbol < 256) {
+					out.push_back(static_cast<uint8_t>(symbol));
+					continue;
+				}
+				if (symbol == 256) {
+					break;
+				}
+				if (symbol > 285) {
+					Fail("bad literal/length code");
+				}
+				size_t const length = LENGTH_BASE[symbol - 257] + bits.Bits(LENGTH_EXTRA[symbol - 257]);
+				int const distance_symbol = ReferenceDecode(bits, distance);
+				if (distance_symbol >= 30) {
+					Fail("bad distance code");
+				}
+				size_t const match_distance = DISTANCE_BASE[distance_symbol] + bits.Bits(DISTANCE_EXTRA[distance_symbol]);
+				if (match_distance > out.size()) {
+					Fail("distance before the start of the data");
+				}
+				for (size_t i = 0; i < length; ++i) out.push_back(out[out.size() - match_distance]);
+			}
+		}
+		return out;
+	}
+
+	// Sample index of a row, scaled to 8 bits as the fast path does (the
+	// high byte of 16-bit samples).
+	uint32_t ReferenceSample(const png_info_t& info, const uint8_t* row, size_t index) {
+		if (info.bit_depth == 16) return static_cast<uint32_t>(row[index * 2] << 8 | row[index * 2 + 1]);
+		if (info.bit_depth == 8) return row[index];
+		size_t const bit = index * info.bit_depth;
+		return row[bit / 8] >> (8 - info.bit_depth - bit % 8) & ((1u << info.bit_depth) - 1);
+	}
+
+	uint8_t ReferenceScale(const png_info_t& info, uint32_t sample) {
+		if (info.bit_depth == 16) return static_cast<uint8_t>(sample >> 8);
+		return static_cast<uint8_t>(sample * 255 / ((1u << info.bit_depth) - 1));
+	}
+}
+
+bool IsPng(const uint8_t* data, size_t size) {
+	return size >= 8 && memcmp(data, PNG_SIGNATURE, 8) == 0;
+}
+
+void DecodePng(const uint8_t* data, size_t size, ImageSink& sink) {
+	png_info_t const info = ParsePng(data, size);
+	std::vector<uint8_t> filtered(FilteredSize(info) + INFLATE_SLACK);
+	Inflate(info.zlib, filtered.data(), filtered.size() - INFLATE_SLACK);
+
+	size_t pitch = 0;
+	uint8_t* const pixels = sink.Begin(info.width, info.height, pitch);
+	size_t const stride = FilterStride(info);
+	std::vector<uint8_t> zero_row(RowBytes(info, info.width), 0);
+	std::vector<uint8_t> pass_row;
+	uint8_t* row = filtered.data();
+	for (const pass_t& pass : Passes(info)) {
+		size_t const bytes = RowBytes(info, pass.width);
+		const uint8_t* prior = zero_row.data();
+		pass_row.resize(size_t(pass.width) * 4);
+		for (uint32_t y = 0; y < pass.height; ++y) {
+			UnfilterRow(row[0], row + 1, prior, bytes, stride);
+			uint8_t* out = pixels + size_t(pass.y + y * pass.dy) * pitch;
+			if (pass.dx == 1) {
+				ConvertRow(info, row + 1, pass.width, out);
+			}
+			else {
+				ConvertRow(info, row + 1, pass.width, pass_row.data());
+				for (uint32_t x = 0; x < pass.width; ++x) {
+					memcpy(out + size_t(pass.x + x * pass.dx) * 4, &pass_row[size_t(x) * 4], 4);
+				}
+			}
+			prior = row + 1;
+			row += bytes + 1;
+		}
+	}
+}
+
+rgba_image_t DecodePng(const uint8_t* data, size_t size) {
+	rgba_image_t image = {};
+	ImageBufferSink sink(image);
+	DecodePng(data, size, sink);
+	return image;
+}
+
+rgba_image_t DecodePngReference(const uint8_t* data, size_t size) {
+	png_info_t const info = ParsePng(data, size);
+	std::vector<uint8_t> filtered = ReferenceInflate(info.zlib);
+	if (filtered.size() != FilteredSize(info)) {
+		Fail("image data of the wrong size");
+	}
+
+	rgba_image_t image = { info.width, info.height, {} };
+	image.pixels.resize(size_t(info.width) * info.height * 4);
+	size_t const stride = FilterStride(info);
+	size_t position = 0;
+	for (const pass_t& pass : Passes(info)) {
+		size_t const bytes = RowBytes(info, pass.width);
+		std::vector<uint8_t> prior(bytes, 0);
+		for (uint32_t y = 0; y < pass.height; ++y) {
+			uint8_t const filter = filtered[position];
+			std::vector<uint8_t> row(filtered.begin() + position + 1, filtered.begin() + position + 1 + bytes);
+			for (size_t i = 0; i < bytes; ++i) {
+				int const a = i >= stride ? row[i - stride] : 0;
+				int const b = prior[i];
+				int const c = i >= stride ? prior[i - stride] : 0;
+				int predicted = 0;
+				switch (filter) {
+				case 0: predicted = 0; break;
+				case 1: predicted = a; break;
+				case 2: predicted = b; break;
+				case 3: predicted = (a + b) / 2; break;
+				case 4: predicted = Paeth(a, b, c); break;
+				default: Fail("bad filter type");
+				}
+				row[i] = static_cast<uint8_t>(row[i] + predicted);
+			}
+			for (uint32_t x = 0; x < pass.width; ++x) {
+				size_t const first = size_t(x) * info.channels;
+				uint32_t samples[4] = {};
+				for (int c = 0; c < info.channels; ++c) samples[c] = ReferenceSample(info, row.data(), first + c);
+				uint8_t rgba[4] = { 0, 0, 0, 255 };
+				switch (info.color_type) {
+				case 0:
+					rgba[0] = rgba[1] = rgba[2] = ReferenceScale(info, samples[0]);
+					if (info.has_key && samples[0] == info.key[0]) rgba[3] = 0;
+					break;
+				case 2:
+					for (int c = 0; c < 3; ++c) rgba[c] = ReferenceScale(info, samples[c]);
+					if (info.has_key && samples[0] == info.key[0] && samples[1] == info.key[1] && samples[2] == info.key[2]) rgba[3] = 0;
+					break;
+				case 3:
+					if (samples[0] < info.palette_size) memcpy(rgba, &info.palette[samples[0]], 4);
+					break;
+				case 4:
+					rgba[0] = rgba[1] = rgba[2] = ReferenceScale(info, samples[0]);
+					rgba[3] = ReferenceScale(info, samples[1]);
+					break;
+				default:
+					for (int c = 0; c < 4; ++c) rgba[c] = ReferenceScale(info, samples[c]);
+					break;
+				}
+				size_t const px = pass.x + size_t(x) * pass.dx, py = pass.y + size_t(y) * pass.dy;
+				memcpy(&image.pixels[(py * info.width + px) * 4], rgba, 4);
+			}
+			prior = row;
+			position += bytes + 1;
+		}
+	}
+	return image;
+}
+
+std::vector<rgba_image_t> DecodePngFiles(const std::vector<std::string>& paths, unsigned thread_count) {
+	std::vector<rgba_image_t> images(paths.size());
+	ParallelFor(paths.size(), ResolveThreadCount(thread_count), [&](size_t i) {
+		MappedFile file;
+		if (!file.Open(paths[i].c_str())) {
+			throw std::runtime_error("PNG: cannot open " + paths[i]);
+		}
+		images[i] = DecodePng(file.Data(), file.Size());
+	});
+	return images;
+}
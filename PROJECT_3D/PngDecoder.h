@@ -0,0 +1,36 @@
+#pragma once
+
+#include "ImageFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+bool IsPng(const uint8_t* data, size_t size);
+
+// Decodes a PNG held in memory to RGBA8 with rows width * 4 bytes apart,
+// as WIC's 32bppRGBA conversion did for LoadBitmapFromFile: every color
+// type and bit depth, palettes, tRNS transparency and Adam7 interlacing.
+// 16-bit samples keep their high byte; gamma and color chunks are ignored.
+// Chunk CRCs and the zlib checksum are not verified. Throws
+// std::runtime_error on malformed or truncated data.
+//
+// Inflate decodes Huffman codes through two-level lookup tables from a
+// 64-bit bit buffer and copies matches 16 bytes at a time. Each row is
+// unfiltered with SSE, one pixel per register for Sub, Average and Paeth,
+// and converted to RGBA8 while it is still in cache.
+rgba_image_t DecodePng(const uint8_t* data, size_t size);
+
+// The same, writing each row into sink as soon as it is unfiltered, e.g.
+// straight into a mapped upload buffer. Only the inflated scanlines are
+// held on the side; no RGBA copy of the image is.
+void DecodePng(const uint8_t* data, size_t size, ImageSink& sink);
+
+// The same decoder written the plain way: bit-at-a-time Huffman decoding,
+// byte-at-a-time unfiltering and per-sample conversion. What the fast path
+// is checked and measured against; its output is identical.
+rgba_image_t DecodePngReference(const uint8_t* data, size_t size);
+
+// Maps and decodes each file on up to thread_count threads (0: every
+// hardware thread), one image per thread at a time.
+std::vector<rgba_image_t> DecodePngFiles(const std::vector<std::string>& paths, unsigned thread_count = 0);
@@ -0,0 +1,65 @@
+#include "ReportTools.h"
+#include "ImageFile.h"
+#include "MappedFile.h"
+#include "ParallelFor.h"
+#include "PngDecoder.h"
+#include <algorithm>
+
+// Decodes each PNG with the fast decoder and the reference one, best of
+// three runs, and requires identical pixels; then decodes all of them at
+// once on every hardware thread.
+//   --png-report [png.txt] [textures.png ...]
+int PngReportTool(const std::vector<std::string>& args) {
+	std::vector<std::string> paths(args.begin() + (std::min)(args.size(), size_t(2)), args.end());
+	if (paths.empty()) {
+		paths.push_back("textures.png");
+	}
+	int const RUNS = 3;
+
+	FILE* out = OpenReport(args, "png.txt");
+	if (!out) {
+		return 1;
+	}
+	bool identical = true;
+	size_t total_bytes = 0;
+	for (const std::string& path : paths) {
+		MappedFile file;
+		if (!file.Open(path.c_str())) {
+			fprintf(out, "%s: cannot open\n", path.c_str());
+			identical = false;
+			continue;
+		}
+		rgba_image_t fast, reference;
+		double fast_seconds = 1e30, reference_seconds = 1e30;
+		for (int run = 0; run < RUNS; ++run) {
+			auto const start = std::chrono::steady_clock::now();
+			fast = DecodePng(file.Data(), file.Size());
+			auto const decoded = std::chrono::steady_clock::now();
+			reference = DecodePngReference(file.Data(), file.Size());
+			auto const end = std::chrono::steady_clock::now();
+			fast_seconds = (std::min)(fast_seconds, std::chrono::duration<double>(decoded - start).count());
+			reference_seconds = (std::min)(reference_seconds, std::chrono::duration<double>(end - decoded).count());
+		}
+		bool const same = fast.width == reference.width && fast.height == reference.height && fast.pixels == reference.pixels;
+		identical = identical && same;
+		total_bytes += fast.pixels.size();
+		double const megapixels = static_cast<double>(fast.width) * fast.height / 1e6;
+		fprintf(out, "%s: %ux%u, %zu bytes compressed\n", path.c_str(), fast.width, fast.height, file.Size());
+		fprintf(out, "  fast      %8.2f ms, %6.1f MP/s\n", fast_seconds * 1e3, megapixels / fast_seconds);
+		fprintf(out, "  reference %8.2f ms, %6.1f MP/s, %.2fx\n", reference_seconds * 1e3,
+			megapixels / reference_seconds, reference_seconds / fast_seconds);
+		fprintf(out, "  %s\n", same ? "identical" : "MISMATCH");
+	}
+
+	double concurrent_seconds = 1e30;
+	for (int run = 0; run < RUNS && identical; ++run) {
+		auto const start = std::chrono::steady_clock::now();
+		std::vector<rgba_image_t> const images = DecodePngFiles(paths);
+		concurrent_seconds = (std::min)(concurrent_seconds, Seconds(start));
+	}
+	if (identical) {
+		fprintf(out, "%zu files, %zu bytes decoded on %u threads: %.2f ms\n",
+			paths.size(), total_bytes, ResolveThreadCount(0), concurrent_seconds * 1e3);
+	}
+	return CloseReport(out, identical ? 0 : 1);
+}
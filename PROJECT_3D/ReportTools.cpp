@@ -0,0 +1,176 @@
+#include "ReportTools.h"
+#include "FileUtil.h"
+#include "SceneAsset.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+	// Free space between neighbouring copies of a report grid.
+	float const GRID_GAP = 2.0f;
+	float const TWO_PI = 6.2831853f;
+}
+
+std::vector<report_input_t> ReportInputs(const std::vector<std::string>& args, uint32_t default_size, bool rotate) {
+	uint32_t const columns = args.size() > 2 ? static_cast<uint32_t>(std::stoul(args[2])) : default_size;
+	uint32_t const rows = args.size() > 3 ? static_cast<uint32_t>(std::stoul(args[3])) : default_size;
+	std::vector<report_input_t> inputs(2);
+	inputs[0].name = "room";
+	inputs[0].vertices = SceneSourceVertices();
+	inputs[1].name = "grid";
+	inputs[1].vertices = ReportGrid(inputs[0].vertices, columns, rows, rotate);
+	return inputs;
+}
+
+std::vector<vertex_t> ReportGrid(const std::vector<vertex_t>& source, uint32_t columns, uint32_t rows, bool rotate) {
+	float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (const vertex_t& v : source) {
+		for (int k = 0; k < 3; ++k) {
+			lo[k] = (std::min)(lo[k], v.position[k]);
+			hi[k] = (std::max)(hi[k], v.position[k]);
+		}
+	}
+	float const center[2] = { (lo[0] + hi[0]) * 0.5f, (lo[2] + hi[2]) * 0.5f };
+	float const extent[2] = { hi[0] - lo[0], hi[2] - lo[2] };
+	// Any yaw fits in the circle around the footprint.
+	float const diagonal = std::sqrt(extent[0] * extent[0] + extent[1] * extent[1]);
+	float const cell[2] = { (rotate ? diagonal : extent[0]) + GRID_GAP, (rotate ? diagonal : extent[1]) + GRID_GAP };
+
+	std::vector<vertex_t> grid;
+	grid.reserve(source.size() * columns * rows);
+	uint32_t noise = 1;
+	for (uint32_t row = 0; row < rows; ++row) {
+		for (uint32_t column = 0; column < columns; ++column) {
+			float yaw = 0.0f;
+			if (rotate) {
+				noise = noise * 1664525u + 1013904223u;
+				yaw = static_cast<float>(noise >> 8) / 16777216.0f * TWO_PI;
+			}
+			float const c = std::cos(yaw), s = std::sin(yaw);
+			float const offset[2] = { (static_cast<float>(column) + 0.5f) * cell[0], (static_cast<float>(row) + 0.5f) * cell[1] };
+			for (vertex_t v : source) {
+				float const x = v.position[0] - center[0], z = v.position[2] - center[1];
+				v.position[0] = offset[0] + c * x + s * z;
+				v.position[2] = offset[1] - s * x + c * z;
+				grid.push_back(v);
+			}
+		}
+	}
+	return grid;
+}
+
+FILE* OpenReport(const std::vector<std::string>& args, const char* default_path) {
+	return OpenFile(args.size() > 1 ? args[1].c_str() : default_path, "w");
+}
+
+int CloseReport(FILE* out, size_t failures) {
+	bool const written = fclose(out) == 0;
+	return written && failures == 0 ? 0 : 1;
+}
+
+std::vector<std::array<uint32_t, 3>> SortedTriangles(const std::vector<uint32_t>& indices) {
+	std::vector<std::array<uint32_t, 3>> triangles;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		std::array<uint32_t, 3> t = { indices[i], indices[i + 1], indices[i + 2] };
+		while (t[0] > t[1] || t[0] > t[2]) {
+			t = { t[1], t[2], t[0] };
+		}
+		triangles.push_back(t);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+std::vector<ray_t> RandomRays(const std::vector<vertex_t>& vertices, size_t count, uint32_t seed) {
+	float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (const vertex_t& v : vertices) {
+		for (int k = 0; k < 3; ++k) {
+			lo[k] = (std::min)(lo[k], v.position[k]);
+			hi[k] = (std::max)(hi[k], v.position[k]);
+		}
+	}
+	std::vector<ray_t> rays(count);
+	uint32_t noise = seed;
+	for (ray_t& ray : rays) {
+		float target[3];
+		for (int k = 0; k < 3; ++k) {
+			noise = noise * 1664525u + 1013904223u;
+			ray.origin[k] = lo[k] + (hi[k] - lo[k]) * static_cast<float>(noise >> 8) / 16777216.0f;
+			noise = noise * 1664525u + 1013904223u;
+			target[k] = lo[k] + (hi[k] - lo[k]) * static_cast<float>(noise >> 8) / 16777216.0f;
+			ray.direction[k] = target[k] - ray.origin[k];
+		}
+		ray.t_max = 1.0f;
+	}
+	return rays;
+}
+
+void LookAtPerspective(const float eye[3], const float at[3], float fov_y, float aspect, float z_near, float z_far, float* view_proj) {
+	float z[3] = { at[0] - eye[0], at[1] - eye[1], at[2] - eye[2] };
+	float const z_length = sqrtf(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
+	for (float& c : z) {
+		c /= z_length;
+	}
+	// x = up x z with up = +y.
+	float x[3] = { z[2], 0.0f, -z[0] };
+	float const x_length = sqrtf(x[0] * x[0] + x[2] * x[2]);
+	for (float& c : x) {
+		c /= x_length;
+	}
+	float const y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+	float view[16] = {};
+	for (int i = 0; i < 3; ++i) {
+		view[i * 4 + 0] = x[i];
+		view[i * 4 + 1] = y[i];
+		view[i * 4 + 2] = z[i];
+		view[12] -= x[i] * eye[i];
+		view[13] -= y[i] * eye[i];
+		view[14] -= z[i] * eye[i];
+	}
+	view[15] = 1.0f;
+	float const y_scale = 1.0f / tanf(0.5f * fov_y);
+	float const range = z_far / (z_far - z_near);
+	float const projection[16] = {
+		y_scale / aspect, 0.0f, 0.0f, 0.0f,
+		0.0f, y_scale, 0.0f, 0.0f,
+		0.0f, 0.0f, range, 1.0f,
+		0.0f, 0.0f, -range * z_near, 0.0f,
+	};
+	for (int i = 0; i < 4; ++i) {
+		for (int j = 0; j < 4; ++j) {
+			float sum = 0.0f;
+			for (int k = 0; k < 4; ++k) {
+				sum += view[i * 4 + k] * projection[k * 4 + j];
+			}
+			view_proj[i * 4 + j] = sum;
+		}
+	}
+}
+
+std::vector<uint8_t> BlockTestImage(uint32_t width, uint32_t height) {
+	std::vector<uint8_t> image(static_cast<size_t>(width) * height * 4);
+	uint32_t noise = 1;
+	for (uint32_t y = 0; y < height; ++y) {
+		for (uint32_t x = 0; x < width; ++x) {
+			noise = noise * 1664525u + 1013904223u;
+			float const grain = static_cast<float>(noise >> 24) / 255.0f * 0.1f - 0.05f;
+			float const u = static_cast<float>(x) / width, v = static_cast<float>(y) / height;
+			float color[3] = {
+				0.5f + 0.5f * std::sin(u * 9.0f + v * 3.0f),
+				0.5f + 0.5f * std::sin(v * 7.0f - u * 2.0f),
+				0.5f + 0.5f * std::cos((u + v) * 5.0f),
+			};
+			float const cu = std::fmod(u * 6.0f, 1.0f) - 0.5f, cv = std::fmod(v * 6.0f, 1.0f) - 0.5f;
+			if (cu * cu + cv * cv < 0.09f) {
+				color[(x / (width / 6 + 1) + y / (height / 6 + 1)) % 3] = 1.0f;
+			}
+			float const alpha = u < 0.5f ? v : ((x / 8 + y / 8) % 3 == 0 ? 0.0f : 1.0f);
+			uint8_t* p = &image[(static_cast<size_t>(y) * width + x) * 4];
+			for (int c = 0; c < 3; ++c) {
+				p[c] = static_cast<uint8_t>(std::clamp(color[c] + grain, 0.0f, 1.0f) * 255.0f + 0.5f);
+			}
+			p[3] = static_cast<uint8_t>(alpha * 255.0f + 0.5f);
+		}
+	}
+	return image;
+}
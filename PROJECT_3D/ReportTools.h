@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Bvh.h"
+#include "Vertex.h"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// The --*-report tools check one module each and live next to it, in
+// <Module>Report.cpp. Each writes its findings to args[1] and returns 0
+// when every check passed, 1 otherwise.
+
+// A triangle list a geometry report runs on.
+struct report_input_t {
+    const char* name;
+    std::vector<vertex_t> vertices;
+};
+
+// The room and a grid of copies of it, args[2] columns by args[3] rows
+// (default_size when left out).
+std::vector<report_input_t> ReportInputs(const std::vector<std::string>& args, uint32_t default_size, bool rotate = true);
+
+// columns x rows copies of source, one per grid cell, spaced so they never
+// overlap. With rotate each copy turns about y by a random angle drawn
+// from its index, so the same grid comes out every time.
+std::vector<vertex_t> ReportGrid(const std::vector<vertex_t>& source, uint32_t columns, uint32_t rows, bool rotate = true);
+
+// Opens args[1], or default_path when it is left out, for writing.
+FILE* OpenReport(const std::vector<std::string>& args, const char* default_path);
+
+// Closes the report: 0 when it was written and nothing failed.
+int CloseReport(FILE* out, size_t failures);
+
+// Seconds since start, for timing a step.
+inline double Seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Triangles of an index list, each rotated to start at its smallest index
+// so winding is kept, then sorted: equal for two orderings of the same
+// triangles.
+std::vector<std::array<uint32_t, 3>> SortedTriangles(const std::vector<uint32_t>& indices);
+
+// Rays between random points of the bounds, extended past the far one for
+// Intersect and ending there for Occluded.
+std::vector<ray_t> RandomRays(const std::vector<vertex_t>& vertices, size_t count, uint32_t seed);
+
+// Row-major view-projection for row vectors, as OnUpdate builds it: a
+// left-handed look-at and perspective with D3D depth.
+void LookAtPerspective(const float eye[3], const float at[3], float fov_y, float aspect, float z_near, float z_far, float* view_proj);
+
+// Smooth color fields with grain, hard-edged discs and a cut-out alpha
+// mask: the mix of content an atlas holds.
+std::vector<uint8_t> BlockTestImage(uint32_t width, uint32_t height);
+
+int WeldReportTool(const std::vector<std::string>& args);
+int CacheReportTool(const std::vector<std::string>& args);
+int QuantizeReportTool(const std::vector<std::string>& args);
+int LoadReportTool(const std::vector<std::string>& args);
+int MeshletReportTool(const std::vector<std::string>& args);
+int RayReportTool(const std::vector<std::string>& args);
+int SegmentReportTool(const std::vector<std::string>& args);
+int CullReportTool(const std::vector<std::string>& args);
+int OcclusionReportTool(const std::vector<std::string>& args);
+int SimplifyReportTool(const std::vector<std::string>& args);
+int MergeReportTool(const std::vector<std::string>& args);
+int InstanceReportTool(const std::vector<std::string>& args);
+int CollisionReportTool(const std::vector<std::string>& args);
+int ImportReportTool(const std::vector<std::string>& args);
+int StreamReportTool(const std::vector<std::string>& args);
+int GenerateReportTool(const std::vector<std::string>& args);
+int MipReportTool(const std::vector<std::string>& args);
+int BlockReportTool(const std::vector<std::string>& args);
+int TextureReportTool(const std::vector<std::string>& args);
+int AtlasReportTool(const std::vector<std::string>& args);
+int PngReportTool(const std::vector<std::string>& args);
+int DecodeReportTool(const std::vector<std::string>& args);
+int UploadRingReportTool(const std::vector<std::string>& args);
+int TextureStreamReportTool(const std::vector<std::string>& args);
+int VirtualTextureReportTool(const std::vector<std::string>& args);
@@ -0,0 +1,94 @@
+#include "SceneAsset.h"
+#include "MeshAsset.h"
+#include "MeshWeld.h"
+#include "ObjectSegmentation.h"
+#include "SceneVertices.h"
+#include <algorithm>
+
+scene_bake_stats_t BakeSceneAsset(const char* path) {
+	return BakeMeshAsset(path, SceneSourceVertices());
+}
+
+scene_bake_stats_t BakeMeshAsset(const char* path, std::vector<vertex_t> source) {
+	scene_bake_stats_t stats = {};
+	stats.source_vertices = source.size();
+
+	// Tiled surfaces sharing one texture mapping become larger polygons;
+	// the sampler wraps, so mappings a whole period apart merge too.
+	stats.merge = MergeCoplanarTriangles(source, true);
+
+	// The scene is stored as a plain triangle list; weld duplicates so
+	// each unique vertex is fetched and transformed only once.
+	indexed_mesh_t scene_mesh = WeldVertices(source.data(), source.size());
+	stats.unique_vertices = scene_mesh.vertices.size();
+
+	// Triangle order decides how often the post-transform cache hits.
+	stats.cache_before = AnalyzeVertexCacheFifo(
+		scene_mesh.indices.data(), scene_mesh.indices.size(), scene_mesh.vertices.size()
+	);
+	OptimizeVertexCache(
+		scene_mesh.indices.data(), scene_mesh.indices.size(), scene_mesh.vertices.size()
+	);
+	OptimizeOverdraw(
+		scene_mesh.indices.data(), scene_mesh.indices.size(),
+		scene_mesh.vertices.data(), scene_mesh.vertices.size()
+	);
+	stats.cache_after = AnalyzeVertexCacheFifo(
+		scene_mesh.indices.data(), scene_mesh.indices.size(), scene_mesh.vertices.size()
+	);
+
+	// Objects keep the optimized triangle order within their ranges.
+	std::vector<scene_object_t> objects = SegmentObjects(
+		scene_mesh.vertices.data(), scene_mesh.vertices.size(), scene_mesh.indices
+	);
+	stats.object_count = objects.size();
+
+	// Repeated objects keep only a placement and draw their prototype.
+	std::vector<object_instance_t> const instances = DetectInstances(
+		scene_mesh.vertices.data(), scene_mesh.vertices.size(), scene_mesh.indices, objects
+	);
+	stats.instancing = ShareInstanceGeometry(scene_mesh, objects, instances);
+
+	// Coarser levels share the vertex buffer and append index ranges; they
+	// are built once per prototype.
+	std::vector<scene_object_t> prototypes;
+	for (size_t i = 0; i < objects.size(); ++i) {
+		if (instances[i].prototype == i) {
+			prototypes.push_back(objects[i]);
+		}
+	}
+	std::vector<object_lods_t> const prototype_lods = BuildLodChains(
+		scene_mesh.vertices.data(), scene_mesh.vertices.size(), scene_mesh.indices, prototypes
+	);
+	std::vector<object_lods_t> lods(objects.size());
+	for (size_t i = 0, p = 0; i < objects.size(); ++i) {
+		lods[i] = instances[i].prototype == i ? prototype_lods[p++] : lods[instances[i].prototype];
+	}
+	for (const object_lods_t& chain : lods) {
+		for (uint32_t level = 0; level < MAX_LOD_LEVELS; ++level) {
+			stats.lod_triangles[level] += chain.index_count[std::min(level, chain.level_count - 1)] / 3;
+		}
+	}
+
+	quantized_vertices_t const packed = QuantizeVertices(
+		scene_mesh.vertices.data(), scene_mesh.vertices.size()
+	);
+	stats.bytes_per_vertex = packed.BytesPerVertex();
+
+	// Grow the bounds by the quantization error so culling stays
+	// conservative against the decoded positions.
+	float const margin = packed.PositionErrorBound() * 2.0f;
+	for (scene_object_t& object : objects) {
+		for (int k = 0; k < 3; ++k) {
+			object.aabb_min[k] -= margin;
+			object.aabb_max[k] += margin;
+		}
+	}
+
+	WriteMeshAsset(path, packed, scene_mesh.indices, objects, lods, instances);
+	return stats;
+}
+
+std::vector<vertex_t> SceneSourceVertices() {
+	return std::vector<vertex_t>(vertices_data, vertices_data + sizeof(vertices_data) / sizeof(vertices_data[0]));
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "CoplanarMerge.h"
+#include "InstanceDetect.h"
+#include "MeshSimplify.h"
+#include "VertexCache.h"
+#include <vector>
+
+const char* const SCENE_ASSET_PATH = "scene.p3dm";
+
+struct scene_bake_stats_t {
+    size_t source_vertices;
+    coplanar_merge_stats_t merge;
+    size_t unique_vertices;
+    size_t bytes_per_vertex;
+    size_t object_count;
+    instance_stats_t instancing;
+    vertex_cache_stats_t cache_before;
+    vertex_cache_stats_t cache_after;
+    // Triangles drawn when every object uses level k (or its coarsest).
+    size_t lod_triangles[MAX_LOD_LEVELS];
+};
+
+// Converts the compiled-in vertices_data into a mesh asset: merges
+// coplanar triangles, welds, optimizes triangle order, splits it into
+// objects, shares the geometry of repeated objects, builds LOD chains,
+// quantizes and writes it to path.
+scene_bake_stats_t BakeSceneAsset(const char* path);
+// Bakes any triangle list the same way, e.g. one from ImportMesh.
+scene_bake_stats_t BakeMeshAsset(const char* path, std::vector<vertex_t> source);
+
+// Copy of the compiled-in triangle list, for offline tools.
+std::vector<vertex_t> SceneSourceVertices();
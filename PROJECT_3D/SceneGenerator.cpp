@@ -0,0 +1,280 @@
+#include "SceneGenerator.h"
+#include "MeshWeld.h"
+#include "ObjectSegmentation.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+	// Chunks handed to emit hold about this many vertices (36 MB).
+	size_t const CHUNK_VERTICES = 1 << 20;
+	size_t const COPIES_PER_TASK = 64;
+	uint32_t const WHOLE_TEMPLATE = UINT32_MAX;
+	uint64_t const COPY_STREAM = 0;
+	uint64_t const TOWER_STREAM = 1;
+	float const TWO_PI = 6.2831853f;
+
+	// SplitMix64 finalizer.
+	uint64_t Mix(uint64_t x) {
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+		return x ^ (x >> 31);
+	}
+
+	// Independent stream per (seed, stream, index), so any copy can be
+	// placed without generating the ones before it.
+	struct random_t {
+		uint64_t state;
+
+		random_t(uint64_t seed, uint64_t stream, uint64_t index)
+			: state(Mix(Mix(seed) + Mix(stream + 1) + index)) {
+		}
+
+		uint64_t Next() {
+			state += 0x9E3779B97F4A7C15ull;
+			return Mix(state);
+		}
+
+		// [0, 1)
+		float Uniform() {
+			return static_cast<float>(Next() >> 40) * (1.0f / 16777216.0f);
+		}
+
+		// [-1, 1)
+		float Signed() {
+			return Uniform() * 2.0f - 1.0f;
+		}
+	};
+
+	// transform = translate(offset) * scale * rotate(yaw about y) * translate(-pivot)
+	void YawTransform(float yaw, const float pivot[3], const float offset[3], float transform[3][4]) {
+		float const c = std::cos(yaw), s = std::sin(yaw);
+		float const rotation[3][3] = { { c, 0.0f, s }, { 0.0f, 1.0f, 0.0f }, { -s, 0.0f, c } };
+		for (int r = 0; r < 3; ++r) {
+			for (int k = 0; k < 3; ++k) {
+				transform[r][k] = rotation[r][k];
+			}
+			transform[r][3] = offset[r] - (rotation[r][0] * pivot[0] + rotation[r][1] * pivot[1] + rotation[r][2] * pivot[2]);
+		}
+	}
+}
+
+SceneGenerator::SceneGenerator(std::vector<vertex_t> source)
+	: m_source(std::move(source)) {
+	if (m_source.size() < 3) {
+		throw std::runtime_error("SceneGenerator: empty template");
+	}
+	m_source.resize(m_source.size() / 3 * 3);
+	for (int c = 0; c < 3; ++c) {
+		m_min[c] = m_max[c] = m_source[0].position[c];
+	}
+	for (const vertex_t& vertex : m_source) {
+		for (int c = 0; c < 3; ++c) {
+			m_min[c] = std::min(m_min[c], vertex.position[c]);
+			m_max[c] = std::max(m_max[c], vertex.position[c]);
+		}
+	}
+	m_whole.first = 0;
+	m_whole.count = m_source.size();
+	for (int c = 0; c < 3; ++c) {
+		m_whole.center[c] = (m_min[c] + m_max[c]) * 0.5f;
+	}
+
+	// The soup scatters the template's individual objects.
+	indexed_mesh_t mesh = WeldVertices(m_source.data(), m_source.size());
+	std::vector<scene_object_t> const objects = SegmentObjects(mesh.vertices.data(), mesh.vertices.size(), mesh.indices);
+	for (const scene_object_t& object : objects) {
+		if (object.index_count == 0) {
+			continue;
+		}
+		range_t range;
+		range.first = m_objectVertices.size();
+		range.count = object.index_count;
+		for (int c = 0; c < 3; ++c) {
+			range.center[c] = (object.aabb_min[c] + object.aabb_max[c]) * 0.5f;
+		}
+		for (uint32_t i = 0; i < object.index_count; ++i) {
+			m_objectVertices.push_back(mesh.vertices[mesh.indices[object.first_index + i]]);
+		}
+		m_objects.push_back(range);
+	}
+}
+
+SceneGenerator::plan_t SceneGenerator::Plan(const scene_generator_config_t& config) const {
+	plan_t plan;
+	plan.config = config;
+	plan.config.floors = std::max(config.floors, 1u);
+	float const extent[2] = { m_max[0] - m_min[0], m_max[2] - m_min[2] };
+	float const diagonal = std::sqrt(extent[0] * extent[0] + extent[1] * extent[1]);
+	float const widest = std::max(extent[0], extent[1]);
+	if (config.layout == scene_layout_t::rooms && config.rotate) {
+		// Any yaw fits in the circle around the footprint.
+		plan.cell[0] = plan.cell[1] = diagonal + config.gap;
+	}
+	else if (config.layout != scene_layout_t::rooms && (config.rotate || config.layout == scene_layout_t::soup)) {
+		// Quarter turns swap the footprint's sides.
+		plan.cell[0] = plan.cell[1] = widest + config.gap;
+	}
+	else {
+		plan.cell[0] = extent[0] + config.gap;
+		plan.cell[1] = extent[1] + config.gap;
+	}
+
+	uint64_t const cells = static_cast<uint64_t>(config.columns) * config.rows;
+	if (config.layout == scene_layout_t::rooms) {
+		plan.copies = cells;
+	}
+	else if (config.layout == scene_layout_t::towers) {
+		plan.tower_first.resize(static_cast<size_t>(cells));
+		plan.copies = 0;
+		for (uint64_t tower = 0; tower < cells; ++tower) {
+			random_t random(config.seed, TOWER_STREAM, tower);
+			plan.tower_first[static_cast<size_t>(tower)] = plan.copies;
+			plan.copies += 1 + random.Next() % plan.config.floors;
+		}
+	}
+	else {
+		plan.copies = m_objects.empty() || cells == 0 ? 0 : config.objects;
+	}
+	return plan;
+}
+
+SceneGenerator::placement_t SceneGenerator::Place(const plan_t& plan, uint64_t copy) const {
+	const scene_generator_config_t& config = plan.config;
+	placement_t placement;
+	random_t random(config.seed, COPY_STREAM, copy);
+	float const height = m_max[1] - m_min[1];
+
+	if (config.layout == scene_layout_t::soup) {
+		placement.object = static_cast<uint32_t>(random.Next() % m_objects.size());
+		const range_t& object = m_objects[placement.object];
+
+		// Uniform random rotation from a unit quaternion (Shoemake).
+		float const u0 = random.Uniform(), u1 = random.Uniform() * TWO_PI, u2 = random.Uniform() * TWO_PI;
+		float const a = std::sqrt(1.0f - u0), b = std::sqrt(u0);
+		float const x = a * std::sin(u1), y = a * std::cos(u1), z = b * std::sin(u2), w = b * std::cos(u2);
+		// Log-uniform between half and twice the original size.
+		float const scale = 0.5f * std::pow(4.0f, random.Uniform());
+		float const rotation[3][3] = {
+			{ 1 - 2 * (y * y + z * z), 2 * (x * y - z * w), 2 * (x * z + y * w) },
+			{ 2 * (x * y + z * w), 1 - 2 * (x * x + z * z), 2 * (y * z - x * w) },
+			{ 2 * (x * z - y * w), 2 * (y * z + x * w), 1 - 2 * (x * x + y * y) },
+		};
+		float const position[3] = {
+			random.Uniform() * plan.cell[0] * config.columns,
+			m_min[1] + random.Uniform() * height * config.floors,
+			random.Uniform() * plan.cell[1] * config.rows,
+		};
+		for (int r = 0; r < 3; ++r) {
+			float pivot = 0.0f;
+			for (int k = 0; k < 3; ++k) {
+				placement.transform[r][k] = rotation[r][k] * scale;
+				pivot += placement.transform[r][k] * object.center[k];
+			}
+			placement.transform[r][3] = position[r] - pivot;
+		}
+		return placement;
+	}
+
+	placement.object = WHOLE_TEMPLATE;
+	uint64_t cell = copy, floor = 0;
+	if (config.layout == scene_layout_t::towers) {
+		cell = static_cast<uint64_t>(std::upper_bound(plan.tower_first.begin(), plan.tower_first.end(), copy) - plan.tower_first.begin()) - 1;
+		floor = copy - plan.tower_first[static_cast<size_t>(cell)];
+	}
+
+	// A tower's floors share its jitter so they stay stacked.
+	random_t jitter = config.layout == scene_layout_t::towers ? random_t(config.seed, TOWER_STREAM, cell) : random;
+	if (config.layout == scene_layout_t::towers) {
+		jitter.Next();
+	}
+	float const reach = config.jitter * config.gap * 0.5f;
+	float const offset[3] = {
+		(static_cast<float>(cell % config.columns) + 0.5f) * plan.cell[0] + jitter.Signed() * reach,
+		m_whole.center[1] + static_cast<float>(floor) * height,
+		(static_cast<float>(cell / config.columns) + 0.5f) * plan.cell[1] + jitter.Signed() * reach,
+	};
+	float yaw = 0.0f;
+	if (config.rotate) {
+		yaw = config.layout == scene_layout_t::towers ? static_cast<float>(random.Next() % 4) * (TWO_PI / 4.0f) : random.Uniform() * TWO_PI;
+	}
+	YawTransform(yaw, m_whole.center, offset, placement.transform);
+	return placement;
+}
+
+const SceneGenerator::range_t& SceneGenerator::Range(uint32_t object) const {
+	return object == WHOLE_TEMPLATE ? m_whole : m_objects[object];
+}
+
+uint64_t SceneGenerator::CopyCount(const scene_generator_config_t& config) const {
+	return Plan(config).copies;
+}
+
+uint64_t SceneGenerator::VertexCount(const scene_generator_config_t& config) const {
+	plan_t const plan = Plan(config);
+	if (config.layout != scene_layout_t::soup) {
+		return plan.copies * m_whole.count;
+	}
+	uint64_t count = 0;
+	for (uint64_t copy = 0; copy < plan.copies; ++copy) {
+		random_t random(config.seed, COPY_STREAM, copy);
+		count += m_objects[static_cast<size_t>(random.Next() % m_objects.size())].count;
+	}
+	return count;
+}
+
+void SceneGenerator::Generate(
+	const scene_generator_config_t& config, const std::function<void(const vertex_t*, size_t)>& emit,
+	unsigned thread_count
+) const {
+	thread_count = ResolveThreadCount(thread_count);
+	plan_t const plan = Plan(config);
+	std::vector<placement_t> placements;
+	std::vector<size_t> offsets;
+	std::vector<vertex_t> chunk;
+	uint64_t copy = 0;
+	while (copy < plan.copies) {
+		// Placing is cheap next to transforming, so it stays serial and
+		// fixes every copy's place in the chunk up front.
+		placements.clear();
+		offsets.clear();
+		size_t total = 0;
+		while (copy < plan.copies && total < CHUNK_VERTICES) {
+			placements.push_back(Place(plan, copy++));
+			offsets.push_back(total);
+			total += Range(placements.back().object).count;
+		}
+		chunk.resize(total);
+
+		size_t const tasks = (placements.size() + COPIES_PER_TASK - 1) / COPIES_PER_TASK;
+		ParallelFor(tasks, thread_count, [&](size_t task) {
+			size_t const end = std::min(placements.size(), (task + 1) * COPIES_PER_TASK);
+			for (size_t p = task * COPIES_PER_TASK; p < end; ++p) {
+				const placement_t& placement = placements[p];
+				const range_t& range = Range(placement.object);
+				const vertex_t* in = (placement.object == WHOLE_TEMPLATE ? m_source.data() : m_objectVertices.data()) + range.first;
+				vertex_t* out = chunk.data() + offsets[p];
+				for (size_t v = 0; v < range.count; ++v) {
+					out[v] = in[v];
+					for (int r = 0; r < 3; ++r) {
+						const float* row = placement.transform[r];
+						out[v].position[r] = row[0] * in[v].position[0] + row[1] * in[v].position[1] +
+							row[2] * in[v].position[2] + row[3];
+					}
+				}
+			}
+		});
+		emit(chunk.data(), chunk.size());
+	}
+}
+
+std::vector<vertex_t> SceneGenerator::GenerateVertices(const scene_generator_config_t& config, unsigned thread_count) const {
+	std::vector<vertex_t> vertices;
+	vertices.reserve(static_cast<size_t>(VertexCount(config)));
+	Generate(config, [&](const vertex_t* chunk, size_t count) {
+		vertices.insert(vertices.end(), chunk, chunk + count);
+	}, thread_count);
+	return vertices;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Vertex.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+enum class scene_layout_t {
+    rooms,                      // one copy of the template per grid cell
+    towers,                     // a stack of 1 to floors copies per grid cell
+    soup,                       // objects of the template scattered over the grid
+};
+
+struct scene_generator_config_t {
+    scene_layout_t layout = scene_layout_t::rooms;
+    uint32_t columns = 8;       // grid cells along x
+    uint32_t rows = 8;          // grid cells along z
+    uint32_t floors = 4;        // towers: height of the tallest; soup: height of the scatter volume
+    uint64_t objects = 10000;   // soup only
+    uint64_t seed = 1;
+    float gap = 2.0f;           // free space between neighbouring grid cells
+    float jitter = 0.5f;        // fraction of the gap a copy is moved by at most
+    bool rotate = true;         // rooms turn freely about y, tower floors in quarter turns
+};
+
+// Builds stress scenes out of copies of a template triangle list, e.g. the
+// compiled-in room. Every copy is placed by a random stream derived from the
+// seed and the copy's index alone, so a config always produces the same
+// vertices, whatever the thread count. Copies never overlap in the grid
+// layouts; the soup is random and does.
+class SceneGenerator
+{
+public:
+    explicit SceneGenerator(std::vector<vertex_t> source);
+
+    uint64_t CopyCount(const scene_generator_config_t& config) const;
+    uint64_t VertexCount(const scene_generator_config_t& config) const;
+
+    // Produces the scene in order, in chunks of about a million vertices,
+    // so scenes far larger than memory can be written out as they are made.
+    void Generate(
+        const scene_generator_config_t& config, const std::function<void(const vertex_t*, size_t)>& emit,
+        unsigned thread_count = 0
+    ) const;
+    std::vector<vertex_t> GenerateVertices(const scene_generator_config_t& config, unsigned thread_count = 0) const;
+
+    size_t ObjectCount() const { return m_objects.size(); }
+
+private:
+    struct placement_t {
+        uint32_t object;        // index into m_objects, or the whole template
+        float transform[3][4];
+    };
+    struct range_t {
+        size_t first;
+        size_t count;
+        float center[3];
+    };
+    // Per-config layout: where each tower's copies start in copy order.
+    struct plan_t {
+        scene_generator_config_t config;
+        float cell[2];
+        std::vector<uint64_t> tower_first;
+        uint64_t copies;
+    };
+
+    plan_t Plan(const scene_generator_config_t& config) const;
+    placement_t Place(const plan_t& plan, uint64_t copy) const;
+    const range_t& Range(uint32_t object) const;
+
+    std::vector<vertex_t> m_source;
+    std::vector<vertex_t> m_objectVertices;
+    std::vector<range_t> m_objects;
+    range_t m_whole;
+    float m_min[3];
+    float m_max[3];
+};
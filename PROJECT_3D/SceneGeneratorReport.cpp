@@ -0,0 +1,146 @@
+#include "ReportTools.h"
+#include "ParallelFor.h"
+#include "SceneAsset.h"
+#include "SceneGenerator.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+
+// Generates every layout at one thread and at several, checks that the
+// output is the same bit for bit, that streamed chunks add up to the
+// whole, that the counts are the ones promised, that a seed repeats and
+// another seed differs, and that no two copies of the room or tower
+// layouts overlap. Prints the generation speed on a larger grid.
+// Fails on any difference or overlap.
+//   --generate-report [generate.txt] [columns] [rows]
+int GenerateReportTool(const std::vector<std::string>& args) {
+	uint32_t const columns = args.size() > 2 ? static_cast<uint32_t>(std::stoul(args[2])) : 64;
+	uint32_t const rows = args.size() > 3 ? static_cast<uint32_t>(std::stoul(args[3])) : 64;
+	float const OVERLAP_TOLERANCE = 1e-3f;
+	unsigned const threads = (std::max)(ResolveThreadCount(0), 4u);
+
+	std::vector<vertex_t> const room = SceneSourceVertices();
+	SceneGenerator const generator(room);
+	size_t const copy_vertices = room.size() / 3 * 3;
+	struct input_t {
+		const char* name;
+		scene_generator_config_t config;
+	};
+	std::vector<input_t> inputs(5);
+	inputs[0].name = "rooms turned freely";
+	inputs[1].name = "rooms translated";
+	inputs[1].config.rotate = false;
+	inputs[2].name = "towers";
+	inputs[2].config.layout = scene_layout_t::towers;
+	inputs[3].name = "towers without jitter";
+	inputs[3].config.layout = scene_layout_t::towers;
+	inputs[3].config.jitter = 0.0f;
+	inputs[4].name = "soup";
+	inputs[4].config.layout = scene_layout_t::soup;
+	inputs[4].config.objects = 20000;
+
+	FILE* out = OpenReport(args, "generate.txt");
+	if (!out) {
+		return 1;
+	}
+	auto const same = [](const std::vector<vertex_t>& a, const std::vector<vertex_t>& b) {
+		return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(vertex_t)) == 0);
+	};
+	size_t failures = 0;
+	for (const input_t& input : inputs) {
+		const scene_generator_config_t& config = input.config;
+		std::vector<vertex_t> const serial = generator.GenerateVertices(config, 1);
+		std::vector<vertex_t> const parallel = generator.GenerateVertices(config, threads);
+		std::vector<vertex_t> streamed;
+		size_t chunks = 0, empty_chunks = 0;
+		generator.Generate(config, [&](const vertex_t* vertices, size_t count) {
+			streamed.insert(streamed.end(), vertices, vertices + count);
+			++chunks;
+			empty_chunks += count == 0;
+		}, threads);
+		scene_generator_config_t reseeded = config;
+		std::vector<vertex_t> const repeated = generator.GenerateVertices(reseeded, threads);
+		reseeded.seed = config.seed + 1;
+		std::vector<vertex_t> const other = generator.GenerateVertices(reseeded, threads);
+
+		uint64_t const copies = generator.CopyCount(config);
+		bool const counts_match = serial.size() == generator.VertexCount(config) &&
+			(config.layout == scene_layout_t::soup ? copies == config.objects : serial.size() == copies * copy_vertices);
+		bool const threads_match = same(serial, parallel);
+		bool const chunks_match = same(serial, streamed) && empty_chunks == 0;
+		bool const seed_repeats = same(serial, repeated);
+		bool const seed_differs = !same(serial, other);
+
+		// Copies are consecutive runs of the whole room; the soup's
+		// scattered objects may overlap by design.
+		size_t overlaps = 0;
+		if (config.layout != scene_layout_t::soup && counts_match) {
+			std::vector<std::array<float, 6>> bounds(static_cast<size_t>(copies));
+			for (size_t copy = 0; copy < bounds.size(); ++copy) {
+				std::array<float, 6>& box = bounds[copy];
+				for (int c = 0; c < 3; ++c) {
+					box[c] = FLT_MAX;
+					box[3 + c] = -FLT_MAX;
+				}
+				for (size_t v = copy * copy_vertices; v < (copy + 1) * copy_vertices; ++v) {
+					for (int c = 0; c < 3; ++c) {
+						box[c] = (std::min)(box[c], serial[v].position[c]);
+						box[3 + c] = (std::max)(box[3 + c], serial[v].position[c]);
+					}
+				}
+			}
+			for (size_t a = 0; a < bounds.size(); ++a) {
+				for (size_t b = a + 1; b < bounds.size(); ++b) {
+					bool overlap = true;
+					for (int c = 0; c < 3; ++c) {
+						overlap = overlap && (std::min)(bounds[a][3 + c], bounds[b][3 + c]) -
+							(std::max)(bounds[a][c], bounds[b][c]) > OVERLAP_TOLERANCE;
+					}
+					overlaps += overlap;
+				}
+			}
+		}
+		fprintf(out, "%s: %llu copies, %zu triangles in %zu chunks; counts %s, 1 and %u threads %s, chunks %s, "
+			"seed %s and %s; %zu overlapping copies\n",
+			input.name, static_cast<unsigned long long>(copies), serial.size() / 3, chunks,
+			counts_match ? "match" : "DIFFER", threads, threads_match ? "match" : "DIFFER",
+			chunks_match ? "match" : "DIFFER", seed_repeats ? "repeats" : "DOES NOT REPEAT",
+			seed_differs ? "another differs" : "ANOTHER IS THE SAME", overlaps);
+		failures += !counts_match + !threads_match + !chunks_match + !seed_repeats + !seed_differs + overlaps;
+	}
+
+	// Larger grids, streamed into a checksum so the whole output never
+	// has to fit in memory; both thread counts must sum the same.
+	for (scene_layout_t layout : { scene_layout_t::rooms, scene_layout_t::towers }) {
+		scene_generator_config_t config;
+		config.layout = layout;
+		config.columns = columns;
+		config.rows = rows;
+		uint64_t sums[2] = {};
+		uint64_t counts[2] = {};
+		double seconds[2] = {};
+		unsigned const thread_counts[2] = { 1, threads };
+		for (int run = 0; run < 2; ++run) {
+			uint64_t hash = 14695981039346656037ull;
+			auto const start = std::chrono::steady_clock::now();
+			generator.Generate(config, [&](const vertex_t* vertices, size_t count) {
+				const unsigned char* bytes = reinterpret_cast<const unsigned char*>(vertices);
+				for (size_t i = 0; i < count * sizeof(vertex_t); ++i) {
+					hash = (hash ^ bytes[i]) * 1099511628211ull;
+				}
+				counts[run] += count;
+			}, thread_counts[run]);
+			seconds[run] = Seconds(start);
+			sums[run] = hash;
+		}
+		bool const match = sums[0] == sums[1] && counts[0] == counts[1] && counts[0] == generator.VertexCount(config);
+		fprintf(out, "%s %ux%u: %llu triangles; 1 thread %.2f M tris/s, %u threads %.2f M tris/s (with checksum); "
+			"output %s\n",
+			layout == scene_layout_t::rooms ? "rooms" : "towers", columns, rows,
+			static_cast<unsigned long long>(counts[0] / 3), seconds[0] > 0.0 ? counts[0] / 3 / seconds[0] / 1e6 : 0.0,
+			threads, seconds[1] > 0.0 ? counts[1] / 3 / seconds[1] / 1e6 : 0.0, match ? "matches" : "DIFFERS");
+		failures += !match;
+	}
+	fprintf(out, "%zu failures\n", failures);
+	return CloseReport(out, failures);
+}
@@ -1,7 +1,7 @@
 #pragma once
-#include "D3D12HelloTriangle.h"
+#include "Vertex.h"
 
-D3D12HelloTriangle::vertex_t vertices_data[3864] = {
+vertex_t vertices_data[3864] = {
 {0.09024f,-0.380974f,-0.18172f,1.f,1.f,1.f,1.f,0.007546f,0.673598f},
 {1.8671f,-0.380974f,-0.18172f,1.f,1.f,1.f,1.f,0.326402f,0.673598f},
 {1.8671f,-0.380974f,-1.95858f,1.f,1.f,1.f,1.f,0.326402f,0.992454f},
@@ -0,0 +1,181 @@
+#include "TextureAsset.h"
+#include "FileUtil.h"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+	uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	struct level_source_t {
+		const uint8_t* data;
+		size_t pitch;
+	};
+
+	block_format_t BlockFormat(texture_format_t format) {
+		switch (format) {
+		case texture_format_t::bc1: return block_format_t::bc1;
+		case texture_format_t::bc3: return block_format_t::bc3;
+		default: return block_format_t::bc7;
+		}
+	}
+
+	texture_format_t TextureFormat(block_format_t format) {
+		switch (format) {
+		case block_format_t::bc1: return texture_format_t::bc1;
+		case block_format_t::bc3: return texture_format_t::bc3;
+		default: return texture_format_t::bc7;
+		}
+	}
+
+	// Lays the levels out as GetCopyableFootprints would for a texture
+	// placed at offset 0 and writes header, level table and padded rows.
+	void WriteLevels(
+		const char* path, texture_format_t format, std::vector<texture_asset_level_t> levels,
+		const std::vector<level_source_t>& sources
+	) {
+		texture_asset_header_t header = {};
+		header.magic = TEXTURE_ASSET_MAGIC;
+		header.version = TEXTURE_ASSET_VERSION;
+		header.format = format;
+		header.width = levels.front().width;
+		header.height = levels.front().height;
+		header.level_count = static_cast<uint32_t>(levels.size());
+		header.level_offset = sizeof(texture_asset_header_t);
+		header.data_offset = AlignUp(header.level_offset + levels.size() * sizeof(texture_asset_level_t), TEXTURE_ASSET_PLACEMENT_ALIGNMENT);
+		uint64_t offset = 0;
+		for (texture_asset_level_t& level : levels) {
+			level.row_pitch = AlignUp(level.row_bytes, TEXTURE_ASSET_PITCH_ALIGNMENT);
+			level.offset = AlignUp(offset, TEXTURE_ASSET_PLACEMENT_ALIGNMENT);
+			offset = level.offset + level.row_pitch * level.rows;
+		}
+		header.data_size = offset;
+		header.file_size = header.data_offset + header.data_size;
+
+		FILE* file = OpenFile(path, "wb");
+		if (!file) {
+			throw std::runtime_error(std::string("Texture asset: cannot create ") + path);
+		}
+		// Each row goes out through a zeroed buffer of row_pitch bytes, so the
+		// padding is deterministic.
+		std::vector<uint8_t> row;
+		bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+			fwrite(levels.data(), sizeof(texture_asset_level_t), levels.size(), file) == levels.size();
+		uint64_t position = header.level_offset + levels.size() * sizeof(texture_asset_level_t);
+		for (size_t i = 0; ok && i < levels.size(); ++i) {
+			const texture_asset_level_t& level = levels[i];
+			row.assign(static_cast<size_t>(level.row_pitch), 0);
+			uint64_t const start = header.data_offset + level.offset;
+			if (position < start) {
+				std::vector<uint8_t> const pad(static_cast<size_t>(start - position), 0);
+				ok = fwrite(pad.data(), 1, pad.size(), file) == pad.size();
+				position = start;
+			}
+			for (uint32_t y = 0; ok && y < level.rows; ++y) {
+				std::copy(sources[i].data + sources[i].pitch * y, sources[i].data + sources[i].pitch * y + level.row_bytes, row.begin());
+				ok = fwrite(row.data(), 1, row.size(), file) == row.size();
+			}
+			position += level.row_pitch * level.rows;
+		}
+		if (fclose(file) != 0 || !ok) {
+			throw std::runtime_error("Texture asset: write failed");
+		}
+	}
+}
+
+void WriteTextureAsset(const char* path, const mip_chain_t& chain) {
+	std::vector<texture_asset_level_t> levels;
+	std::vector<level_source_t> sources;
+	for (const mip_level_t& mip : chain.levels) {
+		levels.push_back({ mip.width, mip.height, mip.height, mip.width * 4, 0, 0 });
+		sources.push_back({ chain.pixels.data() + mip.offset, size_t(mip.width) * 4 });
+	}
+	WriteLevels(path, texture_format_t::rgba8, std::move(levels), sources);
+}
+
+void WriteTextureAsset(const char* path, const compressed_texture_t& texture) {
+	std::vector<texture_asset_level_t> levels;
+	std::vector<level_source_t> sources;
+	for (const mip_level_t& mip : texture.levels) {
+		uint32_t const row_bytes = static_cast<uint32_t>(BlockRowBytes(texture.format, mip.width));
+		levels.push_back({ mip.width, mip.height, (mip.height + 3) / 4, row_bytes, 0, 0 });
+		sources.push_back({ texture.data.data() + mip.offset, row_bytes });
+	}
+	WriteLevels(path, TextureFormat(texture.format), std::move(levels), sources);
+}
+
+texture_bake_stats_t BakeTextureAsset(
+	const char* path, const uint8_t* rgba, uint32_t width, uint32_t height, size_t pitch,
+	texture_format_t format, block_quality_t quality, unsigned thread_count
+) {
+	if (format != texture_format_t::rgba8 && (width % 4 != 0 || height % 4 != 0)) {
+		throw std::runtime_error("Texture asset: block formats need a width and height that are multiples of 4");
+	}
+	mip_chain_t const chain = GenerateMipChain(rgba, width, height, pitch, mip_filter_t::box, thread_count);
+	if (format == texture_format_t::rgba8) {
+		WriteTextureAsset(path, chain);
+	}
+	else {
+		WriteTextureAsset(path, CompressMipChain(chain, BlockFormat(format), quality, thread_count));
+	}
+
+	TextureAsset written;
+	if (!written.Open(path)) {
+		throw std::runtime_error(std::string("Texture asset: cannot read back ") + path);
+	}
+	texture_bake_stats_t stats = {};
+	stats.width = width;
+	stats.height = height;
+	stats.levels = written.Header().level_count;
+	stats.source_bytes = size_t(width) * height * 4;
+	stats.data_bytes = static_cast<size_t>(written.Header().data_size);
+	return stats;
+}
+
+bool TextureAsset::Open(const char* path) {
+	Close();
+	if (!m_file.Open(path)) {
+		return false;
+	}
+	if (m_file.Size() < sizeof(texture_asset_header_t)) {
+		m_file.Close();
+		return false;
+	}
+
+	auto header = reinterpret_cast<const texture_asset_header_t*>(m_file.Data());
+	bool valid =
+		header->magic == TEXTURE_ASSET_MAGIC &&
+		header->version == TEXTURE_ASSET_VERSION &&
+		header->format <= texture_format_t::bc7 &&
+		header->level_count > 0 && header->level_count <= 32 &&
+		header->file_size == m_file.Size() &&
+		header->level_offset + header->level_count * sizeof(texture_asset_level_t) <= header->data_offset &&
+		header->data_offset % TEXTURE_ASSET_PLACEMENT_ALIGNMENT == 0 &&
+		header->data_offset + header->data_size == header->file_size;
+	auto levels = reinterpret_cast<const texture_asset_level_t*>(m_file.Data() + (valid ? header->level_offset : 0));
+	for (uint32_t i = 0; valid && i < header->level_count; ++i) {
+		valid =
+			levels[i].row_bytes <= levels[i].row_pitch &&
+			levels[i].offset % TEXTURE_ASSET_PLACEMENT_ALIGNMENT == 0 &&
+			levels[i].offset + levels[i].row_pitch * levels[i].rows <= header->data_size;
+	}
+	if (!valid) {
+		m_file.Close();
+		return false;
+	}
+
+	m_header = header;
+	m_levels = levels;
+	return true;
+}
+
+void TextureAsset::Close() {
+	m_file.Close();
+	m_header = nullptr;
+	m_levels = nullptr;
+}
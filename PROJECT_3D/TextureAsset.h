@@ -0,0 +1,91 @@
+#pragma once
+
+#include "BlockCompression.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include <cstddef>
+#include <cstdint>
+
+// Binary texture container holding a whole mip chain in the layout D3D12
+// places it in an upload buffer: every level starts on a
+// TEXTURE_ASSET_PLACEMENT_ALIGNMENT boundary of the data block and its rows
+// are padded to TEXTURE_ASSET_PITCH_ALIGNMENT. The header and level table
+// are followed by the data block, so a mapped file is copied into the upload
+// heap with one memcpy and no decoding.
+uint32_t const TEXTURE_ASSET_MAGIC = 0x54443350; // "P3DT"
+uint32_t const TEXTURE_ASSET_VERSION = 1;
+size_t const TEXTURE_ASSET_PITCH_ALIGNMENT = 256;       // D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+size_t const TEXTURE_ASSET_PLACEMENT_ALIGNMENT = 512;   // D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
+
+const char* const TEXTURE_ASSET_PATH = "textures.p3dt";
+
+enum class texture_format_t : uint32_t {
+    rgba8,
+    bc1,
+    bc3,
+    bc7,
+};
+
+struct texture_asset_header_t {
+    uint32_t magic;
+    uint32_t version;
+    texture_format_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t level_count;
+    uint64_t level_offset;      // of the texture_asset_level_t table
+    uint64_t data_offset;       // of the data block, which level offsets index
+    uint64_t data_size;
+    uint64_t file_size;
+};
+
+struct texture_asset_level_t {
+    uint32_t width;
+    uint32_t height;
+    uint32_t rows;              // of texels, or of 4x4 blocks
+    uint32_t row_bytes;         // without padding
+    uint64_t row_pitch;
+    uint64_t offset;            // in the data block
+};
+
+struct texture_bake_stats_t {
+    uint32_t width;
+    uint32_t height;
+    uint32_t levels;
+    size_t source_bytes;        // of the RGBA8 top level
+    size_t data_bytes;          // every level, padded as stored
+};
+
+// Writes an RGBA8 or block-compressed mip chain. Throws std::runtime_error
+// on I/O failure.
+void WriteTextureAsset(const char* path, const mip_chain_t& chain);
+void WriteTextureAsset(const char* path, const compressed_texture_t& texture);
+
+// Builds the mip chain of an RGBA8 image whose rows are pitch bytes apart,
+// compresses it unless format is rgba8 and writes it to path. Block formats
+// need a width and height that are multiples of 4. Throws
+// std::runtime_error on I/O failure or an unsupported size.
+texture_bake_stats_t BakeTextureAsset(
+    const char* path, const uint8_t* rgba, uint32_t width, uint32_t height, size_t pitch,
+    texture_format_t format, block_quality_t quality = block_quality_t::normal, unsigned thread_count = 0
+);
+
+class TextureAsset
+{
+public:
+    // Maps the file and validates the header and level table. Returns false
+    // for a missing, truncated or outdated file.
+    bool Open(const char* path);
+    void Close();
+    bool IsOpen() const { return m_header != nullptr; }
+
+    const texture_asset_header_t& Header() const { return *m_header; }
+    const texture_asset_level_t& Level(uint32_t level) const { return m_levels[level]; }
+    const uint8_t* Data() const { return m_file.Data() + m_header->data_offset; }
+    const uint8_t* LevelData(uint32_t level) const { return Data() + m_levels[level].offset; }
+
+private:
+    MappedFile m_file;
+    const texture_asset_header_t* m_header = nullptr;
+    const texture_asset_level_t* m_levels = nullptr;
+};
@@ -0,0 +1,111 @@
+#include "ReportTools.h"
+#include "BlockCompression.h"
+#include "ImageFile.h"
+#include "MipGenerator.h"
+#include "TextureAsset.h"
+#include <algorithm>
+#include <cstring>
+
+// Startup cost of the texture: decoding the PNG and building and
+// compressing its mips, as the renderer does without a baked texture,
+// against mapping the container. Both end in an upload-buffer copy laid
+// out like the renderer's footprints, and the two copies must match.
+// When the PNG cannot be read a generated image of the same size stands
+// in and decode time is not reported.
+//   --texture-report [texture.txt] [textures.png]
+int TextureReportTool(const std::vector<std::string>& args) {
+	const char* image_path = args.size() > 2 ? args[2].c_str() : "textures.png";
+	const char* const asset_path = "texture_report.p3dt";
+	int const RUNS = 3;
+
+	double decode_seconds = -1.0;
+	rgba_image_t image = {};
+	for (int run = 0; run < RUNS; ++run) {
+		auto const start = std::chrono::steady_clock::now();
+		try {
+			image = LoadImageFile(image_path);
+		}
+		catch (const std::exception&) {
+			break;
+		}
+		double const seconds = Seconds(start);
+		decode_seconds = run == 0 ? seconds : (std::min)(decode_seconds, seconds);
+	}
+	if (decode_seconds < 0.0) {
+		image.width = image.height = 768;
+		image.pixels = BlockTestImage(image.width, image.height);
+	}
+	if (image.width % 4 != 0 || image.height % 4 != 0) {
+		return 1;
+	}
+	BakeTextureAsset(asset_path, image.pixels.data(), image.width, image.height, size_t(image.width) * 4, texture_format_t::bc7);
+
+	double mip_seconds = 1e30, compress_seconds = 1e30, png_copy_seconds = 1e30;
+	std::vector<uint8_t> png_upload;
+	for (int run = 0; run < RUNS; ++run) {
+		auto const start = std::chrono::steady_clock::now();
+		mip_chain_t const chain = GenerateMipChain(image.pixels.data(), image.width, image.height, size_t(image.width) * 4);
+		auto const mipped = std::chrono::steady_clock::now();
+		compressed_texture_t const blocks = CompressMipChain(chain, block_format_t::bc7, block_quality_t::normal);
+		auto const compressed = std::chrono::steady_clock::now();
+
+		TextureAsset layout;
+		if (!layout.Open(asset_path)) {
+			return 1;
+		}
+		png_upload.assign(static_cast<size_t>(layout.Header().data_size), 0);
+		auto const copy_start = std::chrono::steady_clock::now();
+		for (uint32_t l = 0; l < layout.Header().level_count; ++l) {
+			const texture_asset_level_t& level = layout.Level(l);
+			size_t const pitch = BlockRowBytes(block_format_t::bc7, level.width);
+			for (uint32_t y = 0; y < level.rows; ++y) {
+				memcpy(&png_upload[static_cast<size_t>(level.offset + level.row_pitch * y)],
+					blocks.data.data() + blocks.levels[l].offset + pitch * y, level.row_bytes);
+			}
+		}
+		auto const end = std::chrono::steady_clock::now();
+		mip_seconds = (std::min)(mip_seconds, std::chrono::duration<double>(mipped - start).count());
+		compress_seconds = (std::min)(compress_seconds, std::chrono::duration<double>(compressed - mipped).count());
+		png_copy_seconds = (std::min)(png_copy_seconds, std::chrono::duration<double>(end - copy_start).count());
+	}
+
+	double open_seconds = 1e30, asset_copy_seconds = 1e30;
+	std::vector<uint8_t> asset_upload;
+	for (int run = 0; run < RUNS; ++run) {
+		auto const start = std::chrono::steady_clock::now();
+		TextureAsset asset;
+		if (!asset.Open(asset_path)) {
+			return 1;
+		}
+		auto const opened = std::chrono::steady_clock::now();
+		asset_upload.resize(static_cast<size_t>(asset.Header().data_size));
+		memcpy(asset_upload.data(), asset.Data(), asset_upload.size());
+		auto const end = std::chrono::steady_clock::now();
+		open_seconds = (std::min)(open_seconds, std::chrono::duration<double>(opened - start).count());
+		asset_copy_seconds = (std::min)(asset_copy_seconds, std::chrono::duration<double>(end - opened).count());
+	}
+	remove(asset_path);
+	bool const same = png_upload == asset_upload;
+
+	FILE* out = OpenReport(args, "texture.txt");
+	if (!out) {
+		return 1;
+	}
+	fprintf(out, "%ux%u, %zu bytes as BC7 with mips, best of %d\n",
+		image.width, image.height, asset_upload.size(), RUNS);
+	double png_total = mip_seconds + compress_seconds + png_copy_seconds;
+	if (decode_seconds >= 0.0) {
+		fprintf(out, "png:       decode %8.2f ms, ", decode_seconds * 1e3);
+		png_total += decode_seconds;
+	}
+	else {
+		fprintf(out, "png:       decode (unreadable, generated image), ");
+	}
+	fprintf(out, "mips %.2f ms, BC7 %.2f ms, upload copy %.2f ms, total %.2f ms\n",
+		mip_seconds * 1e3, compress_seconds * 1e3, png_copy_seconds * 1e3, png_total * 1e3);
+	double const asset_total = open_seconds + asset_copy_seconds;
+	fprintf(out, "container: map %.3f ms, upload copy %.3f ms, total %.3f ms (%.0fx faster)\n",
+		open_seconds * 1e3, asset_copy_seconds * 1e3, asset_total * 1e3, png_total / asset_total);
+	fprintf(out, "upload buffers %s\n", same ? "match" : "DIFFER");
+	return CloseReport(out, same ? 0 : 1);
+}
@@ -0,0 +1,214 @@
+#include "TextureStreaming.h"
+#include <algorithm>
+#include <cmath>
+
+float ProjectedAabbArea(const float view_proj[16], const float aabb_min[3], const float aabb_max[3], float width, float height) {
+	float lower[2] = { 1.0f, 1.0f }, upper[2] = { -1.0f, -1.0f };
+	for (int corner = 0; corner < 8; ++corner) {
+		float const p[3] = {
+			corner & 1 ? aabb_max[0] : aabb_min[0],
+			corner & 2 ? aabb_max[1] : aabb_min[1],
+			corner & 4 ? aabb_max[2] : aabb_min[2],
+		};
+		float clip[4];
+		for (int c = 0; c < 4; ++c) {
+			clip[c] = p[0] * view_proj[c] + p[1] * view_proj[4 + c] + p[2] * view_proj[8 + c] + view_proj[12 + c];
+		}
+		if (clip[3] <= 1e-6f) {
+			return width * height;
+		}
+		for (int axis = 0; axis < 2; ++axis) {
+			float const ndc = clip[axis] / clip[3];
+			lower[axis] = (std::min)(lower[axis], ndc);
+			upper[axis] = (std::max)(upper[axis], ndc);
+		}
+	}
+	float const x = std::clamp(upper[0], -1.0f, 1.0f) - std::clamp(lower[0], -1.0f, 1.0f);
+	float const y = std::clamp(upper[1], -1.0f, 1.0f) - std::clamp(lower[1], -1.0f, 1.0f);
+	return x > 0.0f && y > 0.0f ? x * 0.5f * width * y * 0.5f * height : 0.0f;
+}
+
+TextureStreamer::TextureStreamer(TextureStreamingSink& sink, const texture_streaming_config_t& config)
+	: m_sink(sink), m_config(config) {
+	m_stats = {};
+}
+
+uint32_t TextureStreamer::AddTexture(const streamed_texture_t& texture) {
+	texture_state_t state = {};
+	state.desc = texture;
+	state.desc.level_bytes.resize(texture.level_count, 0);
+	// The tail is the longest run of coarsest levels within tail_bytes, but
+	// it has to start at a level that can top a chain.
+	uint32_t tail = texture.level_count > 0 ? texture.level_count - 1 : 0;
+	while (tail > 0 && ChainBytes(state, tail - 1) <= m_config.tail_bytes) {
+		--tail;
+	}
+	state.tail = (std::min)(tail, texture.coarsest_top_level);
+	state.top = texture.level_count;
+	state.desired = state.tail;
+	m_textures.push_back(state);
+	++m_stats.textures;
+	return static_cast<uint32_t>(m_textures.size() - 1);
+}
+
+uint64_t TextureStreamer::ChainBytes(const texture_state_t& texture, uint32_t top) const {
+	uint64_t bytes = 0;
+	for (uint32_t level = top; level < texture.desc.level_count; ++level) {
+		bytes += texture.desc.level_bytes[level];
+	}
+	return bytes;
+}
+
+// The new chain is allocated while the old one is still in use, so both
+// count against the budget until the transition completes.
+bool TextureStreamer::StartTransition(uint32_t index, uint32_t new_top, uint64_t read_bytes) {
+	texture_state_t& texture = m_textures[index];
+	uint64_t const bytes = ChainBytes(texture, new_top);
+	if (m_stats.resident_bytes + bytes > m_config.memory_budget) {
+		return false;
+	}
+	if (read_bytes > 0 && m_stats.inflight_bytes > 0 && m_stats.inflight_bytes + read_bytes > m_config.max_inflight_bytes) {
+		return false;
+	}
+	m_sink.RecordTransition(index, texture.top, new_top);
+	if (new_top < texture.top) {
+		m_stats.uploads += texture.top - new_top;
+	}
+	else {
+		++m_stats.evictions;
+	}
+	texture.pending = true;
+	texture.pending_top = new_top;
+	texture.pending_read = read_bytes;
+	m_stats.resident_bytes += bytes;
+	m_stats.inflight_bytes += read_bytes;
+	++m_stats.transitions_in_flight;
+	m_recorded.push_back(index);
+	return true;
+}
+
+void TextureStreamer::Update(const float* footprints, uint64_t completed_fence) {
+	for (uint32_t i = 0; i < m_textures.size(); ++i) {
+		texture_state_t& texture = m_textures[i];
+		if (!texture.pending || texture.pending_fence > completed_fence) {
+			continue;
+		}
+		m_stats.resident_bytes -= ChainBytes(texture, texture.top);
+		m_stats.inflight_bytes -= texture.pending_read;
+		--m_stats.transitions_in_flight;
+		texture.top = texture.pending_top;
+		texture.pending = false;
+		m_sink.LevelsResident(i, texture.top);
+	}
+
+	// The level with about one texel per covered pixel, never finer than
+	// level 0 nor coarser than the tail.
+	m_stats.missing_levels = 0;
+	for (uint32_t i = 0; i < m_textures.size(); ++i) {
+		texture_state_t& texture = m_textures[i];
+		float const footprint = footprints[i] > 0.0f ? footprints[i] : 0.0f;
+		texture.footprint = footprint;
+		texture.desired = texture.tail;
+		if (footprint > 0.0f) {
+			double const texels = static_cast<double>(texture.desc.width) * texture.desc.height;
+			double const level = std::floor(0.5 * std::log2(texels / footprint) + m_config.lod_bias);
+			texture.desired = static_cast<uint32_t>(std::clamp(level, 0.0, static_cast<double>(texture.tail)));
+		}
+		if (texture.top > texture.desired) {
+			m_stats.missing_levels += (std::min)(texture.top, texture.desc.level_count) - texture.desired;
+		}
+	}
+
+	m_recorded.clear();
+	unsigned transitions = 0;
+
+	// A texture without its tail cannot be drawn at all, so tails go first,
+	// those on screen before the rest.
+	std::vector<uint32_t> order;
+	for (uint32_t i = 0; i < m_textures.size(); ++i) {
+		const texture_state_t& texture = m_textures[i];
+		if (!texture.pending && texture.top == texture.desc.level_count && texture.desc.level_count > 0) {
+			order.push_back(i);
+		}
+	}
+	auto const by_footprint = [this](uint32_t a, uint32_t b) {
+		return m_textures[a].footprint > m_textures[b].footprint;
+	};
+	std::stable_sort(order.begin(), order.end(), by_footprint);
+	for (uint32_t index : order) {
+		if (StartTransition(index, m_textures[index].tail, ChainBytes(m_textures[index], m_textures[index].tail))) {
+			++transitions;
+		}
+		else {
+			++m_stats.deferred;
+		}
+	}
+
+	order.clear();
+	for (uint32_t i = 0; i < m_textures.size(); ++i) {
+		const texture_state_t& texture = m_textures[i];
+		if (!texture.pending && texture.top < texture.desc.level_count && texture.top > texture.desired) {
+			order.push_back(i);
+		}
+	}
+	std::stable_sort(order.begin(), order.end(), by_footprint);
+	for (uint32_t index : order) {
+		if (transitions >= m_config.max_transitions_per_update) {
+			++m_stats.deferred;
+			continue;
+		}
+		texture_state_t& texture = m_textures[index];
+		if (texture.pending) {
+			continue;
+		}
+		uint32_t const new_top = texture.top - 1;
+		if (StartTransition(index, new_top, texture.desc.level_bytes[new_top])) {
+			++transitions;
+			continue;
+		}
+		++m_stats.deferred;
+		if (m_stats.resident_bytes + ChainBytes(texture, new_top) <= m_config.memory_budget) {
+			continue;
+		}
+
+		// Over budget: drop levels from a texture that needs them less, so
+		// a later frame has room. Textures finer than their footprint asks
+		// go first and straight to what it asks; then the smallest
+		// footprint gives up its top level.
+		uint32_t victim = index;
+		for (uint32_t j = 0; j < m_textures.size(); ++j) {
+			const texture_state_t& other = m_textures[j];
+			if (j == index || other.pending || other.top >= other.tail) {
+				continue;
+			}
+			bool const excess = other.top < other.desired;
+			if (!excess && other.footprint >= texture.footprint) {
+				continue;
+			}
+			if (victim == index) {
+				victim = j;
+				continue;
+			}
+			const texture_state_t& best = m_textures[victim];
+			bool const best_excess = best.top < best.desired;
+			if (excess != best_excess ? excess : other.footprint < best.footprint) {
+				victim = j;
+			}
+		}
+		if (victim != index && transitions < m_config.max_transitions_per_update) {
+			const texture_state_t& other = m_textures[victim];
+			uint32_t const victim_top = other.top < other.desired ? other.desired : other.top + 1;
+			if (StartTransition(victim, victim_top, 0)) {
+				++transitions;
+			}
+		}
+	}
+
+	if (!m_recorded.empty()) {
+		uint64_t const fence = m_sink.SubmitTransitions();
+		for (uint32_t index : m_recorded) {
+			m_textures[index].pending_fence = fence;
+		}
+	}
+	m_stats.peak_resident_bytes = (std::max)(m_stats.peak_resident_bytes, m_stats.resident_bytes);
+}
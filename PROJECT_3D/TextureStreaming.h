@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Mip levels of one streamed texture. A texture holds a contiguous chain of
+// levels [top, level_count): levels are added one at a time above the top
+// and dropped from it.
+struct streamed_texture_t {
+    uint32_t width;
+    uint32_t height;
+    uint32_t level_count;
+    // The coarsest level that may top a resident chain; every finer level
+    // may too. Block-compressed textures need a top level in whole 4x4
+    // blocks.
+    uint32_t coarsest_top_level;
+    // GPU bytes of each level, row padding included.
+    std::vector<uint64_t> level_bytes;
+};
+
+// Carries out the streamer's decisions, e.g. on a copy queue. Every call is
+// made from TextureStreamer::Update on the caller's thread.
+class TextureStreamingSink
+{
+public:
+    virtual ~TextureStreamingSink() = default;
+    // Records the copies that replace the texture's levels [top, ...) with
+    // [new_top, ...): the level above top from memory when new_top is
+    // top - 1, or the coarsest levels at once when nothing is resident
+    // (top == level_count); the levels kept are copied from what the
+    // texture holds now, which stays readable until LevelsResident.
+    virtual void RecordTransition(uint32_t texture, uint32_t top, uint32_t new_top) = 0;
+    // Submits everything recorded since the last call and returns the fence
+    // value that signals its completion.
+    virtual uint64_t SubmitTransitions() = 0;
+    // The transition's fence has passed: levels [top, level_count) may be
+    // sampled and the previous chain released.
+    virtual void LevelsResident(uint32_t texture, uint32_t top) = 0;
+};
+
+struct texture_streaming_config_t {
+    // GPU bytes of all chains, counting both chains of a texture while one
+    // replaces the other.
+    uint64_t memory_budget = 32u << 20;
+    // The coarsest levels of every texture, up to this many bytes, load
+    // first and are never dropped.
+    uint64_t tail_bytes = 64u << 10;
+    // Bytes read from memory by transitions in flight. A single level
+    // larger than this goes alone.
+    uint64_t max_inflight_bytes = 4u << 20;
+    unsigned max_transitions_per_update = 4;
+    // Added to the level the footprint asks for; positive is coarser.
+    float lod_bias = 0.0f;
+};
+
+struct texture_streaming_stats_t {
+    size_t textures;
+    uint64_t resident_bytes;        // chains in use, both during a transition
+    uint64_t peak_resident_bytes;
+    uint64_t inflight_bytes;
+    size_t transitions_in_flight;
+    size_t uploads;                 // levels added
+    size_t evictions;               // transitions that dropped levels
+    size_t deferred;                // uploads wanted but over budget or in-flight limit
+    size_t missing_levels;          // levels short of the footprint's, summed
+};
+
+// Screen pixels covered by the bounding rectangle of a box's projection,
+// the footprint of the surfaces inside it. view_proj is row-major for row
+// vectors, as for ExtractFrustumPlanes; a box reaching behind the eye
+// covers the whole screen.
+float ProjectedAabbArea(const float view_proj[16], const float aabb_min[3], const float aabb_max[3], float width, float height);
+
+// Decides which mip levels of which textures are resident. Each Update is
+// given every texture's screen footprint: the level whose texel count
+// roughly matches the pixels covered is wanted. Wanted levels load one at a
+// time, coarse to fine, largest footprint first. When the budget is full,
+// textures finer than they need, then ones with smaller footprints, drop
+// levels to make room for later frames. Nothing here touches the GPU; the
+// sink records the copies and reports completion through fence values.
+class TextureStreamer
+{
+public:
+    TextureStreamer(TextureStreamingSink& sink, const texture_streaming_config_t& config = {});
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // Nothing is resident until the first Update after it requests the
+    // tail. Returns the texture's index.
+    uint32_t AddTexture(const streamed_texture_t& texture);
+
+    // footprints[i] is the screen pixels texture i covers, 0 when unseen;
+    // completed_fence is the last fence value the sink's queue has reached.
+    void Update(const float* footprints, uint64_t completed_fence);
+
+    // level_count while nothing is resident.
+    uint32_t ResidentLevel(uint32_t texture) const { return m_textures[texture].top; }
+    uint32_t DesiredLevel(uint32_t texture) const { return m_textures[texture].desired; }
+    uint32_t TailLevel(uint32_t texture) const { return m_textures[texture].tail; }
+    bool Idle() const { return m_stats.transitions_in_flight == 0; }
+    const texture_streaming_stats_t& Stats() const { return m_stats; }
+
+private:
+    struct texture_state_t {
+        streamed_texture_t desc;
+        uint32_t tail;
+        uint32_t top;
+        uint32_t desired;
+        float footprint;
+        // A transition in flight replaces [top, ...) by [pending_top, ...).
+        bool pending;
+        uint32_t pending_top;
+        uint64_t pending_fence;
+        uint64_t pending_read;      // bytes the transition reads from memory
+    };
+
+    uint64_t ChainBytes(const texture_state_t& texture, uint32_t top) const;
+    bool StartTransition(uint32_t index, uint32_t new_top, uint64_t read_bytes);
+
+    TextureStreamingSink& m_sink;
+    texture_streaming_config_t m_config;
+    std::vector<texture_state_t> m_textures;
+    std::vector<uint32_t> m_recorded;
+    texture_streaming_stats_t m_stats;
+};
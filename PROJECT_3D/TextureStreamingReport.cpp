@@ -0,0 +1,227 @@
+#include "ReportTools.h"
+#include "BlockCompression.h"
+#include "MipGenerator.h"
+#include "TextureAsset.h"
+#include "TextureStreaming.h"
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <utility>
+
+namespace {
+	// Stands in for the renderer's copy queue: each batch completes a fixed
+	// latency after the previous one, plus its bytes at a fixed bandwidth.
+	// Checks every transition against the chains it holds, and tracks the
+	// bytes of those chains independently of the streamer.
+	class SimulatedCopyQueue : public TextureStreamingSink
+	{
+	public:
+		SimulatedCopyQueue(const std::vector<streamed_texture_t>& textures, double latency_frames, double bytes_per_frame)
+			: m_textures(textures), m_latency(latency_frames), m_bandwidth(bytes_per_frame) {
+			for (const streamed_texture_t& texture : textures) {
+				m_top.push_back(texture.level_count);
+				m_pending.push_back({ false, 0, 0 });
+			}
+		}
+
+		void RecordTransition(uint32_t texture, uint32_t top, uint32_t new_top) override {
+			const streamed_texture_t& desc = m_textures[texture];
+			bool const valid = !m_pending[texture].active && m_top[texture] == top && new_top < desc.level_count &&
+				new_top <= desc.coarsest_top_level && (top == desc.level_count || new_top == top - 1 || new_top > top);
+			if (!valid) {
+				++errors;
+				return;
+			}
+			m_pending[texture] = { true, new_top, 0 };
+			m_batch.push_back(texture);
+			m_batchBytes += top == desc.level_count ? Chain(texture, new_top) : new_top < top ? desc.level_bytes[new_top] : 0;
+			held_bytes += Chain(texture, new_top);
+			peak_held_bytes = (std::max)(peak_held_bytes, held_bytes);
+		}
+
+		uint64_t SubmitTransitions() override {
+			++m_fence;
+			m_lastDone = (std::max)(m_now, m_lastDone) + m_latency + m_batchBytes / m_bandwidth;
+			m_done.push_back({ m_fence, m_lastDone });
+			for (uint32_t texture : m_batch) {
+				m_pending[texture].fence = m_fence;
+			}
+			m_batch.clear();
+			m_batchBytes = 0.0;
+			return m_fence;
+		}
+
+		void LevelsResident(uint32_t texture, uint32_t top) override {
+			const pending_t& pending = m_pending[texture];
+			if (!pending.active || pending.top != top || pending.fence == 0 || pending.fence > m_completed) {
+				++errors;
+				return;
+			}
+			held_bytes -= Chain(texture, m_top[texture]);
+			m_top[texture] = top;
+			m_pending[texture].active = false;
+		}
+
+		// Moves the clock to frame and returns the last fence reached.
+		uint64_t Advance(double frame) {
+			m_now = frame;
+			while (!m_done.empty() && m_done.front().second <= frame) {
+				m_completed = m_done.front().first;
+				m_done.pop_front();
+			}
+			return m_completed;
+		}
+
+		uint32_t Top(uint32_t texture) const { return m_top[texture]; }
+
+		size_t errors = 0;
+		uint64_t held_bytes = 0;
+		uint64_t peak_held_bytes = 0;
+
+	private:
+		struct pending_t {
+			bool active;
+			uint32_t top;
+			uint64_t fence;
+		};
+
+		uint64_t Chain(uint32_t texture, uint32_t top) const {
+			uint64_t bytes = 0;
+			for (uint32_t level = top; level < m_textures[texture].level_count; ++level) {
+				bytes += m_textures[texture].level_bytes[level];
+			}
+			return bytes;
+		}
+
+		const std::vector<streamed_texture_t>& m_textures;
+		double m_latency;
+		double m_bandwidth;
+		std::vector<uint32_t> m_top;
+		std::vector<pending_t> m_pending;
+		std::vector<uint32_t> m_batch;
+		double m_batchBytes = 0.0;
+		uint64_t m_fence = 0;
+		uint64_t m_completed = 0;
+		double m_now = 0.0;
+		double m_lastDone = 0.0;
+		std::deque<std::pair<uint64_t, double>> m_done;
+	};
+}
+
+// Streams BC7-sized textures on billboards scattered over a field while
+// the camera circles it, against a simulated copy queue. Reports how
+// close the resident levels stay to what the footprints ask for, and
+// fails on an invalid transition or a budget overrun.
+//   --texture-stream-report [stream.txt] [textures] [budget MB] [frames] [latency frames] [MB per frame]
+int TextureStreamReportTool(const std::vector<std::string>& args) {
+	size_t const count = args.size() > 2 ? std::stoul(args[2]) : 256;
+	texture_streaming_config_t config;
+	config.memory_budget = (args.size() > 3 ? std::stoull(args[3]) : 48) << 20;
+	size_t const frames = args.size() > 4 ? std::stoul(args[4]) : 3600;
+	double const latency = args.size() > 5 ? std::stod(args[5]) : 2.0;
+	double const bytes_per_frame = (args.size() > 6 ? std::stod(args[6]) : 4.0) * 1048576.0;
+	if (count == 0 || bytes_per_frame <= 0.0) {
+		return 1;
+	}
+
+	// Square and 2:1 textures from 256 to 4096 texels, laid out as BC7
+	// in 256-byte rows like the texture asset.
+	uint32_t noise = 1;
+	auto next = [&]() {
+		noise = noise * 1664525u + 1013904223u;
+		return noise >> 8;
+	};
+	std::vector<streamed_texture_t> textures;
+	std::vector<std::pair<float, float>> positions;
+	std::vector<float> sizes;
+	float const field = 400.0f;
+	for (size_t i = 0; i < count; ++i) {
+		streamed_texture_t texture = {};
+		texture.width = 256u << (next() % 5);
+		texture.height = next() % 3 == 0 ? (std::max)(texture.width / 2, 256u) : texture.width;
+		texture.level_count = MipLevelCount(texture.width, texture.height);
+		for (uint32_t level = 0; level < texture.level_count; ++level) {
+			uint32_t const w = (std::max)(texture.width >> level, 1u), h = (std::max)(texture.height >> level, 1u);
+			if (w % 4 == 0 && h % 4 == 0) {
+				texture.coarsest_top_level = level;
+			}
+			uint64_t const row_bytes = BlockRowBytes(block_format_t::bc7, w);
+			uint64_t const pitch = (row_bytes + TEXTURE_ASSET_PITCH_ALIGNMENT - 1) & ~uint64_t(TEXTURE_ASSET_PITCH_ALIGNMENT - 1);
+			texture.level_bytes.push_back(pitch * ((h + 3) / 4));
+		}
+		textures.push_back(texture);
+		positions.emplace_back(static_cast<float>(next() % 4096) / 4096.0f * field, static_cast<float>(next() % 4096) / 4096.0f * field);
+		sizes.push_back(2.0f + static_cast<float>(next() % 1024) / 1024.0f * 14.0f);
+	}
+
+	SimulatedCopyQueue queue(textures, latency, bytes_per_frame);
+	TextureStreamer streamer(queue, config);
+	for (const streamed_texture_t& texture : textures) {
+		streamer.AddTexture(texture);
+	}
+
+	// 1080 lines, 60 degrees vertically; a billboard of size s at
+	// distance d covers (s * focal / d)^2 pixels when in view.
+	float const screen_width = 1920.0f, screen_height = 1080.0f;
+	float const focal = screen_height * 0.5f / std::tan(0.5236f);
+	float const cos_half_view = std::cos(0.6f);
+	std::vector<float> footprints(count);
+	size_t visible = 0, at_detail = 0, missing = 0, without_tail = 0;
+	double update_seconds = 0.0;
+	for (size_t frame = 0; frame < frames; ++frame) {
+		float const angle = 6.2831853f * frame / frames;
+		float const camera[2] = { field * (0.5f + 0.3f * std::cos(angle)), field * (0.5f + 0.3f * std::sin(angle)) };
+		float const forward[2] = { -std::sin(angle), std::cos(angle) };
+		for (size_t i = 0; i < count; ++i) {
+			float const dx = positions[i].first - camera[0], dz = positions[i].second - camera[1];
+			float const distance = (std::max)(std::sqrt(dx * dx + dz * dz), 0.5f);
+			float const side = (std::min)(sizes[i] * focal / distance, screen_height);
+			bool const in_view = (dx * forward[0] + dz * forward[1]) / distance >= cos_half_view;
+			footprints[i] = in_view ? (std::min)(side * side, screen_width * screen_height) : 0.0f;
+		}
+
+		uint64_t const completed = queue.Advance(static_cast<double>(frame));
+		auto const start = std::chrono::steady_clock::now();
+		streamer.Update(footprints.data(), completed);
+		update_seconds += Seconds(start);
+
+		for (uint32_t i = 0; i < count; ++i) {
+			if (footprints[i] <= 0.0f) {
+				continue;
+			}
+			++visible;
+			uint32_t const top = queue.Top(i);
+			without_tail += top == textures[i].level_count;
+			if (top <= streamer.DesiredLevel(i)) {
+				++at_detail;
+			}
+			else if (top < textures[i].level_count) {
+				missing += top - streamer.DesiredLevel(i);
+			}
+		}
+	}
+	const texture_streaming_stats_t& stats = streamer.Stats();
+
+	FILE* out = OpenReport(args, "stream.txt");
+	if (!out) {
+		return 1;
+	}
+	uint64_t full_bytes = 0, tail_bytes = 0;
+	for (uint32_t i = 0; i < count; ++i) {
+		for (uint32_t level = 0; level < textures[i].level_count; ++level) {
+			full_bytes += textures[i].level_bytes[level];
+			tail_bytes += level >= streamer.TailLevel(i) ? textures[i].level_bytes[level] : 0;
+		}
+	}
+	fprintf(out, "%zu textures, %.1f MB with every level, %.1f MB of tails, budget %.1f MB\n",
+		count, full_bytes / 1048576.0, tail_bytes / 1048576.0, config.memory_budget / 1048576.0);
+	fprintf(out, "%zu frames, copy latency %.1f frames, %.1f MB per frame; update %.1f us\n",
+		frames, latency, bytes_per_frame / 1048576.0, update_seconds * 1e6 / frames);
+	fprintf(out, "uploads %zu levels, evictions %zu, deferred %zu\n", stats.uploads, stats.evictions, stats.deferred);
+	fprintf(out, "peak resident %.1f MB (streamer), %.1f MB (queue)\n",
+		stats.peak_resident_bytes / 1048576.0, queue.peak_held_bytes / 1048576.0);
+	fprintf(out, "visible texture-frames %zu: %.1f%% at the wanted level, %.3f levels short on average, %zu without a tail\n",
+		visible, visible ? 100.0 * at_detail / visible : 100.0, visible ? static_cast<double>(missing) / visible : 0.0, without_tail);
+	fprintf(out, "queue errors %zu\n", queue.errors);
+	return CloseReport(out, queue.peak_held_bytes <= config.memory_budget ? queue.errors : 1);
+}
@@ -0,0 +1,18 @@
+#include "CommandLineTools.h"
+#include <cstdio>
+
+// The renderer needs Windows, where Main.cpp runs the tools. Elsewhere they
+// build on their own around this entry point, from every source file except
+// Main.cpp, Win32Application.cpp, DXSample.cpp and D3D12HelloTriangle.cpp.
+#ifndef _WIN32
+int main(int argc, char** argv) {
+	std::vector<std::string> const args(argv + 1, argv + argc);
+	int exit_code = 0;
+	if (!RunCommandLineTool(args, exit_code)) {
+		fprintf(stderr, "usage: %s <tool> [args], where the tools are\n", argc > 0 ? argv[0] : "tools");
+		PrintCommandLineTools(stderr);
+		return 2;
+	}
+	return exit_code;
+}
+#endif
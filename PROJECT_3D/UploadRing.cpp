@@ -0,0 +1,57 @@
+#include "UploadRing.h"
+#include <algorithm>
+
+void UploadRing::Reset(uint8_t* cpu, uint64_t gpu, uint64_t size) {
+	m_cpu = cpu;
+	m_gpu = gpu;
+	m_size = size;
+	m_head = m_tail = m_submitted = 0;
+	m_submissions.clear();
+	m_stats = {};
+}
+
+upload_allocation_t UploadRing::Allocate(uint64_t size, uint64_t alignment) {
+	if (size == 0 || size > m_size) {
+		++m_stats.failures;
+		return { nullptr, 0, 0 };
+	}
+	if (m_head == m_tail) {
+		// Nothing is live, so the next allocation may as well start at
+		// offset 0 and get the whole buffer.
+		m_head = m_tail = m_submitted = (m_head + m_size - 1) / m_size * m_size;
+	}
+	uint64_t const position = m_head % m_size;
+	uint64_t start = (position + alignment - 1) & ~(alignment - 1);
+	uint64_t padding = start - position;
+	bool const wrap = start + size > m_size;
+	if (wrap) {
+		// The rest of the buffer is skipped; offset 0 suits any alignment.
+		start = 0;
+		padding = m_size - position;
+	}
+	if (Used() + padding + size > m_size) {
+		++m_stats.failures;
+		return { nullptr, 0, 0 };
+	}
+	m_head += padding + size;
+	++m_stats.allocations;
+	m_stats.wraps += wrap;
+	m_stats.allocated_bytes += size;
+	m_stats.peak_used = (std::max)(m_stats.peak_used, Used());
+	return { m_cpu + start, m_gpu + start, start };
+}
+
+void UploadRing::Submit(uint64_t fence) {
+	if (m_head == m_submitted) {
+		return;
+	}
+	m_submissions.push_back({ fence, m_head });
+	m_submitted = m_head;
+}
+
+void UploadRing::Reclaim(uint64_t completed_fence) {
+	while (!m_submissions.empty() && m_submissions.front().fence <= completed_fence) {
+		m_tail = m_submissions.front().head;
+		m_submissions.pop_front();
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+size_t const UPLOAD_CONSTANT_ALIGNMENT = 256;  // D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT
+size_t const UPLOAD_TEXTURE_ALIGNMENT = 512;   // D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
+
+struct upload_allocation_t {
+    uint8_t* cpu;       // where to write; nullptr when the ring is full
+    uint64_t gpu;       // the same bytes as the GPU addresses them
+    uint64_t offset;    // from the start of the buffer, for copy locations
+};
+
+struct upload_ring_stats_t {
+    size_t allocations;
+    size_t failures;        // allocations refused because the ring was full
+    size_t wraps;
+    uint64_t allocated_bytes;
+    uint64_t peak_used;     // including alignment and wrap padding
+};
+
+// Suballocates one persistently mapped upload buffer front to back, wrapping
+// at the end. Allocations since the last Submit are tagged with the fence
+// value Submit is given; Reclaim frees every submission whose fence the GPU
+// has reached. Nothing here waits or touches the GPU: the owner maps the
+// buffer, signals the fence and passes its completed value in, so the ring
+// runs as well against a simulated fence.
+//
+// Allocate never blocks. When the ring has no room it returns a null
+// allocation and the caller decides whether to wait for the GPU, at least
+// up to OldestPendingFence, and retry.
+class UploadRing
+{
+public:
+    UploadRing() = default;
+    UploadRing(const UploadRing&) = delete;
+    UploadRing& operator=(const UploadRing&) = delete;
+
+    // cpu and gpu address the same size bytes, aligned to at least
+    // UPLOAD_TEXTURE_ALIGNMENT, as committed buffers are.
+    void Reset(uint8_t* cpu, uint64_t gpu, uint64_t size);
+
+    // alignment is a power of two no larger than the buffer's own.
+    upload_allocation_t Allocate(uint64_t size, uint64_t alignment);
+    void Submit(uint64_t fence);
+    void Reclaim(uint64_t completed_fence);
+
+    // Fence of the oldest submission not reclaimed yet, 0 when none is:
+    // waiting for it is the least that frees space. Allocations since the
+    // last Submit are not counted, as no fence covers them yet.
+    uint64_t OldestPendingFence() const {
+        return m_submissions.empty() ? 0 : m_submissions.front().fence;
+    }
+
+    uint64_t Size() const { return m_size; }
+    // Bytes between the oldest live allocation and the newest, padding
+    // included.
+    uint64_t Used() const { return m_head - m_tail; }
+    const upload_ring_stats_t& Stats() const { return m_stats; }
+
+private:
+    struct submission_t {
+        uint64_t fence;
+        uint64_t head;
+    };
+
+    uint8_t* m_cpu = nullptr;
+    uint64_t m_gpu = 0;
+    uint64_t m_size = 0;
+    // Running byte counts that only grow; their difference is what is in
+    // use and each modulo m_size is a position in the buffer.
+    uint64_t m_head = 0;
+    uint64_t m_tail = 0;
+    uint64_t m_submitted = 0;
+    std::deque<submission_t> m_submissions;
+    upload_ring_stats_t m_stats = {};
+};
@@ -0,0 +1,108 @@
+#include "ReportTools.h"
+#include "UploadRing.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+
+// Drives the upload ring as the renderer does, against a simulated GPU
+// that reaches each frame's fence latency frames after it is signalled.
+// Every frame allocates constants and instances, and now and then a
+// buffer or texture upload. Each allocation must be aligned and filled
+// with its own byte, which must still be there when its fence retires:
+// anything handed out twice while in flight shows up as a clobbered
+// byte. A full ring waits for its oldest pending fence, as the renderer's
+// AllocateUpload does, never submitting the frame being recorded, and the
+// waits are counted.
+//   --upload-ring-report [ring.txt] [ring KB] [frames] [latency]
+int UploadRingReportTool(const std::vector<std::string>& args) {
+	uint64_t const ring_size = (args.size() > 2 ? std::stoull(args[2]) : 4096) * 1024;
+	size_t const frames = args.size() > 3 ? std::stoul(args[3]) : 100000;
+	uint64_t const latency = args.size() > 4 ? std::stoull(args[4]) : 2;
+	if (ring_size == 0 || ring_size % UPLOAD_TEXTURE_ALIGNMENT != 0) {
+		return 1;
+	}
+
+	struct live_t {
+		uint64_t fence;
+		uint64_t offset;
+		uint64_t size;
+		uint8_t fill;
+	};
+	std::vector<uint8_t> memory(ring_size);
+	uint64_t const gpu_base = 0x100000000ull;
+	UploadRing ring;
+	ring.Reset(memory.data(), gpu_base, ring_size);
+	std::deque<live_t> live;
+	uint64_t completed = 0;
+	size_t misaligned = 0, clobbered = 0, waits = 0, refused = 0;
+
+	auto retire = [&](uint64_t fence) {
+		completed = (std::max)(completed, fence);
+		ring.Reclaim(completed);
+		while (!live.empty() && live.front().fence <= completed) {
+			const live_t& allocation = live.front();
+			for (uint64_t i = 0; i < allocation.size; ++i) {
+				if (memory[allocation.offset + i] != allocation.fill) {
+					++clobbered;
+					break;
+				}
+			}
+			live.pop_front();
+		}
+	};
+
+	uint32_t noise = 1;
+	auto next = [&]() {
+		noise = noise * 1664525u + 1013904223u;
+		return noise >> 8;
+	};
+	auto allocate = [&](uint64_t size, uint64_t alignment, uint64_t fence) {
+		upload_allocation_t allocation = ring.Allocate(size, alignment);
+		while (!allocation.cpu && ring.OldestPendingFence() != 0) {
+			++waits;
+			retire(ring.OldestPendingFence());
+			allocation = ring.Allocate(size, alignment);
+		}
+		if (!allocation.cpu) {
+			++refused;
+			return;
+		}
+		misaligned += allocation.offset % alignment != 0 || allocation.gpu != gpu_base + allocation.offset ||
+			allocation.cpu != memory.data() + allocation.offset;
+		uint8_t const fill = static_cast<uint8_t>(live.size() * 31 + fence);
+		memset(allocation.cpu, fill, static_cast<size_t>(size));
+		live.push_back({ fence, allocation.offset, size, fill });
+	};
+
+	auto const start = std::chrono::steady_clock::now();
+	for (size_t frame = 0; frame < frames; ++frame) {
+		uint64_t const fence = frame + 1;
+		allocate(256, UPLOAD_CONSTANT_ALIGNMENT, fence);
+		allocate(64 * (1 + next() % 2048), UPLOAD_CONSTANT_ALIGNMENT, fence);
+		if (next() % 16 == 0) {
+			allocate(1 + next() % (ring_size / 8), UPLOAD_CONSTANT_ALIGNMENT, fence);
+		}
+		if (next() % 64 == 0) {
+			allocate(UPLOAD_TEXTURE_ALIGNMENT * (1 + next() % (ring_size / UPLOAD_TEXTURE_ALIGNMENT / 3)), UPLOAD_TEXTURE_ALIGNMENT, fence);
+		}
+		ring.Submit(fence);
+		if (fence > latency) {
+			retire(fence - latency);
+		}
+	}
+	retire(frames);
+	double const seconds = Seconds(start);
+	const upload_ring_stats_t& stats = ring.Stats();
+
+	FILE* out = OpenReport(args, "ring.txt");
+	if (!out) {
+		return 1;
+	}
+	fprintf(out, "%llu KB ring, %zu frames, GPU %llu frames behind, %.2f s\n",
+		static_cast<unsigned long long>(ring_size / 1024), frames, static_cast<unsigned long long>(latency), seconds);
+	fprintf(out, "allocations %zu, %.1f MB, wraps %zu, peak use %.1f%%\n", stats.allocations,
+		stats.allocated_bytes / 1048576.0, stats.wraps, 100.0 * stats.peak_used / ring_size);
+	fprintf(out, "waits for the GPU %zu, refused %zu, misaligned %zu, clobbered %zu, still live %llu bytes\n",
+		waits, refused, misaligned, clobbered, static_cast<unsigned long long>(ring.Used()));
+	return CloseReport(out, ring.Used() == 0 ? misaligned + clobbered + refused : 1);
+}
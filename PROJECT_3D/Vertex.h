@@ -0,0 +1,8 @@
+#pragma once
+
+// Vertex layout shared by the renderer and the portable geometry code.
+struct vertex_t {
+    float position[3];
+    float color[4];
+    float tex_coord[2];
+};
@@ -0,0 +1,359 @@
+#include "VertexCache.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+	int const CACHE_SIZE = 32;
+	int const MAX_VALENCE = 32;
+
+	float const CACHE_DECAY_POWER = 1.5f;
+	float const LAST_TRI_SCORE = 0.75f;
+	float const VALENCE_BOOST_SCALE = 2.0f;
+	float const VALENCE_BOOST_POWER = 0.5f;
+
+	struct score_tables_t {
+		float cache[CACHE_SIZE];
+		float valence[MAX_VALENCE + 1];
+
+		score_tables_t() {
+			for (int i = 0; i < CACHE_SIZE; ++i) {
+				if (i < 3) {
+					cache[i] = LAST_TRI_SCORE;
+				}
+				else {
+					float const scaler = 1.0f / (CACHE_SIZE - 3);
+					cache[i] = powf(1.0f - (i - 3) * scaler, CACHE_DECAY_POWER);
+				}
+			}
+			valence[0] = 0.0f;
+			for (int i = 1; i <= MAX_VALENCE; ++i) {
+				valence[i] = VALENCE_BOOST_SCALE * powf(static_cast<float>(i), -VALENCE_BOOST_POWER);
+			}
+		}
+	};
+
+	float VertexScore(const score_tables_t& tables, int cache_pos, uint32_t live) {
+		if (live == 0) {
+			return -1.0f;
+		}
+		float score = cache_pos >= 0 ? tables.cache[cache_pos] : 0.0f;
+		return score + tables.valence[std::min<uint32_t>(live, MAX_VALENCE)];
+	}
+
+	// Returns the number of misses caused by the triangle in a FIFO cache.
+	int FifoTouch(std::vector<uint32_t>& stamps, uint32_t& clock, size_t cache_size, const uint32_t* tri) {
+		int misses = 0;
+		for (int k = 0; k < 3; ++k) {
+			uint32_t const v = tri[k];
+			if (clock - stamps[v] > cache_size) {
+				stamps[v] = clock++;
+				++misses;
+			}
+		}
+		return misses;
+	}
+}
+
+void OptimizeVertexCache(uint32_t* indices, size_t index_count, size_t vertex_count) {
+	static const score_tables_t tables;
+	size_t const tri_count = index_count / 3;
+	if (tri_count == 0) {
+		return;
+	}
+
+	// Per-vertex list of triangles that still have to be emitted.
+	std::vector<uint32_t> live(vertex_count, 0);
+	for (size_t i = 0; i < tri_count * 3; ++i) {
+		++live[indices[i]];
+	}
+	std::vector<uint32_t> adjacency_offset(vertex_count + 1, 0);
+	for (size_t v = 0; v < vertex_count; ++v) {
+		adjacency_offset[v + 1] = adjacency_offset[v] + live[v];
+	}
+	std::vector<uint32_t> adjacency(tri_count * 3);
+	{
+		std::vector<uint32_t> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+		for (size_t t = 0; t < tri_count; ++t) {
+			for (int k = 0; k < 3; ++k) {
+				adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+			}
+		}
+	}
+
+	std::vector<int> cache_pos(vertex_count, -1);
+	std::vector<float> vertex_score(vertex_count);
+	for (size_t v = 0; v < vertex_count; ++v) {
+		vertex_score[v] = VertexScore(tables, -1, live[v]);
+	}
+
+	std::vector<float> tri_score(tri_count);
+	std::vector<bool> emitted(tri_count, false);
+	for (size_t t = 0; t < tri_count; ++t) {
+		const uint32_t* tri = &indices[t * 3];
+		tri_score[t] = vertex_score[tri[0]] + vertex_score[tri[1]] + vertex_score[tri[2]];
+	}
+
+	std::vector<uint32_t> output(tri_count * 3);
+	uint32_t cache[CACHE_SIZE + 3];
+	uint32_t new_cache[CACHE_SIZE + 3];
+	int cache_count = 0;
+	size_t next_candidate = 0;
+	int64_t best_tri = 0;
+
+	for (size_t out = 0; out < tri_count; ++out) {
+		if (best_tri < 0) {
+			// Nothing connected to the cache is left; restart from the
+			// first triangle that was not emitted yet.
+			while (emitted[next_candidate]) {
+				++next_candidate;
+			}
+			best_tri = static_cast<int64_t>(next_candidate);
+		}
+
+		const uint32_t* tri = &indices[best_tri * 3];
+		memcpy(&output[out * 3], tri, 3 * sizeof(uint32_t));
+		emitted[best_tri] = true;
+
+		for (int k = 0; k < 3; ++k) {
+			uint32_t const v = tri[k];
+			uint32_t* list = &adjacency[adjacency_offset[v]];
+			for (uint32_t i = 0; i < live[v]; ++i) {
+				if (list[i] == best_tri) {
+					list[i] = list[live[v] - 1];
+					break;
+				}
+			}
+			--live[v];
+		}
+
+		// Most recently used vertices move to the front.
+		int new_count = 0;
+		for (int k = 0; k < 3; ++k) {
+			new_cache[new_count++] = tri[k];
+		}
+		for (int i = 0; i < cache_count; ++i) {
+			uint32_t const v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2]) {
+				new_cache[new_count++] = v;
+			}
+		}
+
+		for (int i = 0; i < new_count; ++i) {
+			uint32_t const v = new_cache[i];
+			cache_pos[v] = i < CACHE_SIZE ? i : -1;
+			vertex_score[v] = VertexScore(tables, cache_pos[v], live[v]);
+		}
+
+		best_tri = -1;
+		float best_score = -1.0f;
+		for (int i = 0; i < new_count; ++i) {
+			uint32_t const v = new_cache[i];
+			const uint32_t* list = &adjacency[adjacency_offset[v]];
+			for (uint32_t j = 0; j < live[v]; ++j) {
+				uint32_t const t = list[j];
+				const uint32_t* other = &indices[t * 3];
+				tri_score[t] = vertex_score[other[0]] + vertex_score[other[1]] + vertex_score[other[2]];
+				if (i < CACHE_SIZE && tri_score[t] > best_score) {
+					best_score = tri_score[t];
+					best_tri = t;
+				}
+			}
+		}
+
+		cache_count = std::min(new_count, CACHE_SIZE);
+		memcpy(cache, new_cache, cache_count * sizeof(uint32_t));
+	}
+
+	memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+}
+
+void OptimizeOverdraw(
+	uint32_t* indices, size_t index_count,
+	const vertex_t* vertices, size_t vertex_count,
+	float threshold
+) {
+	size_t const FIFO_SIZE = 16;
+	size_t const tri_count = index_count / 3;
+	if (tri_count == 0) {
+		return;
+	}
+
+	// Hard boundaries: triangles that miss the cache with all three
+	// vertices start a new cluster, so reordering clusters costs nothing.
+	std::vector<size_t> hard;
+	{
+		std::vector<uint32_t> stamps(vertex_count, 0);
+		uint32_t clock = FIFO_SIZE + 1;
+		for (size_t t = 0; t < tri_count; ++t) {
+			if (FifoTouch(stamps, clock, FIFO_SIZE, &indices[t * 3]) == 3) {
+				hard.push_back(t);
+			}
+		}
+		if (hard.empty() || hard[0] != 0) {
+			hard.insert(hard.begin(), 0);
+		}
+		hard.push_back(tri_count);
+	}
+
+	// Soft boundaries: split a hard cluster further wherever the running
+	// ACMR is already within threshold of the whole cluster's ACMR.
+	// Advancing the clock past the cache size empties the simulated cache
+	// without touching the stamps.
+	std::vector<size_t> clusters;
+	std::vector<uint32_t> stamps(vertex_count, 0);
+	uint32_t clock = FIFO_SIZE + 1;
+	for (size_t c = 0; c + 1 < hard.size(); ++c) {
+		size_t const begin = hard[c];
+		size_t const end = hard[c + 1];
+
+		clock += FIFO_SIZE + 1;
+		size_t misses = 0;
+		for (size_t t = begin; t < end; ++t) {
+			misses += FifoTouch(stamps, clock, FIFO_SIZE, &indices[t * 3]);
+		}
+		float const cluster_acmr = static_cast<float>(misses) / (end - begin);
+
+		clock += FIFO_SIZE + 1;
+		clusters.push_back(begin);
+		size_t sub_misses = 0, sub_tris = 0;
+		for (size_t t = begin; t < end; ++t) {
+			sub_misses += FifoTouch(stamps, clock, FIFO_SIZE, &indices[t * 3]);
+			++sub_tris;
+			float const acmr = static_cast<float>(sub_misses) / sub_tris;
+			if (t + 1 < end && acmr <= cluster_acmr * threshold && sub_tris >= 8) {
+				clusters.push_back(t + 1);
+				clock += FIFO_SIZE + 1;
+				sub_misses = 0;
+				sub_tris = 0;
+			}
+		}
+	}
+	clusters.push_back(tri_count);
+
+	// Outward facing clusters far from the mesh centre occlude the rest
+	// from most viewpoints, so they are drawn first.
+	float mesh_center[3] = { 0.0f, 0.0f, 0.0f };
+	for (size_t t = 0; t < tri_count * 3; ++t) {
+		for (int k = 0; k < 3; ++k) {
+			mesh_center[k] += vertices[indices[t]].position[k];
+		}
+	}
+	for (auto& c : mesh_center) {
+		c /= static_cast<float>(tri_count * 3);
+	}
+
+	size_t const cluster_count = clusters.size() - 1;
+	std::vector<float> sort_key(cluster_count);
+	for (size_t c = 0; c < cluster_count; ++c) {
+		float centroid[3] = { 0.0f, 0.0f, 0.0f };
+		float normal[3] = { 0.0f, 0.0f, 0.0f };
+		float area_sum = 0.0f;
+		for (size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+			const float* p0 = vertices[indices[t * 3 + 0]].position;
+			const float* p1 = vertices[indices[t * 3 + 1]].position;
+			const float* p2 = vertices[indices[t * 3 + 2]].position;
+			float const e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float const e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float const n[3] = {
+				e1[1] * e2[2] - e1[2] * e2[1],
+				e1[2] * e2[0] - e1[0] * e2[2],
+				e1[0] * e2[1] - e1[1] * e2[0]
+			};
+			float const area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			for (int k = 0; k < 3; ++k) {
+				centroid[k] += (p0[k] + p1[k] + p2[k]) / 3.0f * area;
+				normal[k] += n[k];
+			}
+			area_sum += area;
+		}
+		float const length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (area_sum <= 0.0f || length <= 0.0f) {
+			sort_key[c] = 0.0f;
+			continue;
+		}
+		float key = 0.0f;
+		for (int k = 0; k < 3; ++k) {
+			key += (centroid[k] / area_sum - mesh_center[k]) * normal[k] / length;
+		}
+		sort_key[c] = key;
+	}
+
+	std::vector<size_t> order(cluster_count);
+	for (size_t c = 0; c < cluster_count; ++c) {
+		order[c] = c;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return sort_key[a] > sort_key[b];
+	});
+
+	std::vector<uint32_t> output;
+	output.reserve(tri_count * 3);
+	for (size_t c : order) {
+		output.insert(output.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+	}
+	memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+}
+
+vertex_cache_stats_t AnalyzeVertexCacheFifo(
+	const uint32_t* indices, size_t index_count, size_t vertex_count, size_t cache_size
+) {
+	std::vector<uint32_t> stamps(vertex_count, 0);
+	std::vector<bool> referenced(vertex_count, false);
+	uint32_t clock = static_cast<uint32_t>(cache_size) + 1;
+	size_t transforms = 0, unique = 0;
+
+	for (size_t i = 0; i + 2 < index_count; i += 3) {
+		transforms += FifoTouch(stamps, clock, cache_size, &indices[i]);
+		for (int k = 0; k < 3; ++k) {
+			if (!referenced[indices[i + k]]) {
+				referenced[indices[i + k]] = true;
+				++unique;
+			}
+		}
+	}
+
+	size_t const tri_count = index_count / 3;
+	return {
+		transforms,
+		tri_count ? static_cast<float>(transforms) / tri_count : 0.0f,
+		unique ? static_cast<float>(transforms) / unique : 0.0f
+	};
+}
+
+vertex_cache_stats_t AnalyzeVertexCacheLru(
+	const uint32_t* indices, size_t index_count, size_t vertex_count, size_t cache_size
+) {
+	std::vector<uint32_t> cache;
+	cache.reserve(cache_size + 1);
+	std::vector<bool> referenced(vertex_count, false);
+	size_t transforms = 0, unique = 0;
+
+	for (size_t i = 0; i < index_count - index_count % 3; ++i) {
+		uint32_t const v = indices[i];
+		auto it = std::find(cache.begin(), cache.end(), v);
+		if (it == cache.end()) {
+			++transforms;
+			if (cache.size() == cache_size) {
+				cache.pop_back();
+			}
+		}
+		else {
+			cache.erase(it);
+		}
+		cache.insert(cache.begin(), v);
+
+		if (!referenced[v]) {
+			referenced[v] = true;
+			++unique;
+		}
+	}
+
+	size_t const tri_count = index_count / 3;
+	return {
+		transforms,
+		tri_count ? static_cast<float>(transforms) / tri_count : 0.0f,
+		unique ? static_cast<float>(transforms) / unique : 0.0f
+	};
+}
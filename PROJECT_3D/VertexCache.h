@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Vertex.h"
+#include <cstddef>
+#include <cstdint>
+
+struct vertex_cache_stats_t {
+    size_t transforms;      // vertex shader invocations
+    float acmr;             // transforms per triangle
+    float atvr;             // transforms per referenced vertex
+};
+
+// Reorders the triangles of an indexed list for the post-transform cache
+// using Forsyth's linear-speed scoring. Indices stay valid, only the
+// triangle order changes.
+void OptimizeVertexCache(uint32_t* indices, size_t index_count, size_t vertex_count);
+
+// Splits a cache-optimized index list into clusters at cache-miss
+// boundaries and sorts the clusters so outward facing ones come first
+// (Sander et al. 2007). threshold > 1 allows that much ACMR regression.
+void OptimizeOverdraw(
+    uint32_t* indices, size_t index_count,
+    const vertex_t* vertices, size_t vertex_count,
+    float threshold = 1.05f
+);
+
+// Cache simulators used to compare orderings.
+vertex_cache_stats_t AnalyzeVertexCacheFifo(
+    const uint32_t* indices, size_t index_count, size_t vertex_count, size_t cache_size = 16
+);
+vertex_cache_stats_t AnalyzeVertexCacheLru(
+    const uint32_t* indices, size_t index_count, size_t vertex_count, size_t cache_size = 32
+);
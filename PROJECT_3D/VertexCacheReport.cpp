@@ -0,0 +1,56 @@
+#include "ReportTools.h"
+#include "MeshWeld.h"
+#include "VertexCache.h"
+
+// Reorders the welded room and a grid of rooms for the vertex cache and
+// then for overdraw, and prints ACMR/ATVR under a 16-entry FIFO and a
+// 32-entry LRU cache after each step, with the optimizers' throughput.
+// Fails when a step loses or changes a triangle, the cache optimizer does
+// not improve FIFO ACMR or overdraw ordering costs more than its threshold.
+//   --cache-report [cache.txt] [columns] [rows]
+int CacheReportTool(const std::vector<std::string>& args) {
+	std::vector<report_input_t> const inputs = ReportInputs(args, 16);
+	float const overdraw_threshold = 1.05f;
+
+	FILE* out = OpenReport(args, "cache.txt");
+	if (!out) {
+		return 1;
+	}
+	size_t failures = 0;
+	for (const report_input_t& input : inputs) {
+		indexed_mesh_t mesh = WeldVertices(input.vertices.data(), input.vertices.size());
+		size_t const vertex_count = mesh.vertices.size();
+		std::vector<uint32_t>& indices = mesh.indices;
+		std::vector<std::array<uint32_t, 3>> const triangles = SortedTriangles(indices);
+		auto print = [&](const char* step) {
+			vertex_cache_stats_t const fifo = AnalyzeVertexCacheFifo(indices.data(), indices.size(), vertex_count);
+			vertex_cache_stats_t const lru = AnalyzeVertexCacheLru(indices.data(), indices.size(), vertex_count);
+			fprintf(out, "%s %-9s FIFO16 ACMR %.3f ATVR %.3f, LRU32 ACMR %.3f ATVR %.3f\n",
+				input.name, step, fifo.acmr, fifo.atvr, lru.acmr, lru.atvr);
+			return fifo;
+		};
+
+		vertex_cache_stats_t const before = print("original");
+		auto start = std::chrono::steady_clock::now();
+		OptimizeVertexCache(indices.data(), indices.size(), vertex_count);
+		double const cache_seconds = Seconds(start);
+		vertex_cache_stats_t const optimized = print("cache");
+		bool const cache_kept = SortedTriangles(indices) == triangles;
+
+		start = std::chrono::steady_clock::now();
+		OptimizeOverdraw(indices.data(), indices.size(), mesh.vertices.data(), vertex_count, overdraw_threshold);
+		double const overdraw_seconds = Seconds(start);
+		vertex_cache_stats_t const overdraw = print("overdraw");
+		bool const overdraw_kept = SortedTriangles(indices) == triangles;
+
+		size_t const triangle_count = triangles.size();
+		fprintf(out, "%s: %zu triangles; cache %.2f M tris/s, overdraw %.2f M tris/s; triangles kept %s/%s\n",
+			input.name, triangle_count,
+			cache_seconds > 0.0 ? triangle_count / cache_seconds / 1e6 : 0.0,
+			overdraw_seconds > 0.0 ? triangle_count / overdraw_seconds / 1e6 : 0.0,
+			cache_kept ? "yes" : "no", overdraw_kept ? "yes" : "no");
+		failures += !cache_kept + !overdraw_kept + (optimized.acmr > before.acmr) +
+			(overdraw.acmr > optimized.acmr * overdraw_threshold + 1e-4f);
+	}
+	return CloseReport(out, failures);
+}
@@ -0,0 +1,115 @@
+#include "VertexQuantize.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+	float const SNORM16_MAX = 32767.0f;
+	float const UNORM16_MAX = 65535.0f;
+
+	uint32_t PackColor(const float (&color)[4]) {
+		uint32_t packed = 0;
+		for (int k = 0; k < 4; ++k) {
+			float const c = std::min(std::max(color[k], 0.0f), 1.0f);
+			packed |= static_cast<uint32_t>(lroundf(c * 255.0f)) << (8 * k);
+		}
+		return packed;
+	}
+}
+
+size_t quantized_vertices_t::BytesPerVertex() const {
+	return sizeof(packed_vertex_t) + (constant_color ? 0 : sizeof(uint32_t));
+}
+
+float quantized_vertices_t::PositionErrorBound() const {
+	float const s = std::max({ quantization.position_scale[0], quantization.position_scale[1], quantization.position_scale[2] });
+	return 0.5f * s / SNORM16_MAX;
+}
+
+float quantized_vertices_t::TexCoordErrorBound() const {
+	float const s = std::max(quantization.tex_coord_scale[0], quantization.tex_coord_scale[1]);
+	return 0.5f * s / UNORM16_MAX;
+}
+
+quantized_vertices_t QuantizeVertices(const vertex_t* vertices, size_t count) {
+	quantized_vertices_t result = {};
+
+	float pos_min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float pos_max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	float tex_min[2] = { FLT_MAX, FLT_MAX };
+	float tex_max[2] = { -FLT_MAX, -FLT_MAX };
+	for (size_t i = 0; i < count; ++i) {
+		for (int k = 0; k < 3; ++k) {
+			pos_min[k] = std::min(pos_min[k], vertices[i].position[k]);
+			pos_max[k] = std::max(pos_max[k], vertices[i].position[k]);
+		}
+		for (int k = 0; k < 2; ++k) {
+			tex_min[k] = std::min(tex_min[k], vertices[i].tex_coord[k]);
+			tex_max[k] = std::max(tex_max[k], vertices[i].tex_coord[k]);
+		}
+	}
+
+	vertex_quantization_t& q = result.quantization;
+	for (int k = 0; k < 3; ++k) {
+		float const half = count ? 0.5f * (pos_max[k] - pos_min[k]) : 0.0f;
+		q.position_scale[k] = half > 0.0f ? half : 1.0f;
+		q.position_offset[k] = count ? 0.5f * (pos_max[k] + pos_min[k]) : 0.0f;
+	}
+	for (int k = 0; k < 2; ++k) {
+		float const range = count ? tex_max[k] - tex_min[k] : 0.0f;
+		q.tex_coord_scale[k] = range > 0.0f ? range : 1.0f;
+		q.tex_coord_offset[k] = count ? tex_min[k] : 0.0f;
+	}
+
+	result.vertices.resize(count);
+	result.colors.resize(count);
+	for (size_t i = 0; i < count; ++i) {
+		packed_vertex_t& p = result.vertices[i];
+		for (int k = 0; k < 3; ++k) {
+			float const n = (vertices[i].position[k] - q.position_offset[k]) / q.position_scale[k];
+			p.position[k] = static_cast<int16_t>(lroundf(std::min(std::max(n, -1.0f), 1.0f) * SNORM16_MAX));
+		}
+		p.position[3] = static_cast<int16_t>(SNORM16_MAX);
+		for (int k = 0; k < 2; ++k) {
+			float const n = (vertices[i].tex_coord[k] - q.tex_coord_offset[k]) / q.tex_coord_scale[k];
+			p.tex_coord[k] = static_cast<uint16_t>(lroundf(std::min(std::max(n, 0.0f), 1.0f) * UNORM16_MAX));
+		}
+		result.colors[i] = PackColor(vertices[i].color);
+	}
+
+	result.constant_color = std::all_of(result.colors.begin(), result.colors.end(), [&](uint32_t c) {
+		return c == result.colors[0];
+	});
+	if (result.constant_color) {
+		result.colors.resize(std::min<size_t>(count, 1));
+	}
+	return result;
+}
+
+vertex_t DecodeVertex(const quantized_vertices_t& quantized, size_t index) {
+	const vertex_quantization_t& q = quantized.quantization;
+	const packed_vertex_t& p = quantized.vertices[index];
+	uint32_t const color = quantized.colors[quantized.constant_color ? 0 : index];
+
+	vertex_t v;
+	for (int k = 0; k < 3; ++k) {
+		float const n = std::max(p.position[k] / SNORM16_MAX, -1.0f);
+		v.position[k] = n * q.position_scale[k] + q.position_offset[k];
+	}
+	for (int k = 0; k < 4; ++k) {
+		v.color[k] = ((color >> (8 * k)) & 0xFF) / 255.0f;
+	}
+	for (int k = 0; k < 2; ++k) {
+		v.tex_coord[k] = p.tex_coord[k] / UNORM16_MAX * q.tex_coord_scale[k] + q.tex_coord_offset[k];
+	}
+	return v;
+}
+
+void DecodePositions(const vertex_quantization_t& quantization, const packed_vertex_t* vertices, size_t count, float* positions) {
+	for (size_t i = 0; i < count; ++i) {
+		for (int k = 0; k < 3; ++k) {
+			float const n = std::max(vertices[i].position[k] / SNORM16_MAX, -1.0f);
+			positions[3 * i + k] = n * quantization.position_scale[k] + quantization.position_offset[k];
+		}
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Vertex.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// GPU vertex: position as R16G16B16A16_SNORM relative to the mesh AABB,
+// tex_coord as R16G16_UNORM relative to the UV bounds. 12 bytes.
+struct packed_vertex_t {
+    int16_t position[4];
+    uint16_t tex_coord[2];
+};
+
+// Decode constants, position = q * scale + offset (the shader receives
+// q already normalized by the input assembler).
+struct vertex_quantization_t {
+    float position_scale[3];
+    float position_offset[3];
+    float tex_coord_scale[2];
+    float tex_coord_offset[2];
+};
+
+struct quantized_vertices_t {
+    vertex_quantization_t quantization;
+    std::vector<packed_vertex_t> vertices;
+    // R8G8B8A8_UNORM per vertex, or a single entry when every vertex has
+    // the same color (bound with a zero stride in that case).
+    std::vector<uint32_t> colors;
+    bool constant_color = true;
+
+    size_t BytesPerVertex() const;
+    // Largest per-component decode error for positions and tex coords.
+    float PositionErrorBound() const;
+    float TexCoordErrorBound() const;
+};
+
+quantized_vertices_t QuantizeVertices(const vertex_t* vertices, size_t count);
+vertex_t DecodeVertex(const quantized_vertices_t& quantized, size_t index);
+// Decodes count positions into packed float3 (CPU-side geometry such as
+// occluders, built straight from a mapped asset).
+void DecodePositions(const vertex_quantization_t& quantization, const packed_vertex_t* vertices, size_t count, float* positions);
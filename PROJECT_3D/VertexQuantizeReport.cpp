@@ -0,0 +1,77 @@
+#include "ReportTools.h"
+#include "VertexQuantize.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <utility>
+
+// Quantizes the room, a grid of rooms and random vertices spread over a
+// large range, decodes every vertex again and prints the largest errors
+// against the bounds the quantization reports, with encode and decode
+// throughput. Fails when a decoded position, tex coord or color is further
+// off than its bound, or DecodePositions disagrees with DecodeVertex.
+//   --quantize-report [quantize.txt] [columns] [rows]
+int QuantizeReportTool(const std::vector<std::string>& args) {
+	std::vector<report_input_t> inputs = ReportInputs(args, 16);
+	report_input_t scattered = { "scattered", std::vector<vertex_t>(100000) };
+	uint32_t noise = 1;
+	auto random = [&noise](float lo, float hi) {
+		noise = noise * 1664525u + 1013904223u;
+		return lo + (hi - lo) * static_cast<float>(noise >> 8) / 16777216.0f;
+	};
+	for (vertex_t& v : scattered.vertices) {
+		v = { { random(-5000.0f, 5000.0f), random(-1.0f, 1.0f), random(100.0f, 100.5f) },
+			{ random(0.0f, 1.0f), random(0.0f, 1.0f), random(0.0f, 1.0f), 1.0f },
+			{ random(-8.0f, 8.0f), random(0.0f, 1.0f) } };
+	}
+	inputs.push_back(std::move(scattered));
+
+	FILE* out = OpenReport(args, "quantize.txt");
+	if (!out) {
+		return 1;
+	}
+	size_t failures = 0;
+	for (const report_input_t& input : inputs) {
+		const std::vector<vertex_t>& vertices = input.vertices;
+		auto start = std::chrono::steady_clock::now();
+		quantized_vertices_t const quantized = QuantizeVertices(vertices.data(), vertices.size());
+		double const encode_seconds = Seconds(start);
+		std::vector<float> positions(vertices.size() * 3);
+		start = std::chrono::steady_clock::now();
+		DecodePositions(quantized.quantization, quantized.vertices.data(), quantized.vertices.size(), positions.data());
+		double const decode_seconds = Seconds(start);
+
+		// The bounds are exact in real arithmetic; encoding and decoding in
+		// float add rounding relative to the scale and offset.
+		const vertex_quantization_t& q = quantized.quantization;
+		float position_error = 0.0f, tex_coord_error = 0.0f, color_error = 0.0f;
+		size_t over_bound = 0, mismatches = 0;
+		for (size_t i = 0; i < vertices.size(); ++i) {
+			vertex_t const decoded = DecodeVertex(quantized, i);
+			for (int k = 0; k < 3; ++k) {
+				float const error = std::fabs(decoded.position[k] - vertices[i].position[k]);
+				position_error = (std::max)(position_error, error);
+				over_bound += error > quantized.PositionErrorBound() + 4.0f * FLT_EPSILON * (q.position_scale[k] + std::fabs(q.position_offset[k]));
+				mismatches += positions[3 * i + k] != decoded.position[k];
+			}
+			for (int k = 0; k < 2; ++k) {
+				float const error = std::fabs(decoded.tex_coord[k] - vertices[i].tex_coord[k]);
+				tex_coord_error = (std::max)(tex_coord_error, error);
+				over_bound += error > quantized.TexCoordErrorBound() + 4.0f * FLT_EPSILON * (q.tex_coord_scale[k] + std::fabs(q.tex_coord_offset[k]));
+			}
+			for (int k = 0; k < 4; ++k) {
+				float const error = std::fabs(decoded.color[k] - vertices[i].color[k]);
+				color_error = (std::max)(color_error, error);
+				over_bound += error > 0.5f / 255.0f + FLT_EPSILON;
+			}
+		}
+		fprintf(out, "%s: %zu vertices, %zu bytes each; position error %g (bound %g), tex coord error %g (bound %g), "
+			"color error %g; encode %.1f M vertices/s, decode positions %.1f M vertices/s; %zu over bound, %zu mismatches\n",
+			input.name, vertices.size(), quantized.BytesPerVertex(), position_error, quantized.PositionErrorBound(),
+			tex_coord_error, quantized.TexCoordErrorBound(), color_error,
+			encode_seconds > 0.0 ? vertices.size() / encode_seconds / 1e6 : 0.0,
+			decode_seconds > 0.0 ? vertices.size() / decode_seconds / 1e6 : 0.0, over_bound, mismatches);
+		failures += over_bound + mismatches;
+	}
+	return CloseReport(out, failures);
+}
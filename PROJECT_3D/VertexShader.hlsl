@@ -1,6 +1,9 @@
 cbuffer vs_const_buffer_t {
     float4x4 matWorldViewProj;
-    float4 padding[12];
+    float4 posScale;
+    float4 posOffset;
+    float4 texScaleOffset;
+    float4 padding[9];
 };
 struct vs_output_t {
     float4 position : SV_POSITION;
@@ -8,17 +11,21 @@ struct vs_output_t {
     float2 tex : TEXCOORD;
 };
 vs_output_t main(
-    float3 pos : POSITION,
+    float4 pos : POSITION,
+    float2 tex : TEXCOORD,
     float4 col : COLOR,
-    float2 tex : TEXCOORD
-   // row_major float4x4 mat_w : WORLD,
+    row_major float4x4 mat_w : WORLD
    // uint instance_id : SV_InstanceID
 ) {
     vs_output_t result;
+    // Positions and tex coords arrive normalized to the scene bounds;
+    // mat_w places the instance of a shared object.
+    float3 local_pos = pos.xyz * posScale.xyz + posOffset.xyz;
+    float4 world_pos = mul(float4(local_pos, 1.0f), mat_w);
     result.position = mul(
-        float4(pos, 1.0f), matWorldViewProj
+        world_pos, matWorldViewProj
     );
     result.color = col;
-    result.tex = tex;
+    result.tex = tex * texScaleOffset.xy + texScaleOffset.zw;
     return result;
 }
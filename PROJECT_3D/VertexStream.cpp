@@ -0,0 +1,73 @@
+#include "VertexStream.h"
+#include "FileUtil.h"
+#include "MappedFile.h"
+#include <cstring>
+#include <stdexcept>
+
+VertexStreamWriter::~VertexStreamWriter() {
+	// An unclosed stream keeps a zero count, so a failed write never
+	// leaves a file that looks complete.
+	if (m_file) {
+		fclose(m_file);
+	}
+}
+
+void VertexStreamWriter::Open(const char* path) {
+	if (m_file) {
+		throw std::runtime_error("VertexStreamWriter: already open");
+	}
+	m_file = OpenFile(path, "wb");
+	if (!m_file) {
+		throw std::runtime_error("VertexStreamWriter: cannot create file");
+	}
+	m_count = 0;
+	vertex_stream_header_t const header = {};
+	if (fwrite(&header, sizeof(header), 1, m_file) != 1) {
+		throw std::runtime_error("VertexStreamWriter: write failed");
+	}
+}
+
+void VertexStreamWriter::Append(const vertex_t* vertices, size_t count) {
+	if (count && fwrite(vertices, sizeof(vertex_t), count, m_file) != count) {
+		throw std::runtime_error("VertexStreamWriter: write failed");
+	}
+	m_count += count;
+}
+
+void VertexStreamWriter::Close() {
+	vertex_stream_header_t header = {};
+	header.magic = VERTEX_STREAM_MAGIC;
+	header.version = VERTEX_STREAM_VERSION;
+	header.vertex_stride = sizeof(vertex_t);
+	header.vertex_count = m_count;
+	bool const written = fseek(m_file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, m_file) == 1;
+	bool const closed = fclose(m_file) == 0;
+	m_file = nullptr;
+	if (!written || !closed) {
+		throw std::runtime_error("VertexStreamWriter: write failed");
+	}
+}
+
+std::vector<vertex_t> ReadVertexStream(const char* path) {
+	MappedFile file;
+	if (!file.Open(path)) {
+		throw std::runtime_error("ReadVertexStream: cannot open file");
+	}
+	vertex_stream_header_t header;
+	if (file.Size() < sizeof(header)) {
+		throw std::runtime_error("ReadVertexStream: truncated file");
+	}
+	memcpy(&header, file.Data(), sizeof(header));
+	if (header.magic != VERTEX_STREAM_MAGIC || header.version != VERTEX_STREAM_VERSION ||
+		header.vertex_stride != sizeof(vertex_t)) {
+		throw std::runtime_error("ReadVertexStream: not a vertex stream of this version");
+	}
+	if (header.vertex_count > (file.Size() - sizeof(header)) / sizeof(vertex_t)) {
+		throw std::runtime_error("ReadVertexStream: truncated file");
+	}
+	std::vector<vertex_t> vertices(static_cast<size_t>(header.vertex_count));
+	if (!vertices.empty()) {
+		memcpy(vertices.data(), file.Data() + sizeof(header), vertices.size() * sizeof(vertex_t));
+	}
+	return vertices;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Vertex.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Raw triangle list: the header is followed by vertex_count vertex_t, as
+// they are laid out in memory. Meant for generated benchmark scenes too
+// large to build in memory, so it is written in chunks.
+uint32_t const VERTEX_STREAM_MAGIC = 0x56443350; // "P3DV"
+uint32_t const VERTEX_STREAM_VERSION = 1;
+
+struct vertex_stream_header_t {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertex_stride;
+    uint32_t reserved;
+    uint64_t vertex_count;
+};
+
+// Appends vertices to a stream file and fills in the count on Close.
+// Throws std::runtime_error on I/O failure.
+class VertexStreamWriter
+{
+public:
+    VertexStreamWriter() = default;
+    ~VertexStreamWriter();
+    VertexStreamWriter(const VertexStreamWriter&) = delete;
+    VertexStreamWriter& operator=(const VertexStreamWriter&) = delete;
+
+    void Open(const char* path);
+    void Append(const vertex_t* vertices, size_t count);
+    void Close();
+
+    uint64_t VertexCount() const { return m_count; }
+
+private:
+    FILE* m_file = nullptr;
+    uint64_t m_count = 0;
+};
+
+// Reads a whole stream; throws std::runtime_error when the file is missing,
+// truncated or of another version.
+std::vector<vertex_t> ReadVertexStream(const char* path);
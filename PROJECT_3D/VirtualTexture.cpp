@@ -0,0 +1,294 @@
+#include "VirtualTexture.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+	uint32_t const NO_SLOT = 0xFFFFFFFF;
+
+	// Tiles of a level whose parent is the given one: two, or one at an odd
+	// edge, except that the last parent also takes any further child the
+	// rounding of odd level sizes leaves over.
+	void ChildSpan(uint32_t parent, uint32_t parent_count, uint32_t child_count, uint32_t& first, uint32_t& last) {
+		first = parent * 2;
+		last = parent + 1 == parent_count ? child_count - 1 : (std::min)(parent * 2 + 1, child_count - 1);
+	}
+}
+
+uint32_t VirtualTextureLevelCount(uint32_t width, uint32_t height) {
+	uint32_t levels = 1;
+	while (width > VIRTUAL_TILE_SIZE || height > VIRTUAL_TILE_SIZE) {
+		width = (std::max)(width / 2, 1u);
+		height = (std::max)(height / 2, 1u);
+		++levels;
+	}
+	return levels;
+}
+
+VirtualTexture::VirtualTexture(uint32_t width, uint32_t height, VirtualTextureSink& sink, const virtual_texture_config_t& config) :
+	m_sink(sink),
+	m_config(config),
+	m_lruHead(NO_SLOT),
+	m_lruTail(NO_SLOT),
+	m_stats{}
+{
+	uint32_t const level_count = VirtualTextureLevelCount(width, height);
+	uint32_t const slot_count = config.cache_columns * config.cache_rows;
+	if (width == 0 || height == 0 || level_count > 16 || (width + VIRTUAL_TILE_SIZE - 1) / VIRTUAL_TILE_SIZE > 0x4000 ||
+		(height + VIRTUAL_TILE_SIZE - 1) / VIRTUAL_TILE_SIZE > 0x4000) {
+		throw std::runtime_error("VirtualTexture: unsupported size");
+	}
+	if (slot_count == 0 || config.cache_columns > 256 || config.cache_rows > 256) {
+		throw std::runtime_error("VirtualTexture: unsupported cache size");
+	}
+
+	uint32_t tile_count = 0;
+	for (uint32_t level = 0; level < level_count; ++level) {
+		uint32_t const w = (std::max)(width >> level, 1u), h = (std::max)(height >> level, 1u);
+		level_t const desc = {
+			(w + VIRTUAL_TILE_SIZE - 1) / VIRTUAL_TILE_SIZE,
+			(h + VIRTUAL_TILE_SIZE - 1) / VIRTUAL_TILE_SIZE,
+			tile_count
+		};
+		m_levels.push_back(desc);
+		tile_count += desc.tiles_x * desc.tiles_y;
+	}
+	m_state.assign(tile_count, tile_state_t::absent);
+	m_tileSlot.assign(tile_count, NO_SLOT);
+	m_requestFrame.assign(tile_count, 0);
+	m_requestIndex.assign(tile_count, 0);
+	m_indirection.assign(tile_count, 0);
+
+	m_slotTile.assign(slot_count, VIRTUAL_TILE_NONE);
+	m_slotFrame.assign(slot_count, 0);
+	m_lruPrev.assign(slot_count, NO_SLOT);
+	m_lruNext.assign(slot_count, NO_SLOT);
+	// Popped from the back, so slot 0 is used first.
+	for (uint32_t slot = slot_count; slot-- > 0;) {
+		m_freeSlots.push_back(slot);
+	}
+}
+
+void VirtualTexture::AddFeedback(const uint32_t* entries, size_t count) {
+	for (size_t i = 0; i < count; ++i) {
+		uint32_t const tile = entries[i];
+		if (tile == VIRTUAL_TILE_NONE) {
+			continue;
+		}
+		++m_stats.feedback_entries;
+		uint32_t const level = TileLevel(tile);
+		if (level >= m_levels.size() || TileX(tile) >= m_levels[level].tiles_x || TileY(tile) >= m_levels[level].tiles_y) {
+			++m_stats.invalid_feedback;
+			continue;
+		}
+		Request(tile, 1);
+	}
+}
+
+void VirtualTexture::Update(uint64_t completed_fence) {
+	uint32_t const last_level = LevelCount() - 1;
+
+	// Finished uploads become resident, and the entries that fell back to
+	// coarser tiles point at them.
+	while (!m_pending.empty() && m_pending.front().fence <= completed_fence) {
+		pending_t const done = m_pending.front();
+		m_pending.pop_front();
+		uint32_t const level = TileLevel(done.tile);
+		m_state[Index(done.tile)] = tile_state_t::resident;
+		m_slotTile[done.slot] = done.tile;
+		if (level != last_level) {
+			LinkFront(done.slot);
+		}
+		uint32_t const entry = (done.slot % m_config.cache_columns) | (done.slot / m_config.cache_columns) << 8 |
+			level << 16 | 0xFFu << 24;
+		Cover(done.tile, entry, level);
+		--m_stats.pending_tiles;
+		++m_stats.resident_tiles;
+	}
+
+	// The last level's tile is always wanted, and every requested tile's
+	// ancestors are, finest level first so that counts add up the chain.
+	Request(PackTileId(last_level, 0, 0), 0);
+	for (uint32_t level = 0; level < last_level; ++level) {
+		for (size_t i = 0; i < m_requests.size(); ++i) {
+			request_t const request = m_requests[i];
+			if (TileLevel(request.tile) == level) {
+				Request(Parent(request.tile), request.count);
+			}
+		}
+	}
+
+	// Requested tiles move to the front of the LRU list and may not be
+	// evicted this frame.
+	m_missing.clear();
+	for (const request_t& request : m_requests) {
+		uint32_t const index = Index(request.tile);
+		if (m_state[index] == tile_state_t::resident) {
+			uint32_t const slot = m_tileSlot[index];
+			m_slotFrame[slot] = m_frame;
+			if (TileLevel(request.tile) != last_level) {
+				Unlink(slot);
+				LinkFront(slot);
+			}
+		}
+		else if (m_state[index] == tile_state_t::absent) {
+			m_missing.push_back(request);
+		}
+	}
+
+	// Coarse tiles first: they cover the most and are the fallback of the
+	// finer ones.
+	std::sort(m_missing.begin(), m_missing.end(), [](const request_t& a, const request_t& b) {
+		if (TileLevel(a.tile) != TileLevel(b.tile)) {
+			return TileLevel(a.tile) > TileLevel(b.tile);
+		}
+		return a.count != b.count ? a.count > b.count : a.tile < b.tile;
+	});
+	size_t queued = 0;
+	for (const request_t& request : m_missing) {
+		if (queued == m_config.max_uploads_per_update || m_pending.size() >= m_config.max_uploads_in_flight) {
+			break;
+		}
+		uint32_t slot;
+		if (!m_freeSlots.empty()) {
+			slot = m_freeSlots.back();
+			m_freeSlots.pop_back();
+		}
+		else if (m_lruTail != NO_SLOT && m_slotFrame[m_lruTail] != m_frame) {
+			slot = m_lruTail;
+			Evict(slot);
+		}
+		else {
+			// Every slot holds a tile this frame asks for.
+			break;
+		}
+		uint32_t const index = Index(request.tile);
+		m_state[index] = tile_state_t::pending;
+		m_tileSlot[index] = slot;
+		m_sink.RecordTileUpload(request.tile, slot);
+		m_pending.push_back({ request.tile, slot, 0 });
+		++queued;
+		++m_stats.uploads;
+		++m_stats.pending_tiles;
+	}
+	if (queued > 0) {
+		uint64_t const fence = m_sink.SubmitTileUploads();
+		for (size_t i = m_pending.size() - queued; i < m_pending.size(); ++i) {
+			m_pending[i].fence = fence;
+		}
+	}
+
+	m_stats.requested_tiles = m_requests.size();
+	m_stats.missing_tiles = m_missing.size();
+	m_stats.deferred += m_missing.size() - queued;
+	m_requests.clear();
+	++m_frame;
+}
+
+uint32_t VirtualTexture::Parent(uint32_t tile) const {
+	const level_t& parent = m_levels[TileLevel(tile) + 1];
+	return PackTileId(
+		TileLevel(tile) + 1, (std::min)(TileX(tile) / 2, parent.tiles_x - 1), (std::min)(TileY(tile) / 2, parent.tiles_y - 1)
+	);
+}
+
+void VirtualTexture::Request(uint32_t tile, uint32_t count) {
+	uint32_t const index = Index(tile);
+	if (m_requestFrame[index] == m_frame) {
+		m_requests[m_requestIndex[index]].count += count;
+		return;
+	}
+	m_requestFrame[index] = m_frame;
+	m_requestIndex[index] = static_cast<uint32_t>(m_requests.size());
+	m_requests.push_back({ tile, count });
+}
+
+void VirtualTexture::Evict(uint32_t slot) {
+	uint32_t const tile = m_slotTile[slot];
+	uint32_t const index = Index(tile);
+	Unlink(slot);
+	m_state[index] = tile_state_t::absent;
+	m_tileSlot[index] = NO_SLOT;
+	m_slotTile[slot] = VIRTUAL_TILE_NONE;
+	// The last level is never evicted, so there is always a parent.
+	Uncover(tile, m_indirection[Index(Parent(tile))], TileLevel(tile));
+	++m_stats.evictions;
+	--m_stats.resident_tiles;
+}
+
+// Points the tile, and the descendants that fall back to a coarser tile
+// than level, at entry.
+void VirtualTexture::Cover(uint32_t tile, uint32_t entry, uint32_t level) {
+	uint32_t const tile_level = TileLevel(tile);
+	m_indirection[Index(tile)] = entry;
+	m_dirtyLevels |= 1u << tile_level;
+	if (tile_level == 0) {
+		return;
+	}
+	const level_t& parent = m_levels[tile_level];
+	const level_t& child = m_levels[tile_level - 1];
+	uint32_t x0, x1, y0, y1;
+	ChildSpan(TileX(tile), parent.tiles_x, child.tiles_x, x0, x1);
+	ChildSpan(TileY(tile), parent.tiles_y, child.tiles_y, y0, y1);
+	for (uint32_t y = y0; y <= y1; ++y) {
+		for (uint32_t x = x0; x <= x1; ++x) {
+			uint32_t const current = m_indirection[child.first + y * child.tiles_x + x];
+			if (!IndirectionValid(current) || IndirectionLevel(current) > level) {
+				Cover(PackTileId(tile_level - 1, x, y), entry, level);
+			}
+		}
+	}
+}
+
+// Points the tile, and the descendants that fell back to it at level, at
+// entry instead.
+void VirtualTexture::Uncover(uint32_t tile, uint32_t entry, uint32_t level) {
+	uint32_t const tile_level = TileLevel(tile);
+	m_indirection[Index(tile)] = entry;
+	m_dirtyLevels |= 1u << tile_level;
+	if (tile_level == 0) {
+		return;
+	}
+	const level_t& parent = m_levels[tile_level];
+	const level_t& child = m_levels[tile_level - 1];
+	uint32_t x0, x1, y0, y1;
+	ChildSpan(TileX(tile), parent.tiles_x, child.tiles_x, x0, x1);
+	ChildSpan(TileY(tile), parent.tiles_y, child.tiles_y, y0, y1);
+	for (uint32_t y = y0; y <= y1; ++y) {
+		for (uint32_t x = x0; x <= x1; ++x) {
+			uint32_t const current = m_indirection[child.first + y * child.tiles_x + x];
+			if (IndirectionValid(current) && IndirectionLevel(current) == level) {
+				Uncover(PackTileId(tile_level - 1, x, y), entry, level);
+			}
+		}
+	}
+}
+
+void VirtualTexture::LinkFront(uint32_t slot) {
+	m_lruPrev[slot] = NO_SLOT;
+	m_lruNext[slot] = m_lruHead;
+	if (m_lruHead != NO_SLOT) {
+		m_lruPrev[m_lruHead] = slot;
+	}
+	else {
+		m_lruTail = slot;
+	}
+	m_lruHead = slot;
+}
+
+void VirtualTexture::Unlink(uint32_t slot) {
+	uint32_t const prev = m_lruPrev[slot], next = m_lruNext[slot];
+	if (prev != NO_SLOT) {
+		m_lruNext[prev] = next;
+	}
+	else {
+		m_lruHead = next;
+	}
+	if (next != NO_SLOT) {
+		m_lruPrev[next] = prev;
+	}
+	else {
+		m_lruTail = prev;
+	}
+	m_lruPrev[slot] = NO_SLOT;
+	m_lruNext[slot] = NO_SLOT;
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Edge of a virtual texture tile in texels. Every mip level is cut into
+// tiles of this size down to the first level that fits in one.
+uint32_t const VIRTUAL_TILE_SIZE = 128;
+
+// Feedback entries name a tile as level:4 | y:14 | x:14 bits. The feedback
+// pass writes, for each pixel it samples, the tile holding its texture
+// coordinate at the level the hardware would pick, or VIRTUAL_TILE_NONE.
+uint32_t const VIRTUAL_TILE_NONE = 0xFFFFFFFF;
+
+inline uint32_t PackTileId(uint32_t level, uint32_t x, uint32_t y) { return level << 28 | y << 14 | x; }
+inline uint32_t TileLevel(uint32_t tile) { return tile >> 28; }
+inline uint32_t TileX(uint32_t tile) { return tile & 0x3FFF; }
+inline uint32_t TileY(uint32_t tile) { return tile >> 14 & 0x3FFF; }
+
+// Indirection entries are RGBA8 texels: the column and row of the physical
+// tile, the level of the virtual tile held there, and 255 once any tile
+// covers the entry (0 before). A tile that is not resident points at its
+// finest resident ancestor, so the shader scales its coordinate to that
+// level and samples coarser texels instead.
+inline uint32_t IndirectionColumn(uint32_t entry) { return entry & 0xFF; }
+inline uint32_t IndirectionRow(uint32_t entry) { return entry >> 8 & 0xFF; }
+inline uint32_t IndirectionLevel(uint32_t entry) { return entry >> 16 & 0xFF; }
+inline bool IndirectionValid(uint32_t entry) { return (entry >> 24) != 0; }
+
+// Levels of a width x height virtual texture, the last a single tile.
+uint32_t VirtualTextureLevelCount(uint32_t width, uint32_t height);
+
+// Fills physical tiles, e.g. on a copy queue. Every call is made from
+// VirtualTexture::Update on the caller's thread.
+class VirtualTextureSink
+{
+public:
+    virtual ~VirtualTextureSink() = default;
+    // Records the copy of a tile's texels into a slot of the physical
+    // cache, at column slot % cache_columns and row slot / cache_columns.
+    // No indirection entry points at the slot any longer, but frames
+    // recorded before this Update may still sample it.
+    virtual void RecordTileUpload(uint32_t tile, uint32_t slot) = 0;
+    // Submits everything recorded since the last call and returns the fence
+    // value that signals its completion.
+    virtual uint64_t SubmitTileUploads() = 0;
+};
+
+struct virtual_texture_config_t {
+    // The physical cache is a grid of tiles, at most 256 x 256.
+    uint32_t cache_columns = 32;
+    uint32_t cache_rows = 32;
+    unsigned max_uploads_per_update = 16;
+    unsigned max_uploads_in_flight = 64;
+};
+
+struct virtual_texture_stats_t {
+    size_t feedback_entries;
+    size_t invalid_feedback;        // out of range, ignored
+    size_t requested_tiles;         // by the last Update, ancestors included
+    size_t missing_tiles;           // of those, neither resident nor on the way
+    size_t resident_tiles;
+    size_t pending_tiles;
+    size_t uploads;
+    size_t evictions;
+    size_t deferred;                // missing tiles left for a later Update
+};
+
+// Keeps the tiles the feedback asks for in a fixed physical cache and the
+// indirection table that maps virtual tiles onto it. Each frame's feedback
+// is reduced to the distinct tiles requested, with their ancestors, which
+// are the fallback while a tile loads. Missing tiles load coarse to fine,
+// the most requested first, into free slots or the least recently used
+// one that no request of this frame holds. Tiles become resident, and the
+// indirection table points at them, once the sink's fence passes. The
+// single tile of the last level is never evicted.
+class VirtualTexture
+{
+public:
+    VirtualTexture(uint32_t width, uint32_t height, VirtualTextureSink& sink, const virtual_texture_config_t& config = {});
+    VirtualTexture(const VirtualTexture&) = delete;
+    VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+    uint32_t LevelCount() const { return static_cast<uint32_t>(m_levels.size()); }
+    uint32_t TilesX(uint32_t level) const { return m_levels[level].tiles_x; }
+    uint32_t TilesY(uint32_t level) const { return m_levels[level].tiles_y; }
+    uint32_t SlotCount() const { return static_cast<uint32_t>(m_slotTile.size()); }
+
+    // Adds feedback entries to the requests of the next Update; may be
+    // called several times a frame, e.g. once per readback chunk.
+    void AddFeedback(const uint32_t* entries, size_t count);
+
+    // Once per frame. completed_fence is the last fence value the sink's
+    // queue has reached.
+    void Update(uint64_t completed_fence);
+
+    // TilesX * TilesY entries of a level, row by row.
+    const uint32_t* Indirection(uint32_t level) const { return m_indirection.data() + m_levels[level].first; }
+    uint32_t IndirectionEntry(uint32_t tile) const { return m_indirection[Index(tile)]; }
+    // Bit l is set once level l's indirection changed; cleared by the caller
+    // after uploading them.
+    uint32_t DirtyLevels() const { return m_dirtyLevels; }
+    void ClearDirtyLevels() { m_dirtyLevels = 0; }
+
+    bool IsResident(uint32_t tile) const { return m_state[Index(tile)] == tile_state_t::resident; }
+    // The tile a slot holds, or VIRTUAL_TILE_NONE.
+    uint32_t SlotTile(uint32_t slot) const { return m_slotTile[slot]; }
+    const virtual_texture_stats_t& Stats() const { return m_stats; }
+
+private:
+    enum class tile_state_t : uint8_t {
+        absent,
+        pending,
+        resident,
+    };
+    struct level_t {
+        uint32_t tiles_x;
+        uint32_t tiles_y;
+        uint32_t first;             // of its tiles in the per-tile arrays
+    };
+    struct request_t {
+        uint32_t tile;
+        uint32_t count;             // feedback entries, descendants' included
+    };
+    struct pending_t {
+        uint32_t tile;
+        uint32_t slot;
+        uint64_t fence;
+    };
+
+    uint32_t Index(uint32_t tile) const { return m_levels[TileLevel(tile)].first + TileY(tile) * m_levels[TileLevel(tile)].tiles_x + TileX(tile); }
+    uint32_t Parent(uint32_t tile) const;
+    void Request(uint32_t tile, uint32_t count);
+    void Evict(uint32_t slot);
+    void Cover(uint32_t tile, uint32_t entry, uint32_t level);
+    void Uncover(uint32_t tile, uint32_t entry, uint32_t level);
+    void LinkFront(uint32_t slot);
+    void Unlink(uint32_t slot);
+
+    VirtualTextureSink& m_sink;
+    virtual_texture_config_t m_config;
+    std::vector<level_t> m_levels;
+
+    // Per tile.
+    std::vector<tile_state_t> m_state;
+    std::vector<uint32_t> m_tileSlot;
+    std::vector<uint32_t> m_requestFrame;
+    std::vector<uint32_t> m_requestIndex;
+    std::vector<uint32_t> m_indirection;
+    uint32_t m_dirtyLevels = 0;
+
+    // Per slot. The LRU list runs from m_lruHead, most recently requested,
+    // to m_lruTail; free, pending and pinned slots are not on it.
+    std::vector<uint32_t> m_slotTile;
+    std::vector<uint32_t> m_slotFrame;
+    std::vector<uint32_t> m_lruPrev;
+    std::vector<uint32_t> m_lruNext;
+    uint32_t m_lruHead;
+    uint32_t m_lruTail;
+    std::vector<uint32_t> m_freeSlots;
+
+    uint32_t m_frame = 1;
+    std::vector<request_t> m_requests;
+    std::vector<request_t> m_missing;
+    std::deque<pending_t> m_pending;    // in submission order
+    virtual_texture_stats_t m_stats;
+};
@@ -0,0 +1,253 @@
+#include "ReportTools.h"
+#include "VirtualTexture.h"
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <set>
+#include <utility>
+
+namespace {
+	// Stands in for the renderer's copy queue filling the physical cache:
+	// each batch of tiles completes a fixed latency after its submission at
+	// the earliest, and batches copy one after another at a fixed rate. Holds what every slot contains, which
+	// is what the frames sample through the indirection table.
+	class SimulatedTileQueue : public VirtualTextureSink
+	{
+	public:
+		SimulatedTileQueue(uint32_t slot_count, double latency_frames, double tiles_per_frame)
+			: m_slots(slot_count, VIRTUAL_TILE_NONE), m_latency(latency_frames), m_rate(tiles_per_frame) {
+		}
+
+		void RecordTileUpload(uint32_t tile, uint32_t slot) override {
+			if (slot >= m_slots.size() || !m_queued.insert(tile).second) {
+				++errors;
+				return;
+			}
+			// The slot's old tile is overwritten from here on.
+			m_slots[slot] = VIRTUAL_TILE_NONE;
+			m_batch.push_back({ tile, slot });
+		}
+
+		uint64_t SubmitTileUploads() override {
+			++m_fence;
+			m_lastDone = (std::max)(m_now + m_latency, m_lastDone + m_batch.size() / m_rate);
+			m_done.push_back({ m_fence, m_lastDone, std::move(m_batch) });
+			m_batch.clear();
+			return m_fence;
+		}
+
+		// Moves the clock to frame, fills the slots of the batches done by
+		// then and returns the last fence reached.
+		uint64_t Advance(double frame) {
+			m_now = frame;
+			while (!m_done.empty() && m_done.front().time <= frame) {
+				for (const std::pair<uint32_t, uint32_t>& upload : m_done.front().uploads) {
+					m_slots[upload.second] = upload.first;
+					m_queued.erase(upload.first);
+				}
+				m_completed = m_done.front().fence;
+				m_done.pop_front();
+			}
+			return m_completed;
+		}
+
+		uint32_t Slot(uint32_t slot) const { return m_slots[slot]; }
+
+		size_t errors = 0;
+
+	private:
+		struct batch_t {
+			uint64_t fence;
+			double time;
+			std::vector<std::pair<uint32_t, uint32_t>> uploads;
+		};
+
+		std::vector<uint32_t> m_slots;
+		std::set<uint32_t> m_queued;
+		std::vector<std::pair<uint32_t, uint32_t>> m_batch;
+		double m_latency;
+		double m_rate;
+		uint64_t m_fence = 0;
+		uint64_t m_completed = 0;
+		double m_now = 0.0;
+		double m_lastDone = 0.0;
+		std::deque<batch_t> m_done;
+	};
+
+	// Whether the tile's indirection entry points at its finest resident
+	// ancestor, or itself, and the slot there holds that tile.
+	bool IndirectionMatches(const VirtualTexture& texture, const SimulatedTileQueue& queue, uint32_t columns, uint32_t tile) {
+		uint32_t const entry = texture.IndirectionEntry(tile);
+		uint32_t covering = tile;
+		while (!texture.IsResident(covering) && TileLevel(covering) + 1 < texture.LevelCount()) {
+			uint32_t const level = TileLevel(covering) + 1;
+			covering = PackTileId(
+				level, (std::min)(TileX(covering) / 2, texture.TilesX(level) - 1), (std::min)(TileY(covering) / 2, texture.TilesY(level) - 1)
+			);
+		}
+		if (!texture.IsResident(covering)) {
+			return !IndirectionValid(entry);
+		}
+		return IndirectionValid(entry) && IndirectionLevel(entry) == TileLevel(covering) &&
+			queue.Slot(IndirectionRow(entry) * columns + IndirectionColumn(entry)) == covering;
+	}
+}
+
+// Walks a camera over a ground plane carrying a square virtual texture
+// and feeds the cache the tiles a 1/8-resolution feedback buffer would
+// request, with the mip level the hardware picks at 1920x1080. The
+// camera jumps elsewhere every 15 s. Checks the indirection entries of
+// every requested tile each frame, and of every tile now and then,
+// against the slots of a simulated copy queue.
+//   --virtual-texture-report [vt.txt] [texels] [cache tiles] [frames] [latency frames] [tiles per frame]
+int VirtualTextureReportTool(const std::vector<std::string>& args) {
+	uint32_t const texels = args.size() > 2 ? static_cast<uint32_t>(std::stoul(args[2])) : 32768;
+	uint32_t const cache_tiles = args.size() > 3 ? static_cast<uint32_t>(std::stoul(args[3])) : 1024;
+	size_t const frames = args.size() > 4 ? std::stoul(args[4]) : 3600;
+	double const latency = args.size() > 5 ? std::stod(args[5]) : 2.0;
+	double const tiles_per_frame = args.size() > 6 ? std::stod(args[6]) : 16.0;
+	if (texels == 0 || cache_tiles == 0 || tiles_per_frame <= 0.0) {
+		return 1;
+	}
+
+	virtual_texture_config_t config;
+	config.cache_columns = (std::min)(static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(cache_tiles)))), 256u);
+	config.cache_rows = (cache_tiles + config.cache_columns - 1) / config.cache_columns;
+	SimulatedTileQueue queue(config.cache_columns * config.cache_rows, latency, tiles_per_frame);
+	VirtualTexture texture(texels, texels, queue, config);
+	uint32_t const last_level = texture.LevelCount() - 1;
+
+	// 16 texels a meter, seen from 2 m up, 20 degrees down, with a 60
+	// degree vertical field of view.
+	uint32_t const feedback_width = 240, feedback_height = 135;
+	float const screen_width = 1920.0f, screen_height = 1080.0f;
+	float const texels_per_meter = 16.0f;
+	float const world = texels / texels_per_meter;
+	float const eye_height = 2.0f, pitch = 0.35f, far_distance = 1000.0f;
+	float const tan_half_y = std::tan(0.5236f), tan_half_x = tan_half_y * screen_width / screen_height;
+
+	std::vector<uint32_t> feedback(feedback_width * feedback_height);
+	size_t samples = 0, exact = 0, no_data = 0, levels_short = 0, checked = 0, mismatches = 0, requested = 0;
+	double feedback_seconds = 0.0, update_seconds = 0.0;
+	uint32_t noise = 1;
+	float jump[2] = { 0.0f, 0.0f };
+	for (size_t frame = 0; frame < frames; ++frame) {
+		if (frame % 900 == 0) {
+			noise = noise * 1664525u + 1013904223u;
+			jump[0] = static_cast<float>(noise >> 8 & 0xFFF) / 4096.0f * world * 0.5f;
+			noise = noise * 1664525u + 1013904223u;
+			jump[1] = static_cast<float>(noise >> 8 & 0xFFF) / 4096.0f * world * 0.5f;
+		}
+		// A wandering walk at about 10 m/s, facing where it goes.
+		float const t = static_cast<float>(frame) / 60.0f;
+		float const radius = world * 0.2f;
+		float const camera[2] = {
+			world * 0.25f + jump[0] + radius * std::sin(t * 0.05f),
+			world * 0.25f + jump[1] + radius * std::sin(t * 0.035f + 1.0f)
+		};
+		float const yaw = std::atan2(0.7f * std::cos(t * 0.035f + 1.0f), std::cos(t * 0.05f));
+		float const forward[3] = { std::cos(yaw) * std::cos(pitch), -std::sin(pitch), std::sin(yaw) * std::cos(pitch) };
+		float const right[3] = { std::sin(yaw), 0.0f, -std::cos(yaw) };
+		float const up[3] = { std::cos(yaw) * std::sin(pitch), std::cos(pitch), std::sin(yaw) * std::sin(pitch) };
+
+		// Texel hit by a ray through the screen at ndc (x, y), if any.
+		auto hit = [&](float x, float y, float texel[2]) {
+			float dir[3];
+			for (int k = 0; k < 3; ++k) {
+				dir[k] = forward[k] + right[k] * x * tan_half_x + up[k] * y * tan_half_y;
+			}
+			if (dir[1] > -1e-4f) {
+				return false;
+			}
+			float const distance = eye_height / -dir[1];
+			if (distance > far_distance) {
+				return false;
+			}
+			texel[0] = (camera[0] + dir[0] * distance) * texels_per_meter;
+			texel[1] = (camera[1] + dir[2] * distance) * texels_per_meter;
+			return true;
+		};
+		for (uint32_t j = 0; j < feedback_height; ++j) {
+			for (uint32_t i = 0; i < feedback_width; ++i) {
+				float const x = 2.0f * (i + 0.5f) / feedback_width - 1.0f, y = 1.0f - 2.0f * (j + 0.5f) / feedback_height;
+				float texel[2], texel_x[2], texel_y[2];
+				uint32_t& entry = feedback[j * feedback_width + i];
+				entry = VIRTUAL_TILE_NONE;
+				if (!hit(x, y, texel) || !hit(x + 2.0f / screen_width, y, texel_x) || !hit(x, y - 2.0f / screen_height, texel_y) ||
+					texel[0] < 0.0f || texel[1] < 0.0f || texel[0] >= texels || texel[1] >= texels) {
+					continue;
+				}
+				float const du = std::hypot(texel_x[0] - texel[0], texel_x[1] - texel[1]);
+				float const dv = std::hypot(texel_y[0] - texel[0], texel_y[1] - texel[1]);
+				float const lod = std::log2((std::max)((std::max)(du, dv), 1e-6f));
+				uint32_t const level = static_cast<uint32_t>(std::clamp(std::floor(lod), 0.0f, static_cast<float>(last_level)));
+				uint32_t const tx = (std::min)(static_cast<uint32_t>(texel[0]) >> level, (std::max)(texels >> level, 1u) - 1) / VIRTUAL_TILE_SIZE;
+				uint32_t const ty = (std::min)(static_cast<uint32_t>(texel[1]) >> level, (std::max)(texels >> level, 1u) - 1) / VIRTUAL_TILE_SIZE;
+				entry = PackTileId(level, tx, ty);
+			}
+		}
+
+		uint64_t const completed = queue.Advance(static_cast<double>(frame));
+		auto const start = std::chrono::steady_clock::now();
+		texture.AddFeedback(feedback.data(), feedback.size());
+		auto const aggregated = std::chrono::steady_clock::now();
+		texture.Update(completed);
+		auto const end = std::chrono::steady_clock::now();
+		feedback_seconds += std::chrono::duration<double>(aggregated - start).count();
+		update_seconds += std::chrono::duration<double>(end - aggregated).count();
+		texture.ClearDirtyLevels();
+		requested += texture.Stats().requested_tiles;
+
+		// What this frame samples through the indirection table.
+		for (uint32_t tile : feedback) {
+			if (tile == VIRTUAL_TILE_NONE) {
+				continue;
+			}
+			++samples;
+			uint32_t const entry = texture.IndirectionEntry(tile);
+			if (!IndirectionValid(entry)) {
+				++no_data;
+			}
+			else {
+				exact += IndirectionLevel(entry) == TileLevel(tile);
+				levels_short += IndirectionLevel(entry) - TileLevel(tile);
+			}
+			++checked;
+			mismatches += !IndirectionMatches(texture, queue, config.cache_columns, tile);
+		}
+		if (frame % 64 == 63) {
+			for (uint32_t level = 0; level <= last_level; ++level) {
+				for (uint32_t y = 0; y < texture.TilesY(level); ++y) {
+					for (uint32_t x = 0; x < texture.TilesX(level); ++x) {
+						++checked;
+						mismatches += !IndirectionMatches(texture, queue, config.cache_columns, PackTileId(level, x, y));
+					}
+				}
+			}
+		}
+	}
+	const virtual_texture_stats_t& stats = texture.Stats();
+
+	FILE* out = OpenReport(args, "vt.txt");
+	if (!out) {
+		return 1;
+	}
+	size_t tile_count = 0;
+	for (uint32_t level = 0; level <= last_level; ++level) {
+		tile_count += size_t(texture.TilesX(level)) * texture.TilesY(level);
+	}
+	double const tile_bytes = VIRTUAL_TILE_SIZE * VIRTUAL_TILE_SIZE;   // BC7
+	fprintf(out, "%u x %u texels, %u levels, %zu tiles (%.1f MB as BC7); cache %u tiles (%.1f MB)\n",
+		texels, texels, texture.LevelCount(), tile_count, tile_count * tile_bytes / 1048576.0,
+		texture.SlotCount(), texture.SlotCount() * tile_bytes / 1048576.0);
+	fprintf(out, "%zu frames, copy latency %.1f frames, %.1f tiles per frame\n", frames, latency, tiles_per_frame);
+	fprintf(out, "feedback %.0f entries, %.0f distinct tiles with ancestors per frame; %.2f ns per entry, update %.1f us per frame\n",
+		static_cast<double>(stats.feedback_entries) / frames, static_cast<double>(requested) / frames, feedback_seconds * 1e9 / (std::max)(stats.feedback_entries, size_t(1)),
+		update_seconds * 1e6 / frames);
+	fprintf(out, "uploads %zu, evictions %zu, deferred %zu, resident %zu tiles, invalid feedback %zu\n",
+		stats.uploads, stats.evictions, stats.deferred, stats.resident_tiles, stats.invalid_feedback);
+	fprintf(out, "samples %zu: %.1f%% at the requested level, %.3f levels coarser on average, %zu without data\n",
+		samples, samples ? 100.0 * exact / samples : 100.0, samples > no_data ? static_cast<double>(levels_short) / (samples - no_data) : 0.0, no_data);
+	fprintf(out, "indirection checks %zu, mismatches %zu; queue errors %zu\n", checked, mismatches, queue.errors);
+	return CloseReport(out, mismatches + queue.errors);
+}
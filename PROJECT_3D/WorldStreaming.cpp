@@ -0,0 +1,285 @@
+#include "WorldStreaming.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+	uint64_t CellKey(cell_coord_t cell) {
+		return static_cast<uint64_t>(static_cast<uint32_t>(cell.x)) << 32 | static_cast<uint32_t>(cell.z);
+	}
+
+	bool SameCell(cell_coord_t a, cell_coord_t b) {
+		return a.x == b.x && a.z == b.z;
+	}
+
+	size_t MeshBytes(const indexed_mesh_t& mesh) {
+		return mesh.vertices.size() * sizeof(vertex_t) + mesh.indices.size() * sizeof(uint32_t);
+	}
+
+	cell_coord_t CellOf(float x, float z, float cell_size) {
+		return {
+			static_cast<int32_t>(std::floor(x / cell_size)),
+			static_cast<int32_t>(std::floor(z / cell_size))
+		};
+	}
+}
+
+WorldStreamer::WorldStreamer(CellSource& source, StreamingSink& sink, const streaming_config_t& config)
+	: m_source(source), m_sink(sink), m_config(config) {
+	m_cameraCell = { 0, 0 };
+	m_hasCamera = false;
+	m_position[0] = m_position[1] = 0.0f;
+	m_forward[0] = m_forward[1] = 0.0f;
+	m_stats = {};
+	m_loading = false;
+	m_loadingKey = 0;
+	m_loadCount = 0;
+	m_stop = false;
+	m_worker = std::thread(&WorldStreamer::WorkerLoop, this);
+}
+
+WorldStreamer::~WorldStreamer() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	m_worker.join();
+}
+
+cell_coord_t WorldStreamer::CellAt(const float position[3]) const {
+	return CellOf(position[0], position[2], m_config.cell_size);
+}
+
+// Lower loads first: distance to the cell center, shortened for cells in
+// front of the camera.
+float WorldStreamer::Priority(cell_coord_t cell, float& distance) const {
+	float const dx = (cell.x + 0.5f) * m_config.cell_size - m_position[0];
+	float const dz = (cell.z + 0.5f) * m_config.cell_size - m_position[1];
+	distance = std::sqrt(dx * dx + dz * dz);
+	if (distance <= 0.0f) {
+		return 0.0f;
+	}
+	float const facing = (dx * m_forward[0] + dz * m_forward[1]) / distance;
+	return distance * (1.0f - m_config.view_weight * std::max(facing, 0.0f));
+}
+
+void WorldStreamer::Evict(uint64_t key) {
+	auto const found = m_resident.find(key);
+	if (found == m_resident.end()) {
+		return;
+	}
+	if (found->second.uploaded) {
+		m_sink.EvictCell(found->second.cell);
+		m_stats.resident_bytes -= found->second.bytes;
+		--m_stats.resident_cells;
+		++m_stats.evictions;
+	}
+	m_resident.erase(found);
+}
+
+void WorldStreamer::Update(const float position[3], const float forward[3]) {
+	m_position[0] = position[0];
+	m_position[1] = position[2];
+	float const forward_length = std::sqrt(forward[0] * forward[0] + forward[2] * forward[2]);
+	m_forward[0] = forward_length > 0.0f ? forward[0] / forward_length : 0.0f;
+	m_forward[1] = forward_length > 0.0f ? forward[2] / forward_length : 0.0f;
+	cell_coord_t const camera = CellAt(position);
+	if (!m_hasCamera || !SameCell(camera, m_cameraCell)) {
+		// Cells turned away for lack of budget get another chance.
+		m_rejected.clear();
+		m_cameraCell = camera;
+		m_hasCamera = true;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (loaded_cell_t& loaded : m_completed) {
+			m_ready.push_back(std::move(loaded));
+		}
+		m_completed.clear();
+	}
+
+	// Hand over finished loads, most important first, a few per frame.
+	std::vector<std::pair<float, size_t>> order;
+	for (size_t i = 0; i < m_ready.size(); ++i) {
+		float distance;
+		order.emplace_back(Priority(m_ready[i].cell, distance), i);
+	}
+	std::sort(order.begin(), order.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+	std::vector<loaded_cell_t> deferred;
+	unsigned uploads = 0;
+	for (const auto& entry : order) {
+		loaded_cell_t& loaded = m_ready[entry.second];
+		uint64_t const key = CellKey(loaded.cell);
+		float distance;
+		float const priority = Priority(loaded.cell, distance);
+		if ((distance > m_config.evict_radius && !SameCell(loaded.cell, camera)) || m_resident.count(key)) {
+			++m_stats.discarded;
+			continue;
+		}
+		if (!loaded.has_geometry) {
+			m_resident[key] = { loaded.cell, 0, false };
+			continue;
+		}
+		if (uploads == m_config.max_uploads_per_update) {
+			deferred.push_back(std::move(loaded));
+			continue;
+		}
+
+		// Make room by evicting cells that matter less than this one.
+		size_t const bytes = MeshBytes(loaded.mesh);
+		while (m_stats.resident_bytes + bytes > m_config.memory_budget) {
+			uint64_t victim = 0;
+			float victim_priority = priority;
+			for (const auto& resident : m_resident) {
+				float resident_distance;
+				float const resident_priority = Priority(resident.second.cell, resident_distance);
+				if (resident.second.uploaded && resident_priority > victim_priority) {
+					victim = resident.first;
+					victim_priority = resident_priority;
+				}
+			}
+			if (victim_priority <= priority) {
+				break;
+			}
+			Evict(victim);
+		}
+		if (m_stats.resident_bytes + bytes > m_config.memory_budget) {
+			m_rejected.insert(key);
+			++m_stats.discarded;
+			continue;
+		}
+
+		m_sink.UploadCell(loaded.cell, loaded.mesh);
+		m_resident[key] = { loaded.cell, bytes, true };
+		m_stats.resident_bytes += bytes;
+		++m_stats.resident_cells;
+		++m_stats.uploads;
+		++uploads;
+	}
+	m_ready.swap(deferred);
+
+	// Only cells past the evict radius leave; the gap to the load radius
+	// keeps cells near the boundary from reloading every few frames.
+	std::vector<uint64_t> far_cells;
+	for (const auto& resident : m_resident) {
+		float distance;
+		Priority(resident.second.cell, distance);
+		if (distance > m_config.evict_radius && !SameCell(resident.second.cell, camera)) {
+			far_cells.push_back(resident.first);
+		}
+	}
+	for (uint64_t key : far_cells) {
+		Evict(key);
+	}
+
+	// Everything within the load radius that is not resident or on its way,
+	// best first. The camera's own cell is always wanted.
+	std::vector<std::pair<float, cell_coord_t>> wanted;
+	int32_t const reach = static_cast<int32_t>(std::ceil(m_config.load_radius / m_config.cell_size));
+	for (int32_t dz = -reach; dz <= reach; ++dz) {
+		for (int32_t dx = -reach; dx <= reach; ++dx) {
+			cell_coord_t const cell = { camera.x + dx, camera.z + dz };
+			uint64_t const key = CellKey(cell);
+			float distance;
+			float const priority = Priority(cell, distance);
+			if ((distance > m_config.load_radius && (dx != 0 || dz != 0)) ||
+				m_resident.count(key) || m_rejected.count(key)) {
+				continue;
+			}
+			bool const ready = std::any_of(m_ready.begin(), m_ready.end(), [&](const loaded_cell_t& loaded) {
+				return SameCell(loaded.cell, cell);
+			});
+			if (!ready) {
+				wanted.emplace_back(priority, cell);
+			}
+		}
+	}
+	std::sort(wanted.begin(), wanted.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+	// Replacing the queue cancels requests for cells no longer wanted.
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.clear();
+		for (const auto& entry : wanted) {
+			uint64_t const key = CellKey(entry.second);
+			bool const in_flight = (m_loading && m_loadingKey == key) ||
+				std::any_of(m_completed.begin(), m_completed.end(), [&](const loaded_cell_t& loaded) {
+					return SameCell(loaded.cell, entry.second);
+				});
+			if (!in_flight) {
+				m_queue.push_back(entry.second);
+			}
+		}
+	}
+	m_wake.notify_one();
+}
+
+void WorldStreamer::WaitIdle() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this] { return m_queue.empty() && !m_loading; });
+}
+
+streaming_stats_t WorldStreamer::Stats() const {
+	streaming_stats_t stats = m_stats;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	stats.pending_loads = m_queue.size() + (m_loading ? 1 : 0) + m_completed.size() + m_ready.size();
+	stats.loads = m_loadCount;
+	return stats;
+}
+
+void WorldStreamer::WorkerLoop() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true) {
+		m_wake.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+		if (m_stop) {
+			return;
+		}
+		loaded_cell_t loaded = { m_queue.front(), false, {} };
+		m_queue.pop_front();
+		m_loading = true;
+		m_loadingKey = CellKey(loaded.cell);
+		lock.unlock();
+
+		// A cell that fails to load is treated as empty rather than retried
+		// every frame.
+		try {
+			loaded.has_geometry = m_source.LoadCell(loaded.cell, loaded.mesh);
+		}
+		catch (...) {
+			loaded.has_geometry = false;
+			loaded.mesh = {};
+		}
+
+		lock.lock();
+		m_loading = false;
+		m_completed.push_back(std::move(loaded));
+		++m_loadCount;
+		if (m_queue.empty()) {
+			m_idle.notify_all();
+		}
+	}
+}
+
+GridPartitionSource::GridPartitionSource(const vertex_t* vertices, size_t count, float cell_size)
+	: m_cellSize(cell_size) {
+	for (size_t t = 0; t + 2 < count; t += 3) {
+		float x = 0.0f, z = 0.0f;
+		for (int c = 0; c < 3; ++c) {
+			x += vertices[t + c].position[0];
+			z += vertices[t + c].position[2];
+		}
+		std::vector<vertex_t>& cell = m_cells[CellKey(CellOf(x / 3.0f, z / 3.0f, m_cellSize))];
+		cell.insert(cell.end(), vertices + t, vertices + t + 3);
+	}
+}
+
+bool GridPartitionSource::LoadCell(cell_coord_t cell, indexed_mesh_t& mesh) {
+	auto const found = m_cells.find(CellKey(cell));
+	if (found == m_cells.end()) {
+		return false;
+	}
+	mesh = WeldVertices(found->second.data(), found->second.size());
+	return true;
+}
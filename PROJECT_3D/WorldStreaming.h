@@ -0,0 +1,142 @@
+#pragma once
+
+#include "MeshWeld.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Column of the world partition: cells are square in x/z and unbounded in y.
+struct cell_coord_t {
+    int32_t x;
+    int32_t z;
+};
+
+// Supplies cell geometry. LoadCell runs on the streaming thread and must not
+// touch renderer state; it returns false for cells with nothing in them.
+class CellSource
+{
+public:
+    virtual ~CellSource() = default;
+    virtual bool LoadCell(cell_coord_t cell, indexed_mesh_t& mesh) = 0;
+};
+
+// Receives cells on the thread that calls WorldStreamer::Update, which is
+// where the renderer copies them into GPU buffers or releases them.
+class StreamingSink
+{
+public:
+    virtual ~StreamingSink() = default;
+    virtual void UploadCell(cell_coord_t cell, const indexed_mesh_t& mesh) = 0;
+    virtual void EvictCell(cell_coord_t cell) = 0;
+};
+
+struct streaming_config_t {
+    float cell_size = 16.0f;
+    // Cells whose center is this close in x/z are loaded.
+    float load_radius = 48.0f;
+    // Loaded cells stay until they are this far, so walking along a cell
+    // border does not reload them.
+    float evict_radius = 64.0f;
+    // Cells straight ahead are ordered as if this fraction closer.
+    float view_weight = 0.5f;
+    // Bytes of vertices and indices resident in the sink.
+    size_t memory_budget = 64u << 20;
+    unsigned max_uploads_per_update = 4;
+};
+
+struct streaming_stats_t {
+    size_t resident_cells;
+    size_t resident_bytes;
+    size_t pending_loads;
+    size_t loads;
+    size_t uploads;
+    size_t evictions;
+    size_t discarded;           // loaded but no longer wanted or over budget
+};
+
+// Loads cells around the camera on a background thread and hands them to a
+// sink. Requests are re-sorted every Update, so cells the camera moved away
+// from are dropped before they are loaded and cells ahead come first. When
+// the budget is full, a new cell replaces resident cells further away than
+// itself, or is discarded until the camera enters another cell.
+class WorldStreamer
+{
+public:
+    WorldStreamer(CellSource& source, StreamingSink& sink, const streaming_config_t& config = {});
+    ~WorldStreamer();
+    WorldStreamer(const WorldStreamer&) = delete;
+    WorldStreamer& operator=(const WorldStreamer&) = delete;
+
+    // Once per frame on the render thread. forward only needs its x/z.
+    void Update(const float position[3], const float forward[3]);
+    // Blocks until the streaming thread has nothing left to load; the
+    // results are handed to the sink by the next Update.
+    void WaitIdle();
+
+    // Render thread only, like Update.
+    streaming_stats_t Stats() const;
+    cell_coord_t CellAt(const float position[3]) const;
+
+private:
+    struct loaded_cell_t {
+        cell_coord_t cell;
+        bool has_geometry;
+        indexed_mesh_t mesh;
+    };
+    struct resident_cell_t {
+        cell_coord_t cell;
+        size_t bytes;
+        bool uploaded;
+    };
+
+    void WorkerLoop();
+    float Priority(cell_coord_t cell, float& distance) const;
+    void Evict(uint64_t key);
+
+    CellSource& m_source;
+    StreamingSink& m_sink;
+    streaming_config_t m_config;
+
+    // Render thread only.
+    std::unordered_map<uint64_t, resident_cell_t> m_resident;
+    std::vector<loaded_cell_t> m_ready;
+    std::unordered_set<uint64_t> m_rejected;
+    cell_coord_t m_cameraCell;
+    bool m_hasCamera;
+    float m_position[2];
+    float m_forward[2];
+    streaming_stats_t m_stats;
+
+    // Shared with the streaming thread.
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::deque<cell_coord_t> m_queue;   // front is loaded first
+    bool m_loading;
+    uint64_t m_loadingKey;
+    std::vector<loaded_cell_t> m_completed;
+    size_t m_loadCount;
+    bool m_stop;
+    std::thread m_worker;
+};
+
+// In-memory source that splits a triangle list into cells by triangle
+// centroid, e.g. an imported mesh too large to draw at once. Each load
+// welds its cell's triangles.
+class GridPartitionSource : public CellSource
+{
+public:
+    GridPartitionSource(const vertex_t* vertices, size_t count, float cell_size);
+    bool LoadCell(cell_coord_t cell, indexed_mesh_t& mesh) override;
+    size_t CellCount() const { return m_cells.size(); }
+
+private:
+    float m_cellSize;
+    std::unordered_map<uint64_t, std::vector<vertex_t>> m_cells;
+};
@@ -0,0 +1,193 @@
+#include "ReportTools.h"
+#include "MeshImport.h"
+#include "MeshWeld.h"
+#include "SceneAsset.h"
+#include "WorldStreaming.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+
+namespace {
+	// Stands in for the renderer while streaming: checks that every upload
+	// and eviction matches the cells actually held, and keeps their sizes.
+	class CheckingSink : public StreamingSink
+	{
+	public:
+		void UploadCell(cell_coord_t cell, const indexed_mesh_t& mesh) override {
+			size_t const bytes = mesh.vertices.size() * sizeof(vertex_t) + mesh.indices.size() * sizeof(uint32_t);
+			if (!m_cells.emplace(std::make_pair(cell.x, cell.z), bytes).second || mesh.indices.empty()) {
+				++errors;
+				return;
+			}
+			m_bytes += bytes;
+			++uploads;
+		}
+		void EvictCell(cell_coord_t cell) override {
+			auto const found = m_cells.find({ cell.x, cell.z });
+			if (found == m_cells.end()) {
+				++errors;
+				return;
+			}
+			m_bytes -= found->second;
+			m_cells.erase(found);
+			++evictions;
+		}
+
+		bool Holds(int32_t x, int32_t z) const { return m_cells.count({ x, z }) != 0; }
+		size_t Bytes() const { return m_bytes; }
+		const std::map<std::pair<int32_t, int32_t>, size_t>& Cells() const { return m_cells; }
+
+		size_t errors = 0;
+		size_t uploads = 0;
+		size_t evictions = 0;
+
+	private:
+		std::map<std::pair<int32_t, int32_t>, size_t> m_cells;
+		size_t m_bytes = 0;
+	};
+}
+
+// Partitions the scene, or an imported mesh, into cells and walks the
+// camera around it, streaming as the renderer would, once with room for
+// every cell and once with a quarter of that. After every update, no
+// cell is held past the evict radius, the sink holds what the stats
+// say and the budget holds. At each stop on the walk, every cell in the
+// load radius is held when there is room. Swinging back and forth over
+// a cell border must not reload anything. Fails on any broken check.
+//   --stream-report [streaming.txt] [model.glb]
+int StreamReportTool(const std::vector<std::string>& args) {
+	std::vector<vertex_t> const vertices = args.size() > 2 ? ImportMesh(args[2].c_str()) : SceneSourceVertices();
+	if (vertices.empty()) {
+		return 1;
+	}
+	float lower[2] = { vertices[0].position[0], vertices[0].position[2] };
+	float upper[2] = { lower[0], lower[1] };
+	for (const vertex_t& vertex : vertices) {
+		lower[0] = (std::min)(lower[0], vertex.position[0]);
+		lower[1] = (std::min)(lower[1], vertex.position[2]);
+		upper[0] = (std::max)(upper[0], vertex.position[0]);
+		upper[1] = (std::max)(upper[1], vertex.position[2]);
+	}
+
+	// About 16 cells across the larger extent, three of them in reach.
+	float const extent = (std::max)((std::max)(upper[0] - lower[0], upper[1] - lower[1]), 1e-3f);
+	streaming_config_t config;
+	config.cell_size = extent / 16.0f;
+	config.load_radius = config.cell_size * 3.0f;
+	config.evict_radius = config.cell_size * 4.0f;
+
+	GridPartitionSource source(vertices.data(), vertices.size(), config.cell_size);
+	// Sizes of the cells as the sink receives them.
+	std::map<std::pair<int32_t, int32_t>, size_t> cell_bytes;
+	size_t total_bytes = 0;
+	{
+		int32_t const first[2] = {
+			static_cast<int32_t>(floorf(lower[0] / config.cell_size)), static_cast<int32_t>(floorf(lower[1] / config.cell_size))
+		};
+		int32_t const last[2] = {
+			static_cast<int32_t>(floorf(upper[0] / config.cell_size)), static_cast<int32_t>(floorf(upper[1] / config.cell_size))
+		};
+		for (int32_t z = first[1]; z <= last[1]; ++z) {
+			for (int32_t x = first[0]; x <= last[0]; ++x) {
+				indexed_mesh_t mesh;
+				if (source.LoadCell({ x, z }, mesh) && !mesh.indices.empty()) {
+					size_t const bytes = mesh.vertices.size() * sizeof(vertex_t) + mesh.indices.size() * sizeof(uint32_t);
+					cell_bytes[{ x, z }] = bytes;
+					total_bytes += bytes;
+				}
+			}
+		}
+	}
+
+	FILE* out = OpenReport(args, "streaming.txt");
+	if (!out) {
+		return 1;
+	}
+	fprintf(out, "%zu cells of %g, %zu with geometry, %zu bytes\n", source.CellCount(), config.cell_size, cell_bytes.size(), total_bytes);
+	size_t failures = 0;
+	size_t const FRAMES = 720;
+	size_t const STOP_EVERY = 60;
+	size_t const STOP_FRAMES = 8;
+	size_t const BORDER_FRAMES = 200;
+	float const center[2] = { (lower[0] + upper[0]) * 0.5f, (lower[1] + upper[1]) * 0.5f };
+	for (size_t budget : { total_bytes, total_bytes / 4 }) {
+		config.memory_budget = budget;
+		bool const ample = budget == total_bytes;
+		CheckingSink sink;
+		size_t peak_bytes = 0, far_cells = 0, accounting_errors = 0, missing = 0, stops = 0, border_changes = 0;
+		streaming_stats_t stats = {};
+		auto const start = std::chrono::steady_clock::now();
+		{
+			WorldStreamer streamer(source, sink, config);
+			auto const update = [&](const float* position, const float* forward) {
+				streamer.Update(position, forward);
+				streamer.WaitIdle();
+				stats = streamer.Stats();
+				peak_bytes = (std::max)(peak_bytes, sink.Bytes());
+				accounting_errors += sink.Bytes() != stats.resident_bytes || sink.Cells().size() != stats.resident_cells;
+				cell_coord_t const camera = streamer.CellAt(position);
+				for (const auto& cell : sink.Cells()) {
+					float const dx = (cell.first.first + 0.5f) * config.cell_size - position[0];
+					float const dz = (cell.first.second + 0.5f) * config.cell_size - position[2];
+					bool const own = cell.first.first == camera.x && cell.first.second == camera.z;
+					far_cells += !own && sqrtf(dx * dx + dz * dz) > config.evict_radius * 1.0001f;
+				}
+			};
+
+			for (size_t frame = 0; frame < FRAMES; ++frame) {
+				float const angle = 6.2831853f * frame / FRAMES;
+				float const position[3] = {
+					center[0] + extent * 0.3f * cosf(angle), 0.0f, center[1] + extent * 0.3f * sinf(angle)
+				};
+				float const forward[3] = { -sinf(angle), 0.0f, cosf(angle) };
+				update(position, forward);
+				if (frame % STOP_EVERY != 0 || !ample) {
+					continue;
+				}
+				// Standing still long enough for every upload to land.
+				for (size_t i = 0; i < STOP_FRAMES; ++i) {
+					update(position, forward);
+				}
+				++stops;
+				cell_coord_t const camera = streamer.CellAt(position);
+				for (const auto& cell : cell_bytes) {
+					float const dx = (cell.first.first + 0.5f) * config.cell_size - position[0];
+					float const dz = (cell.first.second + 0.5f) * config.cell_size - position[2];
+					bool const own = cell.first.first == camera.x && cell.first.second == camera.z;
+					bool const wanted = own || sqrtf(dx * dx + dz * dz) < config.load_radius * 0.9999f;
+					missing += wanted && !sink.Holds(cell.first.first, cell.first.second);
+				}
+			}
+
+			// Back and forth over the border of the middle cell, by less
+			// than the gap between the load and evict radii, after one
+			// round trip to settle.
+			float const border = floorf(center[0] / config.cell_size) * config.cell_size;
+			float const swing = 0.45f * (config.evict_radius - config.load_radius);
+			float const forward[3] = { 1.0f, 0.0f, 0.0f };
+			size_t changes_before = 0;
+			for (size_t frame = 0; frame < BORDER_FRAMES; ++frame) {
+				float const position[3] = { border + (frame % 2 ? swing : -swing), 0.0f, center[1] };
+				update(position, forward);
+				if (frame == 1 + STOP_FRAMES) {
+					changes_before = sink.uploads + sink.evictions;
+				}
+			}
+			border_changes = sink.uploads + sink.evictions - changes_before;
+		}
+		double const seconds = Seconds(start);
+
+		const char* name = ample ? "room for all" : "a quarter";
+		fprintf(out, "%s: %zu frames in %.2f s; loads %zu, uploads %zu, evictions %zu, discarded %zu\n",
+			name, FRAMES + stops * STOP_FRAMES + BORDER_FRAMES, seconds, stats.loads, stats.uploads, stats.evictions, stats.discarded);
+		fprintf(out, "%s: peak %zu of %zu budget; %zu sink errors, %zu accounting errors, %zu cells held past the evict radius\n",
+			name, peak_bytes, budget, sink.errors, accounting_errors, far_cells);
+		if (ample) {
+			fprintf(out, "%s: %zu cells in reach missing over %zu stops\n", name, missing, stops);
+		}
+		fprintf(out, "%s: %zu uploads and evictions swinging over a cell border\n", name, border_changes);
+		failures += sink.errors + accounting_errors + far_cells + missing + (peak_bytes > budget) + (ample ? border_changes : 0);
+	}
+	return CloseReport(out, failures);
+}